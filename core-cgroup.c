@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-cgroup.h"
+
+static uint32_t cgroup_subtree_users;	/* stressors that may enable +memory */
+static bool cgroup_subtree_memory;	/* memory was enabled before the run */
+
+/*
+ *  stress_cgroup2_mount_point()
+ *	find where the cgroup2 hierarchy is mounted, returns false
+ *	if cgroup v2 is not mounted
+ */
+bool stress_cgroup2_mount_point(char *path, const size_t path_len)
+{
+#if defined(__linux__)
+	FILE *fp;
+	char buf[4096];
+	bool found = false;
+
+	fp = fopen("/proc/mounts", "r");
+	if (!fp)
+		return false;
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		char mnt[PATH_MAX], type[32];
+
+		if (sscanf(buf, "%*s %4095s %31s", mnt, type) != 2)
+			continue;
+		if (strcmp(type, "cgroup2") == 0) {
+			(void)shim_strscpy(path, mnt, path_len);
+			found = true;
+			break;
+		}
+	}
+	(void)fclose(fp);
+	return found;
+#else
+	(void)path;
+	(void)path_len;
+
+	return false;
+#endif
+}
+
+/*
+ *  stress_cgroup_subtree_save()
+ *	note if the memory controller is already enabled for the
+ *	children of the cgroup v2 root, called from a stressor init
+ *	in the parent before any instance can enable it
+ */
+void stress_cgroup_subtree_save(void)
+{
+	char mnt[PATH_MAX], path[PATH_MAX + 32], buf[256];
+
+	if (cgroup_subtree_users++)
+		return;
+	/* if the state can't be read then leave it alone on restore */
+	cgroup_subtree_memory = true;
+	if (!stress_cgroup2_mount_point(mnt, sizeof(mnt)))
+		return;
+	(void)snprintf(path, sizeof(path), "%s/cgroup.subtree_control", mnt);
+	if (stress_system_read(path, buf, sizeof(buf)) < 0)
+		return;
+	cgroup_subtree_memory = (strstr(buf, "memory") != NULL);
+}
+
+/*
+ *  stress_cgroup_subtree_restore()
+ *	disable the memory controller for the children of the cgroup
+ *	v2 root if it was enabled by the stressors, called from a
+ *	stressor deinit in the parent once all instances have finished
+ */
+void stress_cgroup_subtree_restore(void)
+{
+	char mnt[PATH_MAX], path[PATH_MAX + 32];
+
+	if (!cgroup_subtree_users || --cgroup_subtree_users)
+		return;
+	if (cgroup_subtree_memory)
+		return;
+	if (!stress_cgroup2_mount_point(mnt, sizeof(mnt)))
+		return;
+	(void)snprintf(path, sizeof(path), "%s/cgroup.subtree_control", mnt);
+	if (stress_system_write(path, "-memory\n", 8) < 0)
+		pr_dbg("cgroup: cannot disable the memory controller in %s\n", path);
+}
+
+/*
+ *  stress_cgroup_key_value()
+ *	get the value of key from flat keyed cgroup file data such
+ *	as memory.stat or memory.events, 0 if not found
+ */
+uint64_t stress_cgroup_key_value(const char *data, const char *key)
+{
+	const size_t len = strlen(key);
+	const char *ptr;
+
+	for (ptr = data; ptr && *ptr; ptr = strchr(ptr, '\n'), ptr = ptr ? ptr + 1 : NULL) {
+		uint64_t val;
+
+		if ((strncmp(ptr, key, len) == 0) && (ptr[len] == ' ') &&
+		    (sscanf(ptr + len + 1, "%" SCNu64, &val) == 1))
+			return val;
+	}
+	return 0;
+}
+
+/*
+ *  stress_cgroup_mem_path()
+ *	get the path of the child cgroup of a stressor instance,
+ *	returns false if cgroup v2 is not mounted
+ */
+bool stress_cgroup_mem_path(stress_args_t *args, char *cgpath, const size_t cgpath_len)
+{
+	char mnt[PATH_MAX];
+
+	if (!stress_cgroup2_mount_point(mnt, sizeof(mnt)))
+		return false;
+	(void)snprintf(cgpath, cgpath_len, "%s/stress-ng-%s-%" PRIdMAX "-%" PRIu32,
+		mnt, args->name, (intmax_t)args->pid, args->instance);
+	return true;
+}
+
+/*
+ *  stress_cgroup_mem_create()
+ *	create a child cgroup of the cgroup v2 hierarchy root with
+ *	the memory controller enabled and memory.high and memory.max
+ *	set, the path of the cgroup is returned in cgpath. Returns
+ *	0 if OK, -1 if cgroup v2 or the memory controller is not
+ *	available
+ */
+int stress_cgroup_mem_create(
+	stress_args_t *args,
+	char *cgpath,
+	const size_t cgpath_len,
+	const size_t mem_high,
+	const size_t mem_max)
+{
+	char mnt[PATH_MAX], path[PATH_MAX + 96], buf[64];
+	ssize_t len;
+
+	if (!stress_cgroup2_mount_point(mnt, sizeof(mnt))) {
+		pr_dbg("%s: cgroup v2 is not mounted\n", args->name);
+		return -1;
+	}
+
+	/* memory controller for the children of the hierarchy root */
+	(void)snprintf(path, sizeof(path), "%s/cgroup.subtree_control", mnt);
+	(void)stress_system_write(path, "+memory\n", 8);
+
+	if (!stress_cgroup_mem_path(args, cgpath, cgpath_len))
+		return -1;
+	/* an OOM killed child of a restarted stressor can leave it behind */
+	(void)rmdir(cgpath);
+	if (mkdir(cgpath, S_IRUSR | S_IWUSR | S_IXUSR) < 0) {
+		pr_dbg("%s: cannot create cgroup %s, errno=%d (%s)\n",
+			args->name, cgpath, errno, strerror(errno));
+		return -1;
+	}
+	(void)snprintf(path, sizeof(path), "%s/cgroup.controllers", cgpath);
+	if ((stress_system_read(path, buf, sizeof(buf)) < 0) || !strstr(buf, "memory")) {
+		pr_dbg("%s: cgroup v2 memory controller is not available in %s\n",
+			args->name, mnt);
+		goto err;
+	}
+	(void)snprintf(path, sizeof(path), "%s/memory.max", cgpath);
+	len = (ssize_t)snprintf(buf, sizeof(buf), "%zu\n", mem_max);
+	if (stress_system_write(path, buf, (size_t)len) < 0)
+		goto err;
+	(void)snprintf(path, sizeof(path), "%s/memory.high", cgpath);
+	len = (ssize_t)snprintf(buf, sizeof(buf), "%zu\n", mem_high);
+	if (stress_system_write(path, buf, (size_t)len) < 0)
+		goto err;
+	return 0;
+
+err:
+	(void)rmdir(cgpath);
+	return -1;
+}
+
+/*
+ *  stress_cgroup_move_pid()
+ *	move a process into the cgroup
+ */
+int stress_cgroup_move_pid(const char *cgpath, const pid_t pid)
+{
+	char path[PATH_MAX + 32], buf[32];
+	ssize_t len;
+
+	(void)snprintf(path, sizeof(path), "%s/cgroup.procs", cgpath);
+	len = (ssize_t)snprintf(buf, sizeof(buf), "%" PRIdMAX "\n", (intmax_t)pid);
+	return (stress_system_write(path, buf, (size_t)len) < 0) ? -1 : 0;
+}
+
+/*
+ *  stress_cgroup_remove()
+ *	remove a cgroup, it can be busy for a short while after the
+ *	last process in it has exited
+ */
+void stress_cgroup_remove(const char *cgpath)
+{
+	int i;
+
+	for (i = 0; (i < 50) && (rmdir(cgpath) < 0) && (errno == EBUSY); i++)
+		(void)shim_usleep(20000);
+}
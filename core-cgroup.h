@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_CGROUP_H
+#define CORE_CGROUP_H
+
+#include "core-attribute.h"
+
+extern WARN_UNUSED bool stress_cgroup2_mount_point(char *path, const size_t path_len);
+extern WARN_UNUSED uint64_t stress_cgroup_key_value(const char *data, const char *key);
+extern WARN_UNUSED bool stress_cgroup_mem_path(stress_args_t *args, char *cgpath,
+	const size_t cgpath_len);
+extern WARN_UNUSED int stress_cgroup_mem_create(stress_args_t *args, char *cgpath,
+	const size_t cgpath_len, const size_t mem_high, const size_t mem_max);
+extern WARN_UNUSED int stress_cgroup_move_pid(const char *cgpath, const pid_t pid);
+extern void stress_cgroup_remove(const char *cgpath);
+extern void stress_cgroup_subtree_save(void);
+extern void stress_cgroup_subtree_restore(void);
+
+#endif
@@ -814,6 +814,166 @@ bool stress_cpu_x86_has_avx512_bw(void)
 #endif
 }
 
+/*
+ *  stress_cpu_x86_has_avx()
+ *	does x86 cpu support avx
+ */
+bool stress_cpu_x86_has_avx(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ecx & CPUID_avx_ECX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_avx2()
+ *	does x86 cpu support avx2
+ */
+bool stress_cpu_x86_has_avx2(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x7, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ebx & CPUID_avx2_EBX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_avx512_f()
+ *	does x86 cpu support avx512_f
+ */
+bool stress_cpu_x86_has_avx512_f(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x7, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ebx & CPUID_avx512_f_EBX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_fma()
+ *	does x86 cpu support fma
+ */
+bool stress_cpu_x86_has_fma(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ecx & CPUID_fma_ECX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_pclmulqdq()
+ *	does x86 cpu support pclmulqdq
+ */
+bool stress_cpu_x86_has_pclmulqdq(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ecx & CPUID_pclmulqdq_ECX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_sse4_2()
+ *	does x86 cpu support sse4.2
+ */
+bool stress_cpu_x86_has_sse4_2(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x1, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(ecx & CPUID_sse4_2_ECX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_amx_tile()
+ *	does x86 cpu support amx tiles
+ */
+bool stress_cpu_x86_has_amx_tile(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x7, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(edx & CPUID_amx_tile_EDX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_amx_bf16()
+ *	does x86 cpu support amx bf16 tile ops
+ */
+bool stress_cpu_x86_has_amx_bf16(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t eax = 0x7, ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_asm_x86_cpuid(eax, ebx, ecx, edx);
+
+	return !!(edx & CPUID_amx_bf16_EDX);
+#else
+	return false;
+#endif
+}
+
 /*
  *  stress_cpu_disable_fp_subnormals
  *     Floating Point subnormals can be expensive and require
@@ -869,3 +1029,43 @@ bool stress_cpu_x86_has_movdiri(void)
 #endif
 }
 
+/*
+ *  stress_cpu_x86_has_erms()
+ *	does x86 cpu support enhanced rep movsb/stosb?
+ */
+bool stress_cpu_x86_has_erms(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_cpu_x86_extended_features(ebx, ecx, edx);
+
+	return !!(ebx & CPUID_erms_EBX);
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_cpu_x86_has_fsrm()
+ *	does x86 cpu support fast short rep mov?
+ */
+bool stress_cpu_x86_has_fsrm(void)
+{
+#if defined(STRESS_ARCH_X86)
+	uint32_t ebx = 0, ecx = 0, edx = 0;
+
+	if (!stress_cpu_is_x86())
+		return false;
+
+	stress_cpu_x86_extended_features(ebx, ecx, edx);
+
+	return !!(edx & CPUID_fsrm_EDX);
+#else
+	return false;
+#endif
+}
+
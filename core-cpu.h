@@ -27,10 +27,20 @@ extern WARN_UNUSED bool stress_cpu_x86_has_avx_vnni(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_avx512_vl(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_avx512_vnni(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_avx512_bw(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_avx(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_avx2(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_avx512_f(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_fma(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_pclmulqdq(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_sse4_2(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_amx_tile(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_amx_bf16(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_clflushopt(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_clwb(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_cldemote(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_clfsh(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_erms(void);
+extern WARN_UNUSED bool stress_cpu_x86_has_fsrm(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_lahf_lm(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_mmx(void);
 extern WARN_UNUSED bool stress_cpu_x86_has_msr(void);
@@ -20,8 +20,16 @@
 #include "stress-ng.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
 #include "core-hash.h"
 #include "core-pragma.h"
+#include "core-target-clones.h"
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_IMMINTRIN_H) &&	\
+    !defined(HAVE_COMPILER_MUSL)
+#include <immintrin.h>
+#endif
 
 /*
  *  stress_hash_jenkin()
@@ -198,6 +206,160 @@ uint32_t PURE OPTIMIZE3 stress_hash_murmur3_32(
 	return h;
 }
 
+/*
+ *  stress_hash_murmur3_32_x8
+ *	murmur3_32 of 8 keys of len bytes, stride bytes apart,
+ *	the keys are hashed in 8 independent lanes that the compiler
+ *	can map onto SIMD registers. Each lane produces the same
+ *	hash as stress_hash_murmur3_32
+ */
+void OPTIMIZE3 TARGET_CLONES stress_hash_murmur3_32_x8(
+	const uint8_t *keys,
+	const size_t len,
+	const size_t stride,
+	const uint32_t seed,
+	uint32_t hashes[STRESS_HASH_LANES])
+{
+	uint32_t h[STRESS_HASH_LANES], k[STRESS_HASH_LANES];
+	register size_t i, l;
+	const size_t blocks = len >> 2;
+
+	for (l = 0; l < STRESS_HASH_LANES; l++)
+		h[l] = seed;
+
+	for (i = 0; i < blocks; i++) {
+		const uint8_t *key = keys + (i << 2);
+
+		for (l = 0; l < STRESS_HASH_LANES; l++)
+			(void)shim_memcpy(&k[l], key + (l * stride), sizeof(k[l]));
+		for (l = 0; l < STRESS_HASH_LANES; l++) {
+			uint32_t hl = h[l];
+
+			hl ^= stress_hash_murmur_32_scramble(k[l]);
+			hl = (hl << 13) | (hl >> 19);
+			h[l] = hl * 5 + 0xe6546b64;
+		}
+	}
+
+	for (l = 0; l < STRESS_HASH_LANES; l++) {
+		const uint8_t *key = keys + (l * stride) + (blocks << 2);
+		uint32_t kl = 0;
+
+		for (i = len & 3; i; i--) {
+			kl <<= 8;
+			kl |= key[i - 1];
+		}
+		k[l] = kl;
+	}
+	for (l = 0; l < STRESS_HASH_LANES; l++) {
+		uint32_t hl = h[l];
+
+		hl ^= stress_hash_murmur_32_scramble(k[l]);
+		hl ^= (uint32_t)len;
+		hl ^= hl >> 16;
+		hl *= 0x85ebca6b;
+		hl ^= hl >> 13;
+		hl *= 0xc2b2ae35;
+		hl ^= hl >> 16;
+		hashes[l] = hl;
+	}
+}
+
+#define XXH64_PRIME1	(0x9e3779b185ebca87ULL)
+#define XXH64_PRIME2	(0xc2b2ae3d27d4eb4fULL)
+#define XXH64_PRIME3	(0x165667b19e3779f9ULL)
+#define XXH64_PRIME4	(0x85ebca77c2b2ae63ULL)
+#define XXH64_PRIME5	(0x27d4eb2f165667c5ULL)
+
+static inline uint64_t PURE stress_hash_xxh64_rotl(const uint64_t x, const int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t PURE stress_hash_xxh64_round(uint64_t acc, const uint64_t v)
+{
+	acc += v * XXH64_PRIME2;
+	acc = stress_hash_xxh64_rotl(acc, 31);
+	return acc * XXH64_PRIME1;
+}
+
+static inline uint64_t PURE stress_hash_xxh64_merge(uint64_t h, const uint64_t acc)
+{
+	h ^= stress_hash_xxh64_round(0, acc);
+	return (h * XXH64_PRIME1) + XXH64_PRIME4;
+}
+
+/*
+ *  stress_hash_xxh64()
+ *	64 bit xxHash, compatible with XXH64(), 32 byte stripes are
+ *	consumed by 4 independent 64 bit accumulator lanes that the
+ *	compiler can vectorize where 64 bit vector multiplies exist
+ */
+uint64_t PURE OPTIMIZE3 TARGET_CLONES stress_hash_xxh64(
+	const uint8_t *buf,
+	size_t len,
+	const uint64_t seed)
+{
+	const uint8_t *end = buf + len;
+	uint64_t h;
+
+	if (len >= 32) {
+		uint64_t acc[4];
+		register size_t l;
+
+		acc[0] = seed + XXH64_PRIME1 + XXH64_PRIME2;
+		acc[1] = seed + XXH64_PRIME2;
+		acc[2] = seed;
+		acc[3] = seed - XXH64_PRIME1;
+
+		do {
+			uint64_t v[4];
+
+			(void)shim_memcpy(v, buf, sizeof(v));
+			for (l = 0; l < 4; l++)
+				acc[l] = stress_hash_xxh64_round(acc[l], v[l]);
+			buf += 32;
+		} while (buf <= end - 32);
+
+		h = stress_hash_xxh64_rotl(acc[0], 1) +
+		    stress_hash_xxh64_rotl(acc[1], 7) +
+		    stress_hash_xxh64_rotl(acc[2], 12) +
+		    stress_hash_xxh64_rotl(acc[3], 18);
+		for (l = 0; l < 4; l++)
+			h = stress_hash_xxh64_merge(h, acc[l]);
+	} else {
+		h = seed + XXH64_PRIME5;
+	}
+	h += (uint64_t)len;
+
+	for (; buf + 8 <= end; buf += 8) {
+		uint64_t v;
+
+		(void)shim_memcpy(&v, buf, sizeof(v));
+		h ^= stress_hash_xxh64_round(0, v);
+		h = (stress_hash_xxh64_rotl(h, 27) * XXH64_PRIME1) + XXH64_PRIME4;
+	}
+	if (buf + 4 <= end) {
+		uint32_t v;
+
+		(void)shim_memcpy(&v, buf, sizeof(v));
+		h ^= (uint64_t)v * XXH64_PRIME1;
+		h = (stress_hash_xxh64_rotl(h, 23) * XXH64_PRIME2) + XXH64_PRIME3;
+		buf += 4;
+	}
+	while (buf < end) {
+		h ^= (*buf++) * XXH64_PRIME5;
+		h = stress_hash_xxh64_rotl(h, 11) * XXH64_PRIME1;
+	}
+	h ^= h >> 33;
+	h *= XXH64_PRIME2;
+	h ^= h >> 29;
+	h *= XXH64_PRIME3;
+	h ^= h >> 32;
+
+	return h;
+}
+
 /*
  * crc32c table generated using:
  *
@@ -300,6 +462,242 @@ PRAGMA_UNROLL_N(4)
 	return ~crc;
 }
 
+/*
+ *  stress_hash_crc32c_buf()
+ *	crc32c of a buffer, byte at a time lookup table
+ *	implementation, reference for the accelerated variants
+ */
+uint32_t PURE OPTIMIZE3 stress_hash_crc32c_buf(const uint8_t *buf, const size_t len)
+{
+	register uint32_t crc = ~0U;
+	register const uint8_t *end = buf + len;
+
+PRAGMA_UNROLL_N(4)
+	while (buf < end)
+		crc = (crc >> 8) ^ crc32c_table[(crc ^ *buf++) & 0xff];
+
+	return ~crc;
+}
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_IMMINTRIN_H) &&	\
+    defined(HAVE_MM_CRC32_U64) &&	\
+    !defined(HAVE_COMPILER_MUSL) &&	\
+    !defined(HAVE_COMPILER_ICC)
+#define STRESS_HASH_CRC32C_X86
+#define TARGET_SSE42		__attribute__ ((target("sse4.2")))
+
+/*
+ *  stress_hash_crc32c_x86()
+ *	crc32c update using the SSE4.2 crc32 instruction,
+ *	8 bytes per instruction, no pre/post inversion
+ */
+static inline uint32_t OPTIMIZE3 TARGET_SSE42 stress_hash_crc32c_x86(
+	uint32_t crc,
+	const uint8_t *buf,
+	size_t len)
+{
+	uint64_t crc64 = crc;
+
+	for (; len >= 8; len -= 8, buf += 8) {
+		uint64_t v;
+
+		(void)shim_memcpy(&v, buf, sizeof(v));
+		crc64 = _mm_crc32_u64(crc64, v);
+	}
+	crc = (uint32_t)crc64;
+	for (; len; len--)
+		crc = _mm_crc32_u8(crc, *buf++);
+
+	return crc;
+}
+#endif
+
+#if defined(STRESS_ARCH_ARM) &&		\
+    defined(__aarch64__) &&		\
+    defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define STRESS_HASH_CRC32C_ARM
+
+/*
+ *  stress_hash_crc32c_arm()
+ *	crc32c update using the ARMv8 crc32c instructions,
+ *	no pre/post inversion
+ */
+static inline uint32_t OPTIMIZE3 stress_hash_crc32c_arm(
+	uint32_t crc,
+	const uint8_t *buf,
+	size_t len)
+{
+	for (; len >= 8; len -= 8, buf += 8) {
+		uint64_t v;
+
+		(void)shim_memcpy(&v, buf, sizeof(v));
+		crc = __crc32cd(crc, v);
+	}
+	for (; len; len--)
+		crc = __crc32cb(crc, *buf++);
+
+	return crc;
+}
+#endif
+
+/*
+ *  stress_hash_crc32c_hw_supported()
+ *	return true if crc32c can use CRC instructions
+ */
+bool stress_hash_crc32c_hw_supported(void)
+{
+#if defined(STRESS_HASH_CRC32C_X86)
+	return stress_cpu_x86_has_sse4_2();
+#elif defined(STRESS_HASH_CRC32C_ARM)
+	return true;
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_hash_crc32c_hw()
+ *	crc32c of a buffer using a single stream of CRC
+ *	instructions, caller must check stress_hash_crc32c_hw_supported
+ */
+uint32_t PURE OPTIMIZE3 stress_hash_crc32c_hw(const uint8_t *buf, const size_t len)
+{
+#if defined(STRESS_HASH_CRC32C_X86)
+	return ~stress_hash_crc32c_x86(~0U, buf, len);
+#elif defined(STRESS_HASH_CRC32C_ARM)
+	return ~stress_hash_crc32c_arm(~0U, buf, len);
+#else
+	return stress_hash_crc32c_buf(buf, len);
+#endif
+}
+
+#if defined(STRESS_HASH_CRC32C_X86) &&	\
+    defined(HAVE_MM_CLMULEPI64_SI128)
+#define STRESS_HASH_CRC32C_FOLD
+#define TARGET_SSE42_PCLMUL	__attribute__ ((target("sse4.2,pclmul")))
+
+#define CRC32C_LONG		(8192)	/* long 3 way stream length */
+#define CRC32C_SHORT		(256)	/* short 3 way stream length */
+
+static uint32_t crc32c_long_k;		/* x^(8 * CRC32C_LONG - 33) mod P */
+static uint32_t crc32c_short_k;		/* x^(8 * CRC32C_SHORT - 33) mod P */
+
+/*
+ *  stress_hash_crc32c_xpow()
+ *	x^n modulo the crc32c polynomial, bit reflected
+ */
+static uint32_t stress_hash_crc32c_xpow(size_t n)
+{
+	uint32_t x = 0x80000000U;	/* x^0 */
+
+	while (n--)
+		x = (x & 1) ? (x >> 1) ^ 0x82f63b78 : x >> 1;
+	return x;
+}
+
+/*
+ *  stress_hash_crc32c_shift()
+ *	shift crc over len zero bytes, k is x^(8 * len - 33) mod P,
+ *	the carry-less product is reduced back to 32 bits by the
+ *	crc32 instruction which multiplies by x^32 mod P
+ */
+static inline uint32_t TARGET_SSE42_PCLMUL stress_hash_crc32c_shift(
+	const uint32_t crc,
+	const uint32_t k)
+{
+	const __m128i prod = _mm_clmulepi64_si128(_mm_cvtsi32_si128((int)crc),
+						  _mm_cvtsi32_si128((int)k), 0x00);
+
+	return (uint32_t)_mm_crc32_u64(0, (uint64_t)_mm_cvtsi128_si64(prod));
+}
+
+/*
+ *  stress_hash_crc32c_3way()
+ *	crc of 3 x len bytes as three independent streams to hide
+ *	the 3 cycle latency of the crc32 instruction, the three
+ *	partial crcs are then folded together with pclmulqdq
+ */
+static inline uint32_t OPTIMIZE3 TARGET_SSE42_PCLMUL stress_hash_crc32c_3way(
+	const uint32_t crc,
+	const uint8_t *buf,
+	const size_t len,
+	const uint32_t k)
+{
+	uint64_t crc0 = crc, crc1 = 0, crc2 = 0;
+	const uint8_t *buf1 = buf + len;
+	const uint8_t *buf2 = buf1 + len;
+	const uint8_t *end = buf1;
+
+	while (buf < end) {
+		uint64_t v0, v1, v2;
+
+		(void)shim_memcpy(&v0, buf, sizeof(v0));
+		(void)shim_memcpy(&v1, buf1, sizeof(v1));
+		(void)shim_memcpy(&v2, buf2, sizeof(v2));
+		crc0 = _mm_crc32_u64(crc0, v0);
+		crc1 = _mm_crc32_u64(crc1, v1);
+		crc2 = _mm_crc32_u64(crc2, v2);
+		buf += 8;
+		buf1 += 8;
+		buf2 += 8;
+	}
+	crc0 = stress_hash_crc32c_shift((uint32_t)crc0, k) ^ crc1;
+	return stress_hash_crc32c_shift((uint32_t)crc0, k) ^ (uint32_t)crc2;
+}
+
+/*
+ *  stress_hash_crc32c_fold_x86()
+ *	3 way crc32c, long then short blocks, single stream tail
+ */
+static uint32_t OPTIMIZE3 TARGET_SSE42_PCLMUL stress_hash_crc32c_fold_x86(
+	const uint8_t *buf,
+	size_t len)
+{
+	uint32_t crc = ~0U;
+
+	if (UNLIKELY(!crc32c_long_k)) {
+		crc32c_long_k = stress_hash_crc32c_xpow((8 * CRC32C_LONG) - 33);
+		crc32c_short_k = stress_hash_crc32c_xpow((8 * CRC32C_SHORT) - 33);
+	}
+	for (; len >= 3 * CRC32C_LONG; len -= 3 * CRC32C_LONG, buf += 3 * CRC32C_LONG)
+		crc = stress_hash_crc32c_3way(crc, buf, CRC32C_LONG, crc32c_long_k);
+	for (; len >= 3 * CRC32C_SHORT; len -= 3 * CRC32C_SHORT, buf += 3 * CRC32C_SHORT)
+		crc = stress_hash_crc32c_3way(crc, buf, CRC32C_SHORT, crc32c_short_k);
+
+	return ~stress_hash_crc32c_x86(crc, buf, len);
+}
+#endif
+
+/*
+ *  stress_hash_crc32c_fold_supported()
+ *	return true if crc32c can use 3 way CRC instruction
+ *	streams folded with carry-less multiplies
+ */
+bool stress_hash_crc32c_fold_supported(void)
+{
+#if defined(STRESS_HASH_CRC32C_FOLD)
+	return stress_cpu_x86_has_sse4_2() && stress_cpu_x86_has_pclmulqdq();
+#else
+	return false;
+#endif
+}
+
+/*
+ *  stress_hash_crc32c_fold()
+ *	crc32c of a buffer using 3 interleaved CRC instruction
+ *	streams, caller must check stress_hash_crc32c_fold_supported
+ */
+uint32_t OPTIMIZE3 stress_hash_crc32c_fold(const uint8_t *buf, const size_t len)
+{
+#if defined(STRESS_HASH_CRC32C_FOLD)
+	return stress_hash_crc32c_fold_x86(buf, len);
+#else
+	return stress_hash_crc32c_hw(buf, len);
+#endif
+}
+
 /*
  *  stress_hash_adler32()
  *	Mark Adler 32 bit hash
@@ -476,6 +476,45 @@ int stress_strcmp_munged(const char *s1, const char *s2)
 	return (unsigned char)stress_chr_munge(*s1) - (unsigned char)stress_chr_munge(*s2);
 }
 
+/*
+ *  stress_json_escape()
+ *	copy src to dst escaping '"', '\\' and control characters so
+ *	that it can be used in a json string, an escape sequence
+ *	that does not fit is dropped, dst is always '\0' terminated
+ */
+char *stress_json_escape(char *dst, const size_t len, const char *src)
+{
+	char *d = dst;
+	const char *end = dst + len;
+
+	if (UNLIKELY(!len))
+		return dst;
+
+	for (; *src; src++) {
+		const unsigned char c = (unsigned char)*src;
+		char esc[8];
+		size_t n;
+
+		if ((c == '"') || (c == '\\')) {
+			esc[0] = '\\';
+			esc[1] = (char)c;
+			n = 2;
+		} else if (c < 0x20) {
+			n = (size_t)snprintf(esc, sizeof(esc), "\\u%04x", c);
+		} else {
+			esc[0] = (char)c;
+			n = 1;
+		}
+		/* leave room for the terminating '\0' */
+		if (n >= (size_t)(end - d))
+			break;
+		(void)shim_memcpy(d, esc, n);
+		d += n;
+	}
+	*d = '\0';
+	return dst;
+}
+
 /*
  *  stress_get_uint64_zero()
  *	return uint64 zero in way that force less smart
@@ -45,6 +45,7 @@ extern void stress_set_proc_state_str(const char *name, const char *str);
 extern void stress_set_proc_state(const char *name, const int state);
 extern size_t stress_munge_underscore(char *dst, const char *src, size_t len);
 extern WARN_UNUSED int stress_strcmp_munged(const char *s1, const char *s2);
+extern char *stress_json_escape(char *dst, const size_t len, const char *src);
 extern WARN_UNUSED uint64_t stress_get_uint64_zero(void);
 extern WARN_UNUSED void *stress_get_null(void);
 extern WARN_UNUSED bool stress_little_endian(void);
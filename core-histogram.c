@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-histogram.h"
+
+#include <math.h>
+
+/* Percentiles reported for each histogram */
+static const double stress_hist_percentiles[] = {
+	50.0, 90.0, 99.0, 99.9, 99.99
+};
+
+static stress_hist_t *hist_shared = MAP_FAILED;	/* shared histograms */
+static size_t hist_shared_size = 0;		/* size of shared mapping */
+
+/*
+ *  stress_hist_init()
+ *	initialize a process local histogram
+ */
+void stress_hist_init(stress_hist_t *hist, const char *description)
+{
+	(void)shim_memset(hist->buckets, 0, sizeof(hist->buckets));
+	hist->description = description;
+	hist->count = 0;
+	hist->sum = 0;
+	hist->min = UINT64_MAX;
+	hist->max = 0;
+}
+
+/*
+ *  stress_hist_bucket_value()
+ *	map a bucket index to the mid-point value of the bucket
+ */
+uint64_t stress_hist_bucket_value(const size_t index)
+{
+	const size_t group = index >> STRESS_HIST_SUB_BITS;
+	const uint64_t sub = (uint64_t)(index & (STRESS_HIST_SUB_BUCKETS - 1));
+	uint64_t lower, width;
+
+	if (group == 0)
+		return sub;
+
+	lower = (STRESS_HIST_SUB_BUCKETS + sub) << (group - 1);
+	width = 1ULL << (group - 1);
+
+	return lower + (width >> 1);
+}
+
+/*
+ *  stress_hist_percentile()
+ *	return the value at the given percentile, the value is
+ *	accurate to the resolution of the bucket it lands in
+ */
+uint64_t stress_hist_percentile(const stress_hist_t *hist, const double percentile)
+{
+	uint64_t rank, total = 0, value;
+	size_t i;
+
+	if (hist->count == 0)
+		return 0;
+	if (percentile >= 100.0)
+		return hist->max;
+
+	rank = (uint64_t)ceil((percentile / 100.0) * (double)hist->count);
+	if (rank < 1)
+		rank = 1;
+
+	for (i = 0; i < STRESS_HIST_BUCKETS; i++) {
+		total += hist->buckets[i];
+		if (total >= rank)
+			break;
+	}
+	if (i >= STRESS_HIST_BUCKETS)
+		return hist->max;
+
+	value = stress_hist_bucket_value(i);
+	if (value < hist->min)
+		value = hist->min;
+	if (value > hist->max)
+		value = hist->max;
+	return value;
+}
+
+/*
+ *  stress_hist_mean()
+ *	return the mean of the recorded values
+ */
+double stress_hist_mean(const stress_hist_t *hist)
+{
+	return hist->count ? (double)hist->sum / (double)hist->count : 0.0;
+}
+
+/*
+ *  stress_hist_stddev()
+ *	return the standard deviation of the recorded values,
+ *	estimated from the bucket mid-points
+ */
+double stress_hist_stddev(const stress_hist_t *hist)
+{
+	const double mean = stress_hist_mean(hist);
+	double variance = 0.0;
+	size_t i;
+
+	if (hist->count == 0)
+		return 0.0;
+
+	for (i = 0; i < STRESS_HIST_BUCKETS; i++) {
+		if (hist->buckets[i]) {
+			const double diff = (double)stress_hist_bucket_value(i) - mean;
+
+			variance += (double)hist->buckets[i] * diff * diff;
+		}
+	}
+	return sqrt(variance / (double)hist->count);
+}
+
+/*
+ *  stress_hist_accumulate()
+ *	add the values recorded in process local histogram src
+ *	into process local histogram dst
+ */
+void stress_hist_accumulate(stress_hist_t *dst, const stress_hist_t *src)
+{
+	size_t i;
+
+	if (src->count == 0)
+		return;
+	for (i = 0; i < STRESS_HIST_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+/*
+ *  stress_hist_add()
+ *	atomically add val to *ptr
+ */
+static inline void stress_hist_add(uint64_t *ptr, const uint64_t val)
+{
+#if defined(HAVE_ATOMIC_FETCH_ADD)
+	(void)__atomic_fetch_add(ptr, val, __ATOMIC_RELAXED);
+#else
+	/* racy alternative */
+	*ptr += val;
+#endif
+}
+
+/*
+ *  stress_hist_update_min()
+ *	atomically update *ptr if val is smaller
+ */
+static inline void stress_hist_update_min(uint64_t *ptr, const uint64_t val)
+{
+#if defined(HAVE_ATOMIC_COMPARE_EXCHANGE)
+	uint64_t old = *ptr;
+
+	while (val < old) {
+		if (__atomic_compare_exchange(ptr, &old, &val, false,
+					      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+	}
+#else
+	/* racy alternative */
+	if (val < *ptr)
+		*ptr = val;
+#endif
+}
+
+/*
+ *  stress_hist_update_max()
+ *	atomically update *ptr if val is larger
+ */
+static inline void stress_hist_update_max(uint64_t *ptr, const uint64_t val)
+{
+#if defined(HAVE_ATOMIC_COMPARE_EXCHANGE)
+	uint64_t old = *ptr;
+
+	while (val > old) {
+		if (__atomic_compare_exchange(ptr, &old, &val, false,
+					      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+			break;
+	}
+#else
+	/* racy alternative */
+	if (val > *ptr)
+		*ptr = val;
+#endif
+}
+
+/*
+ *  stress_hist_merge()
+ *	merge a process local histogram into the stressor's shared
+ *	histogram index, this is lock-free so all instances can merge
+ *	concurrently at the end of a run
+ */
+void stress_hist_merge(stress_args_t *args, const size_t index, const stress_hist_t *hist)
+{
+	stress_hist_t *shared;
+	size_t i;
+
+	if (!args->stats || !args->stats->hist)
+		return;
+	if (index >= STRESS_HIST_PER_STRESSOR)
+		return;
+	if (hist->count == 0)
+		return;
+
+	shared = &args->stats->hist[index];
+	shared->description = hist->description;
+	for (i = 0; i < STRESS_HIST_BUCKETS; i++) {
+		if (hist->buckets[i])
+			stress_hist_add(&shared->buckets[i], hist->buckets[i]);
+	}
+	stress_hist_add(&shared->sum, hist->sum);
+	stress_hist_update_min(&shared->min, hist->min);
+	stress_hist_update_max(&shared->max, hist->max);
+	/* count last, non-zero count indicates the histogram is populated */
+	stress_hist_add(&shared->count, hist->count);
+}
+
+/*
+ *  stress_hist_shared_map()
+ *	map STRESS_HIST_PER_STRESSOR shared histograms for each
+ *	stressor and point each instance's stats at them. The
+ *	buckets are left untouched so pages are only faulted in
+ *	when a stressor merges data into them.
+ */
+void stress_hist_shared_map(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	size_t n = 0, i;
+	stress_hist_t *hist;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (!ss->ignore.run)
+			n += STRESS_HIST_PER_STRESSOR;
+	}
+	if (n == 0)
+		return;
+
+	hist_shared_size = n * sizeof(*hist_shared);
+	hist_shared = (stress_hist_t *)mmap(NULL, hist_shared_size,
+				PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (hist_shared == MAP_FAILED) {
+		pr_dbg("histogram: cannot mmap %zu bytes for shared histograms, "
+			"errno=%d (%s), latency histograms disabled\n",
+			hist_shared_size, errno, strerror(errno));
+		hist_shared_size = 0;
+		return;
+	}
+	stress_set_vma_anon_name(hist_shared, hist_shared_size, "histograms");
+
+	for (i = 0; i < n; i++)
+		hist_shared[i].min = UINT64_MAX;
+
+	hist = hist_shared;
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run)
+			continue;
+		for (j = 0; j < ss->instances; j++)
+			ss->stats[j]->hist = hist;
+		hist += STRESS_HIST_PER_STRESSOR;
+	}
+}
+
+/*
+ *  stress_hist_shared_unmap()
+ *	unmap shared histograms
+ */
+void stress_hist_shared_unmap(void)
+{
+	if (hist_shared != MAP_FAILED) {
+		(void)munmap((void *)hist_shared, hist_shared_size);
+		hist_shared = MAP_FAILED;
+		hist_shared_size = 0;
+	}
+}
+
+/*
+ *  stress_hist_log()
+ *	log histogram summary and percentiles
+ */
+void stress_hist_log(const char *name, const stress_hist_t *hist)
+{
+	char buf[256], *ptr = buf;
+	size_t i;
+
+	if (!hist->description || (hist->count == 0))
+		return;
+
+	pr_metrics("%-13s %s: %" PRIu64 " samples, min %" PRIu64
+		", mean %.2f, max %" PRIu64 "\n",
+		name, hist->description, hist->count, hist->min,
+		stress_hist_mean(hist), hist->max);
+
+	*ptr = '\0';
+	for (i = 0; i < SIZEOF_ARRAY(stress_hist_percentiles); i++) {
+		ptr += snprintf(ptr, sizeof(buf) - (size_t)(ptr - buf), "%s p%g %" PRIu64,
+			i ? "," : "", stress_hist_percentiles[i],
+			stress_hist_percentile(hist, stress_hist_percentiles[i]));
+	}
+	pr_metrics("%-13s  %s\n", "", buf);
+}
+
+/*
+ *  stress_hist_dump_yaml()
+ *	dump histogram summary and percentiles to the yaml file
+ *	using key as the yaml key prefix
+ */
+void stress_hist_dump_yaml(FILE *yaml, const char *key, const stress_hist_t *hist)
+{
+	size_t i;
+
+	if (!hist->description || (hist->count == 0))
+		return;
+
+	pr_yaml(yaml, "      %s-count: %" PRIu64 "\n", key, hist->count);
+	pr_yaml(yaml, "      %s-min: %" PRIu64 "\n", key, hist->min);
+	pr_yaml(yaml, "      %s-mean: %f\n", key, stress_hist_mean(hist));
+	pr_yaml(yaml, "      %s-max: %" PRIu64 "\n", key, hist->max);
+	for (i = 0; i < SIZEOF_ARRAY(stress_hist_percentiles); i++) {
+		pr_yaml(yaml, "      %s-p%g: %" PRIu64 "\n", key,
+			stress_hist_percentiles[i],
+			stress_hist_percentile(hist, stress_hist_percentiles[i]));
+	}
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_HISTOGRAM_H
+#define CORE_HISTOGRAM_H
+
+#include "core-attribute.h"
+
+/*
+ *  Log-linear histogram: values below STRESS_HIST_SUB_BUCKETS are
+ *  recorded exactly, larger values are split into power of 2 groups
+ *  each with STRESS_HIST_SUB_BUCKETS linear sub-buckets, giving a
+ *  relative error of less than 1 / STRESS_HIST_SUB_BUCKETS. Values
+ *  above 2^STRESS_HIST_MAX_SHIFT are clamped into the top bucket.
+ */
+#define STRESS_HIST_SUB_BITS	(6)
+#define STRESS_HIST_SUB_BUCKETS	(1U << STRESS_HIST_SUB_BITS)
+#define STRESS_HIST_MAX_SHIFT	(40)
+#define STRESS_HIST_MAX_VALUE	((1ULL << (STRESS_HIST_MAX_SHIFT + 1)) - 1)
+#define STRESS_HIST_BUCKETS	((STRESS_HIST_MAX_SHIFT - STRESS_HIST_SUB_BITS + 2) * \
+				 STRESS_HIST_SUB_BUCKETS)
+
+/* Number of shared histograms available to each stressor */
+#define STRESS_HIST_PER_STRESSOR (8)
+
+typedef struct stress_hist {
+	const char *description;	/* description of histogram, NULL = unused */
+	uint64_t count;			/* number of values recorded */
+	uint64_t sum;			/* sum of values recorded */
+	uint64_t min;			/* minimum value recorded */
+	uint64_t max;			/* maximum value recorded */
+	uint64_t buckets[STRESS_HIST_BUCKETS];
+} stress_hist_t;
+
+/*
+ *  stress_hist_index()
+ *	map a value to a histogram bucket index
+ */
+static inline size_t ALWAYS_INLINE stress_hist_index(uint64_t value)
+{
+	register int msb;
+
+	if (value < STRESS_HIST_SUB_BUCKETS)
+		return (size_t)value;
+	if (UNLIKELY(value > STRESS_HIST_MAX_VALUE))
+		value = STRESS_HIST_MAX_VALUE;
+	msb = 63 - __builtin_clzll(value);
+
+	return ((size_t)(msb - STRESS_HIST_SUB_BITS + 1) << STRESS_HIST_SUB_BITS) +
+	       (size_t)((value >> (msb - STRESS_HIST_SUB_BITS)) & (STRESS_HIST_SUB_BUCKETS - 1));
+}
+
+/*
+ *  stress_hist_record()
+ *	record a value into a process local histogram
+ */
+static inline void ALWAYS_INLINE stress_hist_record(stress_hist_t *hist, const uint64_t value)
+{
+	hist->buckets[stress_hist_index(value)]++;
+	hist->count++;
+	hist->sum += value;
+	if (value < hist->min)
+		hist->min = value;
+	if (value > hist->max)
+		hist->max = value;
+}
+
+extern void stress_hist_init(stress_hist_t *hist, const char *description);
+extern uint64_t stress_hist_bucket_value(const size_t index);
+extern uint64_t stress_hist_percentile(const stress_hist_t *hist, const double percentile);
+extern double stress_hist_mean(const stress_hist_t *hist);
+extern double stress_hist_stddev(const stress_hist_t *hist);
+extern void stress_hist_accumulate(stress_hist_t *dst, const stress_hist_t *src);
+extern void stress_hist_merge(stress_args_t *args, const size_t index, const stress_hist_t *hist);
+extern void stress_hist_shared_map(stress_stressor_t *stressors_list);
+extern void stress_hist_shared_unmap(void);
+extern void stress_hist_log(const char *name, const stress_hist_t *hist);
+extern void stress_hist_dump_yaml(FILE *yaml, const char *key, const stress_hist_t *hist);
+
+#endif
@@ -0,0 +1,454 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-killpid.h"
+#include "core-metrics-socket.h"
+#include "core-vmstat.h"
+
+#include <sys/socket.h>
+
+#if defined(HAVE_SYS_UN_H)
+#include <sys/un.h>
+#endif
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
+#define METRICS_SOCKET_CLIENTS_MAX	(16)		/* max concurrent readers */
+#define METRICS_SOCKET_BUF_SIZE		(64 * KB)	/* max snapshot line size */
+#define METRICS_SOCKET_INTERVAL		(1.0)		/* seconds between snapshots */
+
+#if defined(HAVE_SYS_UN_H) &&	\
+    defined(HAVE_POLL_H) &&	\
+    defined(HAVE_POLL) &&	\
+    defined(AF_UNIX) &&		\
+    defined(MSG_DONTWAIT)
+
+/* Per stressor state for computing rates between snapshots */
+typedef struct {
+	uint64_t bogo_ops;		/* bogo-ops at previous snapshot */
+} stress_metrics_socket_prev_t;
+
+static pid_t metrics_socket_pid = -1;	/* collector process pid */
+
+/*
+ *  stress_metrics_socket_proc_times()
+ *	sum user and system time and RSS of the stressor's
+ *	instances, straight from /proc so that the stressors
+ *	are never interrupted
+ */
+static void stress_metrics_socket_proc_times(
+	const stress_stressor_t *ss,
+	double *utime,
+	double *stime,
+	uint64_t *rss_kb)
+{
+#if defined(__linux__)
+	const double ticks = (double)sysconf(_SC_CLK_TCK);
+	const uint64_t page_kb = (uint64_t)stress_get_page_size() / KB;
+	int32_t j;
+
+	*utime = 0.0;
+	*stime = 0.0;
+	*rss_kb = 0;
+	if (ticks <= 0.0)
+		return;
+
+	for (j = 0; j < ss->instances; j++) {
+		const pid_t pid = ss->stats[j]->s_pid.pid;
+		char path[64], buf[1024], *ptr;
+		unsigned long int ut, st;
+		long int rss;
+		ssize_t n;
+		int fd;
+
+		if (pid <= 0)
+			continue;
+		(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/stat", (intmax_t)pid);
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			continue;
+		n = read(fd, buf, sizeof(buf) - 1);
+		(void)close(fd);
+		if (n <= 0)
+			continue;
+		buf[n] = '\0';
+
+		/* skip over pid and (comm) as comm may contain spaces */
+		ptr = strrchr(buf, ')');
+		if (!ptr)
+			continue;
+		if (sscanf(ptr + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+			   "%lu %lu %*d %*d %*d %*d %*d %*d %*u %*u %ld",
+			   &ut, &st, &rss) != 3)
+			continue;
+		*utime += (double)ut / ticks;
+		*stime += (double)st / ticks;
+		*rss_kb += (uint64_t)rss * page_kb;
+	}
+#else
+	(void)ss;
+
+	*utime = 0.0;
+	*stime = 0.0;
+	*rss_kb = 0;
+#endif
+}
+
+/*
+ *  stress_metrics_socket_snapshot()
+ *	format a newline terminated json snapshot of all the stressors
+ *	into buf, returns the length of the snapshot
+ */
+static size_t stress_metrics_socket_snapshot(
+	char *buf,
+	const size_t len,
+	stress_stressor_t *stressors_list,
+	stress_metrics_socket_prev_t *prev,
+	const double t_now,
+	const double interval)
+{
+	stress_stressor_t *ss;
+	char *ptr = buf;
+	const char *end = buf + len - 2;	/* room for "\n\0" */
+	size_t i = 0, n;
+	bool first = true;
+	int ret;
+
+#define STRESS_JSON_APPEND(fmt, ...)				\
+	do {							\
+		ret = snprintf(ptr, (size_t)(end - ptr), fmt, __VA_ARGS__); \
+		if ((ret < 0) || (ret >= (end - ptr)))		\
+			goto truncated;				\
+		ptr += ret;					\
+	} while (0)
+
+	STRESS_JSON_APPEND("{\"time\":%.3f,\"run-time\":%.3f,\"interval\":%.3f,"
+		"\"instances\":{\"started\":%" PRIu32 ",\"exited\":%" PRIu32
+		",\"reaped\":%" PRIu32 ",\"failed\":%" PRIu32 "},\"stressors\":[",
+		t_now, t_now - g_shared->time_started, interval,
+		g_shared->instance_count.started,
+		g_shared->instance_count.exited,
+		g_shared->instance_count.reaped,
+		g_shared->instance_count.failed);
+
+	for (ss = stressors_list; ss; ss = ss->next, i++) {
+		uint64_t bogo_ops = 0, delta, rss_kb;
+		double utime, stime, run_time;
+		char name[128];
+		int32_t j;
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+
+		for (j = 0; j < ss->instances; j++)
+			bogo_ops += ss->stats[j]->args.bogo.ci.counter;
+		/* counters are reset if a stressor is re-run, so restart the delta */
+		delta = (bogo_ops >= prev[i].bogo_ops) ? bogo_ops - prev[i].bogo_ops : bogo_ops;
+		prev[i].bogo_ops = bogo_ops;
+		run_time = t_now - g_shared->time_started;
+
+		stress_metrics_socket_proc_times(ss, &utime, &stime, &rss_kb);
+
+		STRESS_JSON_APPEND("%s{\"stressor\":\"%s\",\"instances\":%" PRId32
+			",\"bogo-ops\":%" PRIu64 ",\"bogo-ops-per-second\":%.2f"
+			",\"bogo-ops-per-second-mean\":%.2f,\"user-time\":%.2f"
+			",\"system-time\":%.2f,\"rss-kb\":%" PRIu64 "}",
+			first ? "" : ",", stress_json_escape(name, sizeof(name), ss->stressor->name), ss->instances,
+			bogo_ops, (interval > 0.0) ? (double)delta / interval : 0.0,
+			(run_time > 0.0) ? (double)bogo_ops / run_time : 0.0,
+			utime, stime, rss_kb);
+		first = false;
+	}
+	STRESS_JSON_APPEND("%s", "],");
+	/* keep room for the closing brace */
+	n = stress_vmstat_json(ptr, (size_t)(end - ptr) - 1, interval);
+	if (n == 0)
+		ptr--;	/* no vmstat members, drop the separator */
+	else
+		ptr += n;
+	STRESS_JSON_APPEND("%s", "}");
+#undef STRESS_JSON_APPEND
+	*ptr++ = '\n';
+	*ptr = '\0';
+	return (size_t)(ptr - buf);
+
+truncated:
+	/* drop the snapshot rather than send malformed json */
+	*buf = '\0';
+	return 0;
+}
+
+/*
+ *  stress_metrics_socket_listen()
+ *	create the non-blocking listening socket
+ */
+static int stress_metrics_socket_listen(const char *path)
+{
+	struct sockaddr_un addr;
+	struct stat statbuf;
+	int fd, flags;
+
+	/* remove a stale socket, but never anything else */
+	if ((lstat(path, &statbuf) == 0) && S_ISSOCK(statbuf.st_mode))
+		(void)unlink(path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	(void)shim_memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	(void)shim_strscpy(addr.sun_path, path, sizeof(addr.sun_path));
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+		goto err;
+	if (listen(fd, METRICS_SOCKET_CLIENTS_MAX) < 0)
+		goto err;
+	flags = fcntl(fd, F_GETFL, 0);
+	if ((flags < 0) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0))
+		goto err;
+	return fd;
+err:
+	(void)close(fd);
+	return -1;
+}
+
+/*
+ *  stress_metrics_socket_accept()
+ *	accept any pending readers
+ */
+static void stress_metrics_socket_accept(const int listen_fd, int *clients)
+{
+	for (;;) {
+		size_t i;
+		int fd;
+
+		fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0)
+			return;
+		for (i = 0; i < METRICS_SOCKET_CLIENTS_MAX; i++) {
+			if (clients[i] < 0) {
+				clients[i] = fd;
+				break;
+			}
+		}
+		if (i == METRICS_SOCKET_CLIENTS_MAX)
+			(void)close(fd);
+	}
+}
+
+/*
+ *  stress_metrics_socket_send()
+ *	send a snapshot to all readers, readers that cannot keep
+ *	up are disconnected rather than being waited for
+ */
+static void stress_metrics_socket_send(int *clients, const char *buf, const size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < METRICS_SOCKET_CLIENTS_MAX; i++) {
+		ssize_t ret;
+
+		if (clients[i] < 0)
+			continue;
+#if defined(MSG_NOSIGNAL)
+		ret = send(clients[i], buf, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+#else
+		ret = send(clients[i], buf, len, MSG_DONTWAIT);
+#endif
+		if (ret != (ssize_t)len) {
+			(void)close(clients[i]);
+			clients[i] = -1;
+		}
+	}
+}
+
+/*
+ *  stress_metrics_socket_collector()
+ *	serve json snapshots to readers until the run completes
+ */
+static void NORETURN stress_metrics_socket_collector(
+	const char *path,
+	stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	stress_metrics_socket_prev_t *prev;
+	int clients[METRICS_SOCKET_CLIENTS_MAX];
+	int listen_fd;
+	size_t i, n = 0;
+	char *buf;
+	double t_prev, t_next;
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stat [metrics-socket]");
+	(void)signal(SIGPIPE, SIG_IGN);
+
+	for (ss = stressors_list; ss; ss = ss->next)
+		n++;
+	prev = (stress_metrics_socket_prev_t *)calloc(n + 1, sizeof(*prev));
+	buf = (char *)malloc(METRICS_SOCKET_BUF_SIZE);
+	if (!prev || !buf) {
+		pr_inf("metrics-socket: cannot allocate snapshot buffers, "
+			"disabling metrics socket\n");
+		free(buf);
+		free(prev);
+		_exit(EXIT_NO_RESOURCE);
+	}
+
+	listen_fd = stress_metrics_socket_listen(path);
+	if (listen_fd < 0) {
+		pr_inf("metrics-socket: cannot create socket '%s', errno=%d (%s), "
+			"disabling metrics socket\n", path, errno, strerror(errno));
+		free(buf);
+		free(prev);
+		_exit(EXIT_NO_RESOURCE);
+	}
+	pr_dbg("metrics-socket: serving json snapshots on '%s'\n", path);
+
+	for (i = 0; i < METRICS_SOCKET_CLIENTS_MAX; i++)
+		clients[i] = -1;
+
+	/* prime vmstat deltas */
+	(void)stress_vmstat_json(buf, METRICS_SOCKET_BUF_SIZE, 0.0);
+
+	t_prev = stress_time_now();
+	t_next = t_prev + METRICS_SOCKET_INTERVAL;
+
+	while (stress_continue_flag()) {
+		struct pollfd pfd;
+		double t_now = stress_time_now();
+		int timeout_ms;
+
+		if (t_now >= t_next) {
+			size_t len;
+
+			stress_metrics_socket_accept(listen_fd, clients);
+			len = stress_metrics_socket_snapshot(buf, METRICS_SOCKET_BUF_SIZE,
+					stressors_list, prev, t_now, t_now - t_prev);
+			if (len)
+				stress_metrics_socket_send(clients, buf, len);
+			t_prev = t_now;
+			t_next += METRICS_SOCKET_INTERVAL;
+			if (t_next < t_now)
+				t_next = t_now + METRICS_SOCKET_INTERVAL;
+			continue;
+		}
+
+		/* wait for new readers until the next snapshot is due */
+		timeout_ms = (int)((t_next - t_now) * 1000.0) + 1;
+		pfd.fd = listen_fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if ((poll(&pfd, 1, timeout_ms) > 0) && (pfd.revents & POLLIN))
+			stress_metrics_socket_accept(listen_fd, clients);
+	}
+
+	for (i = 0; i < METRICS_SOCKET_CLIENTS_MAX; i++) {
+		if (clients[i] >= 0)
+			(void)close(clients[i]);
+	}
+	(void)close(listen_fd);
+	free(buf);
+	free(prev);
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_set_metrics_socket()
+ *	parse --metrics-socket option
+ */
+int stress_set_metrics_socket(const char *const opt)
+{
+	struct sockaddr_un addr;
+
+	if (strlen(opt) >= sizeof(addr.sun_path)) {
+		(void)fprintf(stderr, "metrics-socket path must be less than %zu characters\n",
+			sizeof(addr.sun_path));
+		return -1;
+	}
+	return stress_set_setting_global("metrics-socket", TYPE_ID_STR, (void *)opt);
+}
+
+/*
+ *  stress_metrics_socket_start()
+ *	start the metrics socket collector process
+ */
+void stress_metrics_socket_start(stress_stressor_t *stressors_list)
+{
+	char *path = NULL;
+
+	if (!stress_get_setting("metrics-socket", &path) || !path)
+		return;
+
+	metrics_socket_pid = fork();
+	if (metrics_socket_pid < 0) {
+		pr_inf("metrics-socket: cannot fork collector, errno=%d (%s), "
+			"disabling metrics socket\n", errno, strerror(errno));
+		return;
+	} else if (metrics_socket_pid > 0) {
+		return;
+	}
+	stress_metrics_socket_collector(path, stressors_list);
+}
+
+/*
+ *  stress_metrics_socket_stop()
+ *	stop the metrics socket collector process
+ */
+void stress_metrics_socket_stop(void)
+{
+	char *path = NULL;
+
+	if (metrics_socket_pid > 0) {
+		(void)stress_kill_pid_wait(metrics_socket_pid, NULL);
+		metrics_socket_pid = -1;
+		if (stress_get_setting("metrics-socket", &path) && path) {
+			struct stat statbuf;
+
+			if ((lstat(path, &statbuf) == 0) && S_ISSOCK(statbuf.st_mode))
+				(void)unlink(path);
+		}
+	}
+}
+
+#else
+
+/*
+ *  stress_set_metrics_socket()
+ *	parse --metrics-socket option
+ */
+int stress_set_metrics_socket(const char *const opt)
+{
+	(void)opt;
+
+	(void)fprintf(stderr, "metrics-socket is not supported on this system\n");
+	return -1;
+}
+
+void stress_metrics_socket_start(stress_stressor_t *stressors_list)
+{
+	(void)stressors_list;
+}
+
+void stress_metrics_socket_stop(void)
+{
+}
+#endif
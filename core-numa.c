@@ -21,6 +21,8 @@
 #include "core-builtin.h"
 #include "core-numa.h"
 
+#include <ctype.h>
+
 #if defined(HAVE_LINUX_MEMPOLICY_H)
 #include <linux/mempolicy.h>
 #endif
@@ -228,6 +230,56 @@ void stress_numa_mask_free(stress_numa_mask_t *numa_mask)
 	free(numa_mask);
 }
 
+/*
+ *  stress_numa_cpulist_has()
+ *	return true if cpu is in a sysfs CPU list such as 0-3,8-11
+ */
+static bool stress_numa_cpulist_has(const char *list, const int32_t cpu)
+{
+	const char *ptr = list;
+
+	while (*ptr) {
+		int lo, hi;
+		char *end;
+
+		if (!isdigit((unsigned char)*ptr))
+			break;
+		lo = (int)strtol(ptr, &end, 10);
+		hi = lo;
+		if (*end == '-')
+			hi = (int)strtol(end + 1, &end, 10);
+		if ((cpu >= lo) && (cpu <= hi))
+			return true;
+		if (*end != ',')
+			break;
+		ptr = end + 1;
+	}
+	return false;
+}
+
+/*
+ *  stress_numa_cpu_node()
+ *	find the NUMA node of cpu, 0 if there is no NUMA information
+ */
+int32_t stress_numa_cpu_node(const int32_t cpu)
+{
+	const unsigned long int nodes = stress_numa_nodes();
+	int32_t node;
+
+	for (node = 0; nodes > 1 && node < 1024; node++) {
+		char filename[PATH_MAX];
+		char buf[4096];
+
+		(void)snprintf(filename, sizeof(filename),
+			"/sys/devices/system/node/node%" PRId32 "/cpulist", node);
+		if (stress_system_read(filename, buf, sizeof(buf)) < 1)
+			continue;
+		if (stress_numa_cpulist_has(buf, cpu))
+			return node;
+	}
+	return 0;
+}
+
 #if defined(__NR_get_mempolicy) &&      \
     defined(__NR_mbind) &&              \
     defined(__NR_migrate_pages) &&      \
@@ -88,6 +88,7 @@ typedef struct stress_numa_mask {
 #endif
 
 extern unsigned long int stress_numa_count_mem_nodes(unsigned long int *max_node);
+extern int32_t stress_numa_cpu_node(const int32_t cpu);
 extern unsigned long int stress_numa_mask_nodes_get(stress_numa_mask_t *numa_mask);
 extern unsigned long stress_numa_next_node(const unsigned long int node,
 	stress_numa_mask_t *numa_nodes);
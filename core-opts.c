@@ -75,6 +75,7 @@ const struct option stress_long_options[] = {
 	{ "bitops",		1,	0,	OPT_bitops },
 	{ "bitops-method",	1,	0,	OPT_bitops_method },
 	{ "bitops-ops",		1,	0,	OPT_bitops_ops },
+	{ "bogo-batch",		1,	0,	OPT_bogo_batch },
 	{ "branch",		1,	0,	OPT_branch },
 	{ "branch-ops",		1,	0,	OPT_branch_ops },
 	{ "brk",		1,	0,	OPT_brk },
@@ -130,6 +131,9 @@ const struct option stress_long_options[] = {
 	{ "chroot",		1,	0, 	OPT_chroot},
 	{ "chroot-ops",		1,	0,	OPT_chroot_ops },
 	{ "cgroup",		1,	0,	OPT_cgroup },
+	{ "cgroup-mem-bench",	0,	0,	OPT_cgroup_mem_bench },
+	{ "cgroup-mem-high",	1,	0,	OPT_cgroup_mem_high },
+	{ "cgroup-mem-max",	1,	0,	OPT_cgroup_mem_max },
 	{ "cgroup-ops",		1,	0,	OPT_cgroup_ops },
 	{ "class",		1,	0,	OPT_class },
 	{ "clock",		1,	0,	OPT_clock },
@@ -139,6 +143,8 @@ const struct option stress_long_options[] = {
 	{ "clone-ops",		1,	0,	OPT_clone_ops },
 	{ "close",		1,	0,	OPT_close },
 	{ "close-ops",		1,	0,	OPT_close_ops },
+	{ "compare",		0,	0,	OPT_compare },
+	{ "compare-window",	1,	0,	OPT_compare_window },
 	{ "config",		0,	0,	OPT_config },
 	{ "context",		1,	0,	OPT_context },
 	{ "context-ops",	1,	0,	OPT_context_ops },
@@ -256,6 +262,7 @@ const struct option stress_long_options[] = {
 	{ "far-branch-pageout",	0,	0,	OPT_far_branch_pageout },
 	{ "far-branch-pages",	1,	0,	OPT_far_branch_pages },
 	{ "fault",		1,	0,	OPT_fault },
+	{ "fault-bench",	0,	0,	OPT_fault_bench },
 	{ "fault-ops",		1,	0,	OPT_fault_ops },
 	{ "fcntl",		1,	0,	OPT_fcntl},
 	{ "fcntl-ops",		1,	0,	OPT_fcntl_ops },
@@ -360,6 +367,7 @@ const struct option stress_long_options[] = {
 	{ "handle",		1,	0,	OPT_handle },
 	{ "handle-ops",		1,	0,	OPT_handle_ops },
 	{ "hash",		1,	0,	OPT_hash },
+	{ "hash-bulk",		0,	0,	OPT_hash_bulk },
 	{ "hash-method",	1,	0,	OPT_hash_method },
 	{ "hash-ops",		1,	0,	OPT_hash_ops },
 	{ "hdd",		1,	0,	OPT_hdd },
@@ -451,6 +459,13 @@ const struct option stress_long_options[] = {
 	{ "klog-check",		0,	0,	OPT_klog_check },
 	{ "klog-ops",		1,	0,	OPT_klog_ops },
 	{ "ksm",		0,	0,	OPT_ksm },
+	{ "ksm-merge",		1,	0,	OPT_ksm_merge },
+	{ "ksm-merge-bytes",	1,	0,	OPT_ksm_merge_bytes },
+	{ "ksm-merge-dup",	1,	0,	OPT_ksm_merge_dup },
+	{ "ksm-merge-ops",	1,	0,	OPT_ksm_merge_ops },
+	{ "ksm-merge-pages-to-scan", 1,	0,	OPT_ksm_merge_pages_to_scan },
+	{ "ksm-merge-sleep",	1,	0,	OPT_ksm_merge_sleep },
+	{ "ksm-merge-zero",	0,	0,	OPT_ksm_merge_zero },
 	{ "kvm",		1,	0,	OPT_kvm },
 	{ "kvm-ops",		1,	0,	OPT_kvm_ops },
 	{ "l1cache",		1,	0, 	OPT_l1cache },
@@ -529,6 +544,7 @@ const struct option stress_long_options[] = {
 	{ "matrix-method",	1,	0,	OPT_matrix_method },
 	{ "matrix-ops",		1,	0,	OPT_matrix_ops },
 	{ "matrix-size",	1,	0,	OPT_matrix_size },
+	{ "matrix-threads",	1,	0,	OPT_matrix_threads },
 	{ "matrix-yx",		0,	0,	OPT_matrix_yx },
 	{ "matrix-3d",		1,	0,	OPT_matrix_3d },
 	{ "matrix-3d-method",	1,	0,	OPT_matrix_3d_method },
@@ -546,6 +562,7 @@ const struct option stress_long_options[] = {
 	{ "memcpy",		1,	0,	OPT_memcpy },
 	{ "memcpy-method",	1,	0,	OPT_memcpy_method },
 	{ "memcpy-ops",		1,	0,	OPT_memcpy_ops },
+	{ "memcpy-sweep",	0,	0,	OPT_memcpy_sweep },
 	{ "memfd",		1,	0,	OPT_memfd },
 	{ "memfd-bytes",	1,	0,	OPT_memfd_bytes },
 	{ "memfd-fds",		1,	0,	OPT_memfd_fds },
@@ -560,6 +577,7 @@ const struct option stress_long_options[] = {
 	{ "memrate",		1,	0,	OPT_memrate },
 	{ "memrate-bytes",	1,	0,	OPT_memrate_bytes },
 	{ "memrate-flush",	0,	0,	OPT_memrate_flush },
+	{ "memrate-loaded-latency",0,	0,	OPT_memrate_loaded_latency },
 	{ "memrate-method",	1,	0,	OPT_memrate_method },
 	{ "memrate-ops",	1,	0,	OPT_memrate_ops },
 	{ "memrate-rd-mbs",	1,	0,	OPT_memrate_rd_mbs },
@@ -576,6 +594,7 @@ const struct option stress_long_options[] = {
         { "metamix-bytes",	1,	0,	OPT_metamix_bytes },
 	{ "metrics",		0,	0,	OPT_metrics },
 	{ "metrics-brief",	0,	0,	OPT_metrics_brief },
+	{ "metrics-socket",	1,	0,	OPT_metrics_socket },
 	{ "mincore",		1,	0,	OPT_mincore },
 	{ "mincore-ops",	1,	0,	OPT_mincore_ops },
 	{ "mincore-random",	0,	0,	OPT_mincore_rand },
@@ -720,6 +739,9 @@ const struct option stress_long_options[] = {
 	{ "numa-ops",		1,	0,	OPT_numa_ops },
 	{ "numa-shuffle-addr",	0,	0,	OPT_numa_shuffle_addr },
 	{ "numa-shuffle-node",	0,	0,	OPT_numa_shuffle_node },
+	{ "numa-migrate",	1,	0,	OPT_numa_migrate },
+	{ "numa-migrate-bytes",	1,	0,	OPT_numa_migrate_bytes },
+	{ "numa-migrate-ops",	1,	0,	OPT_numa_migrate_ops },
 	{ "oomable",		0,	0,	OPT_oomable },
 	{ "oom-avoid",		0,	0,	OPT_oom_avoid },
 	{ "oom-avoid-bytes",	1,	0,	OPT_oom_avoid_bytes },
@@ -732,6 +754,8 @@ const struct option stress_long_options[] = {
 	{ "open-fd",		0,	0,	OPT_open_fd },
 	{ "open-max",		1,	0,	OPT_open_max },
 	{ "open-ops",		1,	0,	OPT_open_ops },
+	{ "pace-rate",		1,	0,	OPT_pace_rate },
+	{ "pace-util",		1,	0,	OPT_pace_util },
 	{ "page-in",		0,	0,	OPT_page_in },
 	{ "pagemove",		1,	0,	OPT_pagemove },
 	{ "pagemove-bytes",	1,	0,	OPT_pagemove_bytes },
@@ -741,6 +765,11 @@ const struct option stress_long_options[] = {
 	{ "pageswap",		1,	0,	OPT_pageswap },
 	{ "pageswap-ops",	1,	0,	OPT_pageswap_ops },
 	{ "parallel",		1,	0,	OPT_all },
+	{ "parsort",		1,	0,	OPT_parsort },
+	{ "parsort-method",	1,	0,	OPT_parsort_method },
+	{ "parsort-ops",	1,	0,	OPT_parsort_ops },
+	{ "parsort-size",	1,	0,	OPT_parsort_size },
+	{ "parsort-threads",	1,	0,	OPT_parsort_threads },
 	{ "pathological",	0,	0,	OPT_pathological },
 	{ "pause",		1,	0,	OPT_pause },
 	{ "pci",		1,	0,	OPT_pci},
@@ -750,6 +779,7 @@ const struct option stress_long_options[] = {
 #if defined(STRESS_PERF_STATS) && 	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	{ "perf",		0,	0,	OPT_perf_stats },
+	{ "perf-sample",	1,	0,	OPT_perf_sample },
 #endif
 	{ "permute",		1,	0,	OPT_permute },
 	{ "personality",	1,	0,	OPT_personality },
@@ -778,6 +808,7 @@ const struct option stress_long_options[] = {
 	{ "pipeherd-yield", 	0,	0,	OPT_pipeherd_yield },
 	{ "pkey",		1,	0,	OPT_pkey },
 	{ "pkey-ops",		1,	0,	OPT_pkey_ops },
+	{ "placement",		1,	0,	OPT_placement },
 	{ "plugin",		1,	0,	OPT_plugin },
 	{ "plugin-method",	1,	0,	OPT_plugin_method },
 	{ "plugin-ops",		1,	0,	OPT_plugin_ops },
@@ -821,6 +852,8 @@ const struct option stress_long_options[] = {
 	{ "ptr-chase",		1,	0,	OPT_ptr_chase },
 	{ "ptr-chase-ops",	1,	0,	OPT_ptr_chase_ops },
 	{ "ptr-chase-pages",	1,	0,	OPT_ptr_chase_pages },
+	{ "ptr-chase-sweep",	0,	0,	OPT_ptr_chase_sweep },
+	{ "ptr-chase-sweep-max",	1,	0,	OPT_ptr_chase_sweep_max },
 	{ "pty",		1,	0,	OPT_pty },
 	{ "pty-max",		1,	0,	OPT_pty_max },
 	{ "pty-ops",		1,	0,	OPT_pty_ops },
@@ -884,6 +917,7 @@ const struct option stress_long_options[] = {
 	{ "rename-ops",		1,	0,	OPT_rename_ops },
 	{ "resched",		1,	0,	OPT_resched },
 	{ "resched-ops",	1,	0,	OPT_resched_ops },
+	{ "results-db",		1,	0,	OPT_results_db },
 	{ "resources",		1,	0,	OPT_resources },
 	{ "resources-mlock",	0,	0,	OPT_resources_mlock },
 	{ "resources-ops",	1,	0,	OPT_resources_ops },
@@ -1071,6 +1105,7 @@ const struct option stress_long_options[] = {
 	{ "stack-unmap",	0,	0,	OPT_stack_unmap },
 	{ "stackmmap",		1,	0,	OPT_stackmmap },
 	{ "stackmmap-ops",	1,	0,	OPT_stackmmap_ops },
+	{ "start-tree",		0,	0,	OPT_start_tree },
 	{ "statmount",		1,	0,	OPT_statmount },
 	{ "statmount-ops",	1,	0,	OPT_statmount_ops },
 	{ "status",		1,	0,	OPT_status },
@@ -1084,11 +1119,15 @@ const struct option stress_long_options[] = {
 	{ "stream-l3-size",	1,	0,	OPT_stream_l3_size },
 	{ "stream-madvise",	1,	0,	OPT_stream_madvise },
 	{ "stream-mlock",	0,	0,	OPT_stream_mlock },
+	{ "stream-numa-matrix",	0,	0,	OPT_stream_numa_matrix },
 	{ "stream-ops",		1,	0,	OPT_stream_ops },
 	{ "stream-prefetch",	0,	0,	OPT_stream_prefetch },
+	{ "stream-threads",	1,	0,	OPT_stream_threads },
 	{ "stressor-time",	0,	0,	OPT_stressor_time },
 	{ "stressors",		0,	0,	OPT_stressors },
 	{ "swap",		1,	0,	OPT_swap },
+	{ "swap-bench",		0,	0,	OPT_swap_bench },
+	{ "swap-bench-bytes",	1,	0,	OPT_swap_bench_bytes },
 	{ "swap-ops",		1,	0,	OPT_swap_ops },
 	{ "swap-self",		0,	0,	OPT_swap_self },
 	{ "switch",		1,	0,	OPT_switch },
@@ -1166,6 +1205,8 @@ const struct option stress_long_options[] = {
 	{ "thermalstat",	1,	0,	OPT_thermalstat },
 	{ "thrash",		0,	0,	OPT_thrash },
 	{ "times",		0,	0,	OPT_times },
+	{ "timeseries",	1,	0,	OPT_timeseries },
+	{ "timeseries-csv",	1,	0,	OPT_timeseries_csv },
 	{ "timestamp",		0,	0,	OPT_timestamp },
 	{ "tz",			0,	0,	OPT_thermal_zones },
 	{ "tun",		1,	0,	OPT_tun},
@@ -1210,6 +1251,11 @@ const struct option stress_long_options[] = {
 	{ "vecfp",		1,	0,	OPT_vecfp },
 	{ "vecfp-method",	1,	0,	OPT_vecfp_method },
 	{ "vecfp-ops",		1,	0,	OPT_vecfp_ops },
+	{ "vecfreq",		1,	0,	OPT_vecfreq },
+	{ "vecfreq-cores",	1,	0,	OPT_vecfreq_cores },
+	{ "vecfreq-duration",	1,	0,	OPT_vecfreq_duration },
+	{ "vecfreq-method",	1,	0,	OPT_vecfreq_method },
+	{ "vecfreq-ops",	1,	0,	OPT_vecfreq_ops },
 	{ "vecmath",		1,	0,	OPT_vecmath },
 	{ "vecmath-ops",	1,	0,	OPT_vecmath_ops },
 	{ "vecshuf",		1,	0,	OPT_vecshuf },
@@ -1245,6 +1291,7 @@ const struct option stress_long_options[] = {
 #if defined(MAP_POPULATE)
 	{ "vm-populate",	0,	0,	OPT_vm_populate },
 #endif
+	{ "vm-thp-bench",	0,	0,	OPT_vm_thp_bench },
 	{ "vm-addr",		1,	0,	OPT_vm_addr },
 	{ "vm-addr-method",	1,	0,	OPT_vm_addr_method },
 	{ "vm-addr-mlock",	0,	0,	OPT_vm_addr_mlock },
@@ -1301,6 +1348,9 @@ const struct option stress_long_options[] = {
 	{ "zero-ops",		1,	0,	OPT_zero_ops },
 	{ "zero-read",		0,	0,	OPT_zero_read },
 	{ "zlib",		1,	0,	OPT_zlib },
+	{ "zlib-bench",		0,	0,	OPT_zlib_bench },
+	{ "zlib-bench-bytes",	1,	0,	OPT_zlib_bench_bytes },
+	{ "zlib-bench-threads",	1,	0,	OPT_zlib_bench_threads },
 	{ "zlib-level",		1,	0,	OPT_zlib_level },
 	{ "zlib-method",	1,	0,	OPT_zlib_method },
 	{ "zlib-mem-level",	1,	0,	OPT_zlib_mem_level },
@@ -216,6 +216,8 @@ typedef enum {
 	OPT_bitops_method,
 	OPT_bitops_ops,
 
+	OPT_bogo_batch,
+
 	OPT_branch,
 	OPT_branch_ops,
 
@@ -270,6 +272,9 @@ typedef enum {
 	OPT_cap_ops,
 
 	OPT_cgroup,
+	OPT_cgroup_mem_bench,
+	OPT_cgroup_mem_high,
+	OPT_cgroup_mem_max,
 	OPT_cgroup_ops,
 
 	OPT_chattr,
@@ -303,6 +308,9 @@ typedef enum {
 	OPT_context,
 	OPT_context_ops,
 
+	OPT_compare,
+	OPT_compare_window,
+
 	OPT_config,
 
 	OPT_copy_file,
@@ -447,6 +455,7 @@ typedef enum {
 	OPT_far_branch_pages,
 
 	OPT_fault,
+	OPT_fault_bench,
 	OPT_fault_ops,
 
 	OPT_fcntl,
@@ -585,6 +594,7 @@ typedef enum {
 
 	OPT_hash,
 	OPT_hash_ops,
+	OPT_hash_bulk,
 	OPT_hash_method,
 
 	OPT_hdd_bytes,
@@ -701,6 +711,14 @@ typedef enum {
 
 	OPT_ksm,
 
+	OPT_ksm_merge,
+	OPT_ksm_merge_bytes,
+	OPT_ksm_merge_dup,
+	OPT_ksm_merge_ops,
+	OPT_ksm_merge_pages_to_scan,
+	OPT_ksm_merge_sleep,
+	OPT_ksm_merge_zero,
+
 	OPT_kvm,
 	OPT_kvm_ops,
 
@@ -803,6 +821,7 @@ typedef enum {
 	OPT_matrix_ops,
 	OPT_matrix_size,
 	OPT_matrix_method,
+	OPT_matrix_threads,
 	OPT_matrix_yx,
 
 	OPT_matrix_3d,
@@ -824,6 +843,7 @@ typedef enum {
 	OPT_memcpy,
 	OPT_memcpy_ops,
 	OPT_memcpy_method,
+	OPT_memcpy_sweep,
 
 	OPT_memfd,
 	OPT_memfd_bytes,
@@ -841,6 +861,7 @@ typedef enum {
 	OPT_memrate,
 	OPT_memrate_bytes,
 	OPT_memrate_flush,
+	OPT_memrate_loaded_latency,
 	OPT_memrate_method,
 	OPT_memrate_ops,
 	OPT_memrate_rd_mbs,
@@ -860,6 +881,7 @@ typedef enum {
 	OPT_metamix_bytes,
 
 	OPT_metrics_brief,
+	OPT_metrics_socket,
 
 	OPT_mincore,
 	OPT_mincore_ops,
@@ -1043,6 +1065,9 @@ typedef enum {
 	OPT_numa_ops,
 	OPT_numa_shuffle_addr,
 	OPT_numa_shuffle_node,
+	OPT_numa_migrate,
+	OPT_numa_migrate_bytes,
+	OPT_numa_migrate_ops,
 
 	OPT_oomable,
 	OPT_oom_avoid,
@@ -1059,6 +1084,9 @@ typedef enum {
 	OPT_open_fd,
 	OPT_open_max,
 
+	OPT_pace_rate,
+	OPT_pace_util,
+
 	OPT_page_in,
 
 	OPT_pathological,
@@ -1074,11 +1102,18 @@ typedef enum {
 	OPT_pageswap,
 	OPT_pageswap_ops,
 
+	OPT_parsort,
+	OPT_parsort_method,
+	OPT_parsort_ops,
+	OPT_parsort_size,
+	OPT_parsort_threads,
+
 	OPT_pci,
 	OPT_pci_dev,
 	OPT_pci_ops,
 	OPT_pci_ops_rate,
 
+	OPT_perf_sample,
 	OPT_perf_stats,
 
 	OPT_permute,
@@ -1115,6 +1150,8 @@ typedef enum {
 	OPT_pkey,
 	OPT_pkey_ops,
 
+	OPT_placement,
+
 	OPT_plugin,
 	OPT_plugin_ops,
 	OPT_plugin_method,
@@ -1170,6 +1207,8 @@ typedef enum {
 	OPT_ptr_chase,
 	OPT_ptr_chase_ops,
 	OPT_ptr_chase_pages,
+	OPT_ptr_chase_sweep,
+	OPT_ptr_chase_sweep_max,
 
 	OPT_pty,
 	OPT_pty_ops,
@@ -1251,6 +1290,8 @@ typedef enum {
 	OPT_resched,
 	OPT_resched_ops,
 
+	OPT_results_db,
+
 	OPT_resources,
 	OPT_resources_mlock,
 	OPT_resources_ops,
@@ -1476,6 +1517,8 @@ typedef enum {
 	OPT_softlockup_ops,
 
 	OPT_swap,
+	OPT_swap_bench,
+	OPT_swap_bench_bytes,
 	OPT_swap_ops,
 	OPT_swap_self,
 
@@ -1513,6 +1556,8 @@ typedef enum {
 	OPT_stackmmap,
 	OPT_stackmmap_ops,
 
+	OPT_start_tree,
+
 	OPT_statmount,
 	OPT_statmount_ops,
 
@@ -1530,8 +1575,10 @@ typedef enum {
 	OPT_stream_l3_size,
 	OPT_stream_madvise,
 	OPT_stream_mlock,
+	OPT_stream_numa_matrix,
 	OPT_stream_ops,
 	OPT_stream_prefetch,
+	OPT_stream_threads,
 
 	OPT_stressor_time,
 
@@ -1599,6 +1646,9 @@ typedef enum {
 
 	OPT_times,
 
+	OPT_timeseries,
+	OPT_timeseries_csv,
+
 	OPT_timestamp,
 
 	OPT_time_warp,
@@ -1691,6 +1741,12 @@ typedef enum {
 	OPT_vecfp_ops,
 	OPT_vecfp_method,
 
+	OPT_vecfreq,
+	OPT_vecfreq_cores,
+	OPT_vecfreq_duration,
+	OPT_vecfreq_method,
+	OPT_vecfreq_ops,
+
 	OPT_vecmath,
 	OPT_vecmath_ops,
 
@@ -1726,6 +1782,7 @@ typedef enum {
 	OPT_vm_madvise,
 	OPT_vm_method,
 	OPT_vm_numa,
+	OPT_vm_thp_bench,
 
 	OPT_vm_addr,
 	OPT_vm_addr_method,
@@ -1798,6 +1855,9 @@ typedef enum {
 
 	OPT_zlib,
 	OPT_zlib_ops,
+	OPT_zlib_bench,
+	OPT_zlib_bench_bytes,
+	OPT_zlib_bench_threads,
 	OPT_zlib_level,
 	OPT_zlib_mem_level,
 	OPT_zlib_method,
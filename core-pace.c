@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-killpid.h"
+#include "core-pace.h"
+
+#include <math.h>
+
+/*
+ *  The pacing controller is a background process that reads the
+ *  shared bogo-op counters every period and grants each stressor
+ *  instance a budget of bogo-ops by lowering its bogo.max_ops
+ *  below the --ops limit kept in bogo.ops_limit. Instances that
+ *  reach max_ops drop out of the stress_continue() fast path into
+ *  stress_continue_paced() and nap until the controller grants
+ *  more ops. A PI loop corrects
+ *  the budget for the rate actually achieved.
+ */
+#define PACE_RATE_PERIOD	(0.1)		/* rate control period, seconds */
+#define PACE_UTIL_PERIOD	(0.25)		/* utilisation control period, seconds */
+#define PACE_UTIL_WARMUP	(4)		/* unthrottled periods to find peak rate */
+#define PACE_WAIT_NS		(1000000ULL)	/* 1ms nap when out of budget */
+#define PACE_KP			(0.5)		/* proportional gain */
+#define PACE_KI			(2.0)		/* integral gain */
+
+/* Per stressor controller state */
+typedef struct {
+	uint64_t last_count;		/* total bogo-ops at last period */
+	double integral;		/* integrated rate error */
+	double carry;			/* fractional ops not yet granted */
+	double peak;			/* peak unthrottled rate, utilisation mode */
+	uint32_t warmup;		/* periods run unthrottled, utilisation mode */
+	bool active;			/* instances were running last period */
+} stress_pace_state_t;
+
+static uint64_t pace_rate = 0;		/* target bogo-ops/sec per stressor */
+static uint32_t pace_util = 0;		/* target system CPU utilisation % */
+static pid_t pace_pid = -1;		/* controller process pid */
+
+/*
+ *  stress_set_pace_rate()
+ *	parse --pace-rate option
+ */
+int stress_set_pace_rate(const char *const opt)
+{
+	const uint64_t rate = stress_get_uint64(opt);
+
+	stress_check_range("pace-rate", rate, 1, 1000000000000ULL);
+	if (pace_util) {
+		(void)fprintf(stderr, "pace-rate cannot be used with pace-util.\n");
+		_exit(EXIT_FAILURE);
+	}
+	pace_rate = rate;
+	return 0;
+}
+
+/*
+ *  stress_set_pace_util()
+ *	parse --pace-util option
+ */
+int stress_set_pace_util(const char *const opt)
+{
+	const uint64_t util = stress_get_uint64(opt);
+
+	stress_check_range("pace-util", util, 1, 100);
+	if (pace_rate) {
+		(void)fprintf(stderr, "pace-util cannot be used with pace-rate.\n");
+		_exit(EXIT_FAILURE);
+	}
+	pace_util = (uint32_t)util;
+	return 0;
+}
+
+/*
+ *  stress_pace_enabled()
+ *	return true if stressors are to be paced by the controller
+ */
+bool stress_pace_enabled(void)
+{
+	return (pace_rate > 0) || (pace_util > 0);
+}
+
+/*
+ *  stress_continue_paced()
+ *	slow path of stress_continue(), called when an instance has
+ *	reached max_ops. Unpaced, max_ops is the --ops limit and this
+ *	returns false straight away, paced, nap until the controller
+ *	grants more ops or the stressor is told to stop.
+ */
+bool stress_continue_paced(stress_args_t *args)
+{
+	while ((args->bogo.ci.counter < args->bogo.ops_limit) && stress_continue_flag()) {
+		if (args->bogo.ci.counter < args->bogo.max_ops)
+			return true;
+		(void)shim_nanosleep_uint64(PACE_WAIT_NS);
+	}
+	return false;
+}
+
+/*
+ *  stress_pace_cpu_util()
+ *	read system wide busy and total CPU ticks from /proc/stat,
+ *	returns false if they cannot be read
+ */
+static bool stress_pace_cpu_util(uint64_t *busy, uint64_t *total)
+{
+	FILE *fp;
+	uint64_t user, nice, sys, idle, iowait, irq, softirq, steal;
+	int n;
+
+	fp = fopen("/proc/stat", "r");
+	if (!fp)
+		return false;
+	n = fscanf(fp, "cpu %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64
+		" %" SCNu64 " %" SCNu64 " %" SCNu64 " %" SCNu64,
+		&user, &nice, &sys, &idle, &iowait, &irq, &softirq, &steal);
+	(void)fclose(fp);
+	if (n != 8)
+		return false;
+
+	*busy = user + nice + sys + irq + softirq + steal;
+	*total = *busy + idle + iowait;
+	return true;
+}
+
+/*
+ *  stress_pace_grant()
+ *	share ops out between the running instances of a stressor
+ *	by moving their max_ops on, never past the --ops limit, an
+ *	unlimited grant lets the instances run at full speed
+ */
+static void stress_pace_grant(
+	stress_stressor_t *ss,
+	stress_pace_state_t *state,
+	const double ops,
+	const bool unlimited)
+{
+	double quota;
+	int32_t j;
+
+	if (unlimited) {
+		for (j = 0; j < ss->instances; j++) {
+			stress_args_t *args = &ss->stats[j]->args;
+
+			args->bogo.max_ops = args->bogo.ops_limit;
+		}
+		state->carry = 0.0;
+		return;
+	}
+
+	state->carry += ops;
+	quota = floor(state->carry / (double)ss->instances);
+	state->carry -= quota * (double)ss->instances;
+
+	for (j = 0; j < ss->instances; j++) {
+		stress_args_t *args = &ss->stats[j]->args;
+
+		args->bogo.max_ops = STRESS_MINIMUM(args->bogo.ops_limit,
+					args->bogo.ci.counter + (uint64_t)quota);
+	}
+}
+
+/*
+ *  stress_pace_count()
+ *	sum the bogo-op counters of a stressor, returns false
+ *	if none of its instances are running
+ */
+static bool stress_pace_count(stress_stressor_t *ss, uint64_t *count)
+{
+	bool active = false;
+	int32_t j;
+
+	*count = 0;
+	for (j = 0; j < ss->instances; j++) {
+		const stress_stats_t *stats = ss->stats[j];
+
+		*count += stats->args.bogo.ci.counter;
+		if ((stats->s_pid.pid > 0) && !stats->s_pid.reaped)
+			active = true;
+	}
+	return active;
+}
+
+/*
+ *  stress_pace_controller()
+ *	run the PI controller until the stressors are stopped
+ */
+static void NORETURN stress_pace_controller(
+	stress_stressor_t *stressors_list,
+	stress_pace_state_t *states)
+{
+	const double period = pace_rate ? PACE_RATE_PERIOD : PACE_UTIL_PERIOD;
+	const double target_util = (double)pace_util / 100.0;
+	stress_stressor_t *ss;
+	size_t i;
+	double t_prev, t_next, util_integral, duty = 1.0;
+	uint64_t busy_prev = 0, total_prev = 0;
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stat [pace]");
+
+	/* start the utilisation loop assuming stress-ng is the only load */
+	util_integral = target_util / PACE_KI;
+	if (pace_util && !stress_pace_cpu_util(&busy_prev, &total_prev))
+		pr_inf("pace: cannot read /proc/stat, utilisation will not be controlled\n");
+
+	t_prev = stress_time_now();
+	t_next = t_prev;
+
+	while (stress_continue_flag()) {
+		double now, dt, delta;
+
+		t_next += period;
+		delta = t_next - stress_time_now();
+		if (delta > 0.0)
+			(void)shim_nanosleep_uint64((uint64_t)(delta * STRESS_DBL_NANOSECOND));
+		if (!stress_continue_flag())
+			break;
+		now = stress_time_now();
+		dt = now - t_prev;
+		t_prev = now;
+		if (dt <= 0.0)
+			continue;
+
+		if (pace_util) {
+			uint64_t busy, total;
+
+			if (stress_pace_cpu_util(&busy, &total) && (total > total_prev)) {
+				const double util = (double)(busy - busy_prev) / (double)(total - total_prev);
+				const double err = target_util - util;
+
+				util_integral += err * dt;
+				util_integral = STRESS_MAXIMUM(util_integral, 0.0);
+				util_integral = STRESS_MINIMUM(util_integral, 1.0 / PACE_KI);
+				duty = (PACE_KP * err) + (PACE_KI * util_integral);
+				duty = STRESS_MAXIMUM(duty, 0.0);
+				duty = STRESS_MINIMUM(duty, 1.0);
+				busy_prev = busy;
+				total_prev = total;
+			}
+		}
+
+		for (i = 0, ss = stressors_list; ss; ss = ss->next, i++) {
+			stress_pace_state_t *state = &states[i];
+			uint64_t count;
+			double rate;
+
+			if (ss->ignore.run)
+				continue;
+
+			if (!stress_pace_count(ss, &count)) {
+				/* not started or finished, keep the loop idle */
+				(void)shim_memset(state, 0, sizeof(*state));
+				state->last_count = count;
+				continue;
+			}
+			if (!state->active) {
+				/* first period for this stressor, start afresh */
+				state->active = true;
+				state->last_count = count;
+				stress_pace_grant(ss, state, (double)pace_rate * period,
+						  pace_util && (state->warmup < PACE_UTIL_WARMUP));
+				continue;
+			}
+			rate = (count >= state->last_count) ?
+				(double)(count - state->last_count) / dt : 0.0;
+			state->last_count = count;
+
+			if (pace_rate) {
+				const double target = (double)pace_rate;
+				const double err = target - rate;
+				double allowed;
+
+				state->integral += err * dt;
+				state->integral = STRESS_MAXIMUM(state->integral, -target / PACE_KI);
+				state->integral = STRESS_MINIMUM(state->integral, target / PACE_KI);
+				allowed = target + (PACE_KP * err) + (PACE_KI * state->integral);
+				allowed = STRESS_MAXIMUM(allowed, 0.0);
+				allowed = STRESS_MINIMUM(allowed, 2.0 * target);
+				stress_pace_grant(ss, state, allowed * period, false);
+			} else {
+				const bool warming = state->warmup < PACE_UTIL_WARMUP;
+
+				if (warming || (duty >= 1.0))
+					state->peak = STRESS_MAXIMUM(state->peak, rate);
+				if (warming)
+					state->warmup++;
+				stress_pace_grant(ss, state, duty * state->peak * period,
+						  warming || (duty >= 1.0));
+			}
+		}
+	}
+	_exit(0);
+}
+
+/*
+ *  stress_pace_start()
+ *	start the pacing controller if --pace-rate or
+ *	--pace-util has been used
+ */
+void stress_pace_start(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	stress_pace_state_t *states;
+	size_t n = 0;
+
+	if (!stress_pace_enabled())
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next)
+		n++;
+	states = (stress_pace_state_t *)calloc(n, sizeof(*states));
+	if (!states) {
+		pr_inf("pace: cannot allocate controller state, "
+			"stressors will not be paced\n");
+		pace_rate = 0;
+		pace_util = 0;
+		return;
+	}
+
+	if (pace_rate)
+		pr_dbg("pace: holding each stressor at %" PRIu64 " bogo-ops per second\n", pace_rate);
+	else
+		pr_dbg("pace: holding system CPU utilisation at %" PRIu32 "%%\n", pace_util);
+
+	pace_pid = fork();
+	if (pace_pid < 0) {
+		pr_inf("pace: cannot fork controller, errno=%d (%s), "
+			"stressors will not be paced\n",
+			errno, strerror(errno));
+		pace_rate = 0;
+		pace_util = 0;
+	} else if (pace_pid == 0) {
+		stress_pace_controller(stressors_list, states);
+	}
+	free(states);
+}
+
+/*
+ *  stress_pace_stop()
+ *	stop the pacing controller
+ */
+void stress_pace_stop(void)
+{
+	if (pace_pid > 0) {
+		(void)stress_kill_pid_wait(pace_pid, NULL);
+		pace_pid = -1;
+	}
+}
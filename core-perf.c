@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-killpid.h"
 #include "core-lock.h"
 #include "core-perf.h"
 #include "core-perf-event.h"
@@ -26,6 +27,10 @@
 #include <ctype.h>
 #include <sys/ioctl.h>
 
+#if defined(HAVE_LINK_H)
+#include <link.h>
+#endif
+
 #if defined(HAVE_LINUX_PERF_EVENT_H)
 #include <linux/perf_event.h>
 #endif
@@ -487,6 +492,8 @@ int stress_perf_open(stress_perf_t *sp)
 	for (i = 0; i < STRESS_PERF_MAX; i++) {
 		sp->perf_stat[i].fd = -1;
 		sp->perf_stat[i].counter = 0;
+		sp->perf_stat[i].time_enabled = 0;
+		sp->perf_stat[i].time_running = 0;
 	}
 
 	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
@@ -617,18 +624,27 @@ int stress_perf_close(stress_perf_t *sp)
 
 		(void)shim_memset(&data, 0, sizeof(data));
 		ret = read(fd, &data, sizeof(data));
-		if (ret != sizeof(data))
+		if (ret != sizeof(data)) {
 			sp->perf_stat[i].counter = STRESS_PERF_INVALID;
-		else {
+		} else if ((data.time_running == 0) && (data.time_enabled != 0)) {
+			/*
+			 *  Event was enabled but never got a hardware
+			 *  counter because of multiplexing, there is
+			 *  nothing to scale so flag it as invalid
+			 */
+			sp->perf_stat[i].counter = STRESS_PERF_INVALID;
+		} else {
 			/* Ensure we don't get division by zero */
 			if (data.time_running == 0) {
-				scale = (data.time_enabled == 0) ? 1.0 : 0.0;
+				scale = 1.0;
 			} else {
 				scale = (double)data.time_enabled /
 					(double)data.time_running;
 			}
 			sp->perf_stat[i].counter = (uint64_t)
 				((double)data.counter * scale);
+			sp->perf_stat[i].time_enabled = data.time_enabled;
+			sp->perf_stat[i].time_running = data.time_running;
 		}
 		(void)close(fd);
 		sp->perf_stat[i].fd = -1;
@@ -731,6 +747,108 @@ static const perf_relative_t perf_relatives[] = {
 	  true, " (%6.3f%%)" },
 };
 
+/*
+ *  Derived metrics, ratio of a counter to a reference counter
+ *  or to the number of bogo-ops completed, multiplied by scale
+ */
+#define PERF_REF_BOGO_OPS	(~0U)
+
+typedef struct {
+	const unsigned int	type;
+	const unsigned long int	config;
+	const unsigned int	ref_type;	/* PERF_REF_BOGO_OPS for per bogo-op */
+	const unsigned long int	ref_config;
+	const double		scale;		/* 1000.0 for per kilo-instruction */
+	const char		*label;		/* human readable name */
+	const char		*yaml_label;	/* yaml field name */
+} perf_derived_t;
+
+static const perf_derived_t perf_derived[] = {
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CPU_CYCLES,
+	  1.0,		"Instructions per Cycle",	"ipc" },
+	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(L1D, READ, MISS),
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
+	  1000.0,	"L1D Read MPKI",		"l1d_read_mpki" },
+	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(LL, READ, MISS),
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
+	  1000.0,	"LLC Read MPKI",		"llc_read_mpki" },
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CACHE_MISSES,
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
+	  1000.0,	"Cache MPKI",			"cache_mpki" },
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_BRANCH_MISSES,
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
+	  1000.0,	"Branch MPKI",			"branch_mpki" },
+	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(DTLB, READ, MISS),
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
+	  1000.0,	"dTLB Read MPKI",		"dtlb_read_mpki" },
+	{ PERF_TYPE_HW_CACHE,	PERF_INFO_HW_CACHE_CONFIG(ITLB, READ, MISS),
+	  PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
+	  1000.0,	"iTLB Read MPKI",		"itlb_read_mpki" },
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_CPU_CYCLES,
+	  PERF_REF_BOGO_OPS,	0,
+	  1.0,		"Cycles per Bogo-op",		"cycles_per_bogo_op" },
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_INSTRUCTIONS,
+	  PERF_REF_BOGO_OPS,	0,
+	  1.0,		"Instructions per Bogo-op",	"instructions_per_bogo_op" },
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_STALLED_CYCLES_FRONTEND,
+	  PERF_REF_BOGO_OPS,	0,
+	  1.0,		"Frontend Stalls per Bogo-op",	"frontend_stalls_per_bogo_op" },
+	{ PERF_TYPE_HARDWARE,	PERF_COUNT_HW_STALLED_CYCLES_BACKEND,
+	  PERF_REF_BOGO_OPS,	0,
+	  1.0,		"Backend Stalls per Bogo-op",	"backend_stalls_per_bogo_op" },
+};
+
+/*
+ *  stress_perf_derived_dump()
+ *	emit metrics derived from the counter totals of a stressor,
+ *	metrics where either counter is not available are skipped
+ */
+static void stress_perf_derived_dump(
+	FILE *yaml,
+	const uint64_t *counter_totals,
+	const uint64_t bogo_ops)
+{
+	size_t i;
+	bool header = false;
+
+	for (i = 0; i < SIZEOF_ARRAY(perf_derived); i++) {
+		const perf_derived_t *pd = &perf_derived[i];
+		const size_t idx = stress_perf_info_find(pd->type, pd->config);
+		uint64_t ct, ref;
+		double value;
+
+		if (idx >= STRESS_PERF_MAX)
+			continue;
+		ct = counter_totals[idx];
+		if (ct == STRESS_PERF_INVALID)
+			continue;
+
+		if (pd->ref_type == PERF_REF_BOGO_OPS) {
+			ref = bogo_ops;
+		} else {
+			const size_t ref_idx = stress_perf_info_find(pd->ref_type, pd->ref_config);
+
+			if (ref_idx >= STRESS_PERF_MAX)
+				continue;
+			ref = counter_totals[ref_idx];
+			if (ref == STRESS_PERF_INVALID)
+				continue;
+		}
+		if (ref == 0)
+			continue;
+
+		value = pd->scale * (double)ct / (double)ref;
+		if (!header) {
+			pr_inf("%26s %s\n", "", "Derived Metrics:");
+			pr_yaml(yaml, "      derived:\n");
+			header = true;
+		}
+		pr_inf("%'26.3f %s\n", value, pd->label);
+		pr_yaml(yaml, "        %s: %f\n", pd->yaml_label, value);
+	}
+}
+
 /*
  *  stress_perf_stat_dump()
  *	emit perf statistics
@@ -748,7 +866,11 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 
 	for (ss = stressors_list; ss; ss = ss->next) {
 		int p;
+		int32_t j;
 		uint64_t counter_totals[STRESS_PERF_MAX];
+		uint64_t time_enabled[STRESS_PERF_MAX];
+		uint64_t time_running[STRESS_PERF_MAX];
+		uint64_t bogo_ops = 0;
 		bool got_data = false;
 		stress_perf_t *sp;
 
@@ -761,22 +883,29 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 			continue;
 
 		(void)shim_memset(counter_totals, 0, sizeof(counter_totals));
+		(void)shim_memset(time_enabled, 0, sizeof(time_enabled));
+		(void)shim_memset(time_running, 0, sizeof(time_running));
 
 		/* Sum totals across all instances of the stressor */
 		for (p = 0; (p < STRESS_PERF_MAX) && perf_info[p].label; p++) {
 			int32_t j;
 
 			for (j = 0; j < ss->instances; j++) {
-				const uint64_t counter = sp->perf_stat[p].counter;
+				const stress_perf_stat_t *ps = &ss->stats[j]->sp.perf_stat[p];
+				const uint64_t counter = ps->counter;
 
 				if (counter == STRESS_PERF_INVALID) {
 					counter_totals[p] = STRESS_PERF_INVALID;
 					break;
 				}
 				counter_totals[p] += counter;
+				time_enabled[p] += ps->time_enabled;
+				time_running[p] += ps->time_running;
 				got_data |= (counter > 0);
 			}
 		}
+		for (j = 0; j < ss->instances; j++)
+			bogo_ops += ss->stats[j]->counter_total;
 
 		if (!got_data)
 			continue;
@@ -791,9 +920,11 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 
 			if (label && (ct != STRESS_PERF_INVALID)) {
 				char extra[32];
+				char counted[32];
 				char yaml_label[128];
 				*extra = '\0';
 				size_t i;
+				double counted_percent = 100.0;
 
 				no_perf_stats = false;
 
@@ -813,9 +944,18 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 					}
 				}
 
-				pr_inf("%'26" PRIu64 " %-24s %s%s\n",
+				/* Counter was multiplexed and has been scaled up */
+				*counted = '\0';
+				if (time_running[p] < time_enabled[p]) {
+					counted_percent = 100.0 * (double)time_running[p] /
+							  (double)time_enabled[p];
+					(void)snprintf(counted, sizeof(counted),
+						" [%.1f%% counted]", counted_percent);
+				}
+
+				pr_inf("%'26" PRIu64 " %-24s %s%s%s\n",
 					ct, label, stress_perf_stat_scale(ct, duration),
-					extra);
+					extra, counted);
 
 				*yaml_label = '\0';
 				stress_perf_yaml_label(yaml_label, label, sizeof(yaml_label));
@@ -823,8 +963,12 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 					"\n", yaml_label, ct);
 				pr_yaml(yaml, "      %s_per_second: %f\n",
 					yaml_label, (double)ct / duration);
+				if (*counted)
+					pr_yaml(yaml, "      %s_counted_percent: %f\n",
+						yaml_label, counted_percent);
 			}
 		}
+		stress_perf_derived_dump(yaml, counter_totals, bogo_ops);
 		pr_yaml(yaml, "\n");
 	}
 	if (no_perf_stats) {
@@ -852,4 +996,688 @@ void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *stressors_list, const
 		}
 	}
 }
+
+/*
+ *  Sampling profiler, --perf-sample N. A helper process attaches a
+ *  CPU cycles (or CPU clock if there are no hardware counters)
+ *  sampling event to each stressor instance and drains the mmap'd
+ *  sample ring while the instance runs. Sampled IPs are resolved
+ *  to a symbol index and counted in a per stressor hash table in
+ *  shared memory, the parent then reports the top N symbols.
+ */
+#define PERF_SAMPLE_FREQ	(997)		/* samples per second */
+#define PERF_SAMPLE_PAGES	(16)		/* ring data pages, power of 2 */
+#define PERF_SAMPLE_SLOTS	(4096)		/* hash slots per stressor, power of 2 */
+#define PERF_SAMPLE_POLL_NS	(50000000ULL)	/* 50ms between ring reads */
+#define PERF_SAMPLE_RECORD_MAX	(256)		/* largest record copied out of the ring */
+
+#define PERF_SYM_UNKNOWN_USER	(0)		/* symbol index of unresolved user IPs */
+#define PERF_SYM_UNKNOWN_KERNEL	(1)		/* symbol index of unresolved kernel IPs */
+#define PERF_SYM_FIRST		(2)		/* first symbol with an address */
+
+/* resolvable symbol */
+typedef struct {
+	uintptr_t addr;			/* start address */
+	uintptr_t size;			/* size, 0 if unknown */
+	char *name;			/* symbol name */
+	bool kernel;			/* kernel symbol */
+} stress_perf_sym_t;
+
+/* symbol hit count, sym is symbol index + 1, 0 is an empty slot */
+typedef struct {
+	uint32_t sym;			/* symbol index + 1 */
+	uint32_t padding;		/* padding */
+	uint64_t count;			/* number of samples */
+} stress_perf_sample_slot_t;
+
+/* per stressor samples, in shared memory */
+typedef struct {
+	uint64_t samples;		/* samples read */
+	uint64_t lost;			/* samples lost by the kernel */
+	uint64_t dropped;		/* samples not counted, hash full */
+	uint32_t attached;		/* instances attached to */
+	bool	 sw_clock;		/* sampled on CPU clock, not cycles */
+	bool	 user_only;		/* kernel IPs excluded */
+	uint8_t	 padding[2];		/* padding */
+	stress_perf_sample_slot_t slots[PERF_SAMPLE_SLOTS];
+} stress_perf_sample_t;
+
+/* per instance sampling event, helper process only */
+typedef struct {
+	pid_t	pid;			/* instance pid attached to */
+	int	fd;			/* perf event fd */
+	void	*ring;			/* mmap'd ring buffer */
+	size_t	index;			/* stressor index */
+} stress_perf_sample_event_t;
+
+static uint32_t perf_sample_top;		/* report top N symbols */
+static stress_perf_sym_t *perf_syms;		/* symbol table */
+static size_t perf_syms_count;			/* symbols in table */
+static size_t perf_syms_user;			/* user symbols, sorted, at PERF_SYM_FIRST */
+static stress_perf_sample_t *perf_samples;	/* shared per stressor samples */
+static size_t perf_samples_size;		/* size of perf_samples mapping */
+static size_t perf_samples_count;		/* number of stressors */
+static pid_t perf_sample_pid = -1;		/* sampling helper pid */
+
+/*
+ *  stress_perf_sym_add()
+ *	add a symbol to the symbol table, returns false if out of memory
+ */
+static bool stress_perf_sym_add(
+	size_t *max,
+	const uintptr_t addr,
+	const uintptr_t size,
+	const char *name,
+	const bool kernel)
+{
+	stress_perf_sym_t *sym;
+
+	if (perf_syms_count >= *max) {
+		const size_t new_max = *max ? *max * 2 : 4096;
+		stress_perf_sym_t *new_syms;
+
+		new_syms = (stress_perf_sym_t *)realloc(perf_syms, new_max * sizeof(*perf_syms));
+		if (!new_syms)
+			return false;
+		perf_syms = new_syms;
+		*max = new_max;
+	}
+	sym = &perf_syms[perf_syms_count];
+	sym->name = strdup(name);
+	if (!sym->name)
+		return false;
+	sym->addr = addr;
+	sym->size = size;
+	sym->kernel = kernel;
+	perf_syms_count++;
+	return true;
+}
+
+/*
+ *  stress_perf_sym_cmp()
+ *	sort symbols by address
+ */
+static int stress_perf_sym_cmp(const void *p1, const void *p2)
+{
+	const stress_perf_sym_t *s1 = (const stress_perf_sym_t *)p1;
+	const stress_perf_sym_t *s2 = (const stress_perf_sym_t *)p2;
+
+	if (s1->addr < s2->addr)
+		return -1;
+	if (s1->addr > s2->addr)
+		return 1;
+	return 0;
+}
+
+#if defined(HAVE_LINK_H)
+/*
+ *  stress_perf_sym_elf_load()
+ *	add the function symbols of the ELF file filename, loaded
+ *	with the load bias, to the symbol table
+ */
+static void stress_perf_sym_elf_load(size_t *max, const char *filename, const uintptr_t bias)
+{
+	const ElfW(Ehdr) *ehdr;
+	const ElfW(Shdr) *shdr;
+	struct stat statbuf;
+	uint8_t *elf;
+	size_t i;
+	int fd;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return;
+	if ((fstat(fd, &statbuf) < 0) || ((size_t)statbuf.st_size < sizeof(*ehdr))) {
+		(void)close(fd);
+		return;
+	}
+	elf = (uint8_t *)mmap(NULL, (size_t)statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void)close(fd);
+	if (elf == MAP_FAILED)
+		return;
+
+	ehdr = (const ElfW(Ehdr) *)elf;
+	if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) ||
+	    (ehdr->e_shoff == 0) ||
+	    (ehdr->e_shentsize != sizeof(*shdr)) ||
+	    (ehdr->e_shoff + (ehdr->e_shnum * sizeof(*shdr)) > (size_t)statbuf.st_size))
+		goto unmap;
+	shdr = (const ElfW(Shdr) *)(elf + ehdr->e_shoff);
+
+	/* prefer the full symbol table, fall back to the dynamic symbols */
+	for (i = 0; i < ehdr->e_shnum; i++) {
+		if (shdr[i].sh_type == SHT_SYMTAB)
+			break;
+	}
+	if (i == ehdr->e_shnum) {
+		for (i = 0; i < ehdr->e_shnum; i++) {
+			if (shdr[i].sh_type == SHT_DYNSYM)
+				break;
+		}
+	}
+	if ((i < ehdr->e_shnum) && (shdr[i].sh_link < ehdr->e_shnum)) {
+		const ElfW(Shdr) *sym_sh = &shdr[i];
+		const ElfW(Shdr) *str_sh = &shdr[sym_sh->sh_link];
+		const ElfW(Sym) *syms = (const ElfW(Sym) *)(elf + sym_sh->sh_offset);
+		const char *strs = (const char *)(elf + str_sh->sh_offset);
+		const size_t n = sym_sh->sh_size / sizeof(*syms);
+		size_t j;
+
+		if ((sym_sh->sh_offset + sym_sh->sh_size > (size_t)statbuf.st_size) ||
+		    (str_sh->sh_offset + str_sh->sh_size > (size_t)statbuf.st_size))
+			goto unmap;
+
+		for (j = 0; j < n; j++) {
+			const ElfW(Sym) *sym = &syms[j];
+
+			if ((ELF64_ST_TYPE(sym->st_info) != STT_FUNC) ||
+			    (sym->st_value == 0) ||
+			    (sym->st_name >= str_sh->sh_size))
+				continue;
+			if (!stress_perf_sym_add(max, bias + (uintptr_t)sym->st_value,
+						 (uintptr_t)sym->st_size, strs + sym->st_name, false))
+				break;
+		}
+	}
+unmap:
+	(void)munmap((void *)elf, (size_t)statbuf.st_size);
+}
+
+/*
+ *  stress_perf_sym_phdr()
+ *	dl_iterate_phdr callback, load the symbols of the stress-ng
+ *	executable and add shared objects as [name] address ranges
+ */
+static int stress_perf_sym_phdr(struct dl_phdr_info *info, size_t size, void *data)
+{
+	size_t *max = (size_t *)data;
+	const char *name = info->dlpi_name;
+	ElfW(Half) i;
+
+	(void)size;
+
+	if (!name || !*name) {
+		/* the executable itself */
+		stress_perf_sym_elf_load(max, "/proc/self/exe", (uintptr_t)info->dlpi_addr);
+		return 0;
+	}
+	for (i = 0; i < info->dlpi_phnum; i++) {
+		const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+		const char *base = strrchr(name, '/');
+		char label[128];
+
+		if ((phdr->p_type != PT_LOAD) || !(phdr->p_flags & PF_X))
+			continue;
+		(void)snprintf(label, sizeof(label), "[%s]", base ? base + 1 : name);
+		(void)stress_perf_sym_add(max, (uintptr_t)info->dlpi_addr + (uintptr_t)phdr->p_vaddr,
+					  (uintptr_t)phdr->p_memsz, label, false);
+	}
+	return 0;
+}
+#endif
+
+/*
+ *  stress_perf_sym_kallsyms_load()
+ *	add kernel text symbols from /proc/kallsyms, these have no
+ *	size so a symbol extends up to the next one. Nothing is added
+ *	if kernel addresses are hidden by kptr_restrict.
+ */
+static void stress_perf_sym_kallsyms_load(size_t *max)
+{
+	FILE *fp;
+	char buf[512];
+
+	fp = fopen("/proc/kallsyms", "r");
+	if (!fp)
+		return;
+	while (fgets(buf, sizeof(buf), fp)) {
+		unsigned long int addr;
+		char type, name[256];
+
+		if (sscanf(buf, "%lx %c %255s", &addr, &type, name) != 3)
+			continue;
+		if ((addr == 0) || ((type != 't') && (type != 'T')))
+			continue;
+		if (!stress_perf_sym_add(max, (uintptr_t)addr, 0, name, true))
+			break;
+	}
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_perf_sym_load()
+ *	build the symbol table, user symbols first then kernel
+ *	symbols, each range sorted by address
+ */
+static bool stress_perf_sym_load(void)
+{
+	size_t max = 0;
+
+	if (!stress_perf_sym_add(&max, 0, 0, "[unknown]", false) ||
+	    !stress_perf_sym_add(&max, 0, 0, "[kernel]", true))
+		return false;
+#if defined(HAVE_LINK_H)
+	(void)dl_iterate_phdr(stress_perf_sym_phdr, &max);
+#endif
+	perf_syms_user = perf_syms_count - PERF_SYM_FIRST;
+	stress_perf_sym_kallsyms_load(&max);
+
+	qsort(perf_syms + PERF_SYM_FIRST, perf_syms_user,
+		sizeof(*perf_syms), stress_perf_sym_cmp);
+	qsort(perf_syms + PERF_SYM_FIRST + perf_syms_user,
+		perf_syms_count - PERF_SYM_FIRST - perf_syms_user,
+		sizeof(*perf_syms), stress_perf_sym_cmp);
+	return true;
+}
+
+/*
+ *  stress_perf_sym_free()
+ *	free the symbol table
+ */
+static void stress_perf_sym_free(void)
+{
+	size_t i;
+
+	for (i = 0; i < perf_syms_count; i++)
+		free(perf_syms[i].name);
+	free(perf_syms);
+	perf_syms = NULL;
+	perf_syms_count = 0;
+	perf_syms_user = 0;
+}
+
+/*
+ *  stress_perf_sym_find()
+ *	find the symbol index of an address, binary search for the
+ *	last symbol that starts at or below the address
+ */
+static uint32_t stress_perf_sym_find(const uint64_t ip, const bool kernel)
+{
+	const size_t first = kernel ? PERF_SYM_FIRST + perf_syms_user : PERF_SYM_FIRST;
+	const size_t n = kernel ? perf_syms_count - first : perf_syms_user;
+	const uint32_t unknown = kernel ? PERF_SYM_UNKNOWN_KERNEL : PERF_SYM_UNKNOWN_USER;
+	const stress_perf_sym_t *sym;
+	size_t lo = 0, hi = n;
+
+	while (lo < hi) {
+		const size_t mid = lo + ((hi - lo) >> 1);
+
+		if (perf_syms[first + mid].addr <= ip)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo == 0)
+		return unknown;
+	sym = &perf_syms[first + lo - 1];
+	if (sym->size && (ip >= sym->addr + sym->size))
+		return unknown;
+	return (uint32_t)(first + lo - 1);
+}
+
+/*
+ *  stress_perf_sample_count()
+ *	count a sample against a symbol in the stressor hash table
+ */
+static void stress_perf_sample_count(stress_perf_sample_t *ps, const uint32_t sym)
+{
+	const uint32_t key = sym + 1;
+	uint32_t h = (key * 2654435761U) & (PERF_SAMPLE_SLOTS - 1);
+	size_t i;
+
+	ps->samples++;
+	for (i = 0; i < PERF_SAMPLE_SLOTS; i++) {
+		stress_perf_sample_slot_t *slot = &ps->slots[h];
+
+		if (slot->sym == key) {
+			slot->count++;
+			return;
+		}
+		if (slot->sym == 0) {
+			slot->sym = key;
+			slot->count = 1;
+			return;
+		}
+		h = (h + 1) & (PERF_SAMPLE_SLOTS - 1);
+	}
+	ps->dropped++;
+}
+
+/*
+ *  stress_perf_sample_attach()
+ *	open a sampling event on an instance and map its ring buffer,
+ *	try CPU cycles then the CPU clock, with and without kernel IPs
+ */
+static bool stress_perf_sample_attach(
+	stress_perf_sample_event_t *ev,
+	stress_perf_sample_t *ps,
+	const pid_t pid,
+	const size_t page_size)
+{
+	static const struct {
+		const uint32_t type;
+		const uint64_t config;
+		const bool exclude_kernel;
+	} events[] = {
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,	false },
+		{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,	true },
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK,	false },
+		{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_CLOCK,	true },
+	};
+	const size_t ring_size = (PERF_SAMPLE_PAGES + 1) * page_size;
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(events); i++) {
+		struct perf_event_attr attr;
+		void *ring;
+		int fd;
+
+		(void)shim_memset(&attr, 0, sizeof(attr));
+		attr.type = events[i].type;
+		attr.config = events[i].config;
+		attr.size = sizeof(attr);
+		attr.freq = 1;
+		attr.sample_freq = PERF_SAMPLE_FREQ;
+		attr.sample_type = PERF_SAMPLE_IP;
+		attr.exclude_kernel = events[i].exclude_kernel;
+		attr.exclude_hv = 1;
+
+		fd = stress_sys_perf_event_open(&attr, pid, -1, -1, 0);
+		if (fd < 0)
+			continue;
+		ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (ring == MAP_FAILED) {
+			(void)close(fd);
+			continue;
+		}
+		ev->pid = pid;
+		ev->fd = fd;
+		ev->ring = ring;
+		ps->attached++;
+		ps->sw_clock = (events[i].type == PERF_TYPE_SOFTWARE);
+		ps->user_only = events[i].exclude_kernel;
+		return true;
+	}
+	return false;
+}
+
+/*
+ *  stress_perf_sample_detach()
+ *	close an instance's sampling event
+ */
+static void stress_perf_sample_detach(stress_perf_sample_event_t *ev, const size_t page_size)
+{
+	if (ev->ring)
+		(void)munmap(ev->ring, (PERF_SAMPLE_PAGES + 1) * page_size);
+	if (ev->fd >= 0)
+		(void)close(ev->fd);
+	ev->ring = NULL;
+	ev->fd = -1;
+}
+
+/*
+ *  stress_perf_sample_drain()
+ *	read all the records in a sample ring buffer. The kernel keeps
+ *	writing at data_head while we consume from data_tail, so the
+ *	instance being sampled is never stopped.
+ */
+static void stress_perf_sample_drain(
+	stress_perf_sample_event_t *ev,
+	stress_perf_sample_t *ps,
+	const size_t page_size)
+{
+	struct perf_event_mmap_page *meta = (struct perf_event_mmap_page *)ev->ring;
+	const uint8_t *data = (const uint8_t *)ev->ring + page_size;
+	const uint64_t mask = (PERF_SAMPLE_PAGES * page_size) - 1;
+	uint64_t head, tail;
+
+	head = meta->data_head;
+	__sync_synchronize();	/* read data_head before the records */
+	tail = meta->data_tail;
+
+	while (tail < head) {
+		uint8_t record[PERF_SAMPLE_RECORD_MAX];
+		const struct perf_event_header *hdr = (const struct perf_event_header *)record;
+		const size_t offset = (size_t)(tail & mask);
+		size_t len, first;
+
+		/* records may wrap around the end of the ring */
+		first = STRESS_MINIMUM(sizeof(*hdr), (size_t)(mask + 1 - offset));
+		(void)shim_memcpy(record, data + offset, first);
+		if (first < sizeof(*hdr))
+			(void)shim_memcpy(record + first, data, sizeof(*hdr) - first);
+		if (hdr->size < sizeof(*hdr))
+			break;
+		len = STRESS_MINIMUM((size_t)hdr->size, sizeof(record));
+		first = STRESS_MINIMUM(len, (size_t)(mask + 1 - offset));
+		(void)shim_memcpy(record, data + offset, first);
+		if (first < len)
+			(void)shim_memcpy(record + first, data, len - first);
+
+		if ((hdr->type == PERF_RECORD_SAMPLE) && (len >= sizeof(*hdr) + sizeof(uint64_t))) {
+			const uint16_t mode = hdr->misc & PERF_RECORD_MISC_CPUMODE_MASK;
+			const bool kernel = (mode == PERF_RECORD_MISC_KERNEL);
+			uint64_t ip;
+
+			(void)shim_memcpy(&ip, record + sizeof(*hdr), sizeof(ip));
+			stress_perf_sample_count(ps, stress_perf_sym_find(ip, kernel));
+		} else if ((hdr->type == PERF_RECORD_LOST) && (len >= sizeof(*hdr) + 2 * sizeof(uint64_t))) {
+			uint64_t lost;
+
+			(void)shim_memcpy(&lost, record + sizeof(*hdr) + sizeof(uint64_t), sizeof(lost));
+			ps->lost += lost;
+		}
+		tail += hdr->size;
+	}
+	__sync_synchronize();	/* finish reading records before freeing them */
+	meta->data_tail = tail;
+}
+
+/*
+ *  stress_perf_sample_helper()
+ *	attach to stressor instances as they start and drain their
+ *	sample rings until the helper is killed
+ */
+static void NORETURN stress_perf_sample_helper(stress_stressor_t *stressors_list)
+{
+	const size_t page_size = stress_get_page_size();
+	stress_perf_sample_event_t *events;
+	stress_stressor_t *ss;
+	size_t n = 0, i, k;
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stat [perf-sample]");
+
+	for (ss = stressors_list; ss; ss = ss->next)
+		n += (size_t)ss->instances;
+	events = (stress_perf_sample_event_t *)calloc(n ? n : 1, sizeof(*events));
+	if (!events)
+		_exit(0);
+	for (k = 0; k < n; k++)
+		events[k].fd = -1;
+
+	while (stress_continue_flag()) {
+		for (k = 0, i = 0, ss = stressors_list; ss; ss = ss->next, i++) {
+			stress_perf_sample_t *ps = &perf_samples[i];
+			int32_t j;
+
+			for (j = 0; j < ss->instances; j++, k++) {
+				stress_perf_sample_event_t *ev = &events[k];
+				const stress_stats_t *stats;
+				pid_t pid;
+
+				if (ss->ignore.run || !ss->stats)
+					continue;
+				stats = ss->stats[j];
+				pid = stats->s_pid.pid;
+
+				if (ev->ring) {
+					stress_perf_sample_drain(ev, ps, page_size);
+					if ((ev->pid != pid) || stats->s_pid.reaped)
+						stress_perf_sample_detach(ev, page_size);
+				}
+				/* attach to new or restarted instances */
+				if (!ev->ring && (pid > 0) && !stats->s_pid.reaped && (ev->pid != pid)) {
+					ev->index = i;
+					if (!stress_perf_sample_attach(ev, ps, pid, page_size))
+						ev->pid = pid;	/* don't retry */
+				}
+			}
+		}
+		(void)shim_nanosleep_uint64(PERF_SAMPLE_POLL_NS);
+	}
+	_exit(0);
+}
+
+/*
+ *  stress_perf_sample_start()
+ *	load the symbols and start the sampling helper
+ *	if --perf-sample has been used
+ */
+void stress_perf_sample_start(stress_stressor_t *stressors_list)
+{
+	const size_t page_size = stress_get_page_size();
+	stress_stressor_t *ss;
+	size_t n = 0;
+
+	if (!stress_get_setting("perf-sample", &perf_sample_top) || (perf_sample_top == 0))
+		return;
+
+	for (ss = stressors_list; ss; ss = ss->next)
+		n++;
+	if (n == 0)
+		return;
+
+	if (!stress_perf_sym_load()) {
+		pr_inf("perf-sample: cannot allocate symbol table, "
+			"stressors will not be sampled\n");
+		goto err_free_syms;
+	}
+	pr_dbg("perf-sample: loaded %zu user and %zu kernel symbols\n",
+		perf_syms_user, perf_syms_count - PERF_SYM_FIRST - perf_syms_user);
+
+	perf_samples_size = ((n * sizeof(*perf_samples)) + page_size - 1) & ~(page_size - 1);
+	perf_samples = (stress_perf_sample_t *)mmap(NULL, perf_samples_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+	if (perf_samples == MAP_FAILED) {
+		pr_inf("perf-sample: cannot mmap %zu byte sample table%s, errno=%d (%s), "
+			"stressors will not be sampled\n",
+			perf_samples_size, stress_get_memfree_str(), errno, strerror(errno));
+		perf_samples = NULL;
+		goto err_free_syms;
+	}
+	stress_set_vma_anon_name(perf_samples, perf_samples_size, "perf-sample");
+	perf_samples_count = n;
+
+	perf_sample_pid = fork();
+	if (perf_sample_pid < 0) {
+		pr_inf("perf-sample: cannot fork sampling helper, errno=%d (%s), "
+			"stressors will not be sampled\n",
+			errno, strerror(errno));
+		(void)munmap((void *)perf_samples, perf_samples_size);
+		perf_samples = NULL;
+		goto err_free_syms;
+	} else if (perf_sample_pid == 0) {
+		stress_perf_sample_helper(stressors_list);
+	}
+	return;
+
+err_free_syms:
+	stress_perf_sym_free();
+	perf_sample_top = 0;
+}
+
+/*
+ *  stress_perf_sample_stop()
+ *	stop the sampling helper
+ */
+void stress_perf_sample_stop(void)
+{
+	if (perf_sample_pid > 0) {
+		(void)stress_kill_pid_wait(perf_sample_pid, NULL);
+		perf_sample_pid = -1;
+	}
+}
+
+/*
+ *  stress_perf_sample_slot_cmp()
+ *	sort sample slots, highest count first
+ */
+static int stress_perf_sample_slot_cmp(const void *p1, const void *p2)
+{
+	const stress_perf_sample_slot_t *s1 = (const stress_perf_sample_slot_t *)p1;
+	const stress_perf_sample_slot_t *s2 = (const stress_perf_sample_slot_t *)p2;
+
+	if (s1->count > s2->count)
+		return -1;
+	if (s1->count < s2->count)
+		return 1;
+	return 0;
+}
+
+/*
+ *  stress_perf_sample_dump()
+ *	report the top N sampled symbols of each stressor
+ */
+void stress_perf_sample_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	size_t i;
+
+	if (!perf_samples)
+		return;
+
+	pr_yaml(yaml, "perf-sample:\n");
+	for (i = 0, ss = stressors_list; ss && (i < perf_samples_count); ss = ss->next, i++) {
+		stress_perf_sample_t *ps = &perf_samples[i];
+		size_t j, n;
+
+		if (ss->ignore.run)
+			continue;
+		if (ps->samples == 0) {
+			if (ps->attached == 0)
+				pr_inf("perf-sample: %s: cannot open a sampling perf event\n",
+					ss->stressor->name);
+			continue;
+		}
+
+		/* compact the hash table to the used slots and rank them */
+		for (n = 0, j = 0; j < PERF_SAMPLE_SLOTS; j++) {
+			if (ps->slots[j].sym)
+				ps->slots[n++] = ps->slots[j];
+		}
+		qsort(ps->slots, n, sizeof(ps->slots[0]), stress_perf_sample_slot_cmp);
+		n = STRESS_MINIMUM(n, (size_t)perf_sample_top);
+
+		pr_inf("perf-sample: %s: %" PRIu64 " samples on %s%s, %" PRIu64
+			" lost, top %zu symbols:\n",
+			ss->stressor->name, ps->samples,
+			ps->sw_clock ? "CPU clock" : "CPU cycles",
+			ps->user_only ? " (user space only)" : "",
+			ps->lost + ps->dropped, n);
+		pr_yaml(yaml, "    - stressor: %s\n", ss->stressor->name);
+		pr_yaml(yaml, "      samples: %" PRIu64 "\n", ps->samples);
+		pr_yaml(yaml, "      lost: %" PRIu64 "\n", ps->lost + ps->dropped);
+		pr_yaml(yaml, "      event: %s\n", ps->sw_clock ? "cpu-clock" : "cpu-cycles");
+		pr_yaml(yaml, "      top:\n");
+
+		for (j = 0; j < n; j++) {
+			const stress_perf_sym_t *sym = &perf_syms[ps->slots[j].sym - 1];
+			const double percent = 100.0 * (double)ps->slots[j].count / (double)ps->samples;
+
+			pr_inf("perf-sample: %7.2f%% %10" PRIu64 " [%c] %s\n",
+				percent, ps->slots[j].count,
+				sym->kernel ? 'k' : '.', sym->name);
+			pr_yaml(yaml, "        - symbol: \"%s\"\n", sym->name);
+			pr_yaml(yaml, "          space: %s\n", sym->kernel ? "kernel" : "user");
+			pr_yaml(yaml, "          samples: %" PRIu64 "\n", ps->slots[j].count);
+			pr_yaml(yaml, "          percent: %f\n", percent);
+		}
+	}
+	pr_yaml(yaml, "\n");
+
+	(void)munmap((void *)perf_samples, perf_samples_size);
+	perf_samples = NULL;
+	stress_perf_sym_free();
+}
 #endif
@@ -29,7 +29,9 @@
 
 /* per perf counter info */
 typedef struct {
-	uint64_t counter;		/* perf counter */
+	uint64_t counter;		/* perf counter, scaled if multiplexed */
+	uint64_t time_enabled;		/* time counter was enabled, ns */
+	uint64_t time_running;		/* time counter was counting, ns */
 	int	 fd;			/* perf per counter fd */
 	uint8_t	 padding[4];		/* padding */
 } stress_perf_stat_t;
@@ -48,6 +50,9 @@ extern int stress_perf_close(stress_perf_t *sp);
 extern void stress_perf_stat_dump(FILE *yaml, stress_stressor_t *procs_head,
 	const double duration);
 extern void stress_perf_init(void);
+extern void stress_perf_sample_start(stress_stressor_t *stressors_list);
+extern void stress_perf_sample_stop(void);
+extern void stress_perf_sample_dump(FILE *yaml, stress_stressor_t *stressors_list);
 #endif
 
 #endif
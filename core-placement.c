@@ -0,0 +1,554 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-affinity.h"
+#include "core-builtin.h"
+#include "core-cpu-cache.h"
+#include "core-numa.h"
+#include "core-placement.h"
+
+#include <sched.h>
+
+/*
+ *  Instance placement policies. The CPUs stress-ng may use are
+ *  described by their NUMA node, last level cache domain, core
+ *  and SMT thread, each policy orders them into a list of slots
+ *  and the Nth instance started is placed on slot N modulo the
+ *  number of slots.
+ */
+typedef enum {
+	PLACEMENT_NONE = 0,
+	PLACEMENT_SPREAD,	/* spread over nodes, LLCs, cores then threads */
+	PLACEMENT_COMPACT,	/* fill threads, cores, LLCs then nodes */
+	PLACEMENT_LLC,		/* one instance per LLC domain */
+	PLACEMENT_CORE,		/* one instance per core, skip SMT siblings */
+	PLACEMENT_NODE,		/* per node, memory on the local node */
+} stress_placement_policy_t;
+
+typedef struct {
+	const char *name;			/* --placement name */
+	const stress_placement_policy_t policy;	/* policy */
+} stress_placement_method_t;
+
+static const stress_placement_method_t placement_methods[] = {
+	{ "spread",	PLACEMENT_SPREAD },
+	{ "compact",	PLACEMENT_COMPACT },
+	{ "llc",	PLACEMENT_LLC },
+	{ "core",	PLACEMENT_CORE },
+	{ "node",	PLACEMENT_NODE },
+};
+
+/* CPU topology */
+typedef struct {
+	int32_t cpu;		/* CPU number */
+	int32_t node;		/* NUMA node */
+	int32_t llc;		/* LLC id, lowest CPU sharing the LLC */
+	int32_t core;		/* core id, lowest SMT sibling */
+	uint32_t thread;	/* SMT thread number in core */
+	uint32_t core_rank;	/* core number in LLC */
+	uint32_t llc_rank;	/* LLC number in node */
+} stress_placement_cpu_t;
+
+/* where an instance was placed, -1 if not placed */
+typedef struct {
+	int32_t cpu;		/* CPU, -1 for all CPUs in node */
+	int32_t node;		/* NUMA node */
+	int32_t llc;		/* LLC id */
+	int32_t padding;	/* padding */
+} stress_placement_slot_t;
+
+#if defined(HAVE_SCHED_SETAFFINITY) &&	\
+    defined(HAVE_CPU_SET_T)
+static const stress_placement_method_t *placement_method;
+static stress_placement_cpu_t *placement_cpus;		/* usable CPUs */
+static size_t placement_cpus_count;
+static stress_placement_slot_t *placement_slots;	/* policy ordered slots */
+static size_t placement_slots_count;
+static stress_placement_slot_t *placement_map;		/* shared, per instance */
+static size_t placement_map_count;
+#endif
+
+/*
+ *  stress_set_placement()
+ *	parse --placement option
+ */
+int stress_set_placement(const char *const opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(placement_methods); i++) {
+		if (!strcmp(opt, placement_methods[i].name)) {
+#if defined(HAVE_SCHED_SETAFFINITY) &&	\
+    defined(HAVE_CPU_SET_T)
+			placement_method = &placement_methods[i];
+#else
+			(void)fprintf(stderr, "placement: CPU affinity not supported, "
+				"option ignored\n");
+#endif
+			return 0;
+		}
+	}
+	(void)fprintf(stderr, "placement must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(placement_methods); i++)
+		(void)fprintf(stderr, " %s", placement_methods[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+#if defined(HAVE_SCHED_SETAFFINITY) &&	\
+    defined(HAVE_CPU_SET_T)
+/*
+ *  stress_placement_read_first()
+ *	read the lowest CPU of a sysfs CPU list file, -1 if not readable
+ */
+static int32_t stress_placement_read_first(const char *filename)
+{
+	char buf[4096];
+	int cpu;
+
+	if (stress_system_read(filename, buf, sizeof(buf)) < 1)
+		return -1;
+	if (sscanf(buf, "%d", &cpu) != 1)
+		return -1;
+	return (int32_t)cpu;
+}
+
+/*
+ *  stress_placement_llc()
+ *	find the lowest CPU that shares the LLC with cpu, the LLC
+ *	level is the maximum cache level found by core-cpu-cache
+ */
+static int32_t stress_placement_llc(const int32_t cpu, const uint16_t llc_level)
+{
+	int i;
+
+	for (i = 0; llc_level > 0; i++) {
+		char filename[PATH_MAX];
+		char buf[64];
+		int level;
+
+		(void)snprintf(filename, sizeof(filename),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cache/index%d/level", cpu, i);
+		if (stress_system_read(filename, buf, sizeof(buf)) < 1)
+			break;
+		if ((sscanf(buf, "%d", &level) != 1) || (level != (int)llc_level))
+			continue;
+		(void)snprintf(filename, sizeof(filename),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/cache/index%d/shared_cpu_list", cpu, i);
+		return stress_placement_read_first(filename);
+	}
+	return -1;
+}
+
+/*
+ *  stress_placement_cmp_compact()
+ *	order CPUs by node, LLC, core then SMT thread
+ */
+static int stress_placement_cmp_compact(const void *p1, const void *p2)
+{
+	const stress_placement_cpu_t *c1 = (const stress_placement_cpu_t *)p1;
+	const stress_placement_cpu_t *c2 = (const stress_placement_cpu_t *)p2;
+
+	if (c1->node != c2->node)
+		return (c1->node < c2->node) ? -1 : 1;
+	if (c1->llc != c2->llc)
+		return (c1->llc < c2->llc) ? -1 : 1;
+	if (c1->core != c2->core)
+		return (c1->core < c2->core) ? -1 : 1;
+	if (c1->cpu != c2->cpu)
+		return (c1->cpu < c2->cpu) ? -1 : 1;
+	return 0;
+}
+
+/*
+ *  stress_placement_topology()
+ *	discover the node, LLC, core and SMT thread of each usable CPU
+ *	and return them sorted in compact order
+ */
+static bool stress_placement_topology(void)
+{
+	stress_cpu_cache_cpus_t *caches;
+	uint16_t llc_level = 0;
+	uint32_t *cpus = NULL;
+	uint32_t n_cpus, i;
+
+	n_cpus = stress_get_usable_cpus(&cpus, true);
+	if (n_cpus == 0)
+		return false;
+	placement_cpus = (stress_placement_cpu_t *)calloc(n_cpus, sizeof(*placement_cpus));
+	if (!placement_cpus) {
+		stress_free_usable_cpus(&cpus);
+		return false;
+	}
+
+	caches = stress_cpu_cache_get_all_details();
+	if (caches) {
+		llc_level = stress_cpu_cache_get_max_level(caches);
+		stress_free_cpu_caches(caches);
+	}
+
+	for (i = 0; i < n_cpus; i++) {
+		stress_placement_cpu_t *pc = &placement_cpus[i];
+		char filename[PATH_MAX];
+
+		pc->cpu = (int32_t)cpus[i];
+		(void)snprintf(filename, sizeof(filename),
+			"/sys/devices/system/cpu/cpu%" PRId32 "/topology/thread_siblings_list", pc->cpu);
+		pc->core = stress_placement_read_first(filename);
+		if (pc->core < 0)
+			pc->core = pc->cpu;
+		pc->llc = stress_placement_llc(pc->cpu, llc_level);
+		if (pc->llc < 0) {
+			(void)snprintf(filename, sizeof(filename),
+				"/sys/devices/system/cpu/cpu%" PRId32 "/topology/package_cpus_list", pc->cpu);
+			pc->llc = stress_placement_read_first(filename);
+			if (pc->llc < 0)
+				pc->llc = 0;
+		}
+		pc->node = stress_numa_cpu_node(pc->cpu);
+	}
+	stress_free_usable_cpus(&cpus);
+
+	qsort(placement_cpus, n_cpus, sizeof(*placement_cpus), stress_placement_cmp_compact);
+
+	/* number the SMT threads, cores in each LLC and LLCs in each node */
+	for (i = 0; i < n_cpus; i++) {
+		stress_placement_cpu_t *pc = &placement_cpus[i];
+		const stress_placement_cpu_t *prev = i ? &placement_cpus[i - 1] : NULL;
+
+		if (!prev || (prev->node != pc->node)) {
+			pc->llc_rank = 0;
+			pc->core_rank = 0;
+			pc->thread = 0;
+		} else if (prev->llc != pc->llc) {
+			pc->llc_rank = prev->llc_rank + 1;
+			pc->core_rank = 0;
+			pc->thread = 0;
+		} else if (prev->core != pc->core) {
+			pc->llc_rank = prev->llc_rank;
+			pc->core_rank = prev->core_rank + 1;
+			pc->thread = 0;
+		} else {
+			pc->llc_rank = prev->llc_rank;
+			pc->core_rank = prev->core_rank;
+			pc->thread = prev->thread + 1;
+		}
+	}
+	placement_cpus_count = n_cpus;
+	return true;
+}
+
+/*
+ *  stress_placement_count()
+ *	count the distinct values of a topology field
+ */
+static size_t stress_placement_count(const size_t offset)
+{
+	size_t i, j, n = 0;
+
+	for (i = 0; i < placement_cpus_count; i++) {
+		const int32_t val = *(const int32_t *)((const uint8_t *)&placement_cpus[i] + offset);
+
+		for (j = 0; j < i; j++) {
+			if (*(const int32_t *)((const uint8_t *)&placement_cpus[j] + offset) == val)
+				break;
+		}
+		if (j == i)
+			n++;
+	}
+	return n;
+}
+
+/*
+ *  stress_placement_cmp_spread()
+ *	order CPUs so that consecutive CPUs are on different nodes,
+ *	then different LLCs, then different cores, SMT threads last
+ */
+static int stress_placement_cmp_spread(const void *p1, const void *p2)
+{
+	const stress_placement_cpu_t *c1 = (const stress_placement_cpu_t *)p1;
+	const stress_placement_cpu_t *c2 = (const stress_placement_cpu_t *)p2;
+
+	if (c1->thread != c2->thread)
+		return (c1->thread < c2->thread) ? -1 : 1;
+	if (c1->core_rank != c2->core_rank)
+		return (c1->core_rank < c2->core_rank) ? -1 : 1;
+	if (c1->llc_rank != c2->llc_rank)
+		return (c1->llc_rank < c2->llc_rank) ? -1 : 1;
+	if (c1->node != c2->node)
+		return (c1->node < c2->node) ? -1 : 1;
+	return 0;
+}
+
+/*
+ *  stress_placement_slots()
+ *	turn the CPU topology into policy ordered slots
+ */
+static bool stress_placement_slots(void)
+{
+	stress_placement_cpu_t *sorted;
+	size_t i;
+
+	placement_slots = (stress_placement_slot_t *)calloc(placement_cpus_count, sizeof(*placement_slots));
+	sorted = (stress_placement_cpu_t *)calloc(placement_cpus_count, sizeof(*sorted));
+	if (!placement_slots || !sorted) {
+		free(sorted);
+		return false;
+	}
+	(void)shim_memcpy(sorted, placement_cpus, placement_cpus_count * sizeof(*sorted));
+	if ((placement_method->policy != PLACEMENT_COMPACT) &&
+	    (placement_method->policy != PLACEMENT_NODE))
+		qsort(sorted, placement_cpus_count, sizeof(*sorted), stress_placement_cmp_spread);
+
+	for (i = 0; i < placement_cpus_count; i++) {
+		const stress_placement_cpu_t *pc = &sorted[i];
+		stress_placement_slot_t *slot = &placement_slots[placement_slots_count];
+
+		switch (placement_method->policy) {
+		case PLACEMENT_LLC:
+			if ((pc->core_rank != 0) || (pc->thread != 0))
+				continue;
+			break;
+		case PLACEMENT_CORE:
+			if (pc->thread != 0)
+				continue;
+			break;
+		case PLACEMENT_NODE:
+			if ((placement_slots_count > 0) &&
+			    (pc->node <= placement_slots[placement_slots_count - 1].node))
+				continue;
+			break;
+		default:
+			break;
+		}
+		slot->cpu = (placement_method->policy == PLACEMENT_NODE) ? -1 : pc->cpu;
+		slot->node = pc->node;
+		slot->llc = (placement_method->policy == PLACEMENT_NODE) ? -1 : pc->llc;
+		placement_slots_count++;
+	}
+	free(sorted);
+	return placement_slots_count > 0;
+}
+
+/*
+ *  stress_placement_free()
+ *	free placement data
+ */
+void stress_placement_free(void)
+{
+	if (placement_map) {
+		(void)munmap((void *)placement_map, placement_map_count * sizeof(*placement_map));
+		placement_map = NULL;
+	}
+	free(placement_slots);
+	placement_slots = NULL;
+	placement_slots_count = 0;
+	free(placement_cpus);
+	placement_cpus = NULL;
+	placement_cpus_count = 0;
+}
+
+/*
+ *  stress_placement_init()
+ *	discover the topology and build the slots for the
+ *	--placement policy, must be called before forking
+ *	the stressors
+ */
+void stress_placement_init(stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	size_t i;
+
+	if (!placement_method)
+		return;
+
+	for (placement_map_count = 0, ss = stressors_list; ss; ss = ss->next) {
+		if (!ss->ignore.run)
+			placement_map_count += (size_t)ss->instances;
+	}
+	if (placement_map_count == 0)
+		return;
+
+	if (!stress_placement_topology() || !stress_placement_slots()) {
+		pr_inf("placement: cannot determine CPU topology, "
+			"instances will not be placed\n");
+		goto err;
+	}
+
+	placement_map = (stress_placement_slot_t *)mmap(NULL,
+		placement_map_count * sizeof(*placement_map),
+		PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANON, -1, 0);
+	if (placement_map == MAP_FAILED) {
+		pr_inf("placement: cannot mmap instance placement map%s, errno=%d (%s), "
+			"instances will not be placed\n",
+			stress_get_memfree_str(), errno, strerror(errno));
+		placement_map = NULL;
+		goto err;
+	}
+	stress_set_vma_anon_name(placement_map, placement_map_count * sizeof(*placement_map), "placement");
+	for (i = 0; i < placement_map_count; i++) {
+		placement_map[i].cpu = -1;
+		placement_map[i].node = -1;
+		placement_map[i].llc = -1;
+	}
+
+	pr_dbg("placement: %s policy, %zu slots over %zu CPUs, %zu cores, %zu LLCs, %zu nodes\n",
+		placement_method->name, placement_slots_count, placement_cpus_count,
+		stress_placement_count(offsetof(stress_placement_cpu_t, core)),
+		stress_placement_count(offsetof(stress_placement_cpu_t, llc)),
+		stress_placement_count(offsetof(stress_placement_cpu_t, node)));
+	return;
+err:
+	stress_placement_free();
+	placement_method = NULL;
+}
+
+/*
+ *  stress_placement_apply()
+ *	bind the index'th instance started to its slot, this is
+ *	called by the stressor instance process
+ */
+void stress_placement_apply(const stress_stats_t *stats, const int32_t index)
+{
+	const stress_placement_slot_t *slot;
+	size_t idx;
+	cpu_set_t mask;
+
+	if (!placement_map || (index < 0))
+		return;
+	idx = (size_t)(stats - g_shared->stats);
+	if (idx >= placement_map_count)
+		return;
+
+	slot = &placement_slots[(size_t)index % placement_slots_count];
+	CPU_ZERO(&mask);
+	if (slot->cpu >= 0) {
+		CPU_SET(slot->cpu, &mask);
+	} else {
+		size_t i;
+
+		for (i = 0; i < placement_cpus_count; i++) {
+			if (placement_cpus[i].node == slot->node)
+				CPU_SET(placement_cpus[i].cpu, &mask);
+		}
+	}
+	if (sched_setaffinity(0, sizeof(mask), &mask) < 0) {
+		pr_dbg("placement: cannot set CPU affinity, errno=%d (%s)\n",
+			errno, strerror(errno));
+		return;
+	}
+	if (placement_method->policy == PLACEMENT_NODE) {
+		unsigned long int nodemask[(1024 + NUMA_LONG_BITS - 1) / NUMA_LONG_BITS];
+
+		(void)shim_memset(nodemask, 0, sizeof(nodemask));
+		if (slot->node < 1024) {
+			nodemask[slot->node / NUMA_LONG_BITS] |= 1UL << (slot->node % NUMA_LONG_BITS);
+			if (shim_set_mempolicy(MPOL_PREFERRED, nodemask, 1024) < 0)
+				pr_dbg("placement: cannot set memory policy to node %" PRId32 ", errno=%d (%s)\n",
+					slot->node, errno, strerror(errno));
+		}
+	}
+	placement_map[idx] = *slot;
+}
+
+/*
+ *  stress_placement_dump()
+ *	report where each instance was placed
+ */
+void stress_placement_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	stress_stressor_t *ss;
+	const bool node = (placement_method && (placement_method->policy == PLACEMENT_NODE));
+
+	if (!placement_map)
+		return;
+
+	pr_inf("placement: %s policy over %zu CPUs, %zu cores, %zu LLCs, %zu nodes\n",
+		placement_method->name, placement_cpus_count,
+		stress_placement_count(offsetof(stress_placement_cpu_t, core)),
+		stress_placement_count(offsetof(stress_placement_cpu_t, llc)),
+		stress_placement_count(offsetof(stress_placement_cpu_t, node)));
+	pr_yaml(yaml, "placement:\n");
+	pr_yaml(yaml, "      policy: %s\n", placement_method->name);
+	pr_yaml(yaml, "      instances:\n");
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		char buf[256];
+		size_t len = 0;
+		int32_t j;
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+		*buf = '\0';
+		for (j = 0; j < ss->instances; j++) {
+			const size_t idx = (size_t)(ss->stats[j] - g_shared->stats);
+			const stress_placement_slot_t *slot;
+			int n;
+
+			if (idx >= placement_map_count)
+				continue;
+			slot = &placement_map[idx];
+			if (slot->node < 0)
+				continue;
+			if (len < sizeof(buf)) {
+				n = snprintf(buf + len, sizeof(buf) - len, "%s%" PRId32,
+					len ? "," : "", node ? slot->node : slot->cpu);
+				if ((n > 0) && ((size_t)n < sizeof(buf) - len - 4)) {
+					len += (size_t)n;
+				} else {
+					(void)shim_strscpy(buf + len, ",...", sizeof(buf) - len);
+					len = sizeof(buf);
+				}
+			}
+			pr_yaml(yaml, "        - stressor: %s\n", ss->stressor->name);
+			pr_yaml(yaml, "          instance: %" PRId32 "\n", j);
+			if (slot->cpu >= 0)
+				pr_yaml(yaml, "          cpu: %" PRId32 "\n", slot->cpu);
+			if (slot->llc >= 0)
+				pr_yaml(yaml, "          llc: %" PRId32 "\n", slot->llc);
+			pr_yaml(yaml, "          node: %" PRId32 "\n", slot->node);
+		}
+		if (len)
+			pr_inf("placement: %s: %s %s\n", ss->stressor->name,
+				node ? "nodes" : "cpus", buf);
+	}
+	pr_yaml(yaml, "\n");
+}
+#else
+void stress_placement_init(stress_stressor_t *stressors_list)
+{
+	(void)stressors_list;
+}
+
+void stress_placement_apply(const stress_stats_t *stats, const int32_t index)
+{
+	(void)stats;
+	(void)index;
+}
+
+void stress_placement_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	(void)yaml;
+	(void)stressors_list;
+}
+
+void stress_placement_free(void)
+{
+}
+#endif
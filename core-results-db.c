@@ -0,0 +1,708 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-results-db.h"
+
+#include <math.h>
+#include <time.h>
+
+#if defined(HAVE_SYS_FILE_H)
+#include <sys/file.h>
+#endif
+
+#if defined(HAVE_UNAME) &&	\
+    defined(HAVE_SYS_UTSNAME_H)
+#include <sys/utsname.h>
+#endif
+
+/*
+ *  The results database is a flat file of fixed size records that
+ *  are only ever appended to, one record per stressor per run. Each
+ *  record is keyed by hashes of the host name, CPU model and the
+ *  command line options so that runs of the same job on the same
+ *  kind of system can be found without any text parsing. The kernel
+ *  is recorded but is not part of the key, so a baseline spans kernel
+ *  updates and the comparison reports runs on other kernels. Records are
+ *  in native byte order and the file is only valid between systems
+ *  of the same endianness.
+ */
+#define STRESS_RESULTS_MAGIC		(0x42445253)	/* "SRDB" */
+#define STRESS_RESULTS_VERSION		(2)
+#define STRESS_RESULTS_METRICS		(8)		/* metrics kept per record */
+#define STRESS_RESULTS_WINDOW_DEFAULT	(10)		/* default baseline runs */
+#define STRESS_RESULTS_WINDOW_MAX	(1000)		/* max baseline runs */
+#define STRESS_RESULTS_MIN_BASELINE	(3)		/* min runs for a comparison */
+#define STRESS_RESULTS_MIN_CHANGE	(5.0)		/* min % change to flag */
+
+typedef struct {
+	uint64_t hash;			/* hash of metric description */
+	double value;			/* mean of metric across instances */
+} stress_results_metric_t;
+
+typedef struct {
+	uint32_t magic;			/* STRESS_RESULTS_MAGIC */
+	uint16_t version;		/* STRESS_RESULTS_VERSION */
+	uint16_t size;			/* sizeof(stress_results_record_t) */
+	uint64_t time;			/* end of run, seconds since the epoch */
+	uint64_t host_hash;		/* hash of host name */
+	uint64_t kernel_hash;		/* hash of kernel name and release */
+	uint64_t cpu_hash;		/* hash of CPU model */
+	uint64_t opts_hash;		/* hash of command line options */
+	char stressor[32];		/* stressor name */
+	char kernel[64];		/* kernel name and release */
+	uint64_t bogo_ops;		/* total bogo-ops */
+	double duration;		/* mean wall clock time of instances */
+	double bogo_rate;		/* bogo-ops per second, real time */
+	double bogo_rate_cpu;		/* bogo-ops per second, usr + sys time */
+	uint32_t instances;		/* instances completed */
+	uint32_t n_metrics;		/* number of metrics used */
+	stress_results_metric_t metrics[STRESS_RESULTS_METRICS];
+	uint32_t checksum;		/* checksum of all the preceding fields */
+	uint32_t padding;		/* padding, zero */
+} stress_results_record_t;
+
+/* Running sums of the baseline for one value */
+typedef struct {
+	double sum;			/* sum of values */
+	double sum_sq;			/* sum of squared values */
+	uint32_t n;			/* number of values */
+} stress_results_stats_t;
+
+/* Current run record and its baseline window */
+typedef struct {
+	stress_results_record_t record;	/* this run */
+	const char *descriptions[STRESS_RESULTS_METRICS]; /* metric descriptions */
+	stress_results_record_t *window;/* ring of matching earlier records */
+	uint32_t count;			/* number of matching records seen */
+} stress_results_entry_t;
+
+/*
+ *  Student's t critical values, one tailed, 99% confidence for
+ *  1..30 degrees of freedom, larger sample sizes use the normal
+ *  approximation
+ */
+static const double stress_results_t99[] = {
+	31.821, 6.965, 4.541, 3.747, 3.365, 3.143, 2.998, 2.896, 2.821, 2.764,
+	2.718, 2.681, 2.650, 2.624, 2.602, 2.583, 2.567, 2.552, 2.539, 2.528,
+	2.518, 2.508, 2.500, 2.492, 2.485, 2.479, 2.473, 2.467, 2.462, 2.457,
+};
+
+static uint64_t results_opts_hash;	/* hash of the command line options */
+
+/*
+ *  stress_results_hash()
+ *	64 bit FNV-1a hash of len bytes of data, seeded with hash
+ */
+static uint64_t stress_results_hash(uint64_t hash, const void *data, const size_t len)
+{
+	const uint8_t *ptr = (const uint8_t *)data;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= (uint64_t)ptr[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/*
+ *  stress_results_hash_str()
+ *	64 bit FNV-1a hash of a string
+ */
+static uint64_t stress_results_hash_str(const char *str)
+{
+	return stress_results_hash(0xcbf29ce484222325ULL, str, strlen(str));
+}
+
+/*
+ *  stress_results_ignore_arg()
+ *	return true if a command line argument only affects where results
+ *	are written and hence should not be part of the options hash, skip
+ *	is set true if the argument's value is in the next argument
+ */
+static bool stress_results_ignore_arg(const char *arg, bool *skip)
+{
+	static const struct {
+		const char *name;	/* option name */
+		const bool has_arg;	/* value is in the next argument */
+	} ignore[] = {
+		{ "--compare-window",	true },
+		{ "--compare",		false },
+		{ "--log-file",		true },
+		{ "--results-db",	true },
+		{ "--yaml",		true },
+		{ "-Y",			true },
+		{ "--quiet",		false },
+		{ "-q",			false },
+		{ "--verbose",		false },
+		{ "-v",			false },
+	};
+	size_t i;
+
+	*skip = false;
+	for (i = 0; i < SIZEOF_ARRAY(ignore); i++) {
+		const size_t len = strlen(ignore[i].name);
+
+		if (strncmp(arg, ignore[i].name, len))
+			continue;
+		if (ignore[i].has_arg && (arg[len] == '='))
+			return true;
+		if (arg[len] == '\0') {
+			*skip = ignore[i].has_arg;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ *  stress_results_db_args()
+ *	hash the command line options, this must be called before
+ *	the options are parsed as getopt may permute argv
+ */
+void stress_results_db_args(const int argc, char **argv)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		bool skip;
+
+		if (stress_results_ignore_arg(argv[i], &skip)) {
+			if (skip)
+				i++;
+			continue;
+		}
+		hash = stress_results_hash(hash, argv[i], strlen(argv[i]) + 1);
+	}
+	results_opts_hash = hash;
+}
+
+/*
+ *  stress_results_job_hash()
+ *	mix the contents of a job file into the options hash
+ *	so that edited jobs are not compared with older runs
+ */
+static uint64_t stress_results_job_hash(uint64_t hash)
+{
+	const char *job_filename = NULL;
+	char buf[4096];
+	FILE *fp;
+
+	if (!stress_get_setting("job", &job_filename) || !job_filename)
+		return hash;
+	fp = fopen(job_filename, "r");
+	if (!fp)
+		return hash;
+	while (fgets(buf, sizeof(buf), fp))
+		hash = stress_results_hash(hash, buf, strlen(buf));
+	(void)fclose(fp);
+	return hash;
+}
+
+/*
+ *  stress_results_cpu_hash()
+ *	hash the CPU model name, falling back to the machine
+ *	architecture if /proc/cpuinfo has no model name
+ */
+static uint64_t stress_results_cpu_hash(void)
+{
+	FILE *fp;
+	char buf[256];
+
+	fp = fopen("/proc/cpuinfo", "r");
+	if (fp) {
+		while (fgets(buf, sizeof(buf), fp)) {
+			if (!strncmp(buf, "model name", 10) ||
+			    !strncmp(buf, "cpu model", 9) ||
+			    !strncmp(buf, "uarch", 5)) {
+				(void)fclose(fp);
+				return stress_results_hash_str(buf);
+			}
+		}
+		(void)fclose(fp);
+	}
+#if defined(HAVE_UNAME) &&	\
+    defined(HAVE_SYS_UTSNAME_H)
+	{
+		struct utsname uts;
+
+		if (uname(&uts) == 0)
+			return stress_results_hash_str(uts.machine);
+	}
+#endif
+	return 0;
+}
+
+/*
+ *  stress_results_checksum()
+ *	checksum a record up to but not including the checksum field
+ */
+static uint32_t stress_results_checksum(const stress_results_record_t *record)
+{
+	const uint64_t hash = stress_results_hash(0xcbf29ce484222325ULL, record,
+					offsetof(stress_results_record_t, checksum));
+
+	return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/*
+ *  stress_results_record_init()
+ *	fill in a record with the results of a stressor
+ */
+static bool stress_results_record_init(
+	stress_results_entry_t *entry,
+	const stress_stressor_t *ss,
+	const uint64_t host_hash,
+	const uint64_t kernel_hash,
+	const char *kernel,
+	const uint64_t cpu_hash,
+	const uint64_t opts_hash,
+	const time_t now)
+{
+	uint64_t c_total = 0;
+	double r_total = 0.0, us_total = 0.0;
+	int32_t j, completed = 0;
+	size_t i;
+	stress_results_record_t *record = &entry->record;
+
+	for (j = 0; j < ss->instances; j++) {
+		const stress_stats_t *const stats = ss->stats[j];
+
+		if (stats->completed)
+			completed++;
+		c_total += stats->counter_total;
+		us_total += stats->rusage_utime_total + stats->rusage_stime_total;
+		r_total += stats->duration_total;
+	}
+	if (completed == 0)
+		return false;
+	r_total /= (double)completed;
+
+	(void)shim_memset(record, 0, sizeof(*record));
+	record->magic = STRESS_RESULTS_MAGIC;
+	record->version = STRESS_RESULTS_VERSION;
+	record->size = (uint16_t)sizeof(*record);
+	record->time = (uint64_t)now;
+	record->host_hash = host_hash;
+	record->kernel_hash = kernel_hash;
+	record->cpu_hash = cpu_hash;
+	record->opts_hash = opts_hash;
+	(void)shim_strscpy(record->stressor, ss->stressor->name, sizeof(record->stressor));
+	(void)shim_strscpy(record->kernel, kernel, sizeof(record->kernel));
+	record->bogo_ops = c_total;
+	record->duration = r_total;
+	record->bogo_rate = (r_total > 0.0) ? (double)c_total / r_total : 0.0;
+	record->bogo_rate_cpu = (us_total > 0.0) ? (double)c_total / us_total : 0.0;
+	record->instances = (uint32_t)completed;
+
+	for (i = 0; i < SIZEOF_ARRAY(ss->stats[0]->metrics.items); i++) {
+		const char *description = ss->stats[0]->metrics.items[i].description;
+		double total = 0.0;
+
+		if (!description)
+			continue;
+		if (record->n_metrics >= STRESS_RESULTS_METRICS)
+			break;
+		for (j = 0; j < ss->instances; j++)
+			total += ss->stats[j]->metrics.items[i].value;
+
+		entry->descriptions[record->n_metrics] = description;
+		record->metrics[record->n_metrics].hash = stress_results_hash_str(description);
+		record->metrics[record->n_metrics].value = total / (double)completed;
+		record->n_metrics++;
+	}
+	record->checksum = stress_results_checksum(record);
+	return true;
+}
+
+/*
+ *  stress_results_same_key()
+ *	return true if two records are for the same stressor, system and
+ *	options, the kernel is not compared so a kernel update can be
+ *	compared against runs on the previous kernel
+ */
+static bool stress_results_same_key(
+	const stress_results_record_t *a,
+	const stress_results_record_t *b)
+{
+	return (a->host_hash == b->host_hash) &&
+	       (a->cpu_hash == b->cpu_hash) &&
+	       (a->opts_hash == b->opts_hash) &&
+	       !strncmp(a->stressor, b->stressor, sizeof(a->stressor));
+}
+
+/*
+ *  stress_results_db_read()
+ *	scan the results database and keep the most recent window
+ *	matching records for each entry, returns number of records read
+ */
+static size_t stress_results_db_read(
+	const char *filename,
+	stress_results_entry_t *entries,
+	const size_t n_entries,
+	const uint32_t window)
+{
+	stress_results_record_t record;
+	size_t n = 0, bad = 0, old = 0;
+	FILE *fp;
+
+	fp = fopen(filename, "r");
+	if (!fp)
+		return 0;
+
+	while (fread(&record, sizeof(record), 1, fp) == 1) {
+		size_t i;
+
+		if ((record.magic == STRESS_RESULTS_MAGIC) &&
+		    (record.version != STRESS_RESULTS_VERSION)) {
+			old++;
+			continue;
+		}
+		if ((record.magic != STRESS_RESULTS_MAGIC) ||
+		    (record.size != sizeof(record)) ||
+		    (record.checksum != stress_results_checksum(&record))) {
+			bad++;
+			continue;
+		}
+		n++;
+		for (i = 0; i < n_entries; i++) {
+			stress_results_entry_t *entry = &entries[i];
+
+			if (stress_results_same_key(&entry->record, &record)) {
+				entry->window[entry->count % window] = record;
+				entry->count++;
+			}
+		}
+	}
+	(void)fclose(fp);
+
+	if (bad)
+		pr_inf("compare: ignored %zu corrupt records in %s\n", bad, filename);
+	if (old)
+		pr_inf("compare: ignored %zu records of a different format version in %s\n", old, filename);
+	return n;
+}
+
+/*
+ *  stress_results_stats_add()
+ *	add a value to the baseline sums
+ */
+static inline void stress_results_stats_add(stress_results_stats_t *stats, const double value)
+{
+	stats->sum += value;
+	stats->sum_sq += value * value;
+	stats->n++;
+}
+
+/*
+ *  stress_results_significant()
+ *	compare value against the baseline, a change is significant if
+ *	the new value lies outside the one tailed 99% prediction interval
+ *	of the baseline and differs from the baseline mean by at least
+ *	STRESS_RESULTS_MIN_CHANGE percent. Returns the signed percentage
+ *	change in *change and the t statistic in *t.
+ */
+static bool stress_results_significant(
+	const stress_results_stats_t *stats,
+	const double value,
+	double *mean,
+	double *stddev,
+	double *change,
+	double *t)
+{
+	const double n = (double)stats->n;
+	const size_t df = (size_t)stats->n - 1;
+	double variance, t_crit, se;
+
+	*mean = stats->sum / n;
+	variance = (stats->sum_sq - (n * *mean * *mean)) / (n - 1.0);
+	*stddev = (variance > 0.0) ? sqrt(variance) : 0.0;
+	*change = (*mean != 0.0) ? 100.0 * (value - *mean) / fabs(*mean) : 0.0;
+
+	t_crit = (df <= SIZEOF_ARRAY(stress_results_t99)) ?
+		stress_results_t99[df - 1] : 2.326;
+	se = *stddev * sqrt(1.0 + (1.0 / n));
+	if (se > 0.0) {
+		*t = (value - *mean) / se;
+	} else {
+		/* no variation in the baseline, any change is outside it */
+		*t = (value > *mean) ? HUGE_VAL : ((value < *mean) ? -HUGE_VAL : 0.0);
+	}
+	return (fabs(*t) > t_crit) && (fabs(*change) >= STRESS_RESULTS_MIN_CHANGE);
+}
+
+/*
+ *  stress_results_compare()
+ *	compare an entry against its baseline window and report
+ *	significant changes, returns true if a regression was found
+ */
+static bool stress_results_compare(FILE *yaml, const stress_results_entry_t *entry, const uint32_t window)
+{
+	const stress_results_record_t *record = &entry->record;
+	const uint32_t n = STRESS_MINIMUM(entry->count, window);
+	stress_results_stats_t rate = { 0.0, 0.0, 0 };
+	double mean, stddev, change, t;
+	bool regression, yaml_metrics = false;
+	uint32_t i, other_kernel = 0;
+	const stress_results_record_t *kernel_base = NULL;
+	bool kernels_differ = false;
+	size_t m;
+
+	if (n < STRESS_RESULTS_MIN_BASELINE) {
+		pr_inf("compare: %s: only %" PRIu32 " matching baseline run%s, "
+			"need at least %d to compare\n",
+			record->stressor, n, (n == 1) ? "" : "s",
+			STRESS_RESULTS_MIN_BASELINE);
+		return false;
+	}
+
+	for (i = 0; i < n; i++) {
+		const stress_results_record_t *base = &entry->window[i];
+
+		stress_results_stats_add(&rate, base->bogo_rate);
+		if (base->kernel_hash != record->kernel_hash) {
+			other_kernel++;
+			if (!kernel_base)
+				kernel_base = base;
+			else if (base->kernel_hash != kernel_base->kernel_hash)
+				kernels_differ = true;
+		}
+	}
+	if (kernel_base) {
+		pr_inf("compare: %s: %" PRIu32 " of %" PRIu32 " baseline runs "
+			"are on kernel %s%s, this run is on kernel %s\n",
+			record->stressor, other_kernel, n, kernel_base->kernel,
+			kernels_differ ? " and other kernels" : "", record->kernel);
+	}
+
+	regression = stress_results_significant(&rate, record->bogo_rate,
+				&mean, &stddev, &change, &t) && (change < 0.0);
+	if (regression) {
+		pr_warn("compare: %s: bogo-ops/s regression, %.2f vs baseline "
+			"%.2f (stddev %.2f, %" PRIu32 " runs), %.2f%% change\n",
+			record->stressor, record->bogo_rate, mean, stddev, n, change);
+	} else {
+		pr_inf("compare: %s: bogo-ops/s %.2f vs baseline %.2f "
+			"(stddev %.2f, %" PRIu32 " runs), %.2f%% change\n",
+			record->stressor, record->bogo_rate, mean, stddev, n, change);
+	}
+	pr_yaml(yaml, "    - stressor: %s\n", record->stressor);
+	pr_yaml(yaml, "      kernel: \"%s\"\n", record->kernel);
+	pr_yaml(yaml, "      baseline-runs: %" PRIu32 "\n", n);
+	pr_yaml(yaml, "      baseline-runs-other-kernel: %" PRIu32 "\n", other_kernel);
+	pr_yaml(yaml, "      bogo-ops-per-second-real-time: %f\n", record->bogo_rate);
+	pr_yaml(yaml, "      baseline-mean: %f\n", mean);
+	pr_yaml(yaml, "      baseline-stddev: %f\n", stddev);
+	pr_yaml(yaml, "      change-percent: %f\n", change);
+	pr_yaml(yaml, "      regression: %s\n", regression ? "true" : "false");
+
+	/*
+	 *  The direction of a better metric is not known, so
+	 *  report any significant change in either direction
+	 */
+	for (m = 0; m < record->n_metrics; m++) {
+		stress_results_stats_t stats = { 0.0, 0.0, 0 };
+		const stress_results_metric_t *metric = &record->metrics[m];
+
+		for (i = 0; i < n; i++) {
+			const stress_results_record_t *base = &entry->window[i];
+			size_t k;
+
+			for (k = 0; k < base->n_metrics; k++) {
+				if (base->metrics[k].hash == metric->hash) {
+					stress_results_stats_add(&stats, base->metrics[k].value);
+					break;
+				}
+			}
+		}
+		if (stats.n < STRESS_RESULTS_MIN_BASELINE)
+			continue;
+		if (!stress_results_significant(&stats, metric->value,
+						&mean, &stddev, &change, &t))
+			continue;
+
+		pr_warn("compare: %s: %s changed, %.2f vs baseline "
+			"%.2f (stddev %.2f, %" PRIu32 " runs), %.2f%% change\n",
+			record->stressor, entry->descriptions[m], metric->value,
+			mean, stddev, stats.n, change);
+		if (!yaml_metrics) {
+			pr_yaml(yaml, "      metrics-changed:\n");
+			yaml_metrics = true;
+		}
+		pr_yaml(yaml, "        - metric: \"%s\"\n", entry->descriptions[m]);
+		pr_yaml(yaml, "          value: %f\n", metric->value);
+		pr_yaml(yaml, "          baseline-mean: %f\n", mean);
+		pr_yaml(yaml, "          change-percent: %f\n", change);
+	}
+	return regression;
+}
+
+/*
+ *  stress_results_db_append()
+ *	append records to the results database in one write
+ */
+static void stress_results_db_append(
+	const char *filename,
+	const stress_results_entry_t *entries,
+	const size_t n_entries)
+{
+	stress_results_record_t *records;
+	const size_t sz = n_entries * sizeof(*records);
+	size_t i;
+	ssize_t ret;
+	int fd;
+
+	records = (stress_results_record_t *)malloc(sz);
+	if (!records) {
+		pr_inf("results-db: cannot allocate %zu bytes for records\n", sz);
+		return;
+	}
+	for (i = 0; i < n_entries; i++)
+		records[i] = entries[i].record;
+
+	fd = open(filename, O_WRONLY | O_APPEND | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (fd < 0) {
+		pr_inf("results-db: cannot open %s, errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		free(records);
+		return;
+	}
+#if defined(HAVE_SYS_FILE_H) &&	\
+    defined(LOCK_EX)
+	(void)flock(fd, LOCK_EX);
+#endif
+	ret = write(fd, records, sz);
+	if (ret != (ssize_t)sz) {
+		pr_inf("results-db: failed to append %zu records to %s, errno=%d (%s)\n",
+			n_entries, filename, errno, strerror(errno));
+	} else {
+		pr_dbg("results-db: appended %zu records to %s\n", n_entries, filename);
+	}
+#if defined(HAVE_SYS_FILE_H) &&	\
+    defined(LOCK_UN)
+	(void)flock(fd, LOCK_UN);
+#endif
+	(void)close(fd);
+	free(records);
+}
+
+/*
+ *  stress_results_db_update()
+ *	compare this run against earlier runs if --compare is used
+ *	and then append the results of this run to the database
+ */
+void stress_results_db_update(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	const char *filename = NULL;
+	bool compare = false;
+	uint32_t window = STRESS_RESULTS_WINDOW_DEFAULT;
+	stress_stressor_t *ss;
+	stress_results_entry_t *entries;
+	size_t n_entries = 0, n, i;
+	uint64_t host_hash, kernel_hash = 0, cpu_hash, opts_hash;
+	char hostname[256];
+	char kernel[64];
+	const time_t now = time(NULL);
+
+	(void)stress_get_setting("results-db", &filename);
+	(void)stress_get_setting("compare", &compare);
+	(void)stress_get_setting("compare-window", &window);
+	if (!filename) {
+		if (compare)
+			pr_inf("compare: no --results-db database specified, "
+				"cannot compare results\n");
+		return;
+	}
+
+	for (n = 0, ss = stressors_list; ss; ss = ss->next)
+		n++;
+	if (n == 0)
+		return;
+	entries = (stress_results_entry_t *)calloc(n, sizeof(*entries));
+	if (!entries) {
+		pr_inf("results-db: cannot allocate %zu result entries\n", n);
+		return;
+	}
+
+	(void)shim_memset(hostname, 0, sizeof(hostname));
+	if (gethostname(hostname, sizeof(hostname) - 1) < 0)
+		(void)shim_strscpy(hostname, "unknown", sizeof(hostname));
+	host_hash = stress_results_hash_str(hostname);
+	(void)shim_strscpy(kernel, "unknown", sizeof(kernel));
+#if defined(HAVE_UNAME) &&	\
+    defined(HAVE_SYS_UTSNAME_H)
+	{
+		struct utsname uts;
+
+		if (uname(&uts) == 0) {
+			kernel_hash = stress_results_hash_str(uts.sysname);
+			kernel_hash = stress_results_hash(kernel_hash, uts.release, strlen(uts.release));
+			(void)shim_strscpy(kernel, uts.sysname, sizeof(kernel));
+			(void)shim_strlcat(kernel, " ", sizeof(kernel));
+			(void)shim_strlcat(kernel, uts.release, sizeof(kernel));
+		}
+	}
+#endif
+	cpu_hash = stress_results_cpu_hash();
+	opts_hash = stress_results_job_hash(results_opts_hash);
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (ss->ignore.run || ss->ignore.permute || !ss->stats)
+			continue;
+		if (stress_results_record_init(&entries[n_entries], ss,
+				host_hash, kernel_hash, kernel, cpu_hash, opts_hash, now))
+			n_entries++;
+	}
+
+	if (compare && (n_entries > 0)) {
+		bool ok = true;
+		size_t regressions = 0;
+
+		for (i = 0; i < n_entries; i++) {
+			entries[i].window = (stress_results_record_t *)
+				calloc(window, sizeof(*entries[i].window));
+			if (!entries[i].window)
+				ok = false;
+		}
+		if (!ok) {
+			pr_inf("compare: cannot allocate baseline window of %" PRIu32 " runs\n", window);
+		} else {
+			const size_t records = stress_results_db_read(filename, entries, n_entries, window);
+
+			pr_dbg("compare: read %zu records from %s\n", records, filename);
+			pr_yaml(yaml, "compare:\n");
+			for (i = 0; i < n_entries; i++) {
+				if (stress_results_compare(yaml, &entries[i], window))
+					regressions++;
+			}
+			pr_yaml(yaml, "\n");
+			if (regressions)
+				pr_warn("compare: %zu stressor%s regressed against baseline\n",
+					regressions, (regressions == 1) ? "" : "s");
+		}
+		for (i = 0; i < n_entries; i++)
+			free(entries[i].window);
+	}
+
+	if (n_entries > 0)
+		stress_results_db_append(filename, entries, n_entries);
+	free(entries);
+}
@@ -17,8 +17,11 @@
  *
  */
 #include "stress-ng.h"
-#include "core-sort.h"
+#include "core-builtin.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
+#include "core-sort.h"
+#include "core-target-clones.h"
 
 uint64_t stress_sort_compares ALIGN64;
 
@@ -248,3 +251,752 @@ sort_copy_func_t sort_copy_func(const size_t size)
 	}
 	return sort_copy;
 }
+
+/*
+ *  Parallel int32 sorting engines
+ *
+ *  stress_sort_network_int32() is a serial sort, 8 x 8 blocks are
+ *  sorted with a vectorized sorting network and the resulting runs
+ *  of 8 are merged bottom up. It is the base case of the parallel
+ *  mergesort, a work stealing task scheduler where the last child
+ *  task to finish merges its parent, large merges are split into
+ *  merge path chunks that are themselves stealable tasks. The LSD
+ *  radix sort uses per-thread digit histograms and scatters each
+ *  thread's block to its own precomputed offsets.
+ */
+#define SORT_NET_ROWS		(8)		/* sorting network inputs */
+#define SORT_NET_LANES		(8)		/* int32 lanes per network vector */
+#define SORT_NET_BLOCK		(SORT_NET_ROWS * SORT_NET_LANES)
+#define SORT_PAR_CUTOFF		(8192)		/* serial base case elements */
+#define SORT_PAR_MERGE_CHUNK	(16384)		/* min elements per merge chunk */
+#define SORT_RADIX_BITS		(8)
+#define SORT_RADIX_BUCKETS	(1U << SORT_RADIX_BITS)
+#define SORT_RADIX_PASSES	(32 / SORT_RADIX_BITS)
+
+#if defined(HAVE_VECMATH)
+typedef int32_t stress_sort_vec_t
+	__attribute__ ((vector_size(sizeof(int32_t) * SORT_NET_LANES)));
+
+/* compare and exchange lanes of vectors a and b, min in a, max in b */
+#define SORT_NET_CE(v, i, j)						\
+do {									\
+	const stress_sort_vec_t lt = (v[i] < v[j]);			\
+	const stress_sort_vec_t mn = (lt & v[i]) | (~lt & v[j]);	\
+									\
+	v[j] = (lt & v[j]) | (~lt & v[i]);				\
+	v[i] = mn;							\
+} while (0)
+
+/*
+ *  stress_sort_network_block()
+ *	sort SORT_NET_LANES columns of SORT_NET_ROWS elements with
+ *	the optimal 19 comparator 8 input network, the columns are
+ *	written back as runs of 8 sorted elements
+ */
+static inline void ALWAYS_INLINE OPTIMIZE3 stress_sort_network_block(int32_t *data)
+{
+	stress_sort_vec_t v[SORT_NET_ROWS];
+	int32_t t[SORT_NET_ROWS][SORT_NET_LANES];
+	register size_t r, l;
+
+	(void)shim_memcpy(v, data, sizeof(v));
+
+	SORT_NET_CE(v, 0, 2); SORT_NET_CE(v, 1, 3); SORT_NET_CE(v, 4, 6); SORT_NET_CE(v, 5, 7);
+	SORT_NET_CE(v, 0, 4); SORT_NET_CE(v, 1, 5); SORT_NET_CE(v, 2, 6); SORT_NET_CE(v, 3, 7);
+	SORT_NET_CE(v, 0, 1); SORT_NET_CE(v, 2, 3); SORT_NET_CE(v, 4, 5); SORT_NET_CE(v, 6, 7);
+	SORT_NET_CE(v, 2, 4); SORT_NET_CE(v, 3, 5);
+	SORT_NET_CE(v, 1, 4); SORT_NET_CE(v, 3, 6);
+	SORT_NET_CE(v, 1, 2); SORT_NET_CE(v, 3, 4); SORT_NET_CE(v, 5, 6);
+
+	/* transpose, column l becomes run l */
+	(void)shim_memcpy(t, v, sizeof(t));
+	for (l = 0; l < SORT_NET_LANES; l++) {
+		for (r = 0; r < SORT_NET_ROWS; r++)
+			data[(l * SORT_NET_ROWS) + r] = t[r][l];
+	}
+}
+#endif
+
+/*
+ *  stress_sort_insertion_int32()
+ *	insertion sort, for short runs
+ */
+static inline void OPTIMIZE3 stress_sort_insertion_int32(int32_t *data, const size_t n)
+{
+	register size_t i;
+
+	for (i = 1; i < n; i++) {
+		const int32_t v = data[i];
+		register size_t j = i;
+
+		while ((j > 0) && (data[j - 1] > v)) {
+			data[j] = data[j - 1];
+			j--;
+		}
+		data[j] = v;
+	}
+}
+
+/*
+ *  stress_sort_merge_int32()
+ *	stable merge of sorted a and b into out
+ */
+static inline void OPTIMIZE3 stress_sort_merge_int32(
+	const int32_t *a,
+	const size_t na,
+	const int32_t *b,
+	const size_t nb,
+	int32_t *out)
+{
+	const int32_t *a_end = a + na;
+	const int32_t *b_end = b + nb;
+
+	while ((a < a_end) && (b < b_end)) {
+		const bool take_b = *b < *a;
+
+		*out++ = take_b ? *b : *a;
+		a += !take_b;
+		b += take_b;
+	}
+	if (a < a_end)
+		(void)shim_memcpy(out, a, (size_t)(a_end - a) * sizeof(*a));
+	else if (b < b_end)
+		(void)shim_memcpy(out, b, (size_t)(b_end - b) * sizeof(*b));
+}
+
+/*
+ *  stress_sort_network_int32()
+ *	serial sort of n int32 values, tmp is n elements of scratch
+ */
+void OPTIMIZE3 TARGET_CLONES stress_sort_network_int32(int32_t *data, int32_t *tmp, const size_t n)
+{
+	int32_t *src = data, *dst = tmp;
+	size_t i, width;
+
+	i = 0;
+#if defined(HAVE_VECMATH)
+	for (; i + SORT_NET_BLOCK <= n; i += SORT_NET_BLOCK)
+		stress_sort_network_block(data + i);
+#endif
+	for (; i < n; i += SORT_NET_ROWS)
+		stress_sort_insertion_int32(data + i, (n - i < SORT_NET_ROWS) ? n - i : SORT_NET_ROWS);
+
+	for (width = SORT_NET_ROWS; width < n; width <<= 1) {
+		int32_t *swap;
+
+		for (i = 0; i < n; i += width << 1) {
+			const size_t na = (i + width < n) ? width : n - i;
+			const size_t nb = (i + width < n) ?
+				((i + (width << 1) < n) ? width : n - i - width) : 0;
+
+			stress_sort_merge_int32(src + i, na, src + i + na, nb, dst + i);
+		}
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != data)
+		(void)shim_memcpy(data, src, n * sizeof(*data));
+}
+
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_ATOMIC_SUB_FETCH) &&	\
+    defined(HAVE_ATOMIC_FETCH_ADD) &&	\
+    defined(HAVE_ATOMIC_LOAD) &&	\
+    defined(HAVE_ATOMIC_STORE)
+#define STRESS_SORT_PARALLEL
+
+typedef struct stress_sort_task {
+	struct stress_sort_task *parent;	/* task to complete when done */
+	size_t lo;				/* first element */
+	size_t n;				/* number of elements */
+	size_t k_start;				/* merge chunk output start */
+	size_t k_end;				/* merge chunk output end */
+	uint32_t pending;			/* outstanding child tasks */
+	bool is_merge;				/* merge chunk rather than sort */
+	bool to_tmp;				/* result in tmp rather than data */
+	bool merging;				/* children sorted, now merging */
+} stress_sort_task_t;
+
+typedef struct {
+	pthread_mutex_t lock;			/* deque lock */
+	stress_sort_task_t **tasks;		/* tasks, owner uses bottom */
+	size_t top;				/* thieves steal from top */
+	size_t bottom;				/* owner pushes/pops bottom */
+} stress_sort_deque_t;
+
+typedef struct {
+	int32_t *data;				/* data to sort */
+	int32_t *tmp;				/* scratch, same size as data */
+	size_t n_threads;			/* number of worker threads */
+	stress_sort_deque_t *deques;		/* per thread task deques */
+	stress_sort_task_t *pool;		/* preallocated tasks */
+	size_t pool_size;			/* number of tasks in pool */
+	size_t pool_used;			/* tasks allocated */
+	bool done;				/* root task complete */
+} stress_sort_sched_t;
+
+typedef struct {
+	pthread_t pthread;			/* worker pthread */
+	int ret;				/* pthread_create return */
+	size_t id;				/* worker index */
+	void *ctxt;				/* sort context */
+} stress_sort_worker_t;
+
+/*
+ *  stress_sort_workers_start()
+ *	start workers 1..n_threads-1, worker 0 is the caller,
+ *	returns number of workers including the caller
+ */
+static size_t stress_sort_workers_start(
+	stress_sort_worker_t *workers,
+	const size_t n_threads,
+	void *ctxt,
+	void *(*func)(void *))
+{
+	size_t i, started = 1;
+
+	for (i = 0; i < n_threads; i++) {
+		workers[i].id = i;
+		workers[i].ctxt = ctxt;
+		workers[i].ret = -1;
+	}
+	for (i = 1; i < n_threads; i++) {
+		workers[i].ret = pthread_create(&workers[i].pthread, NULL, func, &workers[i]);
+		if (workers[i].ret == 0)
+			started++;
+	}
+	return started;
+}
+
+/*
+ *  stress_sort_workers_join()
+ *	wait for started workers
+ */
+static void stress_sort_workers_join(stress_sort_worker_t *workers, const size_t n_threads)
+{
+	size_t i;
+
+	for (i = 1; i < n_threads; i++) {
+		if (workers[i].ret == 0)
+			(void)pthread_join(workers[i].pthread, NULL);
+	}
+}
+
+/*
+ *  stress_sort_worker_block_signals()
+ *	workers leave signal handling to the controlling thread
+ */
+static void stress_sort_worker_block_signals(void)
+{
+	sigset_t set;
+
+	(void)sigfillset(&set);
+	(void)pthread_sigmask(SIG_BLOCK, &set, NULL);
+}
+
+static stress_sort_task_t *stress_sort_task_alloc(stress_sort_sched_t *sched)
+{
+	const size_t i = __atomic_fetch_add(&sched->pool_used, 1, __ATOMIC_RELAXED);
+
+	return (i < sched->pool_size) ? &sched->pool[i] : NULL;
+}
+
+static void stress_sort_task_push(stress_sort_deque_t *dq, stress_sort_task_t *task)
+{
+	(void)pthread_mutex_lock(&dq->lock);
+	dq->tasks[dq->bottom++] = task;
+	(void)pthread_mutex_unlock(&dq->lock);
+}
+
+static stress_sort_task_t *stress_sort_task_pop(stress_sort_deque_t *dq)
+{
+	stress_sort_task_t *task = NULL;
+
+	(void)pthread_mutex_lock(&dq->lock);
+	if (dq->bottom > dq->top)
+		task = dq->tasks[--dq->bottom];
+	if (dq->bottom == dq->top)
+		dq->bottom = dq->top = 0;
+	(void)pthread_mutex_unlock(&dq->lock);
+
+	return task;
+}
+
+static stress_sort_task_t *stress_sort_task_steal(stress_sort_deque_t *dq)
+{
+	stress_sort_task_t *task = NULL;
+
+	if (pthread_mutex_trylock(&dq->lock) != 0)
+		return NULL;
+	if (dq->bottom > dq->top)
+		task = dq->tasks[dq->top++];
+	if (dq->bottom == dq->top)
+		dq->bottom = dq->top = 0;
+	(void)pthread_mutex_unlock(&dq->lock);
+
+	return task;
+}
+
+/*
+ *  stress_sort_corank()
+ *	merge path co-rank, number of elements taken from a for
+ *	the first k elements of the stable merge of a and b
+ */
+static size_t OPTIMIZE3 stress_sort_corank(
+	const size_t k,
+	const int32_t *a,
+	const size_t na,
+	const int32_t *b,
+	const size_t nb)
+{
+	size_t i = (k < na) ? k : na;
+	size_t j = k - i;
+	size_t i_low = (k > nb) ? k - nb : 0;
+	size_t j_low = (k > na) ? k - na : 0;
+
+	for (;;) {
+		if ((i > 0) && (j < nb) && (a[i - 1] > b[j])) {
+			const size_t delta = (i - i_low + 1) >> 1;
+
+			j_low = j;
+			i -= delta;
+			j += delta;
+		} else if ((j > 0) && (i < na) && (b[j - 1] >= a[i])) {
+			const size_t delta = (j - j_low + 1) >> 1;
+
+			i_low = i;
+			i += delta;
+			j -= delta;
+		} else {
+			return i;
+		}
+	}
+}
+
+/*
+ *  stress_sort_task_merge()
+ *	merge output elements k_start..k_end-1 of the two sorted
+ *	halves of a sort task
+ */
+static void OPTIMIZE3 stress_sort_task_merge(
+	const stress_sort_sched_t *sched,
+	const stress_sort_task_t *task,
+	const size_t k_start,
+	const size_t k_end)
+{
+	const int32_t *src = (task->to_tmp ? sched->data : sched->tmp) + task->lo;
+	int32_t *dst = (task->to_tmp ? sched->tmp : sched->data) + task->lo;
+	const size_t na = task->n >> 1;
+	const size_t nb = task->n - na;
+	const int32_t *a = src, *b = src + na;
+	const size_t i0 = stress_sort_corank(k_start, a, na, b, nb);
+	const size_t i1 = stress_sort_corank(k_end, a, na, b, nb);
+
+	stress_sort_merge_int32(a + i0, i1 - i0, b + (k_start - i0),
+		(k_end - i1) - (k_start - i0), dst + k_start);
+}
+
+/*
+ *  stress_sort_task_complete()
+ *	task is done, the last child of a parent merges the parent,
+ *	the last merge chunk of a parent completes the parent
+ */
+static void stress_sort_task_complete(
+	stress_sort_sched_t *sched,
+	stress_sort_deque_t *dq,
+	stress_sort_task_t *task)
+{
+	for (;;) {
+		stress_sort_task_t *parent = task->parent;
+		size_t chunks, i;
+
+		if (!parent) {
+			__atomic_store_n(&sched->done, true, __ATOMIC_RELEASE);
+			return;
+		}
+		if (__atomic_sub_fetch(&parent->pending, 1, __ATOMIC_ACQ_REL) != 0)
+			return;
+		if (parent->merging) {
+			task = parent;
+			continue;
+		}
+		parent->merging = true;
+
+		chunks = parent->n / SORT_PAR_MERGE_CHUNK;
+		if (chunks > sched->n_threads * 2)
+			chunks = sched->n_threads * 2;
+		if ((chunks < 2) || (sched->n_threads < 2)) {
+			stress_sort_task_merge(sched, parent, 0, parent->n);
+			task = parent;
+			continue;
+		}
+		parent->pending = (uint32_t)chunks;
+		task = NULL;
+		for (i = 0; i < chunks; i++) {
+			stress_sort_task_t *chunk = stress_sort_task_alloc(sched);
+			const size_t k_start = (parent->n * i) / chunks;
+			const size_t k_end = (parent->n * (i + 1)) / chunks;
+
+			if (!chunk) {
+				/* out of tasks, merge this chunk now */
+				stress_sort_task_merge(sched, parent, k_start, k_end);
+				if (__atomic_sub_fetch(&parent->pending, 1, __ATOMIC_ACQ_REL) == 0)
+					task = parent;
+				continue;
+			}
+			chunk->parent = parent;
+			chunk->lo = parent->lo;
+			chunk->n = parent->n;
+			chunk->k_start = k_start;
+			chunk->k_end = k_end;
+			chunk->is_merge = true;
+			chunk->to_tmp = parent->to_tmp;
+			stress_sort_task_push(dq, chunk);
+		}
+		if (task)
+			continue;
+		return;
+	}
+}
+
+/*
+ *  stress_sort_task_run()
+ *	run a sort or merge chunk task
+ */
+static void stress_sort_task_run(
+	stress_sort_sched_t *sched,
+	stress_sort_deque_t *dq,
+	stress_sort_task_t *task)
+{
+	if (task->is_merge) {
+		stress_sort_task_merge(sched, task->parent, task->k_start, task->k_end);
+		stress_sort_task_complete(sched, dq, task);
+		return;
+	}
+
+	while (task->n > SORT_PAR_CUTOFF) {
+		stress_sort_task_t *left = stress_sort_task_alloc(sched);
+		stress_sort_task_t *right = stress_sort_task_alloc(sched);
+
+		if (!left || !right)
+			break;
+
+		left->parent = task;
+		left->lo = task->lo;
+		left->n = task->n >> 1;
+		left->to_tmp = !task->to_tmp;
+		right->parent = task;
+		right->lo = task->lo + left->n;
+		right->n = task->n - left->n;
+		right->to_tmp = !task->to_tmp;
+		task->pending = 2;
+
+		stress_sort_task_push(dq, right);
+		task = left;
+	}
+	stress_sort_network_int32(sched->data + task->lo, sched->tmp + task->lo, task->n);
+	if (task->to_tmp)
+		(void)shim_memcpy(sched->tmp + task->lo, sched->data + task->lo,
+			task->n * sizeof(*sched->data));
+	stress_sort_task_complete(sched, dq, task);
+}
+
+/*
+ *  stress_sort_mergesort_worker()
+ *	run own tasks, steal when idle until the root task completes
+ */
+static void *stress_sort_mergesort_worker(void *arg)
+{
+	const stress_sort_worker_t *worker = (const stress_sort_worker_t *)arg;
+	stress_sort_sched_t *sched = (stress_sort_sched_t *)worker->ctxt;
+	stress_sort_deque_t *dq = &sched->deques[worker->id];
+	size_t victim = worker->id;
+
+	if (worker->id)
+		stress_sort_worker_block_signals();
+
+	while (!__atomic_load_n(&sched->done, __ATOMIC_ACQUIRE)) {
+		stress_sort_task_t *task = stress_sort_task_pop(dq);
+		size_t i;
+
+		for (i = 1; !task && (i < sched->n_threads); i++) {
+			victim = (victim + 1) % sched->n_threads;
+			if (victim != worker->id)
+				task = stress_sort_task_steal(&sched->deques[victim]);
+		}
+		if (task)
+			stress_sort_task_run(sched, dq, task);
+		else
+			(void)shim_sched_yield();
+	}
+	return &g_nowt;
+}
+#endif
+
+/*
+ *  stress_sort_mergesort_int32_par()
+ *	parallel work stealing mergesort using n_threads threads,
+ *	tmp is n elements of scratch, returns -1 on allocation failure
+ */
+int stress_sort_mergesort_int32_par(
+	int32_t *data,
+	int32_t *tmp,
+	const size_t n,
+	const size_t n_threads)
+{
+#if defined(STRESS_SORT_PARALLEL)
+	stress_sort_sched_t sched;
+	stress_sort_worker_t *workers;
+	size_t i, levels, leaves;
+
+	if ((n_threads < 2) || (n <= SORT_PAR_CUTOFF)) {
+		stress_sort_network_int32(data, tmp, n);
+		return 0;
+	}
+
+	(void)shim_memset(&sched, 0, sizeof(sched));
+	sched.data = data;
+	sched.tmp = tmp;
+	sched.n_threads = n_threads;
+
+	/* sort tasks form a binary tree, merge chunks are per level */
+	leaves = (n + SORT_PAR_CUTOFF - 1) / SORT_PAR_CUTOFF;
+	for (levels = 1, i = 1; i < leaves; i <<= 1)
+		levels++;
+	sched.pool_size = (4 * leaves) + (levels * ((n / SORT_PAR_MERGE_CHUNK) + 1)) + 1;
+	sched.pool = (stress_sort_task_t *)calloc(sched.pool_size, sizeof(*sched.pool));
+	sched.deques = (stress_sort_deque_t *)calloc(n_threads, sizeof(*sched.deques));
+	workers = (stress_sort_worker_t *)calloc(n_threads, sizeof(*workers));
+	if (!sched.pool || !sched.deques || !workers)
+		goto err;
+	for (i = 0; i < n_threads; i++) {
+		sched.deques[i].tasks = (stress_sort_task_t **)calloc(sched.pool_size, sizeof(stress_sort_task_t *));
+		if (!sched.deques[i].tasks)
+			goto err_deques;
+		(void)pthread_mutex_init(&sched.deques[i].lock, NULL);
+	}
+
+	/* root task */
+	sched.pool[0].n = n;
+	sched.pool_used = 1;
+	stress_sort_task_push(&sched.deques[0], &sched.pool[0]);
+
+	(void)stress_sort_workers_start(workers, n_threads, &sched, stress_sort_mergesort_worker);
+	(void)stress_sort_mergesort_worker(&workers[0]);
+	stress_sort_workers_join(workers, n_threads);
+
+	for (i = 0; i < n_threads; i++) {
+		(void)pthread_mutex_destroy(&sched.deques[i].lock);
+		free(sched.deques[i].tasks);
+	}
+	free(workers);
+	free(sched.deques);
+	free(sched.pool);
+	return 0;
+
+err_deques:
+	while (i > 0) {
+		i--;
+		(void)pthread_mutex_destroy(&sched.deques[i].lock);
+		free(sched.deques[i].tasks);
+	}
+err:
+	free(workers);
+	free(sched.deques);
+	free(sched.pool);
+	return -1;
+#else
+	(void)n_threads;
+
+	stress_sort_network_int32(data, tmp, n);
+	return 0;
+#endif
+}
+
+#if defined(STRESS_SORT_PARALLEL)
+typedef struct {
+	pthread_mutex_t lock;			/* barrier lock */
+	pthread_cond_t cond;			/* barrier wake up */
+	size_t count;				/* threads waiting */
+	size_t n;				/* threads participating */
+	size_t generation;			/* barrier generation */
+} stress_sort_barrier_t;
+
+typedef struct {
+	int32_t *data;				/* data to sort */
+	int32_t *tmp;				/* scratch, same size as data */
+	size_t n;				/* number of elements */
+	size_t n_threads;			/* number of threads */
+	uint32_t (*hist)[SORT_RADIX_BUCKETS];	/* per thread digit histograms */
+	stress_sort_barrier_t barrier;		/* pass phase barrier */
+	bool abort;				/* thread start failure */
+} stress_sort_radix_t;
+
+static void stress_sort_barrier_wait(stress_sort_barrier_t *barrier)
+{
+	(void)pthread_mutex_lock(&barrier->lock);
+	if (++barrier->count >= barrier->n) {
+		barrier->count = 0;
+		barrier->generation++;
+		(void)pthread_cond_broadcast(&barrier->cond);
+	} else {
+		const size_t generation = barrier->generation;
+
+		while (generation == barrier->generation)
+			(void)pthread_cond_wait(&barrier->cond, &barrier->lock);
+	}
+	(void)pthread_mutex_unlock(&barrier->lock);
+}
+
+/*
+ *  stress_sort_radix_worker()
+ *	LSD radix sort passes over this thread's block of elements
+ */
+static void *stress_sort_radix_worker(void *arg)
+{
+	const stress_sort_worker_t *worker = (const stress_sort_worker_t *)arg;
+	stress_sort_radix_t *radix = (stress_sort_radix_t *)worker->ctxt;
+	const size_t id = worker->id;
+	const size_t lo = (radix->n * id) / radix->n_threads;
+	const size_t hi = (radix->n * (id + 1)) / radix->n_threads;
+	int32_t *src = radix->data, *dst = radix->tmp;
+	size_t pass;
+
+	if (id)
+		stress_sort_worker_block_signals();
+
+	/* start gate, all threads started or abort */
+	stress_sort_barrier_wait(&radix->barrier);
+	if (radix->abort)
+		return &g_nowt;
+
+	for (pass = 0; pass < SORT_RADIX_PASSES; pass++) {
+		const unsigned int shift = (unsigned int)(pass * SORT_RADIX_BITS);
+		uint32_t *hist = radix->hist[id];
+		size_t offset[SORT_RADIX_BUCKETS];
+		size_t i, t, base;
+		int32_t *swap;
+
+		(void)shim_memset(hist, 0, sizeof(radix->hist[id]));
+		for (i = lo; i < hi; i++) {
+			const uint32_t key = (uint32_t)src[i] ^ 0x80000000U;
+
+			hist[(key >> shift) & (SORT_RADIX_BUCKETS - 1)]++;
+		}
+		stress_sort_barrier_wait(&radix->barrier);
+
+		/* digit d of thread id goes after all smaller digits and digit d of lower threads */
+		for (base = 0, i = 0; i < SORT_RADIX_BUCKETS; i++) {
+			size_t before = 0, total = 0;
+
+			for (t = 0; t < radix->n_threads; t++) {
+				if (t < id)
+					before += radix->hist[t][i];
+				total += radix->hist[t][i];
+			}
+			offset[i] = base + before;
+			base += total;
+		}
+		for (i = lo; i < hi; i++) {
+			const uint32_t key = (uint32_t)src[i] ^ 0x80000000U;
+
+			dst[offset[(key >> shift) & (SORT_RADIX_BUCKETS - 1)]++] = src[i];
+		}
+		stress_sort_barrier_wait(&radix->barrier);
+
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	return &g_nowt;
+}
+#endif
+
+/*
+ *  stress_sort_radixsort_int32_par()
+ *	parallel LSD radix sort, 8 bits per pass, using n_threads
+ *	threads, tmp is n elements of scratch, returns -1 on
+ *	allocation failure
+ */
+int stress_sort_radixsort_int32_par(
+	int32_t *data,
+	int32_t *tmp,
+	const size_t n,
+	const size_t n_threads)
+{
+#if defined(STRESS_SORT_PARALLEL)
+	stress_sort_radix_t radix;
+	stress_sort_worker_t *workers;
+	size_t started;
+
+	(void)shim_memset(&radix, 0, sizeof(radix));
+	radix.data = data;
+	radix.tmp = tmp;
+	radix.n = n;
+	radix.n_threads = (n_threads < 1) ? 1 : n_threads;
+
+	radix.hist = calloc(radix.n_threads, sizeof(*radix.hist));
+	workers = (stress_sort_worker_t *)calloc(radix.n_threads, sizeof(*workers));
+	if (!radix.hist || !workers) {
+		free(workers);
+		free(radix.hist);
+		return -1;
+	}
+	(void)pthread_mutex_init(&radix.barrier.lock, NULL);
+	(void)pthread_cond_init(&radix.barrier.cond, NULL);
+	radix.barrier.n = radix.n_threads;
+
+	started = stress_sort_workers_start(workers, radix.n_threads, &radix, stress_sort_radix_worker);
+	if (started < radix.n_threads) {
+		/* release the started threads, then sort on this thread */
+		(void)pthread_mutex_lock(&radix.barrier.lock);
+		radix.abort = true;
+		radix.barrier.n = started;
+		(void)pthread_mutex_unlock(&radix.barrier.lock);
+		stress_sort_barrier_wait(&radix.barrier);
+		stress_sort_workers_join(workers, radix.n_threads);
+
+		radix.n_threads = 1;
+		radix.abort = false;
+		radix.barrier.n = 1;
+		(void)stress_sort_radix_worker(&workers[0]);
+	} else {
+		(void)stress_sort_radix_worker(&workers[0]);
+		stress_sort_workers_join(workers, radix.n_threads);
+	}
+	(void)pthread_cond_destroy(&radix.barrier.cond);
+	(void)pthread_mutex_destroy(&radix.barrier.lock);
+	free(workers);
+	free(radix.hist);
+	return 0;
+#else
+	uint32_t hist[SORT_RADIX_BUCKETS];
+	int32_t *src = data, *dst = tmp;
+	size_t pass;
+
+	(void)n_threads;
+
+	for (pass = 0; pass < SORT_RADIX_PASSES; pass++) {
+		const unsigned int shift = (unsigned int)(pass * SORT_RADIX_BITS);
+		size_t i, base;
+		int32_t *swap;
+
+		(void)shim_memset(hist, 0, sizeof(hist));
+		for (i = 0; i < n; i++)
+			hist[(((uint32_t)src[i] ^ 0x80000000U) >> shift) & (SORT_RADIX_BUCKETS - 1)]++;
+		for (base = 0, i = 0; i < SORT_RADIX_BUCKETS; i++) {
+			const size_t count = hist[i];
+
+			hist[i] = (uint32_t)base;
+			base += count;
+		}
+		for (i = 0; i < n; i++)
+			dst[hist[(((uint32_t)src[i] ^ 0x80000000U) >> shift) & (SORT_RADIX_BUCKETS - 1)]++] = src[i];
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	return 0;
+#endif
+}
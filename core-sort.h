@@ -35,6 +35,12 @@ extern uint64_t stress_sort_compares ALIGN64;
 extern sort_swap_func_t sort_swap_func(const size_t size);
 extern sort_copy_func_t sort_copy_func(const size_t size);
 
+extern void stress_sort_network_int32(int32_t *data, int32_t *tmp, const size_t n);
+extern int stress_sort_mergesort_int32_par(int32_t *data, int32_t *tmp,
+	const size_t n, const size_t n_threads);
+extern int stress_sort_radixsort_int32_par(int32_t *data, int32_t *tmp,
+	const size_t n, const size_t n_threads);
+
 static inline int stress_sort_cmp_str(const void *p1, const void *p2)
 {
 	return strcmp(*(const char * const *)p1, *(const char * const *)p2);
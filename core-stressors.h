@@ -152,6 +152,7 @@
 	MACRO(key)		\
 	MACRO(kill)		\
 	MACRO(klog)		\
+	MACRO(ksm_merge)	\
 	MACRO(kvm)		\
 	MACRO(l1cache)		\
 	MACRO(landlock)		\
@@ -221,11 +222,13 @@
 	MACRO(nop)		\
 	MACRO(null)		\
 	MACRO(numa)		\
+	MACRO(numa_migrate)	\
 	MACRO(oom_pipe)		\
 	MACRO(opcode)		\
 	MACRO(open)		\
 	MACRO(pagemove)		\
 	MACRO(pageswap)		\
+	MACRO(parsort)		\
 	MACRO(pci)		\
 	MACRO(personality)	\
 	MACRO(peterson)		\
@@ -367,6 +370,7 @@
 	MACRO(vdso)		\
 	MACRO(veccmp)		\
 	MACRO(vecfp)		\
+	MACRO(vecfreq)		\
 	MACRO(vecmath)		\
 	MACRO(vecshuf)		\
 	MACRO(vecwide)		\
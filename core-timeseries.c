@@ -0,0 +1,438 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-killpid.h"
+#include "core-timeseries.h"
+
+#include <math.h>
+
+#define TIMESERIES_MAX_SAMPLES	(8192)		/* max samples in the ring */
+#define TIMESERIES_MAX_BYTES	(64 * MB)	/* max size of the ring */
+
+/* Per stressor bogo-op rate series, computed at the end of a run */
+typedef struct {
+	double *rates;			/* bogo-ops per second per interval */
+	size_t first;			/* first interval with activity */
+	size_t last;			/* last interval with activity */
+	double min;			/* minimum rate */
+	double p50;			/* 50th percentile rate */
+	double p99;			/* 99th percentile rate */
+	double max;			/* maximum rate */
+} stress_timeseries_rates_t;
+
+static int32_t timeseries_delay = 0;	/* sample interval in seconds */
+static pid_t timeseries_pid = -1;	/* sampler process pid */
+static double timeseries_start;		/* time when sampling started */
+
+/*
+ *  stress_set_timeseries()
+ *	parse --timeseries option
+ */
+int stress_set_timeseries(const char *const opt)
+{
+	const uint64_t delay64 = stress_get_uint64_time(opt);
+
+	if (UNLIKELY((delay64 < 1) || (delay64 > 3600))) {
+		(void)fprintf(stderr, "timeseries must in the range 1 to 3600 seconds.\n");
+		_exit(EXIT_FAILURE);
+	}
+	timeseries_delay = (int32_t)(delay64 & 0x7fffffff);
+	return 0;
+}
+
+/*
+ *  stress_timeseries_sample()
+ *	snapshot all the bogo-op counters into the next ring slot,
+ *	the counters are just read, the stressors are not touched
+ */
+static void stress_timeseries_sample(void)
+{
+	const uint64_t count = g_shared->timeseries.count;
+	const size_t slot = (size_t)(count % g_shared->timeseries.max_samples);
+	const uint32_t num_procs = g_shared->timeseries.num_procs;
+	uint64_t *counters = g_shared->timeseries.counters + (slot * num_procs);
+	uint32_t i;
+
+	for (i = 0; i < num_procs; i++)
+		counters[i] = g_shared->stats[i].args.bogo.ci.counter;
+	g_shared->timeseries.timestamps[slot] = stress_time_now() - timeseries_start;
+	stress_asm_mb();
+	g_shared->timeseries.count = count + 1;
+}
+
+/*
+ *  stress_timeseries_start()
+ *	allocate the sample ring and start the periodic sampler
+ */
+void stress_timeseries_start(const int32_t num_procs)
+{
+	const size_t page_size = stress_get_page_size();
+	size_t max_samples, sz, counters_sz, timestamps_sz;
+	uint64_t timeout = g_opt_timeout;
+	uint8_t *ptr;
+
+	if ((timeseries_delay == 0) || (num_procs < 1))
+		return;
+
+	/*
+	 *  Size the ring for the run duration, capping it so
+	 *  that very long runs just keep the most recent samples
+	 */
+	if ((timeout == 0) || (timeout == TIMEOUT_NOT_SET))
+		timeout = TIMESERIES_MAX_SAMPLES * (uint64_t)timeseries_delay;
+	max_samples = (size_t)STRESS_MINIMUM((timeout / (uint64_t)timeseries_delay) + 2, TIMESERIES_MAX_SAMPLES);
+	while ((max_samples > 2) &&
+	       ((max_samples * (size_t)num_procs * sizeof(uint64_t)) > TIMESERIES_MAX_BYTES))
+		max_samples >>= 1;
+
+	counters_sz = max_samples * (size_t)num_procs * sizeof(*g_shared->timeseries.counters);
+	timestamps_sz = max_samples * sizeof(*g_shared->timeseries.timestamps);
+	sz = (counters_sz + timestamps_sz + page_size - 1) & ~(page_size - 1);
+
+	ptr = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANON, -1, 0);
+	if (ptr == MAP_FAILED) {
+		pr_inf("timeseries: cannot mmap %zu byte sample ring%s, errno=%d (%s), "
+			"disabling timeseries sampling\n",
+			sz, stress_get_memfree_str(), errno, strerror(errno));
+		return;
+	}
+	stress_set_vma_anon_name(ptr, sz, "timeseries");
+	/* Pre-fault the ring so sampling does not page fault during the run */
+	(void)shim_memset(ptr, 0, sz);
+
+	g_shared->timeseries.counters = (uint64_t *)ptr;
+	g_shared->timeseries.timestamps = (double *)(ptr + counters_sz);
+	g_shared->timeseries.length = sz;
+	g_shared->timeseries.max_samples = (uint32_t)max_samples;
+	g_shared->timeseries.num_procs = (uint32_t)num_procs;
+	g_shared->timeseries.count = 0;
+	g_shared->timeseries.interval = (double)timeseries_delay;
+
+	pr_dbg("timeseries: sampling %" PRId32 " bogo-op counter%s every %" PRId32
+		" second%s, %zu sample ring\n",
+		num_procs, num_procs == 1 ? "" : "s",
+		timeseries_delay, timeseries_delay == 1 ? "" : "s",
+		max_samples);
+
+	timeseries_start = stress_time_now();
+	stress_timeseries_sample();
+
+	timeseries_pid = fork();
+	if (timeseries_pid < 0) {
+		pr_inf("timeseries: cannot fork sampler, errno=%d (%s), "
+			"disabling timeseries sampling\n",
+			errno, strerror(errno));
+		stress_timeseries_free();
+		return;
+	} else if (timeseries_pid > 0) {
+		return;
+	}
+
+	stress_parent_died_alarm();
+	stress_set_proc_name("stat [timeseries]");
+
+	{
+		double t_next = timeseries_start;
+
+		while (stress_continue_flag()) {
+			double delta;
+
+			t_next += (double)timeseries_delay;
+			delta = t_next - stress_time_now();
+			if (delta > 0.0)
+				(void)shim_nanosleep_uint64((uint64_t)(delta * STRESS_DBL_NANOSECOND));
+			if (!stress_continue_flag())
+				break;
+			stress_timeseries_sample();
+		}
+	}
+	_exit(0);
+}
+
+/*
+ *  stress_timeseries_stop()
+ *	stop the periodic sampler and take a final sample
+ *	if a reasonable part of an interval has elapsed
+ */
+void stress_timeseries_stop(void)
+{
+	if (timeseries_pid > 0) {
+		(void)stress_kill_pid_wait(timeseries_pid, NULL);
+		timeseries_pid = -1;
+	}
+	if (g_shared->timeseries.counters && (g_shared->timeseries.count > 0)) {
+		const uint64_t count = g_shared->timeseries.count;
+		const size_t slot = (size_t)((count - 1) % g_shared->timeseries.max_samples);
+		const double now = stress_time_now() - timeseries_start;
+
+		if ((now - g_shared->timeseries.timestamps[slot]) >= (g_shared->timeseries.interval * 0.5))
+			stress_timeseries_sample();
+	}
+}
+
+/*
+ *  stress_timeseries_free()
+ *	free the sample ring
+ */
+void stress_timeseries_free(void)
+{
+	if (g_shared->timeseries.counters) {
+		(void)munmap((void *)g_shared->timeseries.counters, g_shared->timeseries.length);
+		g_shared->timeseries.counters = NULL;
+		g_shared->timeseries.timestamps = NULL;
+		g_shared->timeseries.length = 0;
+	}
+}
+
+/*
+ *  stress_timeseries_cmp()
+ *	sort rates into order, least first
+ */
+static int stress_timeseries_cmp(const void *p1, const void *p2)
+{
+	const double *d1 = (const double *)p1;
+	const double *d2 = (const double *)p2;
+
+	if (*d1 > *d2)
+		return 1;
+	else if (*d1 < *d2)
+		return -1;
+	return 0;
+}
+
+/*
+ *  stress_timeseries_percentile()
+ *	nearest rank percentile of n sorted values
+ */
+static double stress_timeseries_percentile(const double *sorted, const size_t n, const double percentile)
+{
+	size_t rank;
+
+	if (n == 0)
+		return 0.0;
+	rank = (size_t)ceil((percentile / 100.0) * (double)n);
+	rank = (rank > 0) ? rank - 1 : 0;
+	return sorted[STRESS_MINIMUM(rank, n - 1)];
+}
+
+/*
+ *  stress_timeseries_rates()
+ *	compute the per interval bogo-op rates of all the instances
+ *	of a stressor, returns false if the stressor had no activity
+ */
+static bool stress_timeseries_rates(
+	const stress_stressor_t *ss,
+	const uint64_t first_sample,
+	const size_t intervals,
+	stress_timeseries_rates_t *tr)
+{
+	const uint32_t max_samples = g_shared->timeseries.max_samples;
+	const uint32_t num_procs = g_shared->timeseries.num_procs;
+	double *sorted;
+	size_t i, n;
+	bool active = false;
+
+	tr->rates = (double *)calloc(intervals, sizeof(*tr->rates));
+	if (!tr->rates)
+		return false;
+	tr->first = 0;
+	tr->last = 0;
+
+	for (i = 0; i < intervals; i++) {
+		const size_t prev = (size_t)((first_sample + i) % max_samples);
+		const size_t curr = (size_t)((first_sample + i + 1) % max_samples);
+		const uint64_t *prev_counters = g_shared->timeseries.counters + (prev * num_procs);
+		const uint64_t *curr_counters = g_shared->timeseries.counters + (curr * num_procs);
+		const double dt = g_shared->timeseries.timestamps[curr] -
+				  g_shared->timeseries.timestamps[prev];
+		uint64_t ops = 0;
+		int32_t j;
+
+		for (j = 0; j < ss->instances; j++) {
+			const size_t idx = (size_t)(ss->stats[j] - g_shared->stats);
+
+			if (idx >= num_procs)
+				continue;
+			/* counter is zero'd when an instance is (re)started */
+			ops += (curr_counters[idx] >= prev_counters[idx]) ?
+				curr_counters[idx] - prev_counters[idx] : curr_counters[idx];
+		}
+		tr->rates[i] = (dt > 0.0) ? (double)ops / dt : 0.0;
+		if (ops) {
+			if (!active)
+				tr->first = i;
+			tr->last = i;
+			active = true;
+		}
+	}
+	if (!active) {
+		free(tr->rates);
+		tr->rates = NULL;
+		return false;
+	}
+
+	/*
+	 *  Stats are only computed over the active window so that
+	 *  sequential runs do not include the idle time of stressors
+	 *  that are waiting to run or have completed
+	 */
+	n = tr->last - tr->first + 1;
+	sorted = (double *)calloc(n, sizeof(*sorted));
+	if (!sorted) {
+		tr->min = tr->p50 = tr->p99 = tr->max = 0.0;
+		return true;
+	}
+	(void)shim_memcpy(sorted, tr->rates + tr->first, n * sizeof(*sorted));
+	qsort(sorted, n, sizeof(*sorted), stress_timeseries_cmp);
+	tr->min = sorted[0];
+	tr->p50 = stress_timeseries_percentile(sorted, n, 50.0);
+	tr->p99 = stress_timeseries_percentile(sorted, n, 99.0);
+	tr->max = sorted[n - 1];
+	free(sorted);
+
+	return true;
+}
+
+/*
+ *  stress_timeseries_csv()
+ *	write the per interval rates of all active stressors to a CSV file
+ */
+static void stress_timeseries_csv(
+	stress_stressor_t *stressors_list,
+	stress_timeseries_rates_t *trs,
+	const uint64_t first_sample,
+	const size_t intervals)
+{
+	const uint32_t max_samples = g_shared->timeseries.max_samples;
+	stress_stressor_t *ss;
+	char *filename;
+	FILE *fp;
+	size_t i, k;
+
+	if (!stress_get_setting("timeseries-csv", &filename))
+		return;
+
+	fp = fopen(filename, "w");
+	if (!fp) {
+		pr_err("timeseries: cannot open CSV file %s, errno=%d (%s)\n",
+			filename, errno, strerror(errno));
+		return;
+	}
+
+	(void)fprintf(fp, "time");
+	for (k = 0, ss = stressors_list; ss; ss = ss->next, k++) {
+		if (trs[k].rates)
+			(void)fprintf(fp, ",%s", ss->stressor->name);
+	}
+	(void)fprintf(fp, "\n");
+
+	for (i = 0; i < intervals; i++) {
+		const size_t curr = (size_t)((first_sample + i + 1) % max_samples);
+
+		(void)fprintf(fp, "%.3f", g_shared->timeseries.timestamps[curr]);
+		for (k = 0, ss = stressors_list; ss; ss = ss->next, k++) {
+			if (trs[k].rates)
+				(void)fprintf(fp, ",%.3f", trs[k].rates[i]);
+		}
+		(void)fprintf(fp, "\n");
+	}
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_timeseries_dump()
+ *	dump per stressor bogo-op rate time series
+ */
+void stress_timeseries_dump(FILE *yaml, stress_stressor_t *stressors_list)
+{
+	const uint32_t max_samples = g_shared->timeseries.max_samples;
+	const double interval = g_shared->timeseries.interval;
+	stress_stressor_t *ss;
+	stress_timeseries_rates_t *trs;
+	uint64_t count, first_sample;
+	size_t n_stressors, intervals, k;
+	bool pr_heading = false;
+
+	if (!g_shared->timeseries.counters)
+		return;
+	count = g_shared->timeseries.count;
+	if (count < 2)
+		return;
+
+	first_sample = (count > max_samples) ? count - max_samples : 0;
+	intervals = (size_t)(count - first_sample - 1);
+	if (count > max_samples)
+		pr_inf("timeseries: note: only the last %zu of %" PRIu64 " intervals were kept\n",
+			intervals, count - 1);
+
+	for (n_stressors = 0, ss = stressors_list; ss; ss = ss->next)
+		n_stressors++;
+	trs = (stress_timeseries_rates_t *)calloc(n_stressors, sizeof(*trs));
+	if (!trs) {
+		pr_inf("timeseries: cannot allocate %zu rate series, skipping timeseries report\n",
+			n_stressors);
+		return;
+	}
+
+	pr_block_begin();
+	for (k = 0, ss = stressors_list; ss; ss = ss->next, k++) {
+		stress_timeseries_rates_t *tr = &trs[k];
+		const char *name = ss->stressor->name;
+		size_t i;
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+		if (!stress_timeseries_rates(ss, first_sample, intervals, tr))
+			continue;
+
+		if (!pr_heading) {
+			pr_inf("timeseries: bogo-ops/s per %.0f second interval:\n", interval);
+			pr_inf("%-13s %8s %12s %12s %12s %12s\n",
+				"stressor", "samples", "min", "p50", "p99", "max");
+			pr_yaml(yaml, "timeseries:\n");
+			pr_heading = true;
+		}
+		pr_inf("%-13s %8zu %12.2f %12.2f %12.2f %12.2f\n",
+			name, tr->last - tr->first + 1, tr->min, tr->p50, tr->p99, tr->max);
+
+		pr_yaml(yaml, "    - stressor: %s\n", name);
+		pr_yaml(yaml, "      interval: %f\n", interval);
+		pr_yaml(yaml, "      bogo-ops-per-second-min: %f\n", tr->min);
+		pr_yaml(yaml, "      bogo-ops-per-second-p50: %f\n", tr->p50);
+		pr_yaml(yaml, "      bogo-ops-per-second-p99: %f\n", tr->p99);
+		pr_yaml(yaml, "      bogo-ops-per-second-max: %f\n", tr->max);
+		pr_yaml(yaml, "      samples:\n");
+		for (i = tr->first; i <= tr->last; i++) {
+			const size_t curr = (size_t)((first_sample + i + 1) % max_samples);
+
+			pr_yaml(yaml, "        - time: %f\n", g_shared->timeseries.timestamps[curr]);
+			pr_yaml(yaml, "          bogo-ops-per-second: %f\n", tr->rates[i]);
+		}
+		pr_yaml(yaml, "\n");
+	}
+	pr_block_end();
+
+	stress_timeseries_csv(stressors_list, trs, first_sample, intervals);
+
+	for (k = 0; k < n_stressors; k++)
+		free(trs[k].rates);
+	free(trs);
+}
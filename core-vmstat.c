@@ -977,6 +977,120 @@ static double stress_get_tz_info(const stress_tz_info_t *tz_info)
 }
 #endif
 
+/*
+ *  stress_vmstat_json()
+ *	format vmstat activity since the previous call, thermal zone
+ *	temperatures and RAPL power as json object members into buf,
+ *	interval is the time in seconds since the previous call.
+ *	Only whole members are written, a member that does not fit
+ *	is dropped. Returns the number of characters written.
+ */
+size_t stress_vmstat_json(char *buf, const size_t len, const double interval)
+{
+	stress_vmstat_t vmstat;
+	double total_ticks, percent, min1, min5, min15;
+	const double scale = (interval > 0.0) ? 1.0 / interval : 0.0;
+	char *ptr = buf, *member = buf;
+	const char *end = buf + len;
+	int ret;
+#if defined(STRESS_RAPL) ||		\
+    (defined(__linux__) &&		\
+     defined(STRESS_THERMAL_ZONES))
+	char name[128];
+#endif
+#if defined(STRESS_RAPL)
+	stress_rapl_domain_t *rapl;
+#endif
+#if defined(__linux__) &&	\
+    defined(STRESS_THERMAL_ZONES)
+	stress_tz_info_t *tz_info;
+#endif
+
+#define STRESS_JSON_APPEND(fmt, ...)				\
+	do {							\
+		ret = snprintf(ptr, (size_t)(end - ptr), fmt, __VA_ARGS__); \
+		if ((ret < 0) || (ret >= (end - ptr)))		\
+			goto truncated;				\
+		ptr += ret;					\
+	} while (0)
+
+	if (len == 0)
+		return 0;
+
+	stress_get_vmstat(&vmstat);
+	total_ticks = (double)vmstat.user_time +
+		      (double)vmstat.system_time +
+		      (double)vmstat.idle_time +
+		      (double)vmstat.wait_time +
+		      (double)vmstat.stolen_time;
+	percent = (total_ticks > 0.0) ? 100.0 / total_ticks : 0.0;
+
+	STRESS_JSON_APPEND("\"vmstat\":{\"r\":%" PRIu64 ",\"b\":%" PRIu64
+		",\"swpd\":%" PRIu64 ",\"free\":%" PRIu64 ",\"buff\":%" PRIu64
+		",\"cache\":%" PRIu64 ",\"si\":%.2f,\"so\":%.2f,\"bi\":%.2f"
+		",\"bo\":%.2f,\"in\":%.2f,\"cs\":%.2f,\"us\":%.2f,\"sy\":%.2f"
+		",\"id\":%.2f,\"wa\":%.2f,\"st\":%.2f}",
+		vmstat.procs_running,
+		vmstat.procs_blocked,
+		vmstat.swap_used,
+		vmstat.memory_free,
+		vmstat.memory_buff,
+		vmstat.memory_cached + vmstat.memory_reclaimable,
+		(double)vmstat.swap_in * scale,
+		(double)vmstat.swap_out * scale,
+		(double)vmstat.block_in * scale,
+		(double)vmstat.block_out * scale,
+		(double)vmstat.interrupt * scale,
+		(double)vmstat.context_switch * scale,
+		percent * (double)vmstat.user_time,
+		percent * (double)vmstat.system_time,
+		percent * (double)vmstat.idle_time,
+		percent * (double)vmstat.wait_time,
+		percent * (double)vmstat.stolen_time);
+	member = ptr;
+
+	if (stress_get_load_avg(&min1, &min5, &min15) == 0) {
+		STRESS_JSON_APPEND(",\"load-average\":[%.2f,%.2f,%.2f]", min1, min5, min15);
+		member = ptr;
+	}
+
+#if defined(__linux__) &&	\
+    defined(STRESS_THERMAL_ZONES)
+	if (g_shared->tz_info) {
+		STRESS_JSON_APPEND("%s", ",\"thermal\":{");
+		for (tz_info = g_shared->tz_info; tz_info; tz_info = tz_info->next) {
+			STRESS_JSON_APPEND("%s\"%s\":%.2f",
+				(tz_info == g_shared->tz_info) ? "" : ",",
+				stress_json_escape(name, sizeof(name), tz_info->type),
+				stress_get_tz_info(tz_info));
+		}
+		STRESS_JSON_APPEND("%s", "}");
+		member = ptr;
+	}
+#endif
+#if defined(STRESS_RAPL)
+	if (g_shared->rapl_domains &&
+	    (stress_rapl_get_power_raplstat(g_shared->rapl_domains) == 0)) {
+		STRESS_JSON_APPEND("%s", ",\"rapl-watts\":{");
+		for (rapl = g_shared->rapl_domains; rapl; rapl = rapl->next) {
+			STRESS_JSON_APPEND("%s\"%s\":%.2f",
+				(rapl == g_shared->rapl_domains) ? "" : ",",
+				stress_json_escape(name, sizeof(name), rapl->domain_name),
+				rapl->data[STRESS_RAPL_DATA_RAPLSTAT].power_watts);
+		}
+		STRESS_JSON_APPEND("%s", "}");
+		member = ptr;
+	}
+#endif
+#undef STRESS_JSON_APPEND
+	return (size_t)(ptr - buf);
+
+truncated:
+	/* roll back to the end of the last complete member */
+	*member = '\0';
+	return (size_t)(member - buf);
+}
+
 /*
  *  stress_vmstat_start()
  *	start vmstat statistics (1 per second)
@@ -1288,3 +1402,122 @@ void stress_vmstat_stop(void)
 	if (vmstat_pid > 0)
 		(void)stress_kill_pid_wait(vmstat_pid, NULL);
 }
+
+/*
+ *  stress_thp_stats_get()
+ *	sample the AnonHugePages of this process and the system
+ *	wide thp_* counters, returns false if none could be read
+ */
+bool stress_thp_stats_get(stress_thp_stats_t *stats)
+{
+#if defined(__linux__)
+	static const struct {
+		const char *name;
+		const size_t offset;
+	} thp_counters[] = {
+		{ "thp_fault_alloc ",		offsetof(stress_thp_stats_t, fault_alloc) },
+		{ "thp_fault_fallback ",	offsetof(stress_thp_stats_t, fault_fallback) },
+		{ "thp_collapse_alloc ",	offsetof(stress_thp_stats_t, collapse_alloc) },
+		{ "thp_collapse_alloc_failed ",	offsetof(stress_thp_stats_t, collapse_alloc_failed) },
+		{ "thp_split_page ",		offsetof(stress_thp_stats_t, split_page) },
+	};
+	FILE *fp;
+	char buffer[256];
+
+	(void)shim_memset(stats, 0, sizeof(*stats));
+
+	/* smaps_rollup is cheaper, fall back to summing all of smaps */
+	fp = fopen("/proc/self/smaps_rollup", "r");
+	if (!fp)
+		fp = fopen("/proc/self/smaps", "r");
+	if (fp) {
+		while (fgets(buffer, sizeof(buffer), fp)) {
+			if (!strncmp(buffer, "AnonHugePages:", 14)) {
+				stats->anon_huge_kb += (uint64_t)atoll(buffer + 14);
+				stats->valid = true;
+			}
+		}
+		(void)fclose(fp);
+	}
+
+	fp = fopen("/proc/vmstat", "r");
+	if (fp) {
+		while (fgets(buffer, sizeof(buffer), fp)) {
+			size_t i;
+
+			if (strncmp(buffer, "thp_", 4))
+				continue;
+			for (i = 0; i < SIZEOF_ARRAY(thp_counters); i++) {
+				const size_t len = strlen(thp_counters[i].name);
+
+				if (!strncmp(buffer, thp_counters[i].name, len)) {
+					*(uint64_t *)((uintptr_t)stats + thp_counters[i].offset) =
+						(uint64_t)atoll(buffer + len);
+					stats->valid = true;
+					break;
+				}
+			}
+		}
+		(void)fclose(fp);
+	}
+	return stats->valid;
+#else
+	(void)shim_memset(stats, 0, sizeof(*stats));
+
+	return false;
+#endif
+}
+
+/*
+ *  stress_thp_stats_report()
+ *	report how much of a size byte buffer was backed by
+ *	transparent huge pages when after was sampled and the
+ *	change in the thp_* counters between before and after,
+ *	metrics are added from index idx, returns the next index
+ */
+size_t stress_thp_stats_report(
+	stress_args_t *args,
+	const stress_thp_stats_t *before,
+	const stress_thp_stats_t *after,
+	const size_t size,
+	size_t idx)
+{
+	double huge;
+
+	if (!before->valid || !after->valid)
+		return idx;
+
+	huge = (size > 0) ? 100.0 * (double)(after->anon_huge_kb * KB) / (double)size : 0.0;
+	huge = STRESS_MINIMUM(huge, 100.0);
+
+#define STRESS_THP_DELTA(field)	\
+	((after->field >= before->field) ? after->field - before->field : 0)
+
+	pr_dbg("%s: THP %.2f%% of buffer in huge pages, thp_fault_alloc %" PRIu64
+		", thp_fault_fallback %" PRIu64 ", thp_collapse_alloc %" PRIu64
+		", thp_collapse_alloc_failed %" PRIu64 ", thp_split_page %" PRIu64
+		" (instance %" PRIu32 ")\n",
+		args->name, huge,
+		STRESS_THP_DELTA(fault_alloc), STRESS_THP_DELTA(fault_fallback),
+		STRESS_THP_DELTA(collapse_alloc), STRESS_THP_DELTA(collapse_alloc_failed),
+		STRESS_THP_DELTA(split_page), args->instance);
+
+	if (idx + 6 > STRESS_MISC_METRICS_MAX)
+		return idx;
+	stress_metrics_set(args, idx++, "% buffer in transparent huge pages",
+		huge, STRESS_METRIC_GEOMETRIC_MEAN);
+	stress_metrics_set(args, idx++, "THP faults allocated (system wide)",
+		(double)STRESS_THP_DELTA(fault_alloc), STRESS_METRIC_MAXIMUM);
+	stress_metrics_set(args, idx++, "THP fault fallbacks (system wide)",
+		(double)STRESS_THP_DELTA(fault_fallback), STRESS_METRIC_MAXIMUM);
+	stress_metrics_set(args, idx++, "THP collapses (system wide)",
+		(double)STRESS_THP_DELTA(collapse_alloc), STRESS_METRIC_MAXIMUM);
+	stress_metrics_set(args, idx++, "THP collapse failures (system wide)",
+		(double)STRESS_THP_DELTA(collapse_alloc_failed), STRESS_METRIC_MAXIMUM);
+	stress_metrics_set(args, idx++, "THP page splits (system wide)",
+		(double)STRESS_THP_DELTA(split_page), STRESS_METRIC_MAXIMUM);
+
+#undef STRESS_THP_DELTA
+
+	return idx;
+}
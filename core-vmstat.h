@@ -21,6 +21,17 @@
 
 #include "core-attribute.h"
 
+/* Transparent huge page statistics */
+typedef struct {
+	uint64_t anon_huge_kb;		/* AnonHugePages of this process, kB */
+	uint64_t fault_alloc;		/* thp_fault_alloc */
+	uint64_t fault_fallback;	/* thp_fault_fallback */
+	uint64_t collapse_alloc;	/* thp_collapse_alloc */
+	uint64_t collapse_alloc_failed;	/* thp_collapse_alloc_failed */
+	uint64_t split_page;		/* thp_split_page */
+	bool valid;			/* true if any statistics were read */
+} stress_thp_stats_t;
+
 extern WARN_UNUSED int stress_set_status(const char *const opt);
 extern WARN_UNUSED int stress_set_vmstat(const char *const opt);
 extern WARN_UNUSED int stress_set_thermalstat(const char *const opt);
@@ -28,7 +39,12 @@ extern WARN_UNUSED int stress_set_iostat(const char *const opt);
 extern WARN_UNUSED int stress_set_raplstat(const char *const opt);
 extern WARN_UNUSED char *stress_find_mount_dev(const char *name);
 extern void stress_set_vmstat_units(const char *const opt);
+extern size_t stress_vmstat_json(char *buf, const size_t len, const double interval);
 extern void stress_vmstat_start(void);
 extern void stress_vmstat_stop(void);
+extern bool stress_thp_stats_get(stress_thp_stats_t *stats);
+extern size_t stress_thp_stats_report(stress_args_t *args,
+	const stress_thp_stats_t *before, const stress_thp_stats_t *after,
+	const size_t size, size_t idx);
 
 #endif
@@ -0,0 +1 @@
+#define STRESS_GIT_COMMIT_ID "e78e8614a692ac810499d9003bf45c73ceb95ced"
@@ -0,0 +1,50 @@
+#define HAVE_IORING_OP_NOP
+#define HAVE_IORING_OP_READV
+#define HAVE_IORING_OP_WRITEV
+#define HAVE_IORING_OP_FSYNC
+#define HAVE_IORING_OP_READ_FIXED
+#define HAVE_IORING_OP_WRITE_FIXED
+#define HAVE_IORING_OP_POLL_ADD
+#define HAVE_IORING_OP_POLL_REMOVE
+#define HAVE_IORING_OP_SYNC_FILE_RANGE
+#define HAVE_IORING_OP_SENDMSG
+#define HAVE_IORING_OP_RECVMSG
+#define HAVE_IORING_OP_TIMEOUT
+#define HAVE_IORING_OP_TIMEOUT_REMOVE
+#define HAVE_IORING_OP_ACCEPT
+#define HAVE_IORING_OP_ASYNC_CANCEL
+#define HAVE_IORING_OP_LINK_TIMEOUT
+#define HAVE_IORING_OP_CONNECT
+#define HAVE_IORING_OP_FALLOCATE
+#define HAVE_IORING_OP_OPENAT
+#define HAVE_IORING_OP_CLOSE
+#define HAVE_IORING_OP_FILES_UPDATE
+#define HAVE_IORING_OP_STATX
+#define HAVE_IORING_OP_READ
+#define HAVE_IORING_OP_WRITE
+#define HAVE_IORING_OP_FADVISE
+#define HAVE_IORING_OP_MADVISE
+#define HAVE_IORING_OP_SEND
+#define HAVE_IORING_OP_RECV
+#define HAVE_IORING_OP_OPENAT2
+#define HAVE_IORING_OP_EPOLL_CTL
+#define HAVE_IORING_OP_SPLICE
+#define HAVE_IORING_OP_PROVIDE_BUFFERS
+#define HAVE_IORING_OP_REMOVE_BUFFERS
+#define HAVE_IORING_OP_TEE
+#define HAVE_IORING_OP_SHUTDOWN
+#define HAVE_IORING_OP_RENAMEAT
+#define HAVE_IORING_OP_UNLINKAT
+#define HAVE_IORING_OP_MKDIRAT
+#define HAVE_IORING_OP_SYMLINKAT
+#define HAVE_IORING_OP_LINKAT
+#define HAVE_IORING_OP_MSG_RING
+#define HAVE_IORING_OP_FSETXATTR
+#define HAVE_IORING_OP_SETXATTR
+#define HAVE_IORING_OP_FGETXATTR
+#define HAVE_IORING_OP_GETXATTR
+#define HAVE_IORING_OP_SOCKET
+#define HAVE_IORING_OP_URING_CMD
+#define HAVE_IORING_OP_SEND_ZC
+#define HAVE_IORING_OP_SENDMSG_ZC
+#define HAVE_IORING_OP_LAST
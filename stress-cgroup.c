@@ -17,17 +17,35 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-capabilities.h"
+#include "core-cgroup.h"
+#include "core-histogram.h"
 #include "core-killpid.h"
+#include "core-mmap.h"
 
 #if defined(HAVE_SYS_MOUNT_H)
 #include <sys/mount.h>
 #endif
 
+#define MIN_CGROUP_MEM_BYTES		(4 * MB)
+#define MAX_CGROUP_MEM_BYTES		(MAX_MEM_LIMIT)
+#define DEFAULT_CGROUP_MEM_HIGH		(64 * MB)
+
 static const stress_help_t help[] = {
-	{ NULL,	"cgroup N",	 "start N workers exercising cgroup mount/read/write/umounts" },
-	{ NULL,	"cgroup-ops N",	 "stop after N iterations of cgroup actions" },
-	{ NULL,	NULL,		 NULL }
+	{ NULL,	"cgroup N",		"start N workers exercising cgroup mount/read/write/umounts" },
+	{ NULL,	"cgroup-mem-bench",	"measure allocation stalls in a memory.high limited cgroup" },
+	{ NULL,	"cgroup-mem-high N",	"set cgroup memory.high to N bytes for --cgroup-mem-bench" },
+	{ NULL,	"cgroup-mem-max N",	"set cgroup memory.max to N bytes for --cgroup-mem-bench" },
+	{ NULL,	"cgroup-ops N",		"stop after N iterations of cgroup actions" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const stress_opt_t opts[] = {
+	{ OPT_cgroup_mem_bench, "cgroup-mem-bench", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_cgroup_mem_high,  "cgroup-mem-high",  TYPE_ID_SIZE_T_BYTES_VM, MIN_CGROUP_MEM_BYTES, MAX_CGROUP_MEM_BYTES, NULL },
+	{ OPT_cgroup_mem_max,   "cgroup-mem-max",   TYPE_ID_SIZE_T_BYTES_VM, MIN_CGROUP_MEM_BYTES, MAX_CGROUP_MEM_BYTES, NULL },
+	END_OPT,
 };
 
 /*
@@ -506,6 +524,324 @@ cleanup:
 	return rc;
 }
 
+#define CGROUP_MEM_ALLOCATORS	(2)
+#define CGROUP_MEM_CHUNK	(1 * MB)
+
+/* Reclaim and pressure state of the --cgroup-mem-bench cgroup */
+typedef struct {
+	uint64_t pgscan;		/* pages scanned by reclaim */
+	uint64_t pgsteal;		/* pages reclaimed */
+	uint64_t pgscan_direct;		/* pages scanned by direct reclaim */
+	uint64_t high;			/* times memory.high was exceeded */
+	uint64_t max;			/* times memory.max was hit */
+	uint64_t oom_kill;		/* processes OOM killed */
+	double some[3];			/* PSI some avg10, avg60, avg300 */
+	double full[3];			/* PSI full avg10, avg60, avg300 */
+} stress_cgroup_mem_stats_t;
+
+/*
+ *  stress_cgroup_mem_stats()
+ *	read the reclaim counters, memory events and PSI pressure
+ *	averages of the cgroup at cgpath
+ */
+static void stress_cgroup_mem_stats(const char *cgpath, stress_cgroup_mem_stats_t *stats)
+{
+	char path[PATH_MAX + 128], data[8192];
+	const char *full;
+
+	(void)shim_memset(stats, 0, sizeof(*stats));
+
+	(void)snprintf(path, sizeof(path), "%s/memory.stat", cgpath);
+	if (stress_system_read(path, data, sizeof(data)) > 0) {
+		stats->pgscan = stress_cgroup_key_value(data, "pgscan");
+		stats->pgsteal = stress_cgroup_key_value(data, "pgsteal");
+		stats->pgscan_direct = stress_cgroup_key_value(data, "pgscan_direct");
+	}
+	(void)snprintf(path, sizeof(path), "%s/memory.events", cgpath);
+	if (stress_system_read(path, data, sizeof(data)) > 0) {
+		stats->high = stress_cgroup_key_value(data, "high");
+		stats->max = stress_cgroup_key_value(data, "max");
+		stats->oom_kill = stress_cgroup_key_value(data, "oom_kill");
+	}
+	(void)snprintf(path, sizeof(path), "%s/memory.pressure", cgpath);
+	if (stress_system_read(path, data, sizeof(data)) > 0) {
+		(void)sscanf(data, "some avg10=%lf avg60=%lf avg300=%lf",
+			&stats->some[0], &stats->some[1], &stats->some[2]);
+		full = strstr(data, "full ");
+		if (full)
+			(void)sscanf(full, "full avg10=%lf avg60=%lf avg300=%lf",
+				&stats->full[0], &stats->full[1], &stats->full[2]);
+	}
+}
+
+/*
+ *  stress_cgroup_mem_allocator()
+ *	allocator run inside the cgroup, time the first touch of each
+ *	page of new anonymous memory while streaming reads through the
+ *	page cache keep the cgroup at its memory.high limit, so the
+ *	allocations stall in reclaim
+ */
+static int stress_cgroup_mem_allocator(
+	stress_args_t *args,
+	const char *cgpath,
+	const int fd,
+	const off_t file_size,
+	const size_t anon_bytes,
+	stress_hist_t *hist)
+{
+	const size_t page_size = args->page_size;
+	const size_t n_chunks = STRESS_MAXIMUM(anon_bytes / CGROUP_MEM_CHUNK, 1);
+	uint8_t **chunks;
+	size_t i, idx = 0;
+	off_t offset = (off_t)(stress_mwc64modn((uint64_t)file_size) & ~(uint64_t)(CGROUP_MEM_CHUNK - 1));
+
+	stress_parent_died_alarm();
+
+	if (stress_cgroup_move_pid(cgpath, getpid()) < 0) {
+		pr_inf_skip("%s: cannot move allocator into cgroup %s, skipping stressor\n",
+			args->name, cgpath);
+		return EXIT_NO_RESOURCE;
+	}
+
+	chunks = (uint8_t **)calloc(n_chunks, sizeof(*chunks));
+	if (!chunks) {
+		pr_inf_skip("%s: failed to allocate %zu chunk pointers%s, skipping stressor\n",
+			args->name, n_chunks, stress_get_memfree_str());
+		return EXIT_NO_RESOURCE;
+	}
+
+	do {
+		uint8_t *ptr;
+
+		ptr = (uint8_t *)mmap(NULL, CGROUP_MEM_CHUNK, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ptr == MAP_FAILED) {
+			(void)shim_usleep(1000);
+			continue;
+		}
+		for (i = 0; i < CGROUP_MEM_CHUNK; i += page_size) {
+			double t;
+
+			t = stress_time_now();
+			*(volatile uint8_t *)(ptr + i) = (uint8_t)i;
+			t = stress_time_now() - t;
+			stress_hist_record(hist, (uint64_t)(t * STRESS_DBL_NANOSECOND));
+		}
+		if (chunks[idx])
+			(void)munmap((void *)chunks[idx], CGROUP_MEM_CHUNK);
+		chunks[idx] = ptr;
+		idx = (idx + 1) % n_chunks;
+
+		/* refill the page cache side of the cgroup */
+		if (pread(fd, (void *)ptr, CGROUP_MEM_CHUNK, offset) < 0)
+			offset = 0;
+		offset += CGROUP_MEM_CHUNK;
+		if (offset >= file_size)
+			offset = 0;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	for (i = 0; i < n_chunks; i++) {
+		if (chunks[i])
+			(void)munmap((void *)chunks[i], CGROUP_MEM_CHUNK);
+	}
+	free(chunks);
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_cgroup_mem_bench()
+ *	create a child cgroup v2 with memory.high and memory.max limits,
+ *	run allocators inside it and report allocation stall latencies,
+ *	PSI memory pressure and reclaim scan/steal rates
+ */
+static int stress_cgroup_mem_bench(stress_args_t *args)
+{
+	size_t mem_high = DEFAULT_CGROUP_MEM_HIGH, mem_max = 0;
+	char cgpath[PATH_MAX + 64], filename[PATH_MAX], buf[64];
+	char data[4096];
+	pid_t pids[CGROUP_MEM_ALLOCATORS];
+	stress_hist_t *hists, total;
+	stress_cgroup_mem_stats_t stats;
+	const size_t hists_size = sizeof(*hists) * CGROUP_MEM_ALLOCATORS;
+	off_t file_size, offset;
+	double t_start, duration;
+	size_t i, n_pids = 0, alive;
+	int fd, rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("cgroup-mem-high", &mem_high);
+	(void)stress_get_setting("cgroup-mem-max", &mem_max);
+	if (mem_max == 0)
+		mem_max = mem_high * 2;
+	if (mem_max < mem_high) {
+		if (stress_instance_zero(args))
+			pr_inf("%s: --cgroup-mem-max is less than --cgroup-mem-high, "
+				"setting it to %zu bytes\n", args->name, mem_high);
+		mem_max = mem_high;
+	}
+
+	if (stress_cgroup_mem_create(args, cgpath, sizeof(cgpath), mem_high, mem_max) < 0) {
+		if (stress_instance_zero(args))
+			pr_inf_skip("%s: cannot create a cgroup v2 with the memory controller "
+				"enabled, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	/*
+	 *  page cache file twice the size of memory.high, dropped from
+	 *  the cache so that the allocators reads are charged to the cgroup
+	 */
+	file_size = (off_t)(mem_high * 2);
+	if (stress_temp_dir_mk_args(args) < 0) {
+		rc = stress_exit_status(errno);
+		goto rmdir_cgroup;
+	}
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	fd = open(filename, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		goto rm_temp_dir;
+	}
+	(void)shim_unlink(filename);
+	for (offset = 0; offset < file_size; offset += (off_t)sizeof(data)) {
+		stress_rndbuf(data, sizeof(data));
+		if (pwrite(fd, data, sizeof(data), offset) < 0) {
+			pr_inf_skip("%s: cannot write %jd bytes to %s, errno=%d (%s), skipping stressor\n",
+				args->name, (intmax_t)file_size, filename, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto close_fd;
+		}
+	}
+	(void)shim_fdatasync(fd);
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_DONTNEED)
+	VOID_RET(int, posix_fadvise(fd, 0, file_size, POSIX_FADV_DONTNEED));
+#endif
+
+	hists = (stress_hist_t *)stress_mmap_populate(NULL, hists_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (hists == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte histograms%s, skipping stressor\n",
+			args->name, hists_size, stress_get_memfree_str());
+		rc = EXIT_NO_RESOURCE;
+		goto close_fd;
+	}
+	stress_set_vma_anon_name(hists, hists_size, "cgroup-mem-histograms");
+	for (i = 0; i < CGROUP_MEM_ALLOCATORS; i++)
+		stress_hist_init(&hists[i], NULL);
+
+	if (stress_instance_zero(args)) {
+		char max_str[32];
+
+		pr_inf("%s: %d allocators in cgroup with memory.high %s and memory.max %s\n",
+			args->name, CGROUP_MEM_ALLOCATORS,
+			stress_uint64_to_str(buf, sizeof(buf), (uint64_t)mem_high, 0, true),
+			stress_uint64_to_str(max_str, sizeof(max_str), (uint64_t)mem_max, 0, true));
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	t_start = stress_time_now();
+	for (i = 0; i < CGROUP_MEM_ALLOCATORS; i++) {
+		pid_t pid;
+
+		pid = fork();
+		if (pid < 0) {
+			pr_inf("%s: fork failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			continue;
+		} else if (pid == 0) {
+			/* anonymous memory is half of memory.high, the rest is page cache */
+			_exit(stress_cgroup_mem_allocator(args, cgpath, fd, file_size,
+				mem_high / (2 * CGROUP_MEM_ALLOCATORS), &hists[i]));
+		}
+		pids[n_pids++] = pid;
+	}
+
+	alive = n_pids;
+	while ((alive > 0) && stress_continue(args)) {
+		(void)shim_usleep(100000);
+		for (i = 0; i < n_pids; i++) {
+			int status;
+
+			if ((pids[i] < 0) || (shim_waitpid(pids[i], &status, WNOHANG) != pids[i]))
+				continue;
+			/* the allocator reports why it could not run */
+			if (WIFEXITED(status) && (WEXITSTATUS(status) == EXIT_NO_RESOURCE)) {
+				rc = EXIT_NO_RESOURCE;
+			} else if (WIFSIGNALED(status)) {
+				pr_dbg("%s: allocator died: %s\n",
+					args->name, stress_strsignal(WTERMSIG(status)));
+			}
+			pids[i] = -1;
+			alive--;
+		}
+	}
+	duration = stress_time_now() - t_start;
+	stress_cgroup_mem_stats(cgpath, &stats);
+
+	for (i = 0; i < n_pids; i++) {
+		int status;
+
+		if (pids[i] > 0)
+			(void)stress_kill_pid_wait(pids[i], &status);
+	}
+
+	stress_hist_init(&total, "allocation stall latency");
+	for (i = 0; i < CGROUP_MEM_ALLOCATORS; i++)
+		stress_hist_accumulate(&total, &hists[i]);
+	if ((total.count > 0) && (duration > 0.0)) {
+		const double pgscan_rate = (double)stats.pgscan / duration;
+		const double pgsteal_rate = (double)stats.pgsteal / duration;
+		const double pgscan_direct_rate = (double)stats.pgscan_direct / duration;
+
+		if (stress_instance_zero(args)) {
+			pr_inf("%s: allocation stall latency nanosecs: p50 %" PRIu64 ", p99 %" PRIu64
+				", p99.9 %" PRIu64 ", max %" PRIu64 " (%" PRIu64 " page allocations)\n",
+				args->name, stress_hist_percentile(&total, 50.0),
+				stress_hist_percentile(&total, 99.0),
+				stress_hist_percentile(&total, 99.9), total.max, total.count);
+			pr_inf("%s: memory.pressure some avg10 %.2f avg60 %.2f avg300 %.2f, "
+				"full avg10 %.2f avg60 %.2f avg300 %.2f\n", args->name,
+				stats.some[0], stats.some[1], stats.some[2],
+				stats.full[0], stats.full[1], stats.full[2]);
+			pr_inf("%s: reclaim %.0f pages scanned/sec (%.0f direct), %.0f pages "
+				"stolen/sec, %" PRIu64 " high, %" PRIu64 " max, %" PRIu64
+				" oom_kill events\n", args->name, pgscan_rate, pgscan_direct_rate,
+				pgsteal_rate, stats.high, stats.max, stats.oom_kill);
+		}
+		stress_metrics_set(args, 0, "nanosecs p50 allocation stall",
+			(double)stress_hist_percentile(&total, 50.0), STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 1, "nanosecs p99 allocation stall",
+			(double)stress_hist_percentile(&total, 99.0), STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 2, "nanosecs p99.9 allocation stall",
+			(double)stress_hist_percentile(&total, 99.9), STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 3, "memory.pressure some avg10",
+			stats.some[0], STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 4, "memory.pressure full avg10",
+			stats.full[0], STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 5, "reclaim pages scanned per sec",
+			pgscan_rate, STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 6, "reclaim pages stolen per sec",
+			pgsteal_rate, STRESS_METRIC_HARMONIC_MEAN);
+		stress_hist_merge(args, 0, &total);
+	}
+	(void)munmap((void *)hists, hists_size);
+close_fd:
+	(void)close(fd);
+rm_temp_dir:
+	(void)stress_temp_dir_rm_args(args);
+rmdir_cgroup:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	stress_cgroup_remove(cgpath);
+
+	return rc;
+}
+
 /*
  *  stress_cgroup_mount()
  *      stress cgroup mounting
@@ -513,6 +849,11 @@ cleanup:
 static int stress_cgroup_mount(stress_args_t *args)
 {
 	int pid, rc = EXIT_SUCCESS;
+	bool cgroup_mem_bench = false;
+
+	(void)stress_get_setting("cgroup-mem-bench", &cgroup_mem_bench);
+	if (cgroup_mem_bench)
+		return stress_cgroup_mem_bench(args);
 
 	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
 	stress_sync_start_wait(args);
@@ -575,10 +916,33 @@ finish:
 	return rc;
 }
 
+/*
+ *  stress_cgroup_init()
+ *	save the cgroup v2 root memory controller state
+ */
+static void stress_cgroup_init(const uint32_t instances)
+{
+	(void)instances;
+
+	stress_cgroup_subtree_save();
+}
+
+/*
+ *  stress_cgroup_deinit()
+ *	restore the cgroup v2 root memory controller state
+ */
+static void stress_cgroup_deinit(void)
+{
+	stress_cgroup_subtree_restore();
+}
+
 const stressor_info_t stress_cgroup_info = {
 	.stressor = stress_cgroup_mount,
+	.init = stress_cgroup_init,
+	.deinit = stress_cgroup_deinit,
 	.classifier = CLASS_OS,
 	.supported = stress_cgroup_supported,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -587,6 +951,7 @@ const stressor_info_t stress_cgroup_info = {
 	.stressor = stress_unimplemented,
 	.classifier = CLASS_OS,
 	.supported = stress_cgroup_supported,
+	.opts = opts,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "only supported on Linux"
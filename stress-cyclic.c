@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-capabilities.h"
+#include "core-histogram.h"
 #include "core-killpid.h"
 #include "core-lock.h"
 #include "core-mmap.h"
@@ -34,7 +35,6 @@
 
 #define DEFAULT_DELAY_NS	(100000)
 #define MAX_SAMPLES		(100000000)
-#define DEFAULT_SAMPLES		(10000)
 #define MAX_BUCKETS		(250)
 
 typedef struct {
@@ -49,19 +49,12 @@ typedef struct {
 } stress_policy_t;
 
 typedef struct {
-	int64_t		min_ns;		/* min latency */
-	int64_t		max_ns;		/* max latency */
-	int64_t		*latencies;	/* latency samples */
-	size_t		latencies_size;	/* size of latencies allocation */
-	size_t		cyclic_samples;	/* number of latency samples */
-	size_t		index;		/* index into latencies */
-	size_t		index_reqd;	/* theoretic size of index required for the run */
 	int32_t		min_prio;	/* min priority allowed */
 	int32_t		max_prio;	/* max priority allowed */
-	double		ns;		/* total nanosecond latency */
+	uint64_t	latency_mode;	/* first mode */
 	double		latency_mean;	/* average latency */
-	int64_t		latency_mode;	/* first mode */
 	double		std_dev;	/* standard deviation */
+	stress_hist_t	hist;		/* latency histogram */
 } stress_rt_stats_t;
 
 typedef int (*stress_cyclic_func)(stress_args_t *args, stress_rt_stats_t *rt_stats, uint64_t cyclic_sleep);
@@ -78,7 +71,7 @@ static const stress_help_t help[] = {
 	{ NULL,	"cyclic-ops N",		"stop after N cyclic timing cycles" },
 	{ NULL,	"cyclic-policy P",	"used rr or fifo scheduling policy" },
 	{ NULL,	"cyclic-prio N",	"real time scheduling priority 1..100" },
-	{ NULL, "cyclic-samples N",	"number of latency samples to take" },
+	{ NULL, "cyclic-samples N",	"deprecated, has no effect" },
 	{ NULL,	"cyclic-sleep N",	"sleep time of real time timer in nanosecs" },
 	{ NULL,	NULL,			NULL }
 };
@@ -127,6 +120,17 @@ static void stress_cyclic_deinit(void)
     (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_NANOSLEEP)) ||		\
     (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_PSELECT)) ||		\
     (defined(HAVE_CLOCK_GETTIME))
+/*
+ *  stress_cyclic_record()
+ *	record a latency, early wakeups are recorded as zero latency
+ */
+static inline void stress_cyclic_record(
+	stress_rt_stats_t *rt_stats,
+	const int64_t delta_ns)
+{
+	stress_hist_record(&rt_stats->hist, (delta_ns < 0) ? 0 : (uint64_t)delta_ns);
+}
+
 static void stress_cyclic_stats(
 	stress_rt_stats_t *rt_stats,
 	const uint64_t cyclic_sleep,
@@ -139,11 +143,7 @@ static void stress_cyclic_stats(
 		   (t2->tv_nsec - t1->tv_nsec);
 	delta_ns -= cyclic_sleep;
 
-	if (rt_stats->index < rt_stats->cyclic_samples)
-		rt_stats->latencies[rt_stats->index++] = delta_ns;
-	rt_stats->index_reqd++;
-
-	rt_stats->ns += (double)delta_ns;
+	stress_cyclic_record(rt_stats, delta_ns);
 }
 #else
 	UNEXPECTED
@@ -240,11 +240,7 @@ static int stress_cyclic_poll(
 		if (delta_ns >= (int64_t)cyclic_sleep) {
 			delta_ns -= cyclic_sleep;
 
-			if (rt_stats->index < rt_stats->cyclic_samples)
-				rt_stats->latencies[rt_stats->index++] = delta_ns;
-			rt_stats->index_reqd++;
-
-			rt_stats->ns += (double)delta_ns;
+			stress_cyclic_record(rt_stats, delta_ns);
 			break;
 		}
 	}
@@ -340,11 +336,7 @@ static int stress_cyclic_itimer(
 		(itimer_time.tv_nsec - t1.tv_nsec);
 	delta_ns -= cyclic_sleep;
 
-	if (rt_stats->index < rt_stats->cyclic_samples)
-		rt_stats->latencies[rt_stats->index++] = delta_ns;
-	rt_stats->index_reqd++;
-
-	rt_stats->ns += (double)delta_ns;
+	stress_cyclic_record(rt_stats, delta_ns);
 
 	(void)timer_delete(timerid);
 
@@ -405,74 +397,22 @@ static void NORETURN MLOCKED_TEXT stress_rlimit_handler(int signum)
 }
 #endif
 
-/*
- *  stress_cyclic_cmp()
- *	sort latencies into order, least first
- */
-static int stress_cyclic_cmp(const void *p1, const void *p2)
-{
-	const int64_t *i1 = (const int64_t *)p1;
-	const int64_t *i2 = (const int64_t *)p2;
-
-	if (*i1 > *i2)
-		return 1;
-	else if (*i1 < *i2)
-		return -1;
-	return 0;
-}
-
 /*
  *  stress_rt_stats()
  *	compute statistics on gathered latencies
  */
 static void stress_rt_stats(stress_rt_stats_t *rt_stats)
 {
-	size_t i;
-	size_t n = 0, best_n = 0;
-	int64_t current;
-	double variance = 0.0;
-
-	rt_stats->latency_mean = 0.0;
-	rt_stats->latency_mode = 0;
+	size_t i, mode_index = 0;
 
-	for (i = 0; i < rt_stats->index; i++) {
-		const int64_t ns = rt_stats->latencies[i];
+	rt_stats->latency_mean = stress_hist_mean(&rt_stats->hist);
+	rt_stats->std_dev = stress_hist_stddev(&rt_stats->hist);
 
-		if (ns > rt_stats->max_ns)
-			rt_stats->max_ns = ns;
-		if (ns < rt_stats->min_ns)
-			rt_stats->min_ns = ns;
-
-		rt_stats->latency_mean += (double)ns;
-	}
-	if (rt_stats->index)
-		rt_stats->latency_mean /= (double)rt_stats->index;
-
-	qsort(rt_stats->latencies, rt_stats->index, sizeof(*(rt_stats->latencies)), stress_cyclic_cmp);
-
-	current = rt_stats->latency_mode = rt_stats->latencies[0];
-
-	for (i = 0; i < rt_stats->index; i++) {
-		const int64_t ns = rt_stats->latencies[i];
-		double diff;
-
-		if (ns == current) {
-			n++;
-			if (n > best_n) {
-				rt_stats->latency_mode = current;
-				best_n = n;
-			}
-		} else {
-			current = ns;
-			n = 0;
-		}
-		diff = ((double)ns - rt_stats->latency_mean);
-		variance += (diff * diff);
-	}
-	if (rt_stats->index) {
-		variance /= (double)rt_stats->index;
-		rt_stats->std_dev = sqrt(variance);
+	for (i = 0; i < STRESS_HIST_BUCKETS; i++) {
+		if (rt_stats->hist.buckets[i] > rt_stats->hist.buckets[mode_index])
+			mode_index = i;
 	}
+	rt_stats->latency_mode = stress_hist_bucket_value(mode_index);
 }
 
 /*
@@ -522,7 +462,7 @@ static void stress_rt_dist(
 	const int64_t cyclic_dist)
 {
 	const ssize_t dist_max_size = (cyclic_dist > 0) ?
-		((ssize_t)rt_stats->max_ns / (ssize_t)cyclic_dist) + 1 : 1;
+		((ssize_t)rt_stats->hist.max / (ssize_t)cyclic_dist) + 1 : 1;
 	const ssize_t dist_size = STRESS_MINIMUM(MAX_BUCKETS, dist_max_size);
 	const ssize_t dist_min = STRESS_MINIMUM(5, dist_max_size);
 	ssize_t i, n;
@@ -537,11 +477,13 @@ static void stress_rt_dist(
 		return;
 	}
 
-	for (i = 0; i < (ssize_t)rt_stats->index; i++) {
-		const int64_t lat = rt_stats->latencies[i] / cyclic_dist;
+	for (i = 0; i < (ssize_t)STRESS_HIST_BUCKETS; i++) {
+		if (rt_stats->hist.buckets[i]) {
+			const int64_t lat = (int64_t)stress_hist_bucket_value((size_t)i) / cyclic_dist;
 
-		if (lat < (int64_t)dist_size)
-			dist[lat]++;
+			if (lat < (int64_t)dist_size)
+				dist[lat] += (int64_t)rt_stats->hist.buckets[i];
+		}
 	}
 
 	for (n = dist_size; n >= 1; n--) {
@@ -603,11 +545,11 @@ static int stress_cyclic(stress_args_t *args)
 	uint64_t cyclic_sleep = DEFAULT_DELAY_NS;
 	uint64_t cyclic_dist = 0;
 	int32_t cyclic_prio = INT32_MAX;
-	size_t cyclic_samples = DEFAULT_SAMPLES;
 	NOCLOBBER int policy;
 	int rc = EXIT_SUCCESS;
 	size_t cyclic_policy = 0;
 	size_t cyclic_method = 0;
+	size_t cyclic_samples;
 	const double start = stress_time_now();
 	stress_rt_stats_t *rt_stats;
 	const size_t page_size = args->page_size;
@@ -619,8 +561,10 @@ static int stress_cyclic(stress_args_t *args)
 	(void)stress_get_setting("cyclic-method", &cyclic_method);
 	(void)stress_get_setting("cyclic-policy", &cyclic_policy);
 	(void)stress_get_setting("cyclic-prio", &cyclic_prio);
-	(void)stress_get_setting("cyclic-samples", &cyclic_samples);
 	(void)stress_get_setting("cyclic-sleep", &cyclic_sleep);
+	if (stress_get_setting("cyclic-samples", &cyclic_samples) && stress_instance_zero(args))
+		pr_warn("%s: --cyclic-samples is deprecated and has no effect, latencies "
+			"are recorded in a fixed size histogram\n", args->name);
 
 	if (NUM_CYCLIC_POLICIES == 0) {
 		if (!args->instance) {
@@ -677,23 +621,7 @@ static int stress_cyclic(stress_args_t *args)
 		return EXIT_NO_RESOURCE;
 	}
 	stress_set_vma_anon_name(rt_stats, size, "rt-statistics");
-	rt_stats->cyclic_samples = cyclic_samples;
-	rt_stats->latencies_size = cyclic_samples * sizeof(*rt_stats->latencies);
-	rt_stats->latencies = (int64_t *)stress_mmap_populate(NULL,
-						rt_stats->latencies_size,
-						PROT_READ | PROT_WRITE,
-						MAP_SHARED | MAP_ANONYMOUS, -1, 0);
-	if (rt_stats->latencies == MAP_FAILED) {
-		pr_inf_skip("%s: mmap of %zu samples failed%s, errno=%d (%s)\n",
-			args->name, cyclic_samples, stress_get_memfree_str(),
-			errno, strerror(errno));
-		(void)munmap((void *)rt_stats, size);
-		return EXIT_NO_RESOURCE;
-	}
-	stress_set_vma_anon_name(rt_stats->latencies, rt_stats->latencies_size, "latencies");
-	rt_stats->min_ns = INT64_MAX;
-	rt_stats->max_ns = INT64_MIN;
-	rt_stats->ns = 0.0;
+	stress_hist_init(&rt_stats->hist, "cyclic latency (nanosecs)");
 #if defined(HAVE_SCHED_GET_PRIORITY_MIN)
 	rt_stats->min_prio = sched_get_priority_min(policy);
 #else
@@ -728,7 +656,6 @@ again:
 			goto finish;
 		pr_inf("%s: cannot fork, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
-		(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
 		(void)munmap((void *)rt_stats, size);
 		return EXIT_NO_RESOURCE;
 	} else if (pid == 0) {
@@ -842,7 +769,6 @@ tidy_ok:
 tidy:
 #endif
 		(void)fflush(stdout);
-		(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
 		(void)munmap((void *)rt_stats, size);
 		_exit(ncrc);
 	} else {
@@ -854,9 +780,10 @@ tidy:
 	}
 
 	stress_rt_stats(rt_stats);
+	stress_hist_merge(args, 0, &rt_stats->hist);
 
 	if (stress_instance_zero(args)) {
-		if (rt_stats->index) {
+		if (rt_stats->hist.count) {
 			size_t i;
 
 			static const double percentiles[] = {
@@ -872,34 +799,29 @@ tidy:
 			};
 
 			pr_block_begin();
-			pr_inf("%s: sched %s: %" PRIu64 " ns delay, %zd samples\n",
+			pr_inf("%s: sched %s: %" PRIu64 " ns delay, %" PRIu64 " samples\n",
 				args->name,
 				cyclic_policies[cyclic_policy].name,
 				cyclic_sleep,
-				rt_stats->index);
-			pr_inf( "%s:   mean: %.2f ns, mode: %" PRId64 " ns\n",
+				rt_stats->hist.count);
+			pr_inf( "%s:   mean: %.2f ns, mode: %" PRIu64 " ns\n",
 				args->name,
 				rt_stats->latency_mean,
 				rt_stats->latency_mode);
-			pr_inf("%s:   min: %" PRId64 " ns, max: %" PRId64 " ns, std.dev. %.2f\n",
+			pr_inf("%s:   min: %" PRIu64 " ns, max: %" PRIu64 " ns, std.dev. %.2f\n",
 				args->name,
-				rt_stats->min_ns,
-				rt_stats->max_ns,
+				rt_stats->hist.min,
+				rt_stats->hist.max,
 				rt_stats->std_dev);
 
 			pr_inf("%s: latency percentiles:\n", args->name);
 			for (i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
-				size_t j = (size_t)(((double)rt_stats->index * percentiles[i]) / 100.0);
-				pr_inf("%s:   %5.2f%%: %10" PRId64 " ns\n",
+				pr_inf("%s:   %5.2f%%: %10" PRIu64 " ns\n",
 					args->name,
 					percentiles[i],
-					rt_stats->latencies[j]);
+					stress_hist_percentile(&rt_stats->hist, percentiles[i]));
 			}
 			stress_rt_dist(args->name, rt_stats, (int64_t)cyclic_dist);
-
-			if (rt_stats->index < rt_stats->index_reqd)
-				pr_inf("%s: Note: --cyclic-samples needed to be %zd to capture all the data for this run\n",
-					args->name, rt_stats->index_reqd);
 			pr_block_end();
 		} else {
 			pr_inf("%s: %10s: no latency information available\n",
@@ -911,7 +833,6 @@ tidy:
 finish:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
-	(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
 	(void)munmap((void *)rt_stats, size);
 
 	return rc;
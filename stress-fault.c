@@ -18,14 +18,90 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-histogram.h"
+#include "core-pthread.h"
 #include "core-put.h"
 
+#define FAULT_BENCH_PAGES	(1024)		/* base pages per thread */
+#define FAULT_BENCH_FILE_STRIDE	(64 * KB)	/* default fault-around window */
+#define FAULT_BENCH_HUGE_SIZE	(2 * MB)	/* PMD sized THP */
+#define FAULT_BENCH_HUGE_PAGES	(8)		/* huge pages per thread */
+#define FAULT_BENCH_THREADS_MAX	(1024)
+
+#if defined(HAVE_LIB_PTHREAD)
+#define HAVE_FAULT_BENCH
+#endif
+
 static const stress_help_t help[] = {
 	{ NULL,	"fault N",	"start N workers producing page faults" },
+	{ NULL,	"fault-bench",	"time faults by fault class, scaling from 1 to N CPUs threads" },
 	{ NULL,	"fault-ops N",	"stop after N page fault bogo operations" },
 	{ NULL,	NULL,		NULL }
 };
 
+static const stress_opt_t opts[] = {
+	{ OPT_fault_bench, "fault-bench", TYPE_ID_BOOL, 0, 1, NULL },
+	END_OPT
+};
+
+#if defined(HAVE_SIGLONGJMP) &&	\
+    defined(HAVE_FAULT_BENCH)
+
+/* Classes of faults timed by --fault-bench */
+typedef enum {
+	FAULT_CLASS_ANON,	/* anonymous first touch */
+	FAULT_CLASS_FILE,	/* page cache backed file read */
+	FAULT_CLASS_COW,	/* copy on write after fork */
+	FAULT_CLASS_ZERO,	/* read mapping the zero page */
+	FAULT_CLASS_HUGE,	/* anonymous THP first touch */
+	FAULT_CLASS_SWAP,	/* swap in */
+	FAULT_CLASS_MAX,
+} stress_fault_class_t;
+
+typedef struct {
+	const char *name;		/* fault class name */
+	const char *description;	/* histogram description */
+	const bool write;		/* true = write fault, false = read fault */
+} stress_fault_class_info_t;
+
+static const stress_fault_class_info_t fault_classes[] = {
+	{ "anon first touch",	"anon first touch fault (nanosecs)",	true },
+	{ "file read",		"file read fault (nanosecs)",		false },
+	{ "cow after fork",	"cow after fork fault (nanosecs)",	true },
+	{ "zero page",		"zero page fault (nanosecs)",		false },
+	{ "huge page",		"huge page fault (nanosecs)",		true },
+	{ "swap in",		"swap in fault (nanosecs)",		false },
+};
+
+struct stress_fault_bench;
+
+/* Per thread --fault-bench state */
+typedef struct {
+	pthread_t pthread;		/* thread handle */
+	int ret;			/* pthread_create return */
+	struct stress_fault_bench *bench; /* benchmark being run */
+	uint8_t *map;			/* mapping */
+	size_t map_size;		/* size of mapping */
+	uint8_t *region;		/* region to fault in */
+	size_t size;			/* size of region */
+	size_t stride;			/* bytes between faults */
+	unsigned char *vec;		/* non-zero = page does not fault, NULL = all fault */
+	volatile bool ready;		/* thread ready to fault */
+	stress_hist_t hist;		/* fault latencies */
+} stress_fault_thread_t;
+
+/* A --fault-bench run of one fault class */
+typedef struct stress_fault_bench {
+	stress_fault_class_t class;	/* class of faults */
+	size_t page_size;		/* base page size */
+	size_t n_threads;		/* number of threads */
+	stress_fault_thread_t *threads;	/* per thread state */
+	stress_hist_t *hist;		/* histogram to add results to */
+	volatile bool go;		/* start faulting */
+} stress_fault_bench_t;
+#endif
+
 #if defined(HAVE_SIGLONGJMP)
 
 static sigjmp_buf jmp_env;
@@ -46,6 +122,436 @@ static void MLOCKED_TEXT stress_segvhandler(int signum)
 	}
 }
 
+#if defined(HAVE_FAULT_BENCH)
+/*
+ *  stress_fault_bench_thread()
+ *	touch each stride of a region, timing each fault
+ */
+static void *stress_fault_bench_thread(void *arg)
+{
+	stress_fault_thread_t *thread = (stress_fault_thread_t *)arg;
+	const stress_fault_bench_t *bench = thread->bench;
+	const bool do_write = fault_classes[bench->class].write;
+	const size_t page_size = bench->page_size;
+	size_t offset;
+	sigset_t set;
+
+	/* Block all signals, let the controlling thread handle these */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	thread->ready = true;
+	while (!bench->go)
+		(void)shim_sched_yield();
+
+	for (offset = 0; offset < thread->size; offset += thread->stride) {
+		volatile uint8_t *ptr = thread->region + offset;
+		double t;
+
+		/* only time pages that are known to fault */
+		if (thread->vec && thread->vec[offset / page_size]) {
+			stress_uint8_put(*ptr);
+			continue;
+		}
+		t = stress_time_now();
+		if (do_write)
+			*ptr = 0xa5;
+		else
+			stress_uint8_put(*ptr);
+		t = stress_time_now() - t;
+		stress_hist_record(&thread->hist, (uint64_t)(t * STRESS_DBL_NANOSECOND));
+	}
+	return &g_nowt;
+}
+
+#if defined(MADV_PAGEOUT)
+/*
+ *  stress_fault_bench_swapped()
+ *	mark the pages of a region that are not swapped out in vec,
+ *	paged out pages may still be in the swap cache so mincore()
+ *	cannot be used, returns the number of swapped out pages
+ */
+static size_t stress_fault_bench_swapped(
+	const uint8_t *region,
+	unsigned char *vec,
+	const size_t page_size)
+{
+	uint64_t entries[64];
+	size_t i, j, swapped = 0;
+	int fd;
+
+	(void)shim_memset(vec, 1, FAULT_BENCH_PAGES);
+	fd = open("/proc/self/pagemap", O_RDONLY);
+	if (fd < 0)
+		return 0;
+	for (i = 0; i < FAULT_BENCH_PAGES; i += SIZEOF_ARRAY(entries)) {
+		const off_t offset = (off_t)((((uintptr_t)region / page_size) + i) * sizeof(entries[0]));
+
+		if (pread(fd, entries, sizeof(entries), offset) != (ssize_t)sizeof(entries))
+			break;
+		for (j = 0; j < SIZEOF_ARRAY(entries); j++) {
+			/* bit 62, page is swapped */
+			if (entries[j] & (1ULL << 62)) {
+				vec[i + j] = 0;
+				swapped++;
+			}
+		}
+	}
+	(void)close(fd);
+	return swapped;
+}
+#endif
+
+/*
+ *  stress_fault_bench_unmap()
+ *	unmap the per thread regions
+ */
+static void stress_fault_bench_unmap(stress_fault_bench_t *bench)
+{
+	size_t i;
+
+	for (i = 0; i < bench->n_threads; i++) {
+		stress_fault_thread_t *thread = &bench->threads[i];
+
+		if (thread->map != MAP_FAILED)
+			(void)munmap((void *)thread->map, thread->map_size);
+		thread->map = MAP_FAILED;
+		free(thread->vec);
+		thread->vec = NULL;
+	}
+}
+
+/*
+ *  stress_fault_bench_map()
+ *	map a region per thread and get it into a state where
+ *	touching it produces faults of the benchmark's class,
+ *	returns false if this is not possible
+ */
+static bool stress_fault_bench_map(stress_fault_bench_t *bench, const int fd)
+{
+	const size_t page_size = bench->page_size;
+	const size_t size = FAULT_BENCH_PAGES * page_size;
+	size_t i, faults = 0;
+
+	for (i = 0; i < bench->n_threads; i++) {
+		stress_fault_thread_t *thread = &bench->threads[i];
+
+		thread->map = MAP_FAILED;
+		thread->vec = NULL;
+	}
+
+	for (i = 0; i < bench->n_threads; i++) {
+		stress_fault_thread_t *thread = &bench->threads[i];
+
+		thread->stride = page_size;
+		thread->size = size;
+		thread->map_size = size;
+
+		switch (bench->class) {
+		case FAULT_CLASS_FILE:
+			/*
+			 *  threads share the page cache pages but have
+			 *  their own mappings, one fault maps a whole
+			 *  fault-around window of pages
+			 */
+			thread->stride = FAULT_BENCH_FILE_STRIDE;
+			thread->map = (uint8_t *)mmap(NULL, size, PROT_READ,
+						MAP_SHARED, fd, 0);
+			break;
+		case FAULT_CLASS_HUGE:
+#if defined(MADV_HUGEPAGE)
+			thread->stride = FAULT_BENCH_HUGE_SIZE;
+			thread->size = FAULT_BENCH_HUGE_PAGES * FAULT_BENCH_HUGE_SIZE;
+			thread->map_size = thread->size + FAULT_BENCH_HUGE_SIZE;
+			thread->map = (uint8_t *)mmap(NULL, thread->map_size, PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			break;
+#else
+			return false;
+#endif
+		case FAULT_CLASS_SWAP:
+#if defined(MADV_PAGEOUT)
+			thread->map = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			break;
+#else
+			return false;
+#endif
+		default:
+			thread->map = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+						MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			break;
+		}
+		if (thread->map == MAP_FAILED) {
+			stress_fault_bench_unmap(bench);
+			return false;
+		}
+		thread->region = thread->map;
+
+		switch (bench->class) {
+		case FAULT_CLASS_HUGE:
+#if defined(MADV_HUGEPAGE)
+			thread->region = (uint8_t *)stress_align_address(thread->map, FAULT_BENCH_HUGE_SIZE);
+			(void)shim_madvise(thread->region, thread->size, MADV_HUGEPAGE);
+#endif
+			break;
+		case FAULT_CLASS_FILE:
+			break;
+		default:
+#if defined(MADV_NOHUGEPAGE)
+			(void)shim_madvise(thread->region, size, MADV_NOHUGEPAGE);
+#endif
+			break;
+		}
+
+		switch (bench->class) {
+		case FAULT_CLASS_COW:
+			(void)shim_memset(thread->region, 0x5a, size);
+			break;
+		case FAULT_CLASS_SWAP:
+#if defined(MADV_PAGEOUT)
+			(void)shim_memset(thread->region, 0x5a, size);
+			if (shim_madvise(thread->region, size, MADV_PAGEOUT) < 0)
+				break;
+			thread->vec = (unsigned char *)calloc(FAULT_BENCH_PAGES, sizeof(*thread->vec));
+			if (thread->vec)
+				faults += stress_fault_bench_swapped(thread->region, thread->vec, page_size);
+#endif
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* no swap, pages were not paged out */
+	if ((bench->class == FAULT_CLASS_SWAP) && (faults == 0)) {
+		stress_fault_bench_unmap(bench);
+		return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_fault_bench_run()
+ *	fault in the regions of all the threads concurrently, for
+ *	COW faults a child process shares the pages while they are
+ *	written to. Returns false if the class is not available.
+ */
+static bool stress_fault_bench_run(
+	stress_args_t *args,
+	stress_fault_bench_t *bench,
+	const int fd)
+{
+	size_t i;
+	pid_t pid = -1;
+	int fds[2] = { -1, -1 };
+	bool running;
+
+	if (!stress_fault_bench_map(bench, fd))
+		return false;
+
+	if (bench->class == FAULT_CLASS_COW) {
+		if (pipe(fds) < 0) {
+			stress_fault_bench_unmap(bench);
+			return false;
+		}
+		pid = fork();
+		if (pid < 0) {
+			(void)close(fds[0]);
+			(void)close(fds[1]);
+			stress_fault_bench_unmap(bench);
+			return false;
+		} else if (pid == 0) {
+			char ch;
+
+			/* hold the shared pages until the parent has written them */
+			(void)close(fds[1]);
+			VOID_RET(ssize_t, read(fds[0], &ch, sizeof(ch)));
+			_exit(0);
+		}
+		(void)close(fds[0]);
+	}
+
+	bench->go = false;
+	for (i = 0; i < bench->n_threads; i++) {
+		stress_fault_thread_t *thread = &bench->threads[i];
+
+		thread->bench = bench;
+		thread->ready = false;
+		stress_hist_init(&thread->hist, NULL);
+		thread->ret = pthread_create(&thread->pthread, NULL,
+				stress_fault_bench_thread, (void *)thread);
+		if (thread->ret) {
+			pr_inf("%s: pthread create failed, errno=%d (%s)\n",
+				args->name, thread->ret, strerror(thread->ret));
+			thread->ready = true;
+		}
+	}
+	/* start all the threads faulting at the same time */
+	do {
+		running = false;
+		for (i = 0; i < bench->n_threads; i++) {
+			if (!bench->threads[i].ready)
+				running = true;
+		}
+		if (running)
+			(void)shim_sched_yield();
+	} while (running);
+	bench->go = true;
+
+	for (i = 0; i < bench->n_threads; i++) {
+		stress_fault_thread_t *thread = &bench->threads[i];
+
+		if (!thread->ret) {
+			(void)pthread_join(thread->pthread, NULL);
+			stress_hist_accumulate(bench->hist, &thread->hist);
+		}
+	}
+
+	if (pid > 0) {
+		int status;
+
+		(void)close(fds[1]);
+		(void)shim_waitpid(pid, &status, 0);
+	}
+	stress_fault_bench_unmap(bench);
+	return true;
+}
+
+/*
+ *  stress_fault_bench()
+ *	time individual faults of each class with one thread scaling
+ *	up to one thread per online CPU and report latency histograms
+ *	for each class and thread count
+ */
+static int stress_fault_bench(stress_args_t *args, const char *filename)
+{
+	const size_t page_size = args->page_size;
+	const int32_t cpus = stress_get_processors_online();
+	const size_t max_threads = (size_t)STRESS_MINIMUM(STRESS_MAXIMUM(cpus, 1), FAULT_BENCH_THREADS_MAX);
+	size_t thread_counts[32];
+	size_t n_steps = 0, n, step, i, c, idx = 0;
+	stress_fault_bench_t bench;
+	stress_hist_t *hists, *total;
+	bool available[FAULT_CLASS_MAX];
+	int fd, rc = EXIT_SUCCESS;
+	off_t offset;
+
+	/* 1, 2, 4.. threads and finally one per CPU */
+	for (n = 1; (n < max_threads) && (n_steps < SIZEOF_ARRAY(thread_counts) - 1); n <<= 1)
+		thread_counts[n_steps++] = n;
+	thread_counts[n_steps++] = max_threads;
+
+	/* a histogram per class per thread count and one for all counts */
+	n = (n_steps * FAULT_CLASS_MAX) + 1;
+	hists = (stress_hist_t *)calloc(n, sizeof(*hists));
+	if (!hists) {
+		pr_inf_skip("%s: cannot allocate %zu histograms%s, skipping stressor\n",
+			args->name, n, stress_get_memfree_str());
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < n; i++)
+		stress_hist_init(&hists[i], NULL);
+	total = &hists[n - 1];
+	bench.page_size = page_size;
+	bench.threads = (stress_fault_thread_t *)calloc(max_threads, sizeof(*bench.threads));
+	if (!bench.threads) {
+		pr_inf_skip("%s: cannot allocate %zu thread states%s, skipping stressor\n",
+			args->name, max_threads, stress_get_memfree_str());
+		free(hists);
+		return EXIT_NO_RESOURCE;
+	}
+
+	/* page cache backed file */
+	fd = open(filename, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		free(bench.threads);
+		free(hists);
+		return EXIT_FAILURE;
+	}
+	(void)shim_unlink(filename);
+	for (offset = 0; offset < (off_t)(FAULT_BENCH_PAGES * page_size); offset += (off_t)page_size) {
+		char page[4096];
+
+		(void)shim_memset(page, 0x5a, sizeof(page));
+		if (pwrite(fd, page, STRESS_MINIMUM(sizeof(page), page_size), offset) < 0)
+			break;
+	}
+
+	for (c = 0; c < FAULT_CLASS_MAX; c++)
+		available[c] = true;
+
+	if (stress_instance_zero(args))
+		pr_inf("%s: timing faults with 1 to %zu threads\n", args->name, max_threads);
+
+	do {
+		for (step = 0; step < n_steps; step++) {
+			for (c = 0; (c < FAULT_CLASS_MAX) && stress_continue(args); c++) {
+				if (!available[c])
+					continue;
+				bench.class = (stress_fault_class_t)c;
+				bench.n_threads = thread_counts[step];
+				bench.hist = &hists[(step * FAULT_CLASS_MAX) + c];
+				if (!stress_fault_bench_run(args, &bench, fd)) {
+					available[c] = false;
+					if (stress_instance_zero(args))
+						pr_inf("%s: cannot produce %s faults, skipping this fault class\n",
+							args->name, fault_classes[c].name);
+				}
+			}
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	(void)close(fd);
+
+	if (stress_instance_zero(args)) {
+		pr_inf("%s: fault latency in nanosecs:\n", args->name);
+		pr_inf("%s: %16s %7s %9s %9s %9s %9s %9s\n", args->name,
+			"fault class", "threads", "faults", "p50", "p99", "p99.9", "max");
+	}
+	for (c = 0; c < FAULT_CLASS_MAX; c++) {
+		stress_hist_init(total, fault_classes[c].description);
+		for (step = 0; step < n_steps; step++) {
+			const stress_hist_t *hist = &hists[(step * FAULT_CLASS_MAX) + c];
+			char description[64];
+
+			if (hist->count == 0)
+				continue;
+			if (stress_instance_zero(args)) {
+				pr_inf("%s: %16s %7zu %9" PRIu64 " %9" PRIu64 " %9" PRIu64
+					" %9" PRIu64 " %9" PRIu64 "\n", args->name,
+					fault_classes[c].name, thread_counts[step], hist->count,
+					stress_hist_percentile(hist, 50.0),
+					stress_hist_percentile(hist, 99.0),
+					stress_hist_percentile(hist, 99.9), hist->max);
+			}
+			if (idx + 2 <= STRESS_MISC_METRICS_MAX) {
+				(void)snprintf(description, sizeof(description),
+					"nanosecs p50 %s fault, %zu threads",
+					fault_classes[c].name, thread_counts[step]);
+				stress_metrics_set(args, idx++, description,
+					(double)stress_hist_percentile(hist, 50.0), STRESS_METRIC_GEOMETRIC_MEAN);
+				(void)snprintf(description, sizeof(description),
+					"nanosecs p99 %s fault, %zu threads",
+					fault_classes[c].name, thread_counts[step]);
+				stress_metrics_set(args, idx++, description,
+					(double)stress_hist_percentile(hist, 99.0), STRESS_METRIC_GEOMETRIC_MEAN);
+			}
+			stress_hist_accumulate(total, hist);
+		}
+		/* all thread counts combined for the shared histogram */
+		stress_hist_merge(args, c, total);
+	}
+
+	free(bench.threads);
+	free(hists);
+	return rc;
+}
+#endif
+
 /*
  *  stress_fault()
  *	stress min and max page faulting
@@ -71,6 +577,9 @@ static int stress_fault(stress_args_t *args)
 #endif
 	NOCLOBBER double duration = 0.0, count = 0.0;
 	NOCLOBBER int rc = EXIT_SUCCESS;
+	bool fault_bench = false;
+
+	(void)stress_get_setting("fault-bench", &fault_bench);
 
 	ret = stress_temp_dir_mk_args(args);
 	if (ret < 0)
@@ -79,6 +588,26 @@ static int stress_fault(stress_args_t *args)
 	(void)stress_temp_filename_args(args,
 		filename, sizeof(filename), stress_mwc32());
 
+	if (fault_bench) {
+#if defined(HAVE_FAULT_BENCH)
+		stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+		stress_sync_start_wait(args);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+		rc = stress_fault_bench(args, filename);
+
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+#else
+		if (stress_instance_zero(args))
+			pr_inf_skip("%s: --fault-bench requires pthread support, "
+				"skipping stressor\n", args->name);
+		rc = EXIT_NOT_IMPLEMENTED;
+#endif
+		(void)shim_unlink(filename);
+		(void)stress_temp_dir_rm_args(args);
+		return rc;
+	}
+
 	if (stress_sighandler(args->name, SIGSEGV, stress_segvhandler, NULL) < 0)
 		return EXIT_FAILURE;
 	if (stress_sighandler(args->name, SIGBUS, stress_segvhandler, NULL) < 0)
@@ -297,6 +826,7 @@ next:
 const stressor_info_t stress_fault_info = {
 	.stressor = stress_fault,
 	.classifier = CLASS_INTERRUPT | CLASS_SCHEDULER | CLASS_OS,
+	.opts = opts,
 	.help = help
 };
 
@@ -305,6 +835,7 @@ const stressor_info_t stress_fault_info = {
 const stressor_info_t stress_fault_info = {
 	.stressor = stress_unimplemented,
 	.classifier = CLASS_INTERRUPT | CLASS_SCHEDULER | CLASS_OS,
+	.opts = opts,
 	.help = help,
 	.unimplemented_reason = "built without siglongjmp support"
 };
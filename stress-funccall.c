@@ -75,6 +75,7 @@ typedef struct {
 } stress_funccall_method_info_t;
 
 static const stress_funccall_method_info_t stress_funccall_methods[];
+static stress_bogo_batch_t funccall_batch;
 
 static const stress_help_t help[] = {
 	{ NULL,	"funccall N",		"start N workers exercising 1 to 9 arg functions" },
@@ -211,7 +212,7 @@ stress_funccall_ ## type(stress_args_t *args)			\
 			}						\
 		}							\
 	}								\
-	stress_bogo_inc(args);						\
+	stress_bogo_batch_inc(args, &funccall_batch);			\
 	return true;							\
 }
 
@@ -1257,9 +1258,11 @@ static int stress_funccall(stress_args_t *args)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	stress_bogo_batch_init(args, &funccall_batch);
 	do {
 		success = stress_funccall_exercise(args, funccall_method);
 	} while (success && stress_continue(args));
+	stress_bogo_batch_flush(args, &funccall_batch);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
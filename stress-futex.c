@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-histogram.h"
 
 #include <time.h>
 
@@ -144,20 +145,28 @@ again:
 			args->name, *timeout);
 	} else {
 		uint64_t threshold = THRESHOLD;
+		stress_hist_t *wait_hist;
 
 		(void)stress_change_cpu(args, parent_cpu);
 		stress_parent_died_alarm();
 		(void)sched_settings_apply(true);
 
+		wait_hist = (stress_hist_t *)malloc(sizeof(*wait_hist));
+		if (wait_hist)
+			stress_hist_init(wait_hist, "futex wait time (nanosecs)");
+
 		do {
 			/* Small timeout to force rapid timer wakeups */
 			int ret;
+			double t;
 
 			/* Break early before potential long wait */
 			if (UNLIKELY(!stress_continue_flag()))
 				break;
 
+			t = stress_time_now();
 			ret = stress_futex_wait(futex, 0, 5000);
+			t = stress_time_now() - t;
 
 			/* timeout, re-do, stress on stupid fast polling */
 			if ((ret < 0) && (errno == ETIMEDOUT)) {
@@ -178,9 +187,16 @@ again:
 						rc = EXIT_FAILURE;
 					}
 				}
+				if (LIKELY(ret == 0) && wait_hist)
+					stress_hist_record(wait_hist, (uint64_t)(t * STRESS_DBL_NANOSECOND));
 				stress_bogo_inc(args);
 			}
 		} while (stress_continue(args));
+
+		if (wait_hist) {
+			stress_hist_merge(args, 0, wait_hist);
+			free(wait_hist);
+		}
 		_exit(rc);
 	}
 finish:
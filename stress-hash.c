@@ -18,8 +18,11 @@
  */
 #include "stress-ng.h"
 #include "core-attribute.h"
+#include "core-asm-x86.h"
 #include "core-builtin.h"
+#include "core-cpu-freq.h"
 #include "core-hash.h"
+#include "core-mmap.h"
 
 #include <math.h>
 
@@ -55,6 +58,7 @@ struct stress_hash_method_info {
 
 static const stress_help_t help[] = {
 	{ NULL,  "hash N",		"start N workers that exercise various hash functions" },
+	{ NULL,  "hash-bulk",		"measure bulk hash throughput over 8 byte to 64K keys" },
 	{ NULL,  "hash-method M",	"specify stress hash method M, default is all" },
 	{ NULL,  "hash-ops N",		"stop after N hash bogo operations" },
 	{ NULL,	 NULL,			NULL }
@@ -669,6 +673,263 @@ static OPTIMIZE3 int stress_hash_all(
 	return rc;
 }
 
+/*
+ *  Bulk throughput mode, hash hash_bulk_sizes[] sized keys packed
+ *  back to back in a STRESS_HASH_BULK_SIZE buffer
+ */
+#define STRESS_HASH_BULK_SIZE	(1024 * 1024)
+#define STRESS_HASH_BULK_SEED	(0xf12b35e1)
+
+static const size_t hash_bulk_sizes[] = {
+	8, 64, 512, 4096, 65536
+};
+
+#define NUM_HASH_BULK_SIZES	(SIZEOF_ARRAY(hash_bulk_sizes))
+
+typedef uint32_t (*stress_hash_bulk_func)(const uint8_t *buf, const size_t size, const size_t n);
+
+typedef struct {
+	const char			*name;		/* bulk method name */
+	const stress_hash_bulk_func	func;		/* hash n keys of size bytes */
+	bool				(*supported)(void); /* NULL if always supported */
+	const size_t			ref;		/* method that produces identical hashes */
+} stress_hash_bulk_method_t;
+
+typedef struct {
+	double		duration;	/* time hashing */
+	double		bytes;		/* bytes hashed */
+	uint64_t	cycles;		/* TSC cycles hashing, 0 if no TSC */
+} stress_hash_bulk_stats_t;
+
+static uint32_t OPTIMIZE3 stress_hash_bulk_crc32c(const uint8_t *buf, const size_t size, const size_t n)
+{
+	register uint32_t sum = 0;
+	register size_t i;
+
+	for (i = 0; i < n; i++, buf += size)
+		sum += stress_hash_crc32c_buf(buf, size);
+	return sum;
+}
+
+static uint32_t OPTIMIZE3 stress_hash_bulk_crc32c_hw(const uint8_t *buf, const size_t size, const size_t n)
+{
+	register uint32_t sum = 0;
+	register size_t i;
+
+	for (i = 0; i < n; i++, buf += size)
+		sum += stress_hash_crc32c_hw(buf, size);
+	return sum;
+}
+
+static uint32_t OPTIMIZE3 stress_hash_bulk_crc32c_fold(const uint8_t *buf, const size_t size, const size_t n)
+{
+	register uint32_t sum = 0;
+	register size_t i;
+
+	for (i = 0; i < n; i++, buf += size)
+		sum += stress_hash_crc32c_fold(buf, size);
+	return sum;
+}
+
+static uint32_t OPTIMIZE3 stress_hash_bulk_murmur3_32(const uint8_t *buf, const size_t size, const size_t n)
+{
+	register uint32_t sum = 0;
+	register size_t i;
+
+	for (i = 0; i < n; i++, buf += size)
+		sum += stress_hash_murmur3_32(buf, size, STRESS_HASH_BULK_SEED);
+	return sum;
+}
+
+static uint32_t OPTIMIZE3 stress_hash_bulk_murmur3_32_x8(const uint8_t *buf, const size_t size, const size_t n)
+{
+	register uint32_t sum = 0;
+	register size_t i, j;
+	uint32_t hashes[STRESS_HASH_LANES];
+
+	for (i = 0; i + STRESS_HASH_LANES <= n; i += STRESS_HASH_LANES, buf += size * STRESS_HASH_LANES) {
+		stress_hash_murmur3_32_x8(buf, size, size, STRESS_HASH_BULK_SEED, hashes);
+		for (j = 0; j < STRESS_HASH_LANES; j++)
+			sum += hashes[j];
+	}
+	for (; i < n; i++, buf += size)
+		sum += stress_hash_murmur3_32(buf, size, STRESS_HASH_BULK_SEED);
+	return sum;
+}
+
+static uint32_t OPTIMIZE3 stress_hash_bulk_xxh64(const uint8_t *buf, const size_t size, const size_t n)
+{
+	register uint64_t sum = 0;
+	register size_t i;
+
+	for (i = 0; i < n; i++, buf += size)
+		sum += stress_hash_xxh64(buf, size, STRESS_HASH_BULK_SEED);
+	return (uint32_t)(sum ^ (sum >> 32));
+}
+
+static const stress_hash_bulk_method_t hash_bulk_methods[] = {
+	{ "crc32c",		stress_hash_bulk_crc32c,	NULL,					0 },
+	{ "crc32c-hw",		stress_hash_bulk_crc32c_hw,	stress_hash_crc32c_hw_supported,	0 },
+	{ "crc32c-fold",	stress_hash_bulk_crc32c_fold,	stress_hash_crc32c_fold_supported,	0 },
+	{ "murmur3_32",		stress_hash_bulk_murmur3_32,	NULL,					3 },
+	{ "murmur3_32-x8",	stress_hash_bulk_murmur3_32_x8,	NULL,					3 },
+	{ "xxh64",		stress_hash_bulk_xxh64,		NULL,					5 },
+};
+
+#define NUM_HASH_BULK_METHODS	(SIZEOF_ARRAY(hash_bulk_methods))
+
+/*
+ *  stress_hash_bulk_cycles()
+ *	cycle counter for cycles per byte, 0 if not available
+ */
+static inline uint64_t stress_hash_bulk_cycles(void)
+{
+#if defined(STRESS_ARCH_X86) &&		\
+    defined(HAVE_ASM_X86_RDTSC)
+	return stress_asm_x86_rdtsc();
+#else
+	return 0;
+#endif
+}
+
+/*
+ *  stress_hash_bulk()
+ *	hash throughput of the bulk methods over a range of key sizes
+ */
+static int stress_hash_bulk(stress_args_t *args)
+{
+	static stress_hash_bulk_stats_t stats[NUM_HASH_BULK_METHODS][NUM_HASH_BULK_SIZES];
+	bool supported[NUM_HASH_BULK_METHODS];
+	uint8_t *buf;
+	size_t i, j, idx;
+	double avg_ghz = 0.0, min_ghz = 0.0, max_ghz = 0.0;
+	int rc = EXIT_SUCCESS;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+
+	buf = (uint8_t *)stress_mmap_populate(NULL, STRESS_HASH_BULK_SIZE,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %d byte buffer%s, errno=%d (%s), "
+			"skipping stressor\n", args->name, STRESS_HASH_BULK_SIZE,
+			stress_get_memfree_str(), errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, STRESS_HASH_BULK_SIZE, "hash-bulk-data");
+	stress_uint8rnd4(buf, STRESS_HASH_BULK_SIZE);
+
+	(void)shim_memset(stats, 0, sizeof(stats));
+	for (i = 0; i < NUM_HASH_BULK_METHODS; i++)
+		supported[i] = !hash_bulk_methods[i].supported ||
+				hash_bulk_methods[i].supported();
+
+	if (stress_instance_zero(args)) {
+		char str[128];
+
+		(void)shim_memset(str, 0, sizeof(str));
+		for (i = 0; i < NUM_HASH_BULK_METHODS; i++) {
+			if (!supported[i]) {
+				(void)shim_strlcat(str, " ", sizeof(str));
+				(void)shim_strlcat(str, hash_bulk_methods[i].name, sizeof(str));
+			}
+		}
+		if (*str)
+			pr_inf("%s: bulk methods not supported by this CPU:%s\n", args->name, str);
+	}
+
+	/* known answer tests, XXH64 of "" and "abc" with seed 0 */
+	if (verify && ((stress_hash_xxh64((const uint8_t *)"", 0, 0) != 0xef46db3751d8e999ULL) ||
+		       (stress_hash_xxh64((const uint8_t *)"abc", 3, 0) != 0x44bc2cf5ad770999ULL))) {
+		pr_fail("%s: xxh64 known answer test failed\n", args->name);
+		rc = EXIT_FAILURE;
+		goto tidy;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		uint32_t sums[NUM_HASH_BULK_METHODS][NUM_HASH_BULK_SIZES];
+
+		for (i = 0; i < NUM_HASH_BULK_METHODS; i++) {
+			const stress_hash_bulk_method_t *hbm = &hash_bulk_methods[i];
+
+			if (!supported[i])
+				continue;
+
+			for (j = 0; j < NUM_HASH_BULK_SIZES; j++) {
+				const size_t size = hash_bulk_sizes[j];
+				const size_t n = STRESS_HASH_BULK_SIZE / size;
+				double t;
+				uint64_t c;
+
+				t = stress_time_now();
+				c = stress_hash_bulk_cycles();
+				sums[i][j] = hbm->func(buf, size, n);
+				stats[i][j].cycles += stress_hash_bulk_cycles() - c;
+				stats[i][j].duration += stress_time_now() - t;
+				stats[i][j].bytes += (double)(size * n);
+
+				if (verify && (sums[i][j] != sums[hbm->ref][j])) {
+					pr_fail("%s: %s %zu byte key hashes differ from %s, "
+						"got 0x%" PRIx32 ", expected 0x%" PRIx32 "\n",
+						args->name, hbm->name, size,
+						hash_bulk_methods[hbm->ref].name,
+						sums[i][j], sums[hbm->ref][j]);
+					rc = EXIT_FAILURE;
+				}
+			}
+			if (UNLIKELY(!stress_continue_flag()))
+				break;
+		}
+		stress_bogo_inc(args);
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	/* no TSC, estimate cycles from the CPU frequency */
+	stress_get_cpu_freq(&avg_ghz, &min_ghz, &max_ghz);
+
+	if (stress_instance_zero(args))
+		pr_block_begin();
+	for (idx = 0, i = 0; i < NUM_HASH_BULK_METHODS; i++) {
+		for (j = 0; j < NUM_HASH_BULK_SIZES; j++) {
+			const stress_hash_bulk_stats_t *s = &stats[i][j];
+			char msg[64];
+			double gbs, cpb;
+
+			if ((s->duration <= 0.0) || (s->bytes <= 0.0))
+				continue;
+
+			gbs = s->bytes / (s->duration * 1.0E9);
+			if (s->cycles)
+				cpb = (double)s->cycles / s->bytes;
+			else
+				cpb = (avg_ghz * 1.0E9 * s->duration) / s->bytes;
+
+			if (stress_instance_zero(args))
+				pr_inf("%s: %14.14s %6zu bytes %9.3f GB/sec %9.3f cycles/byte\n",
+					args->name, hash_bulk_methods[i].name,
+					hash_bulk_sizes[j], gbs, cpb);
+
+			(void)snprintf(msg, sizeof(msg), "%s %zu byte GB per sec",
+				hash_bulk_methods[i].name, hash_bulk_sizes[j]);
+			stress_metrics_set(args, idx++, msg, gbs, STRESS_METRIC_HARMONIC_MEAN);
+			if (cpb > 0.0) {
+				(void)snprintf(msg, sizeof(msg), "%s %zu byte cycles per byte",
+					hash_bulk_methods[i].name, hash_bulk_sizes[j]);
+				stress_metrics_set(args, idx++, msg, cpb, STRESS_METRIC_GEOMETRIC_MEAN);
+			}
+		}
+	}
+	if (stress_instance_zero(args))
+		pr_block_end();
+tidy:
+	(void)munmap((void *)buf, STRESS_HASH_BULK_SIZE);
+
+	return rc;
+}
+
 /*
  *  stress_hash()
  *	stress CPU by doing floating point math ops
@@ -681,6 +942,11 @@ static int OPTIMIZE3 stress_hash(stress_args_t *args)
 	size_t hash_method = 0;
 	stress_bucket_t bucket;
 	int rc = EXIT_SUCCESS;
+	bool hash_bulk = false;
+
+	(void)stress_get_setting("hash-bulk", &hash_bulk);
+	if (hash_bulk)
+		return stress_hash_bulk(args);
 
 	(void)stress_get_setting("hash-method", &hash_method);
 	hm = &hash_methods[hash_method];
@@ -735,6 +1001,7 @@ static const char *stress_hash_method(const size_t i)
 }
 
 static const stress_opt_t opts[] = {
+	{ OPT_hash_bulk,   "hash-bulk",   TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_hash_method, "hash-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_hash_method },
 	END_OPT,
 };
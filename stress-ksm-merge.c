@@ -0,0 +1,453 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-histogram.h"
+
+#include <ctype.h>
+#include <dirent.h>
+
+#define MIN_KSM_MERGE_BYTES		(1 * MB)
+#define MAX_KSM_MERGE_BYTES		(MAX_MEM_LIMIT)
+#define DEFAULT_KSM_MERGE_BYTES	(64 * MB)
+
+#define DEFAULT_KSM_MERGE_DUP		(50)
+#define DEFAULT_KSM_MERGE_PAGES_TO_SCAN (4096)
+#define DEFAULT_KSM_MERGE_SLEEP	(0)
+
+#define KSM_MERGE_PATTERNS		(16)	/* distinct duplicate page contents */
+#define KSM_MERGE_TIMEOUT	(30.0)	/* max secs to wait for merging */
+
+static const stress_help_t help[] = {
+	{ NULL,	"ksm-merge N",			"start N workers measuring KSM page merging throughput" },
+	{ NULL,	"ksm-merge-bytes N",		"size of memory to be merged by KSM" },
+	{ NULL,	"ksm-merge-dup N",		"percentage of pages that are duplicates" },
+	{ NULL,	"ksm-merge-ops N",		"stop after N KSM merge and unmerge rounds" },
+	{ NULL,	"ksm-merge-pages-to-scan N",	"set ksmd pages_to_scan to N pages per wakeup" },
+	{ NULL,	"ksm-merge-sleep N",		"set ksmd sleep_millisecs to N milliseconds" },
+	{ NULL,	"ksm-merge-zero",		"make duplicate pages zero pages and set use_zero_pages" },
+	{ NULL,	NULL,				NULL }
+};
+
+static const stress_opt_t opts[] = {
+	{ OPT_ksm_merge_bytes,	      "ksm-merge-bytes",	 TYPE_ID_SIZE_T_BYTES_VM, MIN_KSM_MERGE_BYTES, MAX_KSM_MERGE_BYTES, NULL },
+	{ OPT_ksm_merge_dup,	      "ksm-merge-dup",		 TYPE_ID_UINT32, 0, 100, NULL },
+	{ OPT_ksm_merge_pages_to_scan, "ksm-merge-pages-to-scan", TYPE_ID_UINT32, 1, 1U << 20, NULL },
+	{ OPT_ksm_merge_sleep,	      "ksm-merge-sleep",	 TYPE_ID_UINT32, 0, 10000, NULL },
+	{ OPT_ksm_merge_zero,	      "ksm-merge-zero",		 TYPE_ID_BOOL, 0, 1, NULL },
+	END_OPT,
+};
+
+#if defined(__linux__) &&	\
+    defined(HAVE_MADVISE) &&	\
+    defined(MADV_DONTNEED) &&	\
+    defined(MADV_MERGEABLE)
+
+#define KSM_SYSFS		"/sys/kernel/mm/ksm/"
+
+/* ksmd tunables changed by the stressor and restored at the end */
+static const char * const ksm_tunables[] = {
+	"run",
+	"pages_to_scan",
+	"sleep_millisecs",
+	"use_zero_pages",
+};
+
+static char ksm_saved[SIZEOF_ARRAY(ksm_tunables)][32];
+
+/*
+ *  stress_ksm_merge_supported()
+ *	check if KSM is available and can be controlled
+ */
+static int stress_ksm_merge_supported(const char *name)
+{
+	if (access(KSM_SYSFS "run", R_OK | W_OK) < 0) {
+		pr_inf_skip("%s stressor will be skipped, cannot access "
+			KSM_SYSFS "run, KSM not configured or need to be "
+			"running as root\n", name);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ *  stress_ksm_merge_init()
+ *	save the ksmd tunables
+ */
+static void stress_ksm_merge_init(const uint32_t instances)
+{
+	size_t i;
+
+	(void)instances;
+
+	for (i = 0; i < SIZEOF_ARRAY(ksm_tunables); i++) {
+		char path[64];
+
+		(void)snprintf(path, sizeof(path), KSM_SYSFS "%s", ksm_tunables[i]);
+		if (stress_system_read(path, ksm_saved[i], sizeof(ksm_saved[i])) < 0)
+			*ksm_saved[i] = '\0';
+	}
+}
+
+/*
+ *  stress_ksm_merge_deinit()
+ *	restore the ksmd tunables
+ */
+static void stress_ksm_merge_deinit(void)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(ksm_tunables); i++) {
+		char path[64];
+
+		if (!*ksm_saved[i])
+			continue;
+		(void)snprintf(path, sizeof(path), KSM_SYSFS "%s", ksm_tunables[i]);
+		(void)stress_system_write(path, ksm_saved[i], strlen(ksm_saved[i]));
+	}
+}
+
+/*
+ *  stress_ksm_merge_set()
+ *	set a ksmd tunable
+ */
+static void stress_ksm_merge_set(const char *tunable, const uint32_t value)
+{
+	char path[64], buf[16];
+	ssize_t len;
+
+	(void)snprintf(path, sizeof(path), KSM_SYSFS "%s", tunable);
+	len = (ssize_t)snprintf(buf, sizeof(buf), "%" PRIu32 "\n", value);
+	(void)stress_system_write(path, buf, (size_t)len);
+}
+
+/*
+ *  stress_ksm_merge_get()
+ *	get a ksmd statistic, 0 if not available
+ */
+static uint64_t stress_ksm_merge_get(const char *stat)
+{
+	char path[64], buf[32];
+	uint64_t val;
+
+	(void)snprintf(path, sizeof(path), KSM_SYSFS "%s", stat);
+	if (stress_system_read(path, buf, sizeof(buf)) < 0)
+		return 0;
+	if (sscanf(buf, "%" SCNu64, &val) != 1)
+		return 0;
+	return val;
+}
+
+/*
+ *  stress_ksm_merge_merged()
+ *	number of merged pages of this process, from /proc/self/ksm_stat
+ *	(Linux 6.1+) or the system wide ksmd counters on older kernels
+ */
+static uint64_t stress_ksm_merge_merged(void)
+{
+	char buf[512];
+	const char *ptr;
+	uint64_t merging = 0, zero = 0;
+
+	if (stress_system_read("/proc/self/ksm_stat", buf, sizeof(buf)) < 0) {
+		return stress_ksm_merge_get("pages_shared") +
+		       stress_ksm_merge_get("pages_sharing") +
+		       stress_ksm_merge_get("ksm_zero_pages");
+	}
+	ptr = strstr(buf, "ksm_merging_pages ");
+	if (ptr)
+		(void)sscanf(ptr, "ksm_merging_pages %" SCNu64, &merging);
+	ptr = strstr(buf, "ksm_zero_pages ");
+	if (ptr)
+		(void)sscanf(ptr, "ksm_zero_pages %" SCNu64, &zero);
+	return merging + zero;
+}
+
+/*
+ *  stress_ksm_merge_ksmd_pid()
+ *	find the ksmd kernel thread, -1 if not found
+ */
+static pid_t stress_ksm_merge_ksmd_pid(void)
+{
+	DIR *dir;
+	const struct dirent *d;
+	pid_t pid = -1;
+
+	dir = opendir("/proc");
+	if (!dir)
+		return -1;
+	while ((d = readdir(dir)) != NULL) {
+		char path[PATH_MAX], comm[32];
+
+		if (!isdigit((unsigned char)d->d_name[0]))
+			continue;
+		(void)snprintf(path, sizeof(path), "/proc/%s/comm", d->d_name);
+		if (stress_system_read(path, comm, sizeof(comm)) < 0)
+			continue;
+		if (strcmp(comm, "ksmd\n") == 0) {
+			pid = (pid_t)atoi(d->d_name);
+			break;
+		}
+	}
+	(void)closedir(dir);
+	return pid;
+}
+
+/*
+ *  stress_ksm_merge_ksmd_cpu()
+ *	user + system CPU time of ksmd in seconds
+ */
+static double stress_ksm_merge_ksmd_cpu(const pid_t pid)
+{
+	char path[64], buf[1024];
+	const char *ptr;
+	unsigned long int utime, stime;
+	const int32_t ticks = stress_get_ticks_per_second();
+
+	if ((pid < 0) || (ticks <= 0))
+		return 0.0;
+	(void)snprintf(path, sizeof(path), "/proc/%" PRIdMAX "/stat", (intmax_t)pid);
+	if (stress_system_read(path, buf, sizeof(buf)) < 0)
+		return 0.0;
+	/* fields after the comm, utime and stime are the 12th and 13th */
+	ptr = strrchr(buf, ')');
+	if (!ptr)
+		return 0.0;
+	if (sscanf(ptr + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+		   &utime, &stime) != 2)
+		return 0.0;
+	return (double)(utime + stime) / (double)ticks;
+}
+
+/*
+ *  stress_ksm_merge_fill()
+ *	fill the region, the first dup_pages are duplicates of one of
+ *	KSM_MERGE_PATTERNS pages (or zero pages), the rest are unique
+ */
+static void stress_ksm_merge_fill(
+	uint8_t *buf,
+	const size_t n_pages,
+	const size_t dup_pages,
+	const size_t page_size,
+	const bool ksm_zero,
+	const uint32_t seed)
+{
+	size_t i;
+
+	for (i = 0; i < n_pages; i++) {
+		uint8_t *page = buf + (i * page_size);
+
+		if (i < dup_pages) {
+			if (ksm_zero)
+				*(volatile uint8_t *)page = 0;
+			else
+				(void)shim_memset(page, (int)(seed + (i % KSM_MERGE_PATTERNS)), page_size);
+		} else {
+			uint64_t *ptr = (uint64_t *)page;
+			const uint64_t *end = (uint64_t *)(page + page_size);
+
+			while (ptr < end)
+				*ptr++ = stress_mwc64();
+		}
+	}
+}
+
+/*
+ *  stress_ksm_merge()
+ *	measure KSM page merging throughput and COW unmerge latency
+ */
+static int stress_ksm_merge(stress_args_t *args)
+{
+	const size_t page_size = args->page_size;
+	size_t ksm_bytes_total = DEFAULT_KSM_MERGE_BYTES, ksm_bytes, n_pages, dup_pages, i;
+	uint32_t ksm_dup = DEFAULT_KSM_MERGE_DUP;
+	uint32_t ksm_pages_to_scan = DEFAULT_KSM_MERGE_PAGES_TO_SCAN;
+	uint32_t ksm_sleep = DEFAULT_KSM_MERGE_SLEEP;
+	bool ksm_zero = false;
+	uint64_t merged_total = 0, expected_total = 0, rounds = 0;
+	double merge_duration = 0.0, ksmd_cpu = 0.0;
+	stress_hist_t hist;
+	pid_t ksmd_pid;
+	uint8_t *buf;
+	int rc = EXIT_SUCCESS;
+
+	if (!stress_get_setting("ksm-merge-bytes", &ksm_bytes_total)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			ksm_bytes_total = MAX_32;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			ksm_bytes_total = MIN_KSM_MERGE_BYTES;
+	}
+	(void)stress_get_setting("ksm-merge-dup", &ksm_dup);
+	(void)stress_get_setting("ksm-merge-pages-to-scan", &ksm_pages_to_scan);
+	(void)stress_get_setting("ksm-merge-sleep", &ksm_sleep);
+	(void)stress_get_setting("ksm-merge-zero", &ksm_zero);
+
+	ksm_bytes = (ksm_bytes_total / args->instances) & ~(page_size - 1);
+	if (ksm_bytes < MIN_KSM_MERGE_BYTES)
+		ksm_bytes = MIN_KSM_MERGE_BYTES;
+	n_pages = ksm_bytes / page_size;
+	dup_pages = (n_pages * ksm_dup) / 100;
+	if (stress_instance_zero(args))
+		stress_usage_bytes(args, ksm_bytes, ksm_bytes * args->instances);
+
+	if (stress_instance_zero(args)) {
+		stress_ksm_merge_set("pages_to_scan", ksm_pages_to_scan);
+		stress_ksm_merge_set("sleep_millisecs", ksm_sleep);
+		stress_ksm_merge_set("use_zero_pages", ksm_zero ? 1 : 0);
+		stress_ksm_merge_set("run", 1);
+	}
+	ksmd_pid = stress_ksm_merge_ksmd_pid();
+	if ((ksmd_pid < 0) && stress_instance_zero(args))
+		pr_inf("%s: cannot find ksmd, ksmd CPU cost will not be reported\n", args->name);
+
+	buf = (uint8_t *)mmap(NULL, ksm_bytes, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes%s, skipping stressor\n",
+			args->name, ksm_bytes, stress_get_memfree_str());
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, ksm_bytes, "ksm-merge-data");
+	stress_hist_init(&hist, "COW unmerge latency");
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		const uint32_t seed = stress_mwc32();
+		uint64_t merged_start, merged = 0, last = 0;
+		double t_start, t_last, t_now, cpu_start;
+
+		/* fresh pages each round, KSM only merges present pages */
+		(void)shim_madvise((void *)buf, ksm_bytes, MADV_DONTNEED);
+		stress_ksm_merge_fill(buf, n_pages, dup_pages, page_size, ksm_zero, seed);
+		merged_start = stress_ksm_merge_merged();
+
+		cpu_start = stress_ksm_merge_ksmd_cpu(ksmd_pid);
+		t_start = stress_time_now();
+		t_last = t_start;
+		if (shim_madvise((void *)buf, ksm_bytes, MADV_MERGEABLE) < 0) {
+			pr_inf_skip("%s: madvise MADV_MERGEABLE failed, errno=%d (%s), "
+				"skipping stressor\n", args->name, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			break;
+		}
+
+		/* wait for all the duplicates to merge or for merging to stall */
+		do {
+			(void)shim_usleep(5000);
+			t_now = stress_time_now();
+			merged = stress_ksm_merge_merged();
+			merged = (merged > merged_start) ? merged - merged_start : 0;
+			if (merged != last) {
+				last = merged;
+				t_last = t_now;
+			}
+		} while ((merged < dup_pages) &&
+			 ((t_now - t_start) < KSM_MERGE_TIMEOUT) &&
+			 (merged == 0 || (t_now - t_last) < 2.0) &&
+			 stress_continue_flag());
+
+		merge_duration += t_last - t_start;
+		ksmd_cpu += stress_ksm_merge_ksmd_cpu(ksmd_pid) - cpu_start;
+		merged_total += merged;
+		expected_total += dup_pages;
+
+		/* write to each duplicate page, merged pages are unmerged by COW */
+		for (i = 0; i < dup_pages; i++) {
+			volatile uint8_t *page = (volatile uint8_t *)(buf + (i * page_size));
+			double t;
+
+			t = stress_time_now();
+			*page = (uint8_t)~*page;
+			t = stress_time_now() - t;
+			stress_hist_record(&hist, (uint64_t)(t * STRESS_DBL_NANOSECOND));
+		}
+
+#if defined(MADV_UNMERGEABLE)
+		(void)shim_madvise((void *)buf, ksm_bytes, MADV_UNMERGEABLE);
+#endif
+		rounds++;
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if ((rounds > 0) && (merge_duration > 0.0)) {
+		const double merge_rate = (double)merged_total / merge_duration;
+		const double ksmd_percent = 100.0 * ksmd_cpu / merge_duration;
+		const double merged_percent = expected_total ?
+			100.0 * (double)merged_total / (double)expected_total : 0.0;
+		const double ksmd_usec_page = merged_total ?
+			(ksmd_cpu * STRESS_DBL_MICROSECOND) / (double)merged_total : 0.0;
+
+		if (stress_instance_zero(args)) {
+			pr_inf("%s: %.0f pages merged/sec, %.1f%% of %" PRIu64 " duplicate pages "
+				"merged, ksmd %.1f%% CPU, %.2f usecs ksmd CPU per merged page\n",
+				args->name, merge_rate, merged_percent, expected_total,
+				ksmd_percent, ksmd_usec_page);
+			if (hist.count > 0) {
+				pr_inf("%s: COW unmerge latency nanosecs: p50 %" PRIu64 ", p99 %" PRIu64
+					", p99.9 %" PRIu64 ", max %" PRIu64 "\n", args->name,
+					stress_hist_percentile(&hist, 50.0),
+					stress_hist_percentile(&hist, 99.0),
+					stress_hist_percentile(&hist, 99.9), hist.max);
+			}
+		}
+		stress_metrics_set(args, 0, "pages merged per sec",
+			merge_rate, STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "% duplicate pages merged",
+			merged_percent, STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 2, "% ksmd CPU while merging",
+			ksmd_percent, STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 3, "microsecs ksmd CPU per merged page",
+			ksmd_usec_page, STRESS_METRIC_GEOMETRIC_MEAN);
+		if (hist.count > 0) {
+			stress_metrics_set(args, 4, "nanosecs p50 COW unmerge",
+				(double)stress_hist_percentile(&hist, 50.0), STRESS_METRIC_GEOMETRIC_MEAN);
+			stress_metrics_set(args, 5, "nanosecs p99 COW unmerge",
+				(double)stress_hist_percentile(&hist, 99.0), STRESS_METRIC_GEOMETRIC_MEAN);
+			stress_hist_merge(args, 0, &hist);
+		}
+	}
+
+	(void)munmap((void *)buf, ksm_bytes);
+
+	return rc;
+}
+
+const stressor_info_t stress_ksm_merge_info = {
+	.stressor = stress_ksm_merge,
+	.supported = stress_ksm_merge_supported,
+	.init = stress_ksm_merge_init,
+	.deinit = stress_ksm_merge_deinit,
+	.classifier = CLASS_MEMORY | CLASS_OS,
+	.opts = opts,
+	.help = help
+};
+#else
+const stressor_info_t stress_ksm_merge_info = {
+	.stressor = stress_unimplemented,
+	.classifier = CLASS_MEMORY | CLASS_OS,
+	.opts = opts,
+	.help = help,
+	.unimplemented_reason = "only supported on Linux with madvise() MADV_MERGEABLE"
+};
+#endif
@@ -19,9 +19,12 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
+#include "core-cpu-freq.h"
 #include "core-madvise.h"
 #include "core-mmap.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 #include "core-put.h"
 #include "core-target-clones.h"
 
@@ -29,11 +32,25 @@
 #define MAX_MATRIX_SIZE		(8192)
 #define DEFAULT_MATRIX_SIZE	(128)
 
+#define MIN_MATRIX_THREADS	(0)
+#define MAX_MATRIX_THREADS	(256)
+
+#define MATRIX_GEMM_MR		(4)	/* micro-kernel register tile rows */
+#define MATRIX_GEMM_NR		(16)	/* micro-kernel register tile columns */
+#define MATRIX_GEMM_MC		(64)	/* packed a block rows */
+#define MATRIX_GEMM_KC		(256)	/* packed a and b panel depth */
+#define MATRIX_GEMM_NC		(512)	/* packed b panel columns */
+#define MATRIX_GEMM_L1		(32)	/* blocked method L1 row strip */
+#define MATRIX_GEMM_L2		(128)	/* blocked method L2 block size */
+#define MATRIX_GEMM_PACK_A	(MATRIX_GEMM_MC * MATRIX_GEMM_KC)
+#define MATRIX_GEMM_PACK_B	(MATRIX_GEMM_KC * MATRIX_GEMM_NC)
+
 static const stress_help_t help[] = {
 	{ NULL,	"matrix N",		"start N workers exercising matrix operations" },
 	{ NULL,	"matrix-method M",	"specify matrix stress method M, default is all" },
 	{ NULL,	"matrix-ops N",		"stop after N matrix bogo operations" },
 	{ NULL,	"matrix-size N",	"specify the size of the N x N matrix" },
+	{ NULL,	"matrix-threads N",	"number of threads for the gemm-mt method" },
 	{ NULL,	"matrix-yx",		"matrix operation is y by x instead of x by y" },
 	{ NULL,	NULL,			NULL }
 };
@@ -54,10 +71,32 @@ typedef void (*stress_matrix_func_t)(
 typedef struct {
 	const char			*name;		/* human readable form of stressor */
 	const stress_matrix_func_t	func[2];	/* method functions, x by y, y by x */
+	const bool			gemm;		/* true if r += a * b, 2 x n^3 flops */
 } stress_matrix_method_info_t;
 
+#if defined(HAVE_LIB_PTHREAD)
+typedef struct {
+	pthread_t pthread;		/* gemm-mt pthread */
+	int create_ret;			/* pthread_create return */
+	size_t n;			/* matrix size */
+	size_t i_start;			/* first row of r band */
+	size_t i_end;			/* end row of r band */
+	const stress_matrix_type_t *a;	/* matrix a */
+	const stress_matrix_type_t *b;	/* matrix b */
+	stress_matrix_type_t *r;	/* result matrix r */
+	stress_matrix_type_t *pack;	/* per thread packing buffers */
+} stress_matrix_gemm_thread_t;
+#endif
+
 static const char *current_method = NULL;		/* current matrix method */
 static size_t method_all_index;				/* all method index */
+static size_t matrix_threads = 1;			/* gemm-mt thread count */
+static stress_matrix_type_t *matrix_gemm_pack;		/* gemm packing buffers */
+
+#if defined(HAVE_VECMATH)
+typedef stress_matrix_type_t stress_matrix_vec_t
+	__attribute__ ((vector_size(sizeof(stress_matrix_type_t) * MATRIX_GEMM_NR / 2)));
+#endif
 
 static const stress_matrix_method_info_t matrix_methods[];
 
@@ -735,6 +774,323 @@ static void OPTIMIZE3 TARGET_CLONES stress_matrix_yx_square(
 	}
 }
 
+/*
+ *  stress_matrix_gemm_min()
+ *	minimum of a and b
+ */
+static inline size_t stress_matrix_gemm_min(const size_t a, const size_t b)
+{
+	return (a < b) ? a : b;
+}
+
+/*
+ *  stress_matrix_gemm_kernel()
+ *	MR x NR register tile micro-kernel, c += a * b over kc steps,
+ *	a elements are a_row apart within a step and advance a_step
+ *	per step, b rows of NR elements advance b_step per step. Only
+ *	the top left mr x nr of the tile is written back to c
+ */
+static inline void ALWAYS_INLINE OPTIMIZE3 stress_matrix_gemm_kernel(
+	const size_t kc,
+	const stress_matrix_type_t *RESTRICT pa,
+	const size_t a_row,
+	const size_t a_step,
+	const stress_matrix_type_t *RESTRICT pb,
+	const size_t b_step,
+	stress_matrix_type_t *RESTRICT c,
+	const size_t ldc,
+	const size_t mr,
+	const size_t nr)
+{
+	stress_matrix_type_t acc[MATRIX_GEMM_MR][MATRIX_GEMM_NR];
+	register size_t i, j, p;
+
+#if defined(HAVE_VECMATH)
+	/*
+	 *  two 8 lane vectors per row, maps onto AVX/AVX2 ymm
+	 *  registers, pairs of SSE/NEON registers or the lower
+	 *  half of AVX-512 zmm registers
+	 */
+	stress_matrix_vec_t vacc[MATRIX_GEMM_MR][2];
+
+	shim_memset(vacc, 0, sizeof(vacc));
+	for (p = 0; p < kc; p++) {
+		stress_matrix_vec_t b0, b1;
+
+		shim_memcpy(&b0, pb, sizeof(b0));
+		shim_memcpy(&b1, pb + MATRIX_GEMM_NR / 2, sizeof(b1));
+		for (i = 0; i < MATRIX_GEMM_MR; i++) {
+			const stress_matrix_type_t av = pa[i * a_row];
+
+			vacc[i][0] += av * b0;
+			vacc[i][1] += av * b1;
+		}
+		pa += a_step;
+		pb += b_step;
+	}
+	shim_memcpy(acc, vacc, sizeof(acc));
+#else
+	for (i = 0; i < MATRIX_GEMM_MR; i++) {
+		for (j = 0; j < MATRIX_GEMM_NR; j++)
+			acc[i][j] = 0.0;
+	}
+	for (p = 0; p < kc; p++) {
+		for (i = 0; i < MATRIX_GEMM_MR; i++) {
+			const stress_matrix_type_t av = pa[i * a_row];
+
+			for (j = 0; j < MATRIX_GEMM_NR; j++)
+				acc[i][j] += av * pb[j];
+		}
+		pa += a_step;
+		pb += b_step;
+	}
+#endif
+	for (i = 0; i < mr; i++) {
+		stress_matrix_type_t *RESTRICT cr = c + (i * ldc);
+
+		for (j = 0; j < nr; j++)
+			cr[j] += acc[i][j];
+	}
+}
+
+/*
+ *  stress_matrix_gemm_packed_rows()
+ *	packed panel GEMM on rows i_start..i_end-1 of r, a mc x kc
+ *	block of a is packed into MR row strips and a kc x nc panel
+ *	of b is packed into NR column strips, both zero padded so
+ *	the micro-kernel always operates on full register tiles
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_gemm_packed_rows(
+	const size_t n,
+	const stress_matrix_type_t *RESTRICT a,
+	const stress_matrix_type_t *RESTRICT b,
+	stress_matrix_type_t *RESTRICT r,
+	const size_t i_start,
+	const size_t i_end,
+	stress_matrix_type_t *RESTRICT pack)
+{
+	stress_matrix_type_t *RESTRICT pa = pack;
+	stress_matrix_type_t *RESTRICT pb = pack + MATRIX_GEMM_PACK_A;
+	size_t jc, pc, ic;
+
+	for (jc = 0; jc < n; jc += MATRIX_GEMM_NC) {
+		const size_t nc = stress_matrix_gemm_min(MATRIX_GEMM_NC, n - jc);
+
+		for (pc = 0; pc < n; pc += MATRIX_GEMM_KC) {
+			const size_t kc = stress_matrix_gemm_min(MATRIX_GEMM_KC, n - pc);
+			stress_matrix_type_t *ptr = pb;
+			size_t jr, ir, p, x;
+
+			for (jr = 0; jr < nc; jr += MATRIX_GEMM_NR) {
+				const size_t nr = stress_matrix_gemm_min(MATRIX_GEMM_NR, nc - jr);
+
+				for (p = 0; p < kc; p++) {
+					const stress_matrix_type_t *brow = b + ((pc + p) * n) + jc + jr;
+
+					for (x = 0; x < nr; x++)
+						*ptr++ = brow[x];
+					for (; x < MATRIX_GEMM_NR; x++)
+						*ptr++ = 0.0;
+				}
+			}
+
+			for (ic = i_start; ic < i_end; ic += MATRIX_GEMM_MC) {
+				const size_t mc = stress_matrix_gemm_min(MATRIX_GEMM_MC, i_end - ic);
+
+				ptr = pa;
+				for (ir = 0; ir < mc; ir += MATRIX_GEMM_MR) {
+					const size_t mr = stress_matrix_gemm_min(MATRIX_GEMM_MR, mc - ir);
+
+					for (p = 0; p < kc; p++) {
+						const stress_matrix_type_t *acol = a + ((ic + ir) * n) + pc + p;
+
+						for (x = 0; x < mr; x++)
+							*ptr++ = acol[x * n];
+						for (; x < MATRIX_GEMM_MR; x++)
+							*ptr++ = 0.0;
+					}
+				}
+
+				for (jr = 0; jr < nc; jr += MATRIX_GEMM_NR) {
+					const size_t nr = stress_matrix_gemm_min(MATRIX_GEMM_NR, nc - jr);
+
+					for (ir = 0; ir < mc; ir += MATRIX_GEMM_MR) {
+						const size_t mr = stress_matrix_gemm_min(MATRIX_GEMM_MR, mc - ir);
+
+						stress_matrix_gemm_kernel(kc,
+							pa + (ir * kc), 1, MATRIX_GEMM_MR,
+							pb + (jr * kc), MATRIX_GEMM_NR,
+							r + ((ic + ir) * n) + jc + jr, n, mr, nr);
+					}
+				}
+			}
+		}
+	}
+}
+
+/*
+ *  stress_matrix_gemm_tiled()
+ *	register tiled matrix product, MR x NR tiles of r are
+ *	accumulated in registers across the full k range directly
+ *	from the unpacked a and b matrices, the ragged right and
+ *	bottom edges use a scalar i-k-j loop
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_gemm_tiled(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n])
+{
+	const size_t i_end = n - (n % MATRIX_GEMM_MR);
+	const size_t j_end = n - (n % MATRIX_GEMM_NR);
+	size_t i, j, k;
+
+	for (i = 0; i < i_end; i += MATRIX_GEMM_MR) {
+		for (j = 0; j < j_end; j += MATRIX_GEMM_NR) {
+			stress_matrix_gemm_kernel(n, &a[i][0], n, 1, &b[0][j], n,
+				&r[i][j], n, MATRIX_GEMM_MR, MATRIX_GEMM_NR);
+		}
+		for (k = 0; k < n; k++) {
+			register size_t ii;
+
+			for (ii = i; ii < i + MATRIX_GEMM_MR; ii++) {
+				const stress_matrix_type_t av = a[ii][k];
+
+				for (j = j_end; j < n; j++)
+					r[ii][j] += av * b[k][j];
+			}
+		}
+	}
+	for (; i < n; i++) {
+		for (k = 0; k < n; k++) {
+			const stress_matrix_type_t av = a[i][k];
+
+			for (j = 0; j < n; j++)
+				r[i][j] += av * b[k][j];
+		}
+	}
+}
+
+/*
+ *  stress_matrix_gemm_blocked()
+ *	cache blocked i-k-j matrix product, a L2 sized block of b
+ *	is reused across L1 sized strips of rows of a and r
+ */
+static void OPTIMIZE3 TARGET_CLONES stress_matrix_gemm_blocked(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n])
+{
+	size_t kk, jj, ii;
+
+	for (kk = 0; kk < n; kk += MATRIX_GEMM_L2) {
+		const size_t k_end = stress_matrix_gemm_min(kk + MATRIX_GEMM_L2, n);
+
+		for (jj = 0; jj < n; jj += MATRIX_GEMM_L2) {
+			const size_t j_end = stress_matrix_gemm_min(jj + MATRIX_GEMM_L2, n);
+
+			for (ii = 0; ii < n; ii += MATRIX_GEMM_L1) {
+				const size_t i_end = stress_matrix_gemm_min(ii + MATRIX_GEMM_L1, n);
+				register size_t i;
+
+				for (i = ii; i < i_end; i++) {
+					stress_matrix_type_t *RESTRICT ri = r[i];
+					register size_t k;
+
+					for (k = kk; k < k_end; k++) {
+						const stress_matrix_type_t av = a[i][k];
+						const stress_matrix_type_t *RESTRICT bk = b[k];
+						register size_t j;
+
+						for (j = jj; j < j_end; j++)
+							ri[j] += av * bk[j];
+					}
+				}
+			}
+		}
+	}
+}
+
+/*
+ *  stress_matrix_gemm_packed()
+ *	packed panel matrix product, single threaded
+ */
+static void OPTIMIZE3 stress_matrix_gemm_packed(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n])
+{
+	stress_matrix_gemm_packed_rows(n, &a[0][0], &b[0][0], &r[0][0],
+		0, n, matrix_gemm_pack);
+}
+
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  stress_matrix_gemm_thread()
+ *	compute a horizontal band of r
+ */
+static void *stress_matrix_gemm_thread(void *ptr)
+{
+	const stress_matrix_gemm_thread_t *thread = (stress_matrix_gemm_thread_t *)ptr;
+
+	stress_matrix_gemm_packed_rows(thread->n, thread->a, thread->b, thread->r,
+		thread->i_start, thread->i_end, thread->pack);
+
+	return &g_nowt;
+}
+#endif
+
+/*
+ *  stress_matrix_gemm_mt()
+ *	packed panel matrix product, horizontal bands of MR aligned
+ *	rows are split across matrix_threads threads, the calling
+ *	thread computes the first band. Each band is computed in the
+ *	same order irrespective of the thread count so results are
+ *	deterministic
+ */
+static void OPTIMIZE3 stress_matrix_gemm_mt(
+	const size_t n,
+	stress_matrix_type_t a[RESTRICT n][n],
+	stress_matrix_type_t b[RESTRICT n][n],
+	stress_matrix_type_t r[RESTRICT n][n])
+{
+#if defined(HAVE_LIB_PTHREAD)
+	stress_matrix_gemm_thread_t threads[MAX_MATRIX_THREADS];
+	size_t band, i, n_threads;
+	const size_t pack_size = MATRIX_GEMM_PACK_A + MATRIX_GEMM_PACK_B;
+
+	band = (n + matrix_threads - 1) / matrix_threads;
+	band = (band + MATRIX_GEMM_MR - 1) & ~(size_t)(MATRIX_GEMM_MR - 1);
+	n_threads = (n + band - 1) / band;
+
+	for (i = 0; i < n_threads; i++) {
+		threads[i].n = n;
+		threads[i].a = &a[0][0];
+		threads[i].b = &b[0][0];
+		threads[i].r = &r[0][0];
+		threads[i].i_start = i * band;
+		threads[i].i_end = stress_matrix_gemm_min((i + 1) * band, n);
+		threads[i].pack = matrix_gemm_pack + (i * pack_size);
+		threads[i].create_ret = (i == 0) ? -1 :
+			pthread_create(&threads[i].pthread, NULL,
+				stress_matrix_gemm_thread, &threads[i]);
+	}
+	/* band 0 and any bands that failed to start run on this thread */
+	for (i = 0; i < n_threads; i++) {
+		if (threads[i].create_ret != 0)
+			(void)stress_matrix_gemm_thread(&threads[i]);
+	}
+	for (i = 1; i < n_threads; i++) {
+		if (threads[i].create_ret == 0)
+			(void)pthread_join(threads[i].pthread, NULL);
+	}
+#else
+	stress_matrix_gemm_packed(n, a, b, r);
+#endif
+}
+
 /*
  *  stress_matrix_xy_all()
  *	iterate over all matrix stressors
@@ -759,22 +1115,26 @@ static void OPTIMIZE3 stress_matrix_yx_all(
  * Table of matrix stress methods, ordered x by y and y by x
  */
 static const stress_matrix_method_info_t matrix_methods[] = {
-	{ "all",		{ stress_matrix_xy_all,		stress_matrix_yx_all } },/* Special "all" test */
-
-	{ "add",		{ stress_matrix_xy_add,		stress_matrix_yx_add } },
-	{ "copy",		{ stress_matrix_xy_copy,	stress_matrix_yx_copy } },
-	{ "div",		{ stress_matrix_xy_div,		stress_matrix_yx_div } },
-	{ "frobenius",		{ stress_matrix_xy_frobenius,	stress_matrix_yx_frobenius } },
-	{ "hadamard",		{ stress_matrix_xy_hadamard,	stress_matrix_yx_hadamard } },
-	{ "identity",		{ stress_matrix_xy_identity,	stress_matrix_yx_identity } },
-	{ "mean",		{ stress_matrix_xy_mean,	stress_matrix_yx_mean } },
-	{ "mult",		{ stress_matrix_xy_mult,	stress_matrix_yx_mult } },
-	{ "negate",		{ stress_matrix_xy_negate,	stress_matrix_yx_negate } },
-	{ "prod",		{ stress_matrix_xy_prod,	stress_matrix_yx_prod } },
-	{ "sub",		{ stress_matrix_xy_sub,		stress_matrix_yx_sub } },
-	{ "square",		{ stress_matrix_xy_square,	stress_matrix_yx_square } },
-	{ "trans",		{ stress_matrix_xy_trans,	stress_matrix_yx_trans } },
-	{ "zero",		{ stress_matrix_xy_zero,	stress_matrix_yx_zero } },
+	{ "all",		{ stress_matrix_xy_all,		stress_matrix_yx_all },	false },/* Special "all" test */
+
+	{ "add",		{ stress_matrix_xy_add,		stress_matrix_yx_add },	false },
+	{ "copy",		{ stress_matrix_xy_copy,	stress_matrix_yx_copy },	false },
+	{ "div",		{ stress_matrix_xy_div,		stress_matrix_yx_div },	false },
+	{ "frobenius",		{ stress_matrix_xy_frobenius,	stress_matrix_yx_frobenius },	false },
+	{ "gemm-blocked",	{ stress_matrix_gemm_blocked,	stress_matrix_gemm_blocked },	true },
+	{ "gemm-mt",		{ stress_matrix_gemm_mt,	stress_matrix_gemm_mt },	true },
+	{ "gemm-packed",	{ stress_matrix_gemm_packed,	stress_matrix_gemm_packed },	true },
+	{ "gemm-tiled",		{ stress_matrix_gemm_tiled,	stress_matrix_gemm_tiled },	true },
+	{ "hadamard",		{ stress_matrix_xy_hadamard,	stress_matrix_yx_hadamard },	false },
+	{ "identity",		{ stress_matrix_xy_identity,	stress_matrix_yx_identity },	false },
+	{ "mean",		{ stress_matrix_xy_mean,	stress_matrix_yx_mean },	false },
+	{ "mult",		{ stress_matrix_xy_mult,	stress_matrix_yx_mult },	false },
+	{ "negate",		{ stress_matrix_xy_negate,	stress_matrix_yx_negate },	false },
+	{ "prod",		{ stress_matrix_xy_prod,	stress_matrix_yx_prod },	true },
+	{ "sub",		{ stress_matrix_xy_sub,		stress_matrix_yx_sub },	false },
+	{ "square",		{ stress_matrix_xy_square,	stress_matrix_yx_square },	false },
+	{ "trans",		{ stress_matrix_xy_trans,	stress_matrix_yx_trans },	false },
+	{ "zero",		{ stress_matrix_xy_zero,	stress_matrix_yx_zero },	false },
 };
 
 static stress_metrics_t matrix_metrics[SIZEOF_ARRAY(matrix_methods)];
@@ -837,6 +1197,58 @@ static inline stress_matrix_type_t stress_matrix_data(const stress_matrix_type_t
 	return v * (stress_matrix_type_t)r;
 }
 
+/*
+ *  stress_matrix_peak_gflops()
+ *	estimate single core single precision peak GFLOP/s from the
+ *	maximum CPU frequency and the widest FMA/SIMD unit available,
+ *	assumes two vector FP pipes per core, returns 0.0 if unknown
+ */
+static double stress_matrix_peak_gflops(void)
+{
+	double avg_ghz = 0.0, min_ghz = 0.0, max_ghz = 0.0;
+	double flops_per_cycle;
+
+	stress_get_cpu_freq(&avg_ghz, &min_ghz, &max_ghz);
+#if defined(__linux__)
+	/* no cpufreq, e.g. virtual machines, try /proc/cpuinfo */
+	if (max_ghz <= 0.0) {
+		FILE *fp;
+
+		if ((fp = fopen("/proc/cpuinfo", "r")) != NULL) {
+			char buf[256];
+
+			while (fgets(buf, sizeof(buf), fp)) {
+				double mhz;
+
+				if ((sscanf(buf, "cpu MHz : %lf", &mhz) == 1) &&
+				    (mhz * 0.001 > max_ghz))
+					max_ghz = mhz * 0.001;
+			}
+			(void)fclose(fp);
+		}
+	}
+#endif
+	if (max_ghz <= 0.0)
+		return 0.0;
+
+#if defined(STRESS_ARCH_X86)
+	if (stress_cpu_x86_has_avx512_f())
+		flops_per_cycle = 64.0;	/* 2 x 16 lane FMA */
+	else if (stress_cpu_x86_has_avx2() && stress_cpu_x86_has_fma())
+		flops_per_cycle = 32.0;	/* 2 x 8 lane FMA */
+	else if (stress_cpu_x86_has_avx())
+		flops_per_cycle = 16.0;	/* 8 lane add + 8 lane mul */
+	else
+		flops_per_cycle = 8.0;	/* 4 lane add + 4 lane mul */
+#elif defined(STRESS_ARCH_ARM) &&	\
+      defined(__aarch64__)
+	flops_per_cycle = 16.0;		/* 2 x 4 lane NEON FMA */
+#else
+	return 0.0;
+#endif
+	return max_ghz * flops_per_cycle;
+}
+
 static inline int stress_matrix_exercise(
 	stress_args_t *args,
 	const size_t matrix_method,
@@ -851,6 +1263,11 @@ static inline int stress_matrix_exercise(
 	const size_t num_matrix_methods = SIZEOF_ARRAY(matrix_methods);
 	const stress_matrix_func_t func = matrix_methods[matrix_method].func[matrix_yx];
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	const size_t pack_threads = (matrix_methods[matrix_method].func[0] == stress_matrix_gemm_mt) ?
+		matrix_threads : 1;
+	const size_t pack_mmap_size = round_up(args->page_size, sizeof(stress_matrix_type_t) *
+		pack_threads * (MATRIX_GEMM_PACK_A + MATRIX_GEMM_PACK_B));
+	const double peak_gflops = stress_matrix_peak_gflops();
 
 	matrix_ptr_t a, b = NULL, r = NULL, s = NULL;
 	register size_t i, j;
@@ -865,13 +1282,23 @@ static inline int stress_matrix_exercise(
 
 	stress_zero_metrics(matrix_metrics, num_matrix_methods);
 
+	matrix_gemm_pack = (stress_matrix_type_t *)stress_mmap_populate(NULL, pack_mmap_size,
+		PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (matrix_gemm_pack == MAP_FAILED) {
+		pr_fail("%s: gemm packing buffer allocation failed, out of memory%s, errno=%d (%s)\n",
+			args->name, stress_get_memfree_str(),
+			errno, strerror(errno));
+		goto tidy_ret;
+	}
+	stress_set_vma_anon_name(matrix_gemm_pack, pack_mmap_size, "matrix-gemm-pack");
+
 	a = (matrix_ptr_t)stress_mmap_populate(NULL, matrix_mmap_size,
 		PROT_READ | PROT_WRITE, flags, -1, 0);
 	if (a == MAP_FAILED) {
 		pr_fail("%s: matrix allocation failed, out of memory%s, errno=%d (%s)\n",
 			args->name, stress_get_memfree_str(),
 			errno, strerror(errno));
-		goto tidy_ret;
+		goto tidy_pack;
 	}
 	(void)stress_madvise_collapse(a, matrix_mmap_size);
 	stress_set_vma_anon_name(a, matrix_mmap_size, "matrix-a");
@@ -950,9 +1377,12 @@ static inline int stress_matrix_exercise(
 			}
 		}
 		if (matrix_method == 0) {
-			method_all_index++;
-			if (method_all_index >= SIZEOF_ARRAY(matrix_methods))
-				method_all_index = 1;
+			/* gemm-mt starts threads, it is only run when selected */
+			do {
+				method_all_index++;
+				if (method_all_index >= SIZEOF_ARRAY(matrix_methods))
+					method_all_index = 1;
+			} while (matrix_methods[method_all_index].func[0] == stress_matrix_gemm_mt);
 		}
 	} while (stress_continue(args));
 
@@ -968,6 +1398,34 @@ static inline int stress_matrix_exercise(
 			j++;
 		}
 	}
+	/* GFLOP/s for the r += a * b product methods */
+	for (i = 1; i < num_matrix_methods; i++) {
+		if (matrix_methods[i].gemm && (matrix_metrics[i].duration > 0.0)) {
+			char msg[64];
+			const double dn = (double)n;
+			const double gflops = (2.0 * dn * dn * dn * matrix_metrics[i].count) /
+						(matrix_metrics[i].duration * 1.0E9);
+			double peak = peak_gflops;
+
+			(void)snprintf(msg, sizeof(msg), "%s GFLOP per sec", matrix_methods[i].name);
+			stress_metrics_set(args, j, msg,
+				gflops, STRESS_METRIC_HARMONIC_MEAN);
+			j++;
+
+			if (matrix_methods[i].func[0] == stress_matrix_gemm_mt) {
+				const int32_t cpus = stress_get_processors_online();
+
+				peak *= (double)(((cpus > 0) && ((size_t)cpus < matrix_threads)) ?
+						(size_t)cpus : matrix_threads);
+			}
+			if (peak > 0.0) {
+				(void)snprintf(msg, sizeof(msg), "%s %% of estimated peak", matrix_methods[i].name);
+				stress_metrics_set(args, j, msg,
+					100.0 * gflops / peak, STRESS_METRIC_GEOMETRIC_MEAN);
+				j++;
+			}
+		}
+	}
 
 
 	if (verify)
@@ -978,6 +1436,8 @@ tidy_b:
 	(void)munmap((void *)b, matrix_mmap_size);
 tidy_a:
 	(void)munmap((void *)a, matrix_mmap_size);
+tidy_pack:
+	(void)munmap((void *)matrix_gemm_pack, pack_mmap_size);
 tidy_ret:
 	return ret;
 }
@@ -997,10 +1457,21 @@ static int stress_matrix(stress_args_t *args)
 
 	(void)stress_get_setting("matrix-method", &matrix_method);
 	(void)stress_get_setting("matrix-yx", &matrix_yx);
+	if (!stress_get_setting("matrix-threads", &matrix_threads) || (matrix_threads == 0)) {
+		const int32_t cpus = stress_get_processors_online();
+		const size_t instances = (args->instances > 0) ? (size_t)args->instances : 1;
+
+		matrix_threads = (cpus > 0) ? (size_t)cpus / instances : 1;
+	}
+	if (matrix_threads < 1)
+		matrix_threads = 1;
+	if (matrix_threads > MAX_MATRIX_THREADS)
+		matrix_threads = MAX_MATRIX_THREADS;
 
 	if (stress_instance_zero(args))
-		pr_dbg("%s: using method '%s' (%s)\n", args->name, matrix_methods[matrix_method].name,
-			matrix_yx ? "y by x" : "x by y");
+		pr_dbg("%s: using method '%s' (%s), %zu gemm-mt thread%s\n", args->name,
+			matrix_methods[matrix_method].name, matrix_yx ? "y by x" : "x by y",
+			matrix_threads, (matrix_threads == 1) ? "" : "s");
 
 	if (!stress_get_setting("matrix-size", &matrix_size)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -1028,6 +1499,7 @@ static const char *stress_matrix_method(const size_t i)
 static const stress_opt_t opts[] = {
 	{ OPT_matrix_method, "matrix-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_matrix_method },
 	{ OPT_matrix_size,   "matrix-size",   TYPE_ID_SIZE_T, MIN_MATRIX_SIZE, MAX_MATRIX_SIZE, NULL },
+	{ OPT_matrix_threads, "matrix-threads", TYPE_ID_SIZE_T, MIN_MATRIX_THREADS, MAX_MATRIX_THREADS, NULL },
 	{ OPT_matrix_yx,     "matrix-yx",     TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
@@ -1045,6 +1517,7 @@ const stressor_info_t stress_matrix_info = {
 static const stress_opt_t opts[] = {
 	{ OPT_matrix_method, "matrix-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_unimplemented_method },
 	{ OPT_matrix_size,   "matrix-size",   TYPE_ID_SIZE_T, MIN_MATRIX_SIZE, MAX_MATRIX_SIZE, NULL },
+	{ OPT_matrix_threads, "matrix-threads", TYPE_ID_SIZE_T, MIN_MATRIX_THREADS, MAX_MATRIX_THREADS, NULL },
 	{ OPT_matrix_yx,     "matrix-yx",     TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
@@ -18,19 +18,29 @@
  *
  */
 #include "stress-ng.h"
+#include "core-asm-x86.h"
 #include "core-builtin.h"
+#include "core-cpu.h"
 #include "core-mmap.h"
+#include "core-nt-store.h"
 #include "core-target-clones.h"
+#include "core-vecmath.h"
 
 #define ALIGN_SIZE	(64)
 #define MEMCPY_MEMSIZE	(2048)
 #define MEMCPY_LOOPS	(1024)
 
+#define MEMCPY_SWEEP_MIN	(8)		/* smallest sweep copy size */
+#define MEMCPY_SWEEP_MAX	(64 * MB)	/* largest sweep copy size */
+#define MEMCPY_SWEEP_SIZES	(24)		/* powers of 2, 8 B to 64 MB */
+#define MEMCPY_SWEEP_LIMIT	(64 * KB)	/* smallest largest sweep size */
+#define MEMCPY_SWEEP_TIME	(0.002)		/* min seconds per size */
 
 static const stress_help_t help[] = {
 	{ NULL,	"memcpy N",	   "start N workers performing memory copies" },
-	{ NULL,	"memcpy-method M", "set memcpy method (M = all, libc, builtin, naive..)" },
+	{ NULL,	"memcpy-method M", "set memcpy method (M = all, libc, builtin, naive.., vec128.., rep_movsb, nt)" },
 	{ NULL,	"memcpy-ops N",	   "stop after N memcpy bogo operations" },
+	{ NULL,	"memcpy-sweep",	   "measure copy rates for sizes from 8 bytes to 64 MB" },
 	{ NULL,	NULL,		   NULL }
 };
 
@@ -39,14 +49,15 @@ static char *s_method_name = "";
 
 typedef void (*stress_memcpy_func)(uint8_t *str1, uint8_t *str2, uint8_t *str3);
 
+typedef void * (*memcpy_func_t)(void *dest, const void *src, size_t n);
+typedef void * (*memmove_func_t)(void *dest, const void *src, size_t n);
+
 typedef struct {
 	const char *name;
 	const stress_memcpy_func func;
+	const memcpy_func_t cpy;	/* copy function used by the size sweep */
 } stress_memcpy_method_info_t;
 
-typedef void * (*memcpy_func_t)(void *dest, const void *src, size_t n);
-typedef void * (*memmove_func_t)(void *dest, const void *src, size_t n);
-
 typedef void * (*memcpy_check_func_t)(memcpy_func_t func, void *dest, const void *src, size_t n);
 typedef void * (*memmove_check_func_t)(memmove_func_t func, void *dest, const void *src, size_t n);
 
@@ -138,6 +149,219 @@ TEST_NAIVE_MEMMOVE(test_naive_memmove_o1, NOINLINE OPTIMIZE1)
 TEST_NAIVE_MEMMOVE(test_naive_memmove_o2, NOINLINE OPTIMIZE2)
 TEST_NAIVE_MEMMOVE(test_naive_memmove_o3, NOINLINE OPTIMIZE3)
 
+#if defined(HAVE_VECMATH)
+/*
+ *  Unaligned vector types, the compiler maps these onto the SIMD
+ *  loads and stores of each target clone, e.g. SSE2, AVX2 and
+ *  AVX-512 on x86 and NEON on ARM
+ */
+typedef uint8_t stress_vuint8w128_t __attribute__ ((vector_size(128 / 8), aligned(1), may_alias));
+typedef uint8_t stress_vuint8w256_t __attribute__ ((vector_size(256 / 8), aligned(1), may_alias));
+typedef uint8_t stress_vuint8w512_t __attribute__ ((vector_size(512 / 8), aligned(1), may_alias));
+
+/*
+ *  Copy 4 vectors per loop, all 4 are loaded before they are
+ *  stored so the forward copy is also safe for memmove when
+ *  dest is below src
+ */
+#define TEST_VEC_MEMCPY(name, vtype)					\
+static NOINLINE TARGET_CLONES void *name(void *dest, const void *src, size_t n)\
+{									\
+	register uint8_t *cdest = (uint8_t *)dest;			\
+	register const uint8_t *csrc = (const uint8_t *)src;		\
+									\
+	for (; n >= 4 * sizeof(vtype); n -= 4 * sizeof(vtype)) {	\
+		const vtype v0 = *(const vtype *)(csrc + 0 * sizeof(vtype));\
+		const vtype v1 = *(const vtype *)(csrc + 1 * sizeof(vtype));\
+		const vtype v2 = *(const vtype *)(csrc + 2 * sizeof(vtype));\
+		const vtype v3 = *(const vtype *)(csrc + 3 * sizeof(vtype));\
+									\
+		*(vtype *)(cdest + 0 * sizeof(vtype)) = v0;		\
+		*(vtype *)(cdest + 1 * sizeof(vtype)) = v1;		\
+		*(vtype *)(cdest + 2 * sizeof(vtype)) = v2;		\
+		*(vtype *)(cdest + 3 * sizeof(vtype)) = v3;		\
+		csrc += 4 * sizeof(vtype);				\
+		cdest += 4 * sizeof(vtype);				\
+	}								\
+	for (; n >= sizeof(vtype); n -= sizeof(vtype)) {		\
+		*(vtype *)cdest = *(const vtype *)csrc;			\
+		csrc += sizeof(vtype);					\
+		cdest += sizeof(vtype);					\
+	}								\
+	while (n--)							\
+		*(cdest++) = *(csrc++);					\
+	return dest;							\
+}
+
+#define TEST_VEC_MEMMOVE(name, vtype, cpy)				\
+static NOINLINE TARGET_CLONES void *name(void *dest, const void *src, size_t n)\
+{									\
+	register uint8_t *cdest;					\
+	register const uint8_t *csrc;					\
+									\
+	if ((uintptr_t)dest <= (uintptr_t)src)				\
+		return cpy(dest, src, n);				\
+									\
+	cdest = (uint8_t *)dest + n;					\
+	csrc = (const uint8_t *)src + n;				\
+	for (; n >= 4 * sizeof(vtype); n -= 4 * sizeof(vtype)) {	\
+		vtype v0, v1, v2, v3;					\
+									\
+		csrc -= 4 * sizeof(vtype);				\
+		cdest -= 4 * sizeof(vtype);				\
+		v0 = *(const vtype *)(csrc + 0 * sizeof(vtype));	\
+		v1 = *(const vtype *)(csrc + 1 * sizeof(vtype));	\
+		v2 = *(const vtype *)(csrc + 2 * sizeof(vtype));	\
+		v3 = *(const vtype *)(csrc + 3 * sizeof(vtype));	\
+		*(vtype *)(cdest + 3 * sizeof(vtype)) = v3;		\
+		*(vtype *)(cdest + 2 * sizeof(vtype)) = v2;		\
+		*(vtype *)(cdest + 1 * sizeof(vtype)) = v1;		\
+		*(vtype *)(cdest + 0 * sizeof(vtype)) = v0;		\
+	}								\
+	for (; n >= sizeof(vtype); n -= sizeof(vtype)) {		\
+		csrc -= sizeof(vtype);					\
+		cdest -= sizeof(vtype);					\
+		*(vtype *)cdest = *(const vtype *)csrc;			\
+	}								\
+	while (n--)							\
+		*(--cdest) = *(--csrc);					\
+	return dest;							\
+}
+
+TEST_VEC_MEMCPY(test_vec128_memcpy, stress_vuint8w128_t)
+TEST_VEC_MEMCPY(test_vec256_memcpy, stress_vuint8w256_t)
+TEST_VEC_MEMCPY(test_vec512_memcpy, stress_vuint8w512_t)
+
+TEST_VEC_MEMMOVE(test_vec128_memmove, stress_vuint8w128_t, test_vec128_memcpy)
+TEST_VEC_MEMMOVE(test_vec256_memmove, stress_vuint8w256_t, test_vec256_memcpy)
+TEST_VEC_MEMMOVE(test_vec512_memmove, stress_vuint8w512_t, test_vec512_memcpy)
+#endif
+
+#if defined(HAVE_ASM_X86_REP_MOVSB) &&	\
+    defined(STRESS_ARCH_X86_64) &&	\
+    !defined(__ILP32__)
+/*
+ *  rep movsb, fast on CPUs with ERMS (enhanced rep movsb) and
+ *  for short copies on CPUs with FSRM (fast short rep mov)
+ */
+static NOINLINE void *test_rep_movsb_memcpy(void *dest, const void *src, size_t n)
+{
+	register void *d = dest;
+	register const void *s = src;
+
+	__asm__ __volatile__(
+		"rep movsb\n"
+		: "+D" (d), "+S" (s), "+c" (n)
+		:
+		: "memory");
+	return dest;
+}
+
+static NOINLINE void *test_rep_movsb_memmove(void *dest, const void *src, size_t n)
+{
+	register void *d;
+	register const void *s;
+
+	if (((uintptr_t)dest <= (uintptr_t)src) ||
+	    ((uintptr_t)dest >= (uintptr_t)src + n))
+		return test_rep_movsb_memcpy(dest, src, n);
+
+	/* overlapping with dest above src, copy backwards */
+	d = (uint8_t *)dest + n - 1;
+	s = (const uint8_t *)src + n - 1;
+	__asm__ __volatile__(
+		"std\n"
+		"rep movsb\n"
+		"cld\n"
+		: "+D" (d), "+S" (s), "+c" (n)
+		:
+		: "memory");
+	return dest;
+}
+#define HAVE_MEMCPY_REP_MOVSB
+#endif
+
+#if defined(HAVE_NT_STORE128)
+typedef __uint128_t stress_uint128u_t __attribute__ ((aligned(1), may_alias));
+
+/*
+ *  stress_memcpy_nt_fence()
+ *	order the weakly ordered non-temporal stores
+ */
+static inline void ALWAYS_INLINE stress_memcpy_nt_fence(void)
+{
+#if defined(HAVE_ASM_X86_SFENCE)
+	stress_asm_x86_sfence();
+#else
+	stress_asm_mb();
+#endif
+}
+
+/*
+ *  Non-temporal stores bypass the cache, the destination is
+ *  byte copied up to a 16 byte boundary so that all the 128 bit
+ *  stores are aligned
+ */
+static NOINLINE void *test_nt_memcpy(void *dest, const void *src, size_t n)
+{
+	register uint8_t *cdest = (uint8_t *)dest;
+	register const uint8_t *csrc = (const uint8_t *)src;
+
+	while (n && ((uintptr_t)cdest & (sizeof(__uint128_t) - 1))) {
+		*(cdest++) = *(csrc++);
+		n--;
+	}
+	for (; n >= 4 * sizeof(__uint128_t); n -= 4 * sizeof(__uint128_t)) {
+		const __uint128_t v0 = *(const stress_uint128u_t *)(csrc + 0 * sizeof(__uint128_t));
+		const __uint128_t v1 = *(const stress_uint128u_t *)(csrc + 1 * sizeof(__uint128_t));
+		const __uint128_t v2 = *(const stress_uint128u_t *)(csrc + 2 * sizeof(__uint128_t));
+		const __uint128_t v3 = *(const stress_uint128u_t *)(csrc + 3 * sizeof(__uint128_t));
+
+		stress_nt_store128((__uint128_t *)(cdest + 0 * sizeof(__uint128_t)), v0);
+		stress_nt_store128((__uint128_t *)(cdest + 1 * sizeof(__uint128_t)), v1);
+		stress_nt_store128((__uint128_t *)(cdest + 2 * sizeof(__uint128_t)), v2);
+		stress_nt_store128((__uint128_t *)(cdest + 3 * sizeof(__uint128_t)), v3);
+		csrc += 4 * sizeof(__uint128_t);
+		cdest += 4 * sizeof(__uint128_t);
+	}
+	for (; n >= sizeof(__uint128_t); n -= sizeof(__uint128_t)) {
+		stress_nt_store128((__uint128_t *)cdest, *(const stress_uint128u_t *)csrc);
+		csrc += sizeof(__uint128_t);
+		cdest += sizeof(__uint128_t);
+	}
+	while (n--)
+		*(cdest++) = *(csrc++);
+	stress_memcpy_nt_fence();
+	return dest;
+}
+
+static NOINLINE void *test_nt_memmove(void *dest, const void *src, size_t n)
+{
+	register uint8_t *cdest;
+	register const uint8_t *csrc;
+
+	if ((uintptr_t)dest <= (uintptr_t)src)
+		return test_nt_memcpy(dest, src, n);
+
+	cdest = (uint8_t *)dest + n;
+	csrc = (const uint8_t *)src + n;
+	while (n && ((uintptr_t)cdest & (sizeof(__uint128_t) - 1))) {
+		*(--cdest) = *(--csrc);
+		n--;
+	}
+	for (; n >= sizeof(__uint128_t); n -= sizeof(__uint128_t)) {
+		csrc -= sizeof(__uint128_t);
+		cdest -= sizeof(__uint128_t);
+		stress_nt_store128((__uint128_t *)cdest, *(const stress_uint128u_t *)csrc);
+	}
+	while (n--)
+		*(--cdest) = *(--csrc);
+	stress_memcpy_nt_fence();
+	return dest;
+}
+#define HAVE_MEMCPY_NT
+#endif
+
 static NOINLINE void stress_memcpy_libc(
 	uint8_t *str1,
 	uint8_t *str2,
@@ -241,57 +465,273 @@ STRESS_MEMCPY_NAIVE("naive_o0", stress_memcpy_naive_o0, test_naive_memcpy_o0, te
 STRESS_MEMCPY_NAIVE("naive_o1", stress_memcpy_naive_o1, test_naive_memcpy_o1, test_naive_memmove_o1)
 STRESS_MEMCPY_NAIVE("naive_o2", stress_memcpy_naive_o2, test_naive_memcpy_o2, test_naive_memmove_o2)
 STRESS_MEMCPY_NAIVE("naive_o3", stress_memcpy_naive_o3, test_naive_memcpy_o3, test_naive_memmove_o3)
+#if defined(HAVE_VECMATH)
+STRESS_MEMCPY_NAIVE("vec128", stress_memcpy_vec128, test_vec128_memcpy, test_vec128_memmove)
+STRESS_MEMCPY_NAIVE("vec256", stress_memcpy_vec256, test_vec256_memcpy, test_vec256_memmove)
+STRESS_MEMCPY_NAIVE("vec512", stress_memcpy_vec512, test_vec512_memcpy, test_vec512_memmove)
+#endif
+#if defined(HAVE_MEMCPY_REP_MOVSB)
+STRESS_MEMCPY_NAIVE("rep_movsb", stress_memcpy_rep_movsb, test_rep_movsb_memcpy, test_rep_movsb_memmove)
+#endif
+#if defined(HAVE_MEMCPY_NT)
+STRESS_MEMCPY_NAIVE("nt", stress_memcpy_nt, test_nt_memcpy, test_nt_memmove)
+#endif
+
+static const stress_memcpy_func stress_memcpy_all_funcs[] = {
+	stress_memcpy_libc,
+	stress_memcpy_builtin,
+	stress_memcpy_naive,
+	stress_memcpy_naive_o0,
+	stress_memcpy_naive_o1,
+	stress_memcpy_naive_o2,
+	stress_memcpy_naive_o3,
+#if defined(HAVE_VECMATH)
+	stress_memcpy_vec128,
+	stress_memcpy_vec256,
+	stress_memcpy_vec512,
+#endif
+#if defined(HAVE_MEMCPY_REP_MOVSB)
+	stress_memcpy_rep_movsb,
+#endif
+#if defined(HAVE_MEMCPY_NT)
+	stress_memcpy_nt,
+#endif
+};
 
 static NOINLINE void stress_memcpy_all(
 	uint8_t *str1,
 	uint8_t *str2,
 	uint8_t *str3)
 {
-	static int whence;
-
-	switch (whence) {
-	case 0:
-		whence++;
-		stress_memcpy_libc(str1, str2, str3);
-		return;
-	case 1:
-		whence++;
-		stress_memcpy_builtin(str1, str2, str3);
-		return;
-	case 2:
-		whence++;
-		stress_memcpy_naive(str1, str2, str3);
-		return;
-	case 3:
-		whence++;
-		stress_memcpy_naive_o0(str1, str2, str3);
-		return;
-	case 4:
-		whence++;
-		stress_memcpy_naive_o1(str1, str2, str3);
-		return;
-	case 5:
-		whence++;
-		stress_memcpy_naive_o2(str1, str2, str3);
-		return;
-	default:
-		stress_memcpy_naive_o3(str1, str2, str3);
+	static size_t whence;
+
+	stress_memcpy_all_funcs[whence](str1, str2, str3);
+	whence++;
+	if (whence >= SIZEOF_ARRAY(stress_memcpy_all_funcs))
 		whence = 0;
-		return;
-	}
 }
 
 static const stress_memcpy_method_info_t stress_memcpy_methods[] = {
-	{ "all",	stress_memcpy_all },
-	{ "libc",	stress_memcpy_libc },
-	{ "builtin",	stress_memcpy_builtin },
-	{ "naive",      stress_memcpy_naive },
-	{ "naive_o0",	stress_memcpy_naive_o0 },
-	{ "naive_o1",	stress_memcpy_naive_o1 },
-	{ "naive_o2",	stress_memcpy_naive_o2 },
-	{ "naive_o3",	stress_memcpy_naive_o3 },
+	{ "all",	stress_memcpy_all,	NULL },
+	{ "libc",	stress_memcpy_libc,	memcpy },
+#if defined(HAVE_BUILTIN_MEMCPY) &&	\
+    defined(HAVE_BUILTIN_MEMMOVE)
+	{ "builtin",	stress_memcpy_builtin,	stress_builtin_memcpy_wrapper },
+#else
+	{ "builtin",	stress_memcpy_builtin,	memcpy },
+#endif
+	{ "naive",      stress_memcpy_naive,	test_naive_memcpy },
+	{ "naive_o0",	stress_memcpy_naive_o0,	test_naive_memcpy_o0 },
+	{ "naive_o1",	stress_memcpy_naive_o1,	test_naive_memcpy_o1 },
+	{ "naive_o2",	stress_memcpy_naive_o2,	test_naive_memcpy_o2 },
+	{ "naive_o3",	stress_memcpy_naive_o3,	test_naive_memcpy_o3 },
+#if defined(HAVE_VECMATH)
+	{ "vec128",	stress_memcpy_vec128,	test_vec128_memcpy },
+	{ "vec256",	stress_memcpy_vec256,	test_vec256_memcpy },
+	{ "vec512",	stress_memcpy_vec512,	test_vec512_memcpy },
+#endif
+#if defined(HAVE_MEMCPY_REP_MOVSB)
+	{ "rep_movsb",	stress_memcpy_rep_movsb, test_rep_movsb_memcpy },
+#endif
+#if defined(HAVE_MEMCPY_NT)
+	{ "nt",		stress_memcpy_nt,	test_nt_memcpy },
+#endif
 };
 
+#define MEMCPY_METHODS	(SIZEOF_ARRAY(stress_memcpy_methods))
+
+/*
+ *  stress_memcpy_sweep_rate()
+ *	copy size bytes from src to dst repeatedly for at least
+ *	MEMCPY_SWEEP_TIME seconds, returns the copy rate in GB/sec
+ */
+static double stress_memcpy_sweep_rate(
+	const memcpy_func_t cpy,
+	uint8_t *dst,
+	const uint8_t *src,
+	const size_t size)
+{
+	uint64_t i, n = 1, loops = 0;
+	double t;
+	const double t_start = stress_time_now();
+
+	do {
+		for (i = 0; i < n; i++)
+			(void)cpy(dst, src, size);
+		loops += n;
+		n += n;
+		t = stress_time_now() - t_start;
+	} while ((t < MEMCPY_SWEEP_TIME) && stress_continue_flag());
+
+	return (t > 0.0) ? ((double)size * (double)loops) / (t * (double)GB) : 0.0;
+}
+
+/*
+ *  stress_memcpy_sweep_report()
+ *	report the best copy rates per size and method, instance 0
+ *	prints the rates as a table
+ */
+static void stress_memcpy_sweep_report(
+	stress_args_t *args,
+	const double *rates,
+	const size_t first,
+	const size_t last,
+	const size_t n_sizes)
+{
+	char line[(MEMCPY_METHODS + 2) * 12];
+	char description[64];
+	char str[32];
+	size_t i, j, idx = 0;
+	const bool all = (first != last);
+	const bool report = stress_instance_zero(args);
+
+	if (report) {
+#if defined(HAVE_MEMCPY_REP_MOVSB)
+		pr_inf("%s: rep movsb: erms %s, fsrm %s\n", args->name,
+			stress_cpu_x86_has_erms() ? "yes" : "no",
+			stress_cpu_x86_has_fsrm() ? "yes" : "no");
+#endif
+		pr_inf("%s: copy rates in GB per sec:\n", args->name);
+		(void)snprintf(line, sizeof(line), "%8s", "size");
+		for (j = first; j <= last; j++) {
+			const size_t len = strlen(line);
+
+			(void)snprintf(line + len, sizeof(line) - len, " %9s",
+				stress_memcpy_methods[j].name);
+		}
+		if (all) {
+			const size_t len = strlen(line);
+
+			(void)snprintf(line + len, sizeof(line) - len, " %9s", "best");
+		}
+		pr_inf("%s: %s\n", args->name, line);
+	}
+
+	for (i = 0; i < n_sizes; i++) {
+		const size_t size = (size_t)MEMCPY_SWEEP_MIN << i;
+		const double *row = rates + (i * MEMCPY_METHODS);
+		size_t best = first;
+
+		for (j = first; j <= last; j++) {
+			if (row[j] > row[best])
+				best = j;
+		}
+		/* sizes not reached before the run ended */
+		if (row[best] <= 0.0)
+			break;
+
+		(void)stress_uint64_to_str(str, sizeof(str), (uint64_t)size, 1, true);
+		if (report) {
+			(void)snprintf(line, sizeof(line), "%8s", str);
+			for (j = first; j <= last; j++) {
+				const size_t len = strlen(line);
+
+				(void)snprintf(line + len, sizeof(line) - len, " %9.2f", row[j]);
+			}
+			if (all) {
+				const size_t len = strlen(line);
+
+				(void)snprintf(line + len, sizeof(line) - len, " %9s",
+					stress_memcpy_methods[best].name);
+			}
+			pr_inf("%s: %s\n", args->name, line);
+		}
+		(void)snprintf(description, sizeof(description), "GB per sec %scopying %s",
+			all ? "best " : "", str);
+		stress_metrics_set(args, idx++, description,
+			row[best], STRESS_METRIC_HARMONIC_MEAN);
+	}
+}
+
+/*
+ *  stress_memcpy_sweep()
+ *	measure the copy rate of each method, or just the selected
+ *	method, over power of 2 sizes from 8 bytes to 64 MB
+ */
+static int stress_memcpy_sweep(stress_args_t *args, const size_t memcpy_method)
+{
+	const size_t first = memcpy_method ? memcpy_method : 1;
+	const size_t last = memcpy_method ? memcpy_method : MEMCPY_METHODS - 1;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t sweep_max = MEMCPY_SWEEP_MAX, n_sizes = 0, i, j;
+	size_t shmall, freemem, totalmem, freeswap, totalswap;
+	uint8_t *buf, *src, *dst;
+	double *rates;
+	int rc = EXIT_SUCCESS;
+
+	/* two buffers per instance, keep to half the free memory */
+	stress_get_memlimits(&shmall, &freemem, &totalmem, &freeswap, &totalswap);
+	if (freemem) {
+		const size_t limit = freemem / (4 * (size_t)args->instances);
+
+		while ((sweep_max > limit) && (sweep_max > MEMCPY_SWEEP_LIMIT))
+			sweep_max >>= 1;
+	}
+	while ((n_sizes < MEMCPY_SWEEP_SIZES) &&
+	       (((size_t)MEMCPY_SWEEP_MIN << n_sizes) <= sweep_max))
+		n_sizes++;
+
+	rates = (double *)calloc(MEMCPY_SWEEP_SIZES * MEMCPY_METHODS, sizeof(*rates));
+	if (!rates) {
+		pr_inf_skip("%s: cannot allocate sweep rates table%s, skipping stressor\n",
+			args->name, stress_get_memfree_str());
+		return EXIT_NO_RESOURCE;
+	}
+	buf = (uint8_t *)stress_mmap_populate(NULL, 2 * sweep_max,
+				PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: mmap of %zu bytes failed%s, errno=%d (%s), "
+			"skipping stressor\n",
+			args->name, 2 * sweep_max,
+			stress_get_memfree_str(), errno, strerror(errno));
+		free(rates);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, 2 * sweep_max, "memcpy-sweep");
+	src = buf;
+	dst = buf + sweep_max;
+	stress_rndbuf(src, sweep_max);
+	(void)shim_memset(dst, 0, sweep_max);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		for (i = 0; (i < n_sizes) && stress_continue(args); i++) {
+			const size_t size = (size_t)MEMCPY_SWEEP_MIN << i;
+			double *row = rates + (i * MEMCPY_METHODS);
+
+			for (j = first; j <= last; j++) {
+				double rate;
+
+				if (verify)
+					(void)shim_memset(dst, 0, size);
+				rate = stress_memcpy_sweep_rate(stress_memcpy_methods[j].cpy, dst, src, size);
+				if (verify && shim_memcmp(dst, src, size)) {
+					pr_fail("%s: %s: memcpy of %zu bytes content is different than expected\n",
+						args->name, stress_memcpy_methods[j].name, size);
+					rc = EXIT_FAILURE;
+					goto done;
+				}
+				if (rate > row[j])
+					row[j] = rate;
+			}
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+done:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_memcpy_sweep_report(args, rates, first, last, n_sizes);
+
+	(void)munmap((void *)buf, 2 * sweep_max);
+	free(rates);
+
+	return rc;
+}
+
 /*
  *  stress_memcpy()
  *	stress memory copies
@@ -300,8 +740,15 @@ static int stress_memcpy(stress_args_t *args)
 {
 	uint8_t *buf, *str1, *str2, *str3;
 	size_t memcpy_method = 0;
+	bool memcpy_sweep = false;
 	stress_memcpy_func func;
 
+	s_args_name = args->name;
+	(void)stress_get_setting("memcpy-method", &memcpy_method);
+	(void)stress_get_setting("memcpy-sweep", &memcpy_sweep);
+	if (memcpy_sweep)
+		return stress_memcpy_sweep(args, memcpy_method);
+
 	memcpy_okay = true;
 	buf = (uint8_t *)stress_mmap_populate(NULL, 3 * MEMCPY_MEMSIZE,
 				PROT_READ | PROT_WRITE,
@@ -318,8 +765,6 @@ static int stress_memcpy(stress_args_t *args)
 	str2 = str1 + MEMCPY_MEMSIZE;
 	str3 = str2 + MEMCPY_MEMSIZE;
 
-	s_args_name = args->name;
-
 	if (g_opt_flags & OPT_FLAGS_VERIFY) {
 		memcpy_check = memcpy_check_func;
 		memmove_check = memmove_check_func;
@@ -328,7 +773,6 @@ static int stress_memcpy(stress_args_t *args)
 		memmove_check = memmove_no_check_func;
 	}
 
-	(void)stress_get_setting("memcpy-method", &memcpy_method);
 	func = stress_memcpy_methods[memcpy_method].func;
 	stress_rndbuf(str3, ALIGN_SIZE);
 
@@ -355,6 +799,7 @@ static const char *stress_memcpy_method(const size_t i)
 
 static const stress_opt_t opts[] = {
 	{ OPT_memcpy_method, "memcpy-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_memcpy_method },
+	{ OPT_memcpy_sweep,  "memcpy-sweep",  TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -25,6 +25,8 @@
 #include "core-mmap.h"
 #include "core-nt-store.h"
 #include "core-out-of-memory.h"
+#include "core-pthread.h"
+#include "core-put.h"
 #include "core-target-clones.h"
 #include "core-vecmath.h"
 
@@ -41,10 +43,18 @@
 
 #define STRESS_PTR_MINIMUM(a, b)	STRESS_MINIMUM((uintptr_t)a, (uintptr_t)b)
 
+#define LOADED_STEPS		(12)		/* idle, 10%..100% of peak, unthrottled */
+#define LOADED_STEP_TIME	(0.5)		/* seconds per step */
+#define LOADED_SETTLE_NS	(50000000ULL)	/* traffic settle time per step */
+#define LOADED_WINDOW		(1 * MB)	/* traffic rate control window */
+#define LOADED_PROBE_MIN	(64 * MB)	/* minimum probe chain size */
+#define LOADED_PROBE_LOADS	(1024)		/* probe loads between timer reads */
+
 static const stress_help_t help[] = {
 	{ NULL,	"memrate N",		"start N workers exercised memory read/writes" },
 	{ NULL,	"memrate-bytes N",	"size of memory buffer being exercised" },
 	{ NULL,	"memrate-flush",	"flush cache before each iteration" },
+	{ NULL,	"memrate-loaded-latency","measure memory latency as background traffic rises" },
 	{ NULL, "memrate-method M",	"specify read/write memory exercising method" },
 	{ NULL,	"memrate-ops N",	"stop after N memrate bogo operations" },
 	{ NULL,	"memrate-rd-mbs N",	"read rate from buffer in megabytes per second" },
@@ -70,8 +80,18 @@ typedef struct {
 	bool		valid;
 } stress_memrate_stats_t;
 
+/* Loaded latency step results, shared with the parent */
+typedef struct {
+	double target_mbs;	/* requested traffic rate, 0 idle, < 0 unthrottled */
+	double kbytes;		/* traffic kbytes */
+	double duration;	/* traffic duration */
+	double loads;		/* probe loads */
+	double probe_time;	/* probe duration */
+} stress_memrate_loaded_t;
+
 typedef struct {
 	stress_memrate_stats_t *stats;
+	stress_memrate_loaded_t *loaded;
 	uint64_t memrate_bytes;
 	uint64_t memrate_rd_mbs;
 	uint64_t memrate_wr_mbs;
@@ -79,6 +99,7 @@ typedef struct {
 	void *start;
 	void *end;
 	bool memrate_flush;
+	bool memrate_loaded_latency;
 } stress_memrate_context_t;
 
 typedef uint64_t (*stress_memrate_func_t)(const stress_memrate_context_t *context, bool *valid);
@@ -1007,6 +1028,360 @@ static void stress_memrate_dispatch_method(
 	context->stats[method].valid = valid;
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+/* Background traffic thread of the loaded latency mode */
+typedef struct {
+	pthread_t pthread;		/* pthread handle */
+	int ret;			/* pthread create return value */
+	const stress_memrate_info_t *info; /* traffic method */
+	uint8_t *start;			/* start of thread's buffer slice */
+	uint8_t *end;			/* end of thread's buffer slice */
+	volatile uint64_t mbs;		/* rate, 0 idle, ~0ULL unthrottled */
+	volatile uint64_t kbytes;	/* traffic generated */
+} stress_memrate_loaded_thread_t;
+
+static volatile bool loaded_stop;
+
+/*
+ *  stress_memrate_loaded_thread()
+ *	generate traffic over the thread's slice of the buffer in
+ *	LOADED_WINDOW chunks at the rate requested by the probe
+ */
+static void *stress_memrate_loaded_thread(void *arg)
+{
+	stress_memrate_loaded_thread_t *thread = (stress_memrate_loaded_thread_t *)arg;
+	stress_memrate_context_t context;
+	uint8_t *ptr = thread->start;
+	sigset_t set;
+
+	/* Block all signals, let the probe thread handle these */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+	(void)shim_memset(&context, 0, sizeof(context));
+	context.memrate_bytes = LOADED_WINDOW;
+
+	while (!loaded_stop) {
+		const uint64_t mbs = thread->mbs;
+		bool valid;
+
+		if (!mbs) {
+			(void)shim_nanosleep_uint64(1000000ULL);
+			continue;
+		}
+		context.start = (void *)ptr;
+		context.end = (void *)(ptr + LOADED_WINDOW);
+		context.memrate_rd_mbs = mbs;
+		context.memrate_wr_mbs = mbs;
+		if (mbs == ~0ULL)
+			thread->kbytes += thread->info->func(&context, &valid);
+		else
+			thread->kbytes += thread->info->func_rate(&context, &valid);
+		ptr += LOADED_WINDOW;
+		if (ptr >= thread->end)
+			ptr = thread->start;
+	}
+	return &g_nowt;
+}
+
+/*
+ *  stress_memrate_loaded_chain()
+ *	link the cache lines of the probe buffer into a random
+ *	single cycle using Sattolo's algorithm
+ */
+static void *stress_memrate_loaded_chain(
+	uint8_t *buf,
+	const size_t lines,
+	const size_t line_size)
+{
+	size_t i;
+
+	for (i = 0; i < lines; i++)
+		*(void **)(buf + (i * line_size)) = (void *)(buf + (i * line_size));
+
+	for (i = lines - 1; i > 0; i--) {
+		const size_t j = (size_t)stress_mwc64modn((uint64_t)i);
+		void **pi = (void **)(buf + (i * line_size));
+		void **pj = (void **)(buf + (j * line_size));
+		void *tmp = *pi;
+
+		*pi = *pj;
+		*pj = tmp;
+	}
+	return (void *)buf;
+}
+
+/*
+ *  stress_memrate_loaded_probe()
+ *	follow n dependent loads, n must be a multiple of 8
+ */
+static void * OPTIMIZE3 stress_memrate_loaded_probe(void *ptr, const size_t n)
+{
+	register void **p = (void **)ptr;
+	register size_t i;
+
+	for (i = 0; i < n; i += 8) {
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+	}
+	return (void *)p;
+}
+
+/*
+ *  stress_memrate_loaded_set()
+ *	share a traffic rate out between the threads
+ */
+static void stress_memrate_loaded_set(
+	stress_memrate_loaded_thread_t *threads,
+	const size_t n_threads,
+	const double target_mbs)
+{
+	size_t i;
+	uint64_t mbs;
+
+	if (target_mbs < 0.0)
+		mbs = ~0ULL;
+	else if (target_mbs == 0.0)
+		mbs = 0;
+	else
+		mbs = STRESS_MAXIMUM((uint64_t)(target_mbs / (double)n_threads), 1ULL);
+
+	for (i = 0; i < n_threads; i++)
+		threads[i].mbs = mbs;
+}
+
+/*
+ *  stress_memrate_loaded_kbytes()
+ *	total traffic generated by the threads
+ */
+static uint64_t stress_memrate_loaded_kbytes(
+	const stress_memrate_loaded_thread_t *threads,
+	const size_t n_threads)
+{
+	size_t i;
+	uint64_t kbytes = 0;
+
+	for (i = 0; i < n_threads; i++)
+		kbytes += threads[i].kbytes;
+	return kbytes;
+}
+
+/*
+ *  stress_memrate_loaded_step()
+ *	set the traffic rate, let it settle and then chase the
+ *	probe chain for LOADED_STEP_TIME seconds, returns false
+ *	if the stressor was stopped
+ */
+static bool stress_memrate_loaded_step(
+	stress_args_t *args,
+	stress_memrate_loaded_thread_t *threads,
+	const size_t n_threads,
+	stress_memrate_loaded_t *loaded,
+	void **probe)
+{
+	uint64_t kbytes;
+	double t_start, t_end, loads = 0.0;
+	void *ptr = *probe;
+
+	stress_memrate_loaded_set(threads, n_threads, loaded->target_mbs);
+	(void)shim_nanosleep_uint64(LOADED_SETTLE_NS);
+
+	kbytes = stress_memrate_loaded_kbytes(threads, n_threads);
+	t_start = stress_time_now();
+	do {
+		ptr = stress_memrate_loaded_probe(ptr, LOADED_PROBE_LOADS);
+		loads += (double)LOADED_PROBE_LOADS;
+		t_end = stress_time_now();
+	} while (stress_continue(args) && (t_end - t_start < LOADED_STEP_TIME));
+	kbytes = stress_memrate_loaded_kbytes(threads, n_threads) - kbytes;
+	*probe = ptr;
+
+	if (t_end - t_start < LOADED_STEP_TIME)
+		return false;
+	loaded->kbytes += (double)kbytes;
+	loaded->duration += t_end - t_start;
+	loaded->loads += loads;
+	loaded->probe_time += t_end - t_start;
+	return true;
+}
+
+/*
+ *  stress_memrate_loaded_latency()
+ *	step background traffic from idle to saturation and measure
+ *	the memory latency with a dependent load chain at each step
+ */
+static int stress_memrate_loaded_latency(
+	stress_args_t *args,
+	stress_memrate_context_t *context,
+	uint8_t *buffer)
+{
+	stress_memrate_loaded_thread_t *threads;
+	stress_memrate_loaded_t peak;
+	const stress_memrate_info_t *info = NULL;
+	const int32_t cpus = stress_get_processors_online();
+	size_t i, n_threads, slice, probe_bytes, llc_size = 0, line_size = 0;
+	uint8_t *probe_buf;
+	void *probe;
+	int rc = EXIT_SUCCESS;
+
+	if (context->memrate_method) {
+		info = &memrate_info[context->memrate_method];
+	} else {
+		for (i = 1; i < memrate_items; i++) {
+			if (!strcmp(memrate_info[i].name, "read64")) {
+				info = &memrate_info[i];
+				break;
+			}
+		}
+	}
+	if (!info)
+		return EXIT_NO_RESOURCE;
+
+	/* one traffic thread per CPU, less one for the probe */
+	n_threads = (size_t)STRESS_MAXIMUM((cpus / (int32_t)args->instances) - 1, 1);
+	slice = (size_t)(context->memrate_bytes / n_threads) & ~(LOADED_WINDOW - 1);
+	if (slice < LOADED_WINDOW) {
+		n_threads = STRESS_MAXIMUM((size_t)(context->memrate_bytes / LOADED_WINDOW), 1);
+		slice = LOADED_WINDOW;
+	}
+	if (n_threads * slice > context->memrate_bytes) {
+		pr_inf_skip("%s: --memrate-bytes must be at least %zu bytes for "
+			"--memrate-loaded-latency, skipping stressor\n",
+			args->name, (size_t)LOADED_WINDOW);
+		return EXIT_NO_RESOURCE;
+	}
+
+	stress_cpu_cache_get_llc_size(&llc_size, &line_size);
+	line_size = (line_size >= sizeof(void *)) ? line_size : 64;
+	probe_bytes = STRESS_MAXIMUM((size_t)LOADED_PROBE_MIN, llc_size * 4);
+	probe_buf = (uint8_t *)stress_mmap_populate(NULL, probe_bytes,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (probe_buf == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu byte probe buffer%s, errno=%d (%s), "
+			"skipping stressor\n", args->name, probe_bytes,
+			stress_get_memfree_str(), errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(probe_buf, probe_bytes, "memrate-probe");
+	probe = stress_memrate_loaded_chain(probe_buf, probe_bytes / line_size, line_size);
+
+	threads = (stress_memrate_loaded_thread_t *)calloc(n_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: failed to allocate %zu threads%s, skipping stressor\n",
+			args->name, n_threads, stress_get_memfree_str());
+		(void)munmap((void *)probe_buf, probe_bytes);
+		return EXIT_NO_RESOURCE;
+	}
+
+	if (stress_instance_zero(args))
+		pr_inf("%s: %zu %s traffic threads, %zu byte latency probe chain\n",
+			args->name, n_threads, info->name, probe_bytes);
+
+	loaded_stop = false;
+	for (i = 0; i < n_threads; i++)
+		threads[i].ret = -1;
+	for (i = 0; i < n_threads; i++) {
+		threads[i].info = info;
+		threads[i].start = buffer + (i * slice);
+		threads[i].end = threads[i].start + slice;
+		threads[i].mbs = 0;
+		threads[i].kbytes = 0;
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+				stress_memrate_loaded_thread, (void *)&threads[i]);
+		if (threads[i].ret) {
+			pr_inf("%s: pthread create failed, errno=%d (%s)\n",
+				args->name, threads[i].ret, strerror(threads[i].ret));
+			rc = EXIT_NO_RESOURCE;
+			goto reap;
+		}
+	}
+
+	/* find the saturation rate to base the steps on */
+	(void)shim_memset(&peak, 0, sizeof(peak));
+	peak.target_mbs = -1.0;
+	if (!stress_memrate_loaded_step(args, threads, n_threads, &peak, &probe))
+		goto reap;
+	peak.target_mbs = (peak.kbytes / KB) / peak.duration;
+
+	for (i = 0; i < LOADED_STEPS; i++) {
+		if (i == LOADED_STEPS - 1)
+			context->loaded[i].target_mbs = -1.0;
+		else
+			context->loaded[i].target_mbs = (peak.target_mbs * (double)i) / (double)(LOADED_STEPS - 2);
+	}
+
+	do {
+		for (i = 0; i < LOADED_STEPS; i++) {
+			if (!stress_memrate_loaded_step(args, threads, n_threads, &context->loaded[i], &probe))
+				break;
+			stress_bogo_inc(args);
+		}
+	} while (stress_continue(args));
+
+reap:
+	loaded_stop = true;
+	for (i = 0; i < n_threads; i++) {
+		if (!threads[i].ret)
+			(void)pthread_join(threads[i].pthread, NULL);
+	}
+	stress_void_ptr_put(probe);
+	free(threads);
+	(void)munmap((void *)probe_buf, probe_bytes);
+
+	return rc;
+}
+
+/*
+ *  stress_memrate_loaded_report()
+ *	report the latency vs bandwidth curve
+ */
+static void stress_memrate_loaded_report(
+	stress_args_t *args,
+	const stress_memrate_loaded_t *loaded)
+{
+	size_t i, idx = 0;
+	const bool report = stress_instance_zero(args);
+
+	if (report)
+		pr_inf("%s: %-12s %12s %12s %12s\n", args->name,
+			"step", "target MB/s", "traffic MB/s", "latency ns");
+	for (i = 0; i < LOADED_STEPS; i++) {
+		const stress_memrate_loaded_t *l = &loaded[i];
+		char step[32], description[64];
+		double mbs, ns;
+
+		if ((l->duration <= 0.0) || (l->loads <= 0.0))
+			continue;
+		mbs = (l->kbytes / KB) / l->duration;
+		ns = (l->probe_time * STRESS_DBL_NANOSECOND) / l->loads;
+
+		if (i == 0)
+			(void)shim_strscpy(step, "idle", sizeof(step));
+		else if (i == LOADED_STEPS - 1)
+			(void)shim_strscpy(step, "unthrottled", sizeof(step));
+		else
+			(void)snprintf(step, sizeof(step), "%zu%% of peak", (i * 100) / (LOADED_STEPS - 2));
+
+		if (report) {
+			if (l->target_mbs < 0.0)
+				pr_inf("%s: %-12s %12s %12.1f %12.2f\n", args->name, step, "-", mbs, ns);
+			else
+				pr_inf("%s: %-12s %12.1f %12.1f %12.2f\n", args->name, step, l->target_mbs, mbs, ns);
+		}
+		(void)snprintf(description, sizeof(description), "MB per sec traffic at %s", step);
+		stress_metrics_set(args, idx++, description, mbs, STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(description, sizeof(description), "nanosec per load at %s", step);
+		stress_metrics_set(args, idx++, description, ns, STRESS_METRIC_HARMONIC_MEAN);
+	}
+}
+#endif
+
 static int stress_memrate_child(stress_args_t *args, void *ctxt)
 {
 	stress_memrate_context_t *context = (stress_memrate_context_t *)ctxt;
@@ -1026,6 +1401,15 @@ static int stress_memrate_child(stress_args_t *args, void *ctxt)
 	context->start = buffer;
 	context->end = buffer_end;
 
+#if defined(HAVE_LIB_PTHREAD)
+	if (context->memrate_loaded_latency) {
+		const int rc = stress_memrate_loaded_latency(args, context, (uint8_t *)buffer);
+
+		(void)munmap((void *)buffer, context->memrate_bytes);
+		return rc;
+	}
+#endif
+
 #if defined(HAVE_SIGLONGJMP)
 	if (sigsetjmp(jmpbuf, 1) != 0)
 		goto tidy;
@@ -1070,11 +1454,13 @@ static int stress_memrate(stress_args_t *args)
 	context.memrate_rd_mbs = ~0ULL;
 	context.memrate_wr_mbs = ~0ULL;
 	context.memrate_flush = false;
+	context.memrate_loaded_latency = false;
 	context.memrate_method = 0; 	/* all */
 	int flag;
 
 	(void)stress_get_setting("memrate-bytes", &context.memrate_bytes);
 	(void)stress_get_setting("memrate-flush", &context.memrate_flush);
+	(void)stress_get_setting("memrate-loaded-latency", &context.memrate_loaded_latency);
 	(void)stress_get_setting("memrate-rd-mbs", &context.memrate_rd_mbs);
 	(void)stress_get_setting("memrate-wr-mbs", &context.memrate_wr_mbs);
 	(void)stress_get_setting("memrate-method", &context.memrate_method);
@@ -1091,7 +1477,16 @@ static int stress_memrate(stress_args_t *args)
 		return EXIT_FAILURE;
 	}
 
-	stats_size = memrate_items * sizeof(*context.stats);
+#if !defined(HAVE_LIB_PTHREAD)
+	if (context.memrate_loaded_latency) {
+		if (stress_instance_zero(args))
+			pr_inf("%s: pthreads not supported, ignoring --memrate-loaded-latency\n", args->name);
+		context.memrate_loaded_latency = false;
+	}
+#endif
+
+	stats_size = (memrate_items * sizeof(*context.stats)) +
+		     (LOADED_STEPS * sizeof(*context.loaded));
 	stats_size = (stats_size + args->page_size - 1) & ~(args->page_size - 1);
 
 	context.stats = (stress_memrate_stats_t *)stress_mmap_populate(NULL, stats_size,
@@ -1108,6 +1503,8 @@ static int stress_memrate(stress_args_t *args)
 		context.stats[i].kbytes = 0.0;
 		context.stats[i].valid = false;
 	}
+	context.loaded = (stress_memrate_loaded_t *)&context.stats[memrate_items];
+	(void)shim_memset(context.loaded, 0, LOADED_STEPS * sizeof(*context.loaded));
 
 	context.memrate_bytes = (context.memrate_bytes + 1023) & ~(1023ULL);
 	if (stress_instance_zero(args)) {
@@ -1128,6 +1525,14 @@ static int stress_memrate(stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	pr_block_begin();
+#if defined(HAVE_LIB_PTHREAD)
+	if (context.memrate_loaded_latency) {
+		stress_memrate_loaded_report(args, context.loaded);
+		pr_block_end();
+		(void)munmap((void *)context.stats, stats_size);
+		return rc;
+	}
+#endif
 	for (i = 1; i < memrate_items; i++) {
 		if (!context.stats[i].valid)
 			continue;
@@ -1159,6 +1564,7 @@ static const char *stress_memmap_method(const size_t i)
 static const stress_opt_t opts[] = {
 	{ OPT_memrate_bytes,  "memrate-bytes",  TYPE_ID_UINT64_BYTES_VM, MIN_MEMRATE_BYTES, MAX_MEMRATE_BYTES, NULL },
 	{ OPT_memrate_flush,  "memrate-flush",  TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_memrate_loaded_latency, "memrate-loaded-latency", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_memrate_rd_mbs, "memrate-rd-mbs", TYPE_ID_UINT64, 0, 1000000, NULL },
 	{ OPT_memrate_wr_mbs, "memrate-wr-mbs", TYPE_ID_UINT64, 0, 1000000, NULL },
 	{ OPT_memrate_method, "memrate-method", TYPE_ID_SIZE_T_METHOD, 0, 0, stress_memmap_method },
@@ -19,6 +19,7 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-histogram.h"
 #include "core-pthread.h"
 
 #if defined(HAVE_PTHREAD_NP_H)
@@ -77,6 +78,7 @@ typedef struct {
 	int ret;
 	double lock_duration;
 	double lock_count;
+	stress_hist_t *lock_hist;	/* sampled lock latencies */
 } pthread_info_t;
 
 /*
@@ -127,8 +129,11 @@ static void OPTIMIZE3 *stress_mutex_exercise(void *arg)
 
 			t = stress_time_now();
 			if (LIKELY(pthread_mutex_lock(&mutex) == 0)) {
-				pthread_info->lock_duration += stress_time_now() - t;
+				t = stress_time_now() - t;
+				pthread_info->lock_duration += t;
 				pthread_info->lock_count += 1.0;
+				stress_hist_record(pthread_info->lock_hist,
+					(uint64_t)(t * STRESS_DBL_NANOSECOND));
 			} else {
 				pr_fail("%s: pthread_mutex_lock failed, errno=%d (%s)\n",
 					args->name, errno, strerror(errno));
@@ -184,6 +189,7 @@ static int stress_mutex(stress_args_t *args)
 	uint64_t mutex_procs = DEFAULT_MUTEX_PROCS;
 	bool mutex_affinity = false;
 	double duration = 0.0, count = 0.0, rate;
+	stress_hist_t *lock_hists;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
@@ -198,9 +204,18 @@ static int stress_mutex(stress_args_t *args)
 
 	(void)shim_memset(&pthread_info, 0, sizeof(pthread_info));
 
+	lock_hists = (stress_hist_t *)calloc((size_t)mutex_procs, sizeof(*lock_hists));
+	if (!lock_hists) {
+		pr_inf_skip("%s: cannot allocate lock latency histograms%s, "
+			"skipping stressor\n", args->name,
+			stress_get_memfree_str());
+		return EXIT_NO_RESOURCE;
+	}
+
 	if (pthread_mutex_init(&mutex, NULL) < 0) {
 		pr_fail("pthread_mutex_init failed, errno=%d: "
 			"(%s)\n", errno, strerror(errno));
+		free(lock_hists);
 		return EXIT_FAILURE;
 	}
 
@@ -225,6 +240,8 @@ static int stress_mutex(stress_args_t *args)
 		pthread_info[i].mutex_affinity = mutex_affinity;
 		pthread_info[i].lock_duration = 0.0;
 		pthread_info[i].lock_count = 0.0;
+		pthread_info[i].lock_hist = &lock_hists[i];
+		stress_hist_init(pthread_info[i].lock_hist, "mutex lock latency (nanosecs)");
 		pthread_info[i].ret = pthread_create(&pthread_info[i].pthread, NULL,
                                 stress_mutex_exercise, (void *)&pthread_info[i]);
 		if ((pthread_info[i].ret) && (pthread_info[i].ret != EAGAIN)) {
@@ -243,6 +260,7 @@ static int stress_mutex(stress_args_t *args)
 #if defined(HAVE_PTHREAD_SETAFFINITY_NP)
 		stress_free_usable_cpus(&cpus);
 #endif
+		free(lock_hists);
 		return EXIT_NO_RESOURCE;
 	}
 
@@ -260,12 +278,14 @@ static int stress_mutex(stress_args_t *args)
 
 		duration += pthread_info[i].lock_duration;
 		count += pthread_info[i].lock_count;
+		stress_hist_merge(args, 0, pthread_info[i].lock_hist);
 	}
 	(void)pthread_mutex_destroy(&mutex);
 
 	rate = (count > 0.0) ? (duration / count) : 0.0;
 	stress_metrics_set(args, 0, "nanosecs per mutex",
 		rate * STRESS_DBL_NANOSECOND, STRESS_METRIC_HARMONIC_MEAN);
+	free(lock_hists);
 
 #if defined(HAVE_PTHREAD_SETAFFINITY_NP)
 	stress_free_usable_cpus(&cpus);
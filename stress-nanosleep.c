@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-cpuidle.h"
+#include "core-histogram.h"
 #include "core-pthread.h"
 
 #define MIN_NANOSLEEP_THREADS		(1)
@@ -57,6 +58,7 @@ typedef struct {
 	double overrun_count;
 	double underrun_nsec;
 	double underrun_count;
+	stress_hist_t overrun_hist;
 #endif
 	int mask;
 } stress_ctxt_t;
@@ -133,6 +135,7 @@ static int stress_nanosleep_ns(stress_ctxt_t *ctxt, const long int nsec)
 			} else {
 				ctxt->overrun_nsec += (double)dt_nsec;
 				ctxt->overrun_count += 1.0;
+				stress_hist_record(&ctxt->overrun_hist, (uint64_t)dt_nsec);
 			}
 		}
 	} else {
@@ -262,6 +265,7 @@ static int stress_nanosleep(stress_args_t *args)
 		ctxts[n].overrun_count = 0.0;
 		ctxts[n].underrun_nsec = 0.0;
 		ctxts[n].underrun_count = 0.0;
+		stress_hist_init(&ctxts[n].overrun_hist, "nanosleep overrun (nanosecs)");
 #endif
 		ctxts[n].mask = mask;
 		ctxts[n].cstate_list = cstate_list;
@@ -332,6 +336,7 @@ tidy:
 		overrun_count += (double)ctxts[i].overrun_count;
 		underrun_nsec += ctxts[i].underrun_nsec;
 		underrun_count += (double)ctxts[i].underrun_count;
+		stress_hist_merge(args, 0, &ctxts[i].overrun_hist);
 	}
 
 	if (underrun_count > 0.0) {
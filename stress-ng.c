@@ -27,19 +27,24 @@
 #include "core-config-check.h"
 #include "core-ftrace.h"
 #include "core-hash.h"
+#include "core-histogram.h"
 #include "core-ignite-cpu.h"
 #include "core-interrupts.h"
 #include "core-io-priority.h"
 #include "core-job.h"
 #include "core-klog.h"
 #include "core-limit.h"
+#include "core-metrics-socket.h"
 #include "core-mlock.h"
 #include "core-numa.h"
 #include "core-opts.h"
 #include "core-out-of-memory.h"
+#include "core-pace.h"
 #include "core-perf.h"
+#include "core-placement.h"
 #include "core-pragma.h"
 #include "core-rapl.h"
+#include "core-results-db.h"
 #include "core-shared-cache.h"
 #include "core-shared-heap.h"
 #include "core-smart.h"
@@ -47,6 +52,7 @@
 #include "core-syslog.h"
 #include "core-thermal-zone.h"
 #include "core-thrash.h"
+#include "core-timeseries.h"
 #include "core-vmstat.h"
 
 #include <ctype.h>
@@ -57,6 +63,10 @@
 
 #include <sys/times.h>
 
+#if defined(HAVE_SYS_PRCTL_H)
+#include <sys/prctl.h>
+#endif
+
 #if defined(HAVE_SYS_UTSNAME_H)
 #include <sys/utsname.h>
 #endif
@@ -109,7 +119,16 @@ typedef struct {
 	stress_stressor_t *tail;
 } stress_stressor_list_t;
 
+/* Instance start up timing, worst run */
+typedef struct {
+	int32_t instances;		/* instances started */
+	double spawn_time;		/* run start to last instance start */
+	double skew;			/* first to last instance start */
+	bool tree;			/* started by --start-tree group leaders */
+} stress_startup_t;
+
 static stress_stressor_list_t stress_stressor_list;
+static stress_startup_t stress_startup;
 
 /* Various option settings and flags */
 static volatile bool wait_flag = true;		/* false = exit run wait loop */
@@ -322,8 +341,11 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"aggressive",		"enable all aggressive options" },
 	{ "a N",	"all N",		"start N workers of each stress test" },
 	{ "b N",	"backoff N",		"wait of N microseconds before work starts" },
+	{ NULL,		"bogo-batch N",		"publish bogo-ops in batches of up to N ops" },
 	{ NULL,		"change-cpu",		"force child processes to use different CPU to that of parent" },
 	{ NULL,		"class name",		"specify a class of stressors, use with --sequential" },
+	{ NULL,		"compare",		"compare results against earlier runs in the results-db" },
+	{ NULL,		"compare-window N",	"compare against the last N matching runs" },
 	{ "n",		"dry-run",		"do not run" },
 	{ NULL,		"ftrace",		"enable kernel function call tracing" },
 	{ "h",		"help",			"show help" },
@@ -345,6 +367,7 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"mbind",		"set NUMA memory binding to specific nodes" },
 	{ "M",		"metrics",		"print pseudo metrics of activity" },
 	{ NULL,		"metrics-brief",	"enable metrics and only show non-zero results" },
+	{ NULL,		"metrics-socket P",	"serve json metrics snapshots on unix socket path P" },
 	{ NULL,		"minimize",		"enable minimal stress options" },
 	{ NULL,		"no-madvise",		"don't use random madvise options for each mmap" },
 	{ NULL,		"no-oom-adjust",	"disable all forms of out-of-memory score adjustments" },
@@ -352,18 +375,23 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"oom-avoid",		"Try to avoid stressors from being OOM'd" },
 	{ NULL,		"oom-avoid-bytes N",	"Number of bytes free to stop further memory allocations" },
 	{ NULL,		"oomable",		"Do not respawn a stressor if it gets OOM'd" },
+	{ NULL,		"pace-rate N",		"pace each stressor to N bogo-ops per second" },
+	{ NULL,		"pace-util P",		"pace stressors to hold system CPU utilisation at P%" },
 	{ NULL,		"page-in",		"touch allocated pages that are not in core" },
 	{ NULL,		"parallel N",		"synonym for 'all N'" },
 	{ NULL,		"pathological",		"enable stressors that are known to hang a machine" },
 #if defined(STRESS_PERF_STATS) &&	\
     defined(HAVE_LINUX_PERF_EVENT_H)
 	{ NULL,		"perf",			"display perf statistics" },
+	{ NULL,		"perf-sample N",	"sample stressor IPs and report the top N symbols" },
 #endif
 	{ NULL,		"permute N",		"run permutations of stressors with N stressors per permutation" },
+	{ NULL,		"placement P",		"place instances by topology, P = spread, compact, llc, core or node" },
 	{ "q",		"quiet",		"quiet output" },
 	{ "r",		"random N",		"start N random workers" },
 	{ NULL,		"rapl",			"report RAPL power domain measurements over entire run (Linux x86 only)" },
 	{ NULL,		"raplstat S",		"show RAPL power domain stats every S seconds (Linux x86 only)" },
+	{ NULL,		"results-db file",	"append run results to a binary results database file" },
 	{ NULL,		"sched type",		"set scheduler type" },
 	{ NULL,		"sched-prio N",		"set scheduler priority level N" },
 	{ NULL,		"sched-period N",	"set period for SCHED_DEADLINE to N nanosecs (Linux only)" },
@@ -375,6 +403,7 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"skip-silent",		"silently skip unimplemented stressors" },
 	{ NULL,		"smart",		"show changes in S.M.A.R.T. data" },
 	{ NULL,		"sn",			"use scientific notation for metrics" },
+	{ NULL,		"start-tree",		"fork stressor instances in parallel from group leaders" },
 	{ NULL,		"status S",		"show stress-ng progress status every S seconds" },
 	{ NULL,		"stderr",		"all output to stderr" },
 	{ NULL,		"stdout",		"all output to stdout (now the default)" },
@@ -390,6 +419,8 @@ static const stress_help_t help_generic[] = {
 	{ "t N",	"timeout T",		"timeout after T seconds" },
 	{ NULL,		"timer-slack N",	"set slack slack to N nanoseconds, 0 for default" },
 	{ NULL,		"times",		"show run time summary at end of the run" },
+	{ NULL,		"timeseries S",		"sample bogo-op rates every S seconds" },
+	{ NULL,		"timeseries-csv file",	"output bogo-op rate time series to a CSV file" },
 	{ NULL,		"timestamp",		"timestamp log output " },
 #if defined(STRESS_THERMAL_ZONES)
 	{ NULL,		"tz",			"collect temperatures from thermal zones (Linux only)" },
@@ -542,8 +573,10 @@ void stress_zero_bogo_max_ops(void)
 		int32_t i;
 
 		if (!ss->ignore.run) {
-			for (i = 0; i < ss->instances; i++)
+			for (i = 0; i < ss->instances; i++) {
+				ss->stats[i]->args.bogo.ops_limit = 0;
 				ss->stats[i]->args.bogo.max_ops = 0;
+			}
 		}
 	}
 }
@@ -1495,6 +1528,7 @@ static int MLOCKED_TEXT stress_run_child(
 		stress_block_signals();
 		goto child_exit;
 	}
+	stress_placement_apply(stats, started_instances);
 	(void)atexit(stress_child_atexit);
 	if (stress_set_handler(name, true) < 0) {
 		rc = EXIT_FAILURE;
@@ -1541,6 +1575,9 @@ static int MLOCKED_TEXT stress_run_child(
 		/* note: set args in same order as stress_args_t */
 		args->bogo.max_ops = g_stressor_current->bogo_max_ops ?
 			g_stressor_current->bogo_max_ops : NEVER_END_OPS;
+		args->bogo.ops_limit = args->bogo.max_ops;
+		if (stress_pace_enabled())
+			args->bogo.max_ops = 0;	/* wait for the pacer to grant ops */
 		args->bogo.ci.counter = 0;
 		args->bogo.possibly_oom_killed = false;
 		args->name = name;
@@ -1680,6 +1717,362 @@ child_exit:
 	return rc;
 }
 
+#if defined(HAVE_PRCTL) &&		\
+    defined(HAVE_SYS_PRCTL_H) &&	\
+    defined(PR_SET_CHILD_SUBREAPER)
+#define STRESS_START_TREE		(1)
+#define STRESS_START_TREE_GROUP		(32)	/* instances per group leader */
+
+#if defined(SIGUSR1) &&	\
+    defined(PR_SET_PDEATHSIG)
+/*
+ *  stress_run_tree_wake()
+ *	no-op handler, the leader exit signal just wakes sigsuspend()
+ */
+static void MLOCKED_TEXT stress_run_tree_wake(int signum)
+{
+	(void)signum;
+}
+#endif
+
+/*
+ *  stress_run_tree_reparented()
+ *	wait for the group leader to exit and for this process to be
+ *	re-parented to stress-ng. The kernel re-parents the process
+ *	before it raises the parent death signal, so the instance can
+ *	sleep until the leader exits rather than poll for it
+ */
+static void MLOCKED_TEXT stress_run_tree_reparented(void)
+{
+#if defined(SIGUSR1) &&	\
+    defined(PR_SET_PDEATHSIG)
+	struct sigaction sa, old_sa;
+	sigset_t set, old_set;
+
+	(void)sigemptyset(&set);
+	(void)sigaddset(&set, SIGUSR1);
+	if (sigprocmask(SIG_BLOCK, &set, &old_set) == 0) {
+		(void)shim_memset(&sa, 0, sizeof(sa));
+		(void)sigemptyset(&sa.sa_mask);
+		sa.sa_handler = stress_run_tree_wake;
+		if (sigaction(SIGUSR1, &sa, &old_sa) == 0) {
+			if (prctl(PR_SET_PDEATHSIG, SIGUSR1) == 0) {
+				sigset_t wait_set = old_set;
+
+				(void)sigdelset(&wait_set, SIGUSR1);
+				while (getppid() != main_pid) {
+					if (kill(main_pid, 0) < 0)
+						_exit(EXIT_FAILURE);
+					(void)sigsuspend(&wait_set);
+				}
+				(void)prctl(PR_SET_PDEATHSIG, 0);
+			}
+			(void)sigaction(SIGUSR1, &old_sa, NULL);
+		}
+		(void)sigprocmask(SIG_SETMASK, &old_set, NULL);
+	}
+#endif
+	/* no parent death signal, poll */
+	while (getppid() != main_pid) {
+		if (kill(main_pid, 0) < 0)
+			_exit(EXIT_FAILURE);
+		(void)shim_usleep(10000);
+	}
+}
+
+/*
+ *  stress_run_tree_instance()
+ *	run a stressor instance forked by a group leader
+ */
+static void NORETURN MLOCKED_TEXT stress_run_tree_instance(
+	stress_checksum_t *checksum,
+	stress_stats_t *const stats,
+	const double fork_time_start,
+	const int64_t backoff,
+	const int32_t ticks_per_sec,
+	const int32_t ionice_class,
+	const int32_t ionice_level,
+	const int32_t instance,
+	const int32_t started_instances,
+	const size_t page_size)
+{
+	const pid_t child_pid = getpid();
+	int rc;
+
+	stats->s_pid.reaped = false;
+	stats->s_pid.pid = child_pid;
+
+	/*
+	 *  Wait to be re-parented to stress-ng so that the parent death
+	 *  signal set up by the stressor is tied to stress-ng and not to
+	 *  the leader
+	 */
+	stress_run_tree_reparented();
+
+	if (g_opt_flags & OPT_FLAGS_C_STATES)
+		stress_cpuidle_read_cstates_begin(&stats->cstates);
+	rc = stress_run_child(&checksum,
+			stats, fork_time_start,
+			backoff, ticks_per_sec,
+			ionice_class, ionice_level,
+			instance, started_instances,
+			page_size, child_pid);
+	if (g_opt_flags & OPT_FLAGS_C_STATES)
+		stress_cpuidle_read_cstates_end(&stats->cstates);
+	_exit(rc);
+}
+
+/*
+ *  stress_run_tree_leader()
+ *	group leader, fork instances first..last-1 of a stressor and
+ *	exit, the instance pids are passed back in the shared stats
+ */
+static void NORETURN MLOCKED_TEXT stress_run_tree_leader(
+	stress_checksum_t *checksum,
+	const int32_t first,
+	const int32_t last,
+	const int32_t started_instances,
+	const int64_t backoff,
+	const int32_t ticks_per_sec,
+	const int32_t ionice_class,
+	const int32_t ionice_level,
+	const size_t page_size)
+{
+	int32_t j;
+
+	stress_set_proc_name("stress-ng-leader");
+
+	for (j = first; j < last; j++) {
+		stress_stats_t *const stats = g_stressor_current->stats[j];
+		double fork_time_start;
+		pid_t pid;
+again:
+		if (!stress_continue_flag())
+			break;
+		fork_time_start = stress_time_now();
+		pid = fork();
+		if (pid < 0) {
+			if (errno == EAGAIN) {
+				(void)shim_usleep(100000);
+				goto again;
+			}
+			stats->s_pid.reaped = true;
+			_exit(EXIT_FAILURE);
+		} else if (pid == 0) {
+			stress_run_tree_instance(checksum + j, stats,
+				fork_time_start, backoff, ticks_per_sec,
+				ionice_class, ionice_level, j,
+				started_instances + (j - first), page_size);
+		}
+		stats->s_pid.pid = pid;
+		stats->s_pid.reaped = false;
+		stats->signalled = false;
+	}
+	_exit(EXIT_SUCCESS);
+}
+
+/*
+ *  stress_run_tree()
+ *	fork a group leader for every STRESS_START_TREE_GROUP instances,
+ *	the leaders fork their instances concurrently and exit. As
+ *	stress-ng is a child sub-reaper the orphaned instances are
+ *	re-parented to it and can be waited for as normal. All the per
+ *	instance state is in the pre-faulted g_shared stats, the only
+ *	allocation is the array of leader pids. Returns the number of
+ *	instances started or -1 if the tree cannot be used.
+ */
+static int32_t MLOCKED_TEXT stress_run_tree(
+	const int32_t ticks_per_sec,
+	stress_stressor_t *stressors_list,
+	stress_checksum_t *checksum,
+	const int64_t backoff,
+	const int32_t ionice_class,
+	const int32_t ionice_level,
+	const size_t page_size,
+	stress_pid_t **s_pids_head)
+{
+	stress_stressor_t *ss;
+	stress_checksum_t *ss_checksum;
+	pid_t *leaders;
+	size_t n_groups = 0, n_leaders = 0, i;
+	int32_t started_instances = 0, index = 0;
+	bool fork_failed = false;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+		n_groups += (size_t)((ss->instances + STRESS_START_TREE_GROUP - 1) / STRESS_START_TREE_GROUP);
+	}
+	if (n_groups == 0)
+		return 0;
+	leaders = (pid_t *)calloc(n_groups, sizeof(*leaders));
+	if (!leaders) {
+		pr_dbg("start-tree: cannot allocate %zu group leader pids, "
+			"starting instances one at a time\n", n_groups);
+		return -1;
+	}
+	if (prctl(PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0) < 0) {
+		pr_dbg("start-tree: cannot become a child sub-reaper, errno=%d (%s), "
+			"starting instances one at a time\n", errno, strerror(errno));
+		free(leaders);
+		return -1;
+	}
+
+	/* Initialize all the instance state before any forking */
+	for (ss_checksum = checksum, ss = stressors_list; ss; ss_checksum += ss->instances, ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+		for (j = 0; j < ss->instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+
+			stress_sync_start_init(&stats->s_pid);
+			stats->s_pid.reaped = true;
+			stats->args.bogo.ci.counter_ready = true;
+			stats->args.bogo.ci.counter = 0;
+			stats->checksum = ss_checksum + j;
+		}
+	}
+
+	/* Fork the group leaders, each forks a group of instances */
+	for (ss_checksum = checksum, ss = stressors_list; ss; ss_checksum += ss->instances, ss = ss->next) {
+		int32_t first;
+
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+		g_stressor_current = ss;
+		for (first = 0; first < ss->instances; first += STRESS_START_TREE_GROUP) {
+			const int32_t last = STRESS_MINIMUM(first + STRESS_START_TREE_GROUP, ss->instances);
+			pid_t pid;
+again:
+			if (!stress_continue_flag())
+				goto reap_leaders;
+			pid = fork();
+			if (pid < 0) {
+				if (errno == EAGAIN) {
+					(void)shim_usleep(100000);
+					goto again;
+				}
+				pr_err("cannot fork, errno=%d (%s)\n",
+					errno, strerror(errno));
+				fork_failed = true;
+				goto reap_leaders;
+			} else if (pid == 0) {
+				stress_run_tree_leader(ss_checksum, first, last,
+					index + first, backoff, ticks_per_sec,
+					ionice_class, ionice_level, page_size);
+			}
+			leaders[n_leaders++] = pid;
+		}
+		index += ss->instances;
+	}
+
+reap_leaders:
+	for (i = 0; i < n_leaders; i++) {
+		int status = 0;
+		pid_t ret;
+
+		while ((ret = waitpid(leaders[i], &status, 0)) < 0) {
+			if (errno != EINTR)
+				break;
+		}
+		if (ret < 0)
+			continue;
+		if (WIFEXITED(status) && (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+			pr_err("cannot fork stressor instance from group leader\n");
+			fork_failed = true;
+		}
+	}
+	free(leaders);
+	/* All instances have been re-parented, stop reaping orphans */
+	(void)prctl(PR_SET_CHILD_SUBREAPER, 0, 0, 0, 0);
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+		for (j = 0; j < ss->instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+
+			if ((stats->s_pid.pid > 0) && !stats->s_pid.reaped) {
+				started_instances++;
+				stress_ftrace_add_pid(stats->s_pid.pid);
+				stress_sync_start_s_pid_list_add(s_pids_head, &stats->s_pid);
+			}
+		}
+	}
+	if (fork_failed || !stress_continue_flag()) {
+		pr_dbg("abort signal during startup, cleaning up\n");
+		stress_kill_stressors(SIGALRM, true);
+	}
+	return started_instances;
+}
+#endif
+
+/*
+ *  stress_startup_measure()
+ *	measure the time taken to start all the instances
+ *	of a run and the skew between the first and last
+ *	instance starting, keeping the worst run
+ */
+static void stress_startup_measure(
+	stress_stressor_t *stressors_list,
+	const double time_start,
+	const bool tree)
+{
+	stress_stressor_t *ss;
+	double first = DBL_MAX, last = 0.0;
+	int32_t instances = 0;
+
+	for (ss = stressors_list; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || ss->ignore.permute)
+			continue;
+		for (j = 0; j < ss->instances; j++) {
+			const double start = ss->stats[j]->start;
+
+			if (start < time_start)
+				continue;
+			first = STRESS_MINIMUM(first, start);
+			last = STRESS_MAXIMUM(last, start);
+			instances++;
+		}
+	}
+	if (instances == 0)
+		return;
+
+	pr_dbg("%" PRId32 " instance%s started in %.3f secs, %.6f secs between "
+		"first and last instance starting\n",
+		instances, instances == 1 ? "" : "s",
+		last - time_start, last - first);
+	if ((last - first) >= stress_startup.skew) {
+		stress_startup.instances = instances;
+		stress_startup.spawn_time = last - time_start;
+		stress_startup.skew = last - first;
+		stress_startup.tree = tree;
+	}
+}
+
+/*
+ *  stress_startup_dump()
+ *	output the worst instance start up timing
+ */
+static void stress_startup_dump(FILE *yaml)
+{
+	if (stress_startup.instances == 0)
+		return;
+
+	pr_yaml(yaml, "startup:\n");
+	pr_yaml(yaml, "      method: %s\n", stress_startup.tree ? "tree" : "serial");
+	pr_yaml(yaml, "      instances: %" PRId32 "\n", stress_startup.instances);
+	pr_yaml(yaml, "      start-time: %f\n", stress_startup.spawn_time);
+	pr_yaml(yaml, "      start-skew: %f\n", stress_startup.skew);
+	pr_yaml(yaml, "\n");
+}
+
 /*
  *  stress_run()
  *	kick off and run stressors
@@ -1700,6 +2093,7 @@ static void MLOCKED_TEXT stress_run(
 	int32_t ionice_class = UNDEFINED;
 	int32_t ionice_level = UNDEFINED;
 	bool handler_set = false;
+	bool tree = false;
 	stress_pid_t *s_pids_head = NULL;
 
 	wait_flag = true;
@@ -1722,6 +2116,22 @@ static void MLOCKED_TEXT stress_run(
 	}
 	pr_dbg("starting stressors\n");
 
+#if defined(STRESS_START_TREE)
+	if (stress_get_setting("start-tree", &tree) && tree &&
+	    !(g_opt_flags & OPT_FLAGS_DRY_RUN)) {
+		started_instances = stress_run_tree(ticks_per_sec, stressors_list,
+					*checksum, backoff, ionice_class, ionice_level,
+					page_size, &s_pids_head);
+		if (started_instances >= 0) {
+			for (g_stressor_current = stressors_list; g_stressor_current;
+			     g_stressor_current = g_stressor_current->next)
+				*checksum += g_stressor_current->instances;
+			goto started;
+		}
+		started_instances = 0;
+		tree = false;
+	}
+#endif
 	/*
 	 *  Work through the list of stressors to run
 	 */
@@ -1811,6 +2221,9 @@ again:
 			}
 		}
 	}
+#if defined(STRESS_START_TREE)
+started:
+#endif
 	if (!handler_set) {
 		(void)stress_set_handler("stress-ng", false);
 		handler_set = true;
@@ -1832,6 +2245,7 @@ wait_for_stressors:
 #endif
 	stress_wait_stressors(s_pids_head, ticks_per_sec, stressors_list, success, resource_success, metrics_success);
 	time_finish = stress_time_now();
+	stress_startup_measure(stressors_list, time_start, tree);
 
 	*duration += time_finish - time_start;
 }
@@ -2085,6 +2499,7 @@ static void stress_metrics_dump(FILE *yaml)
 	const stress_metrics_item_t *item;
 	const char *description;
 	bool misc_metrics = false;
+	bool hist_metrics = false;
 
 	pr_block_begin();
 	if (g_opt_flags & OPT_FLAGS_METRICS_BRIEF) {
@@ -2254,6 +2669,17 @@ static void stress_metrics_dump(FILE *yaml)
 				}
 			}
 		}
+		if (ss->stats[0]->hist) {
+			for (i = 0; i < STRESS_HIST_PER_STRESSOR; i++) {
+				const stress_hist_t *hist = &ss->stats[0]->hist[i];
+
+				if (hist->description && hist->count) {
+					hist_metrics = true;
+					stress_hist_dump_yaml(yaml,
+						stress_description_yamlify(hist->description), hist);
+				}
+			}
+		}
 		pr_yaml(yaml, "\n");
 	}
 
@@ -2391,6 +2817,21 @@ static void stress_metrics_dump(FILE *yaml)
 			}
 		}
 	}
+
+	if (hist_metrics && !(g_opt_flags & OPT_FLAGS_METRICS_BRIEF)) {
+		pr_metrics("latency histograms:\n");
+		for (ss = stress_stressor_list.head; ss; ss = ss->next) {
+			size_t i;
+
+			if (ss->ignore.run)
+				continue;
+			if (!ss->stats || !ss->stats[0]->hist)
+				continue;
+
+			for (i = 0; i < STRESS_HIST_PER_STRESSOR; i++)
+				stress_hist_log(ss->stressor->name, &ss->stats[0]->hist[i]);
+		}
+	}
 	pr_block_end();
 }
 
@@ -3207,6 +3648,11 @@ next_opt:
 			i64 = (int64_t)stress_get_uint64(optarg);
 			stress_set_setting_global("backoff", TYPE_ID_INT64, &i64);
 			break;
+		case OPT_bogo_batch:
+			u64 = stress_get_uint64(optarg);
+			stress_check_range("bogo-batch", u64, 1, STRESS_BOGO_BATCH_MAX);
+			stress_set_setting_global("bogo-batch", TYPE_ID_UINT64, &u64);
+			break;
 		case OPT_cache_level:
 			/*
 			 * Note: Overly high values will be caught in the
@@ -3253,6 +3699,44 @@ next_opt:
 		case OPT_job:
 			stress_set_setting_global("job", TYPE_ID_STR, (void *)optarg);
 			break;
+		case OPT_metrics_socket:
+			if (stress_set_metrics_socket(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_compare:
+			stress_set_setting_true("global", "compare", NULL);
+			break;
+		case OPT_start_tree:
+			stress_set_setting_true("global", "start-tree", NULL);
+			break;
+		case OPT_compare_window:
+			u32 = stress_get_uint32(optarg);
+			stress_check_range("compare-window", (uint64_t)u32, 3, 1000);
+			stress_set_setting_global("compare-window", TYPE_ID_UINT32, &u32);
+			break;
+		case OPT_results_db:
+			stress_set_setting_global("results-db", TYPE_ID_STR, (void *)optarg);
+			break;
+		case OPT_pace_rate:
+			if (stress_set_pace_rate(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_pace_util:
+			if (stress_set_pace_util(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_placement:
+			if (stress_set_placement(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+		case OPT_perf_sample:
+			u32 = stress_get_uint32(optarg);
+			stress_check_range("perf-sample", (uint64_t)u32, 1, 1000);
+			stress_set_setting_global("perf-sample", TYPE_ID_UINT32, &u32);
+			break;
+#endif
 		case OPT_log_file:
 			stress_set_setting_global("log-file", TYPE_ID_STR, (void *)optarg);
 			break;
@@ -3364,6 +3848,13 @@ next_opt:
 		case OPT_timeout:
 			g_opt_timeout = stress_get_uint64_time(optarg);
 			break;
+		case OPT_timeseries:
+			if (stress_set_timeseries(optarg) < 0)
+				exit(EXIT_FAILURE);
+			break;
+		case OPT_timeseries_csv:
+			stress_set_setting_global("timeseries-csv", TYPE_ID_STR, (void *)optarg);
+			break;
 		case OPT_timer_slack:
 			(void)stress_set_timer_slack_ns(optarg);
 			break;
@@ -3827,6 +4318,7 @@ int main(int argc, char **argv, char **envp)
 		goto exit_settings_free;
 	}
 
+	stress_results_db_args(argc, argv);
 	ret = stress_parse_opts(argc, argv, false);
 	if (ret != EXIT_SUCCESS)
 		goto exit_settings_free;
@@ -4049,6 +4541,7 @@ int main(int argc, char **argv, char **envp)
 	 *  Assign procs with shared stats memory
 	 */
 	stress_setup_stats_buffers();
+	stress_hist_shared_map(stress_stressor_list.head);
 
 	/*
 	 *  Allocate shared cache memory
@@ -4093,6 +4586,14 @@ int main(int argc, char **argv, char **envp)
 		stress_thrash_start();
 
 	stress_vmstat_start();
+	stress_timeseries_start(stress_get_total_instances(stress_stressor_list.head));
+	stress_metrics_socket_start(stress_stressor_list.head);
+	stress_placement_init(stress_stressor_list.head);
+	stress_pace_start(stress_stressor_list.head);
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	stress_perf_sample_start(stress_stressor_list.head);
+#endif
 	stress_smart_start();
 	stress_klog_start();
 	stress_clocksource_check();
@@ -4115,6 +4616,14 @@ int main(int argc, char **argv, char **envp)
 	if (g_opt_flags & OPT_FLAGS_THRASH)
 		stress_thrash_stop();
 
+	stress_pace_stop();
+#if defined(STRESS_PERF_STATS) &&	\
+    defined(HAVE_LINUX_PERF_EVENT_H)
+	stress_perf_sample_stop();
+#endif
+	stress_timeseries_stop();
+	stress_metrics_socket_stop();
+
 	yaml = stress_yaml_open(yaml_filename);
 
 	/*
@@ -4123,6 +4632,12 @@ int main(int argc, char **argv, char **envp)
 	if (g_opt_flags & OPT_FLAGS_METRICS)
 		stress_metrics_dump(yaml);
 
+	/*
+	 *  Dump bogo-op rate time series
+	 */
+	stress_timeseries_dump(yaml, stress_stressor_list.head);
+	stress_placement_dump(yaml, stress_stressor_list.head);
+
 	if (g_opt_flags & OPT_FLAGS_INTERRUPTS)
 		stress_interrupts_dump(yaml, stress_stressor_list.head);
 
@@ -4133,6 +4648,7 @@ int main(int argc, char **argv, char **envp)
 	 */
 	if (g_opt_flags & OPT_FLAGS_PERF_STATS)
 		stress_perf_stat_dump(yaml, stress_stressor_list.head, duration);
+	stress_perf_sample_dump(yaml, stress_stressor_list.head);
 #endif
 
 #if defined(STRESS_THERMAL_ZONES)
@@ -4157,6 +4673,9 @@ int main(int argc, char **argv, char **envp)
 	 *  Dump run times
 	 */
 	stress_times_dump(yaml, ticks_per_sec, duration);
+	stress_startup_dump(yaml);
+	stress_placement_free();
+	stress_results_db_update(yaml, stress_stressor_list.head);
 	stress_exit_status_summary();
 
 	stress_klog_stop(&success);
@@ -4179,6 +4698,8 @@ int main(int argc, char **argv, char **envp)
 	stress_stressors_free();
 	stress_cpuidle_free();
 	stress_cache_free();
+	stress_timeseries_free();
+	stress_hist_shared_unmap();
 	stress_shared_unmap();
 	stress_settings_free();
 
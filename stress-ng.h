@@ -221,6 +221,7 @@ typedef struct {
 typedef struct {
 	struct {
 		uint64_t max_ops;		/* max number of bogo ops */
+		uint64_t ops_limit;		/* --ops limit, max_ops is lowered to pace */
 		stress_counter_info_t ci;	/* counter info struct */
 		bool possibly_oom_killed;	/* was oom killed? */
 	} bogo;
@@ -590,6 +591,7 @@ typedef struct stress_stats {
 	stress_interrupts_t interrupts[STRESS_INTERRUPTS_MAX];
 	stress_cstate_stats_t cstates;	/* cstate stats */
 	stress_metrics_data_t metrics;	/* misc metrics */
+	struct stress_hist *hist;	/* shared per stressor histograms */
 	double rusage_utime;		/* rusage user time */
 	double rusage_stime;		/* rusage system time */
 	double rusage_utime_total;	/* rusage user time */
@@ -698,6 +700,15 @@ typedef struct {
 	struct {
 		uint32_t ready;		/* incremented when rawsock stressor is ready */
 	} rawsock;
+	struct {
+		uint64_t *counters;	/* ring of sampled bogo-op counters */
+		double *timestamps;	/* ring of sample times */
+		size_t length;		/* size of ring mapping */
+		uint64_t count;		/* number of samples taken */
+		double interval;	/* sample interval in seconds */
+		uint32_t max_samples;	/* number of samples in ring */
+		uint32_t num_procs;	/* number of counters per sample */
+	} timeseries;
 	stress_stats_t stats[];		/* Shared statistics */
 } stress_shared_t;
 
@@ -722,6 +733,7 @@ extern jmp_buf g_error_env;		/* parsing error env */
 extern void *g_nowt;			/* void pointer to NULL */
 
 extern void stress_zero_bogo_max_ops(void);
+extern bool stress_continue_paced(stress_args_t *args);
 
 /*
  *  stress_continue_flag()
@@ -825,9 +837,12 @@ static inline void ALWAYS_INLINE stress_force_killed_bogo(stress_args_t *args)
 
 /*
  *  stress_continue()
- *      returns true if we can keep on running a stressor
+ *      returns true if we can keep on running a stressor, with
+ *	--pace-rate or --pace-util the controller lowers max_ops and
+ *	the instance naps in stress_continue_paced() until it is raised
  */
-#define stress_continue(args) 	LIKELY(args->bogo.ci.counter < args->bogo.max_ops)
+#define stress_continue(args) 	(LIKELY(args->bogo.ci.counter < args->bogo.max_ops) ||	\
+				 stress_continue_paced(args))
 
 /*
  *  stress_bogo_add_lock()
@@ -871,6 +886,67 @@ static inline bool stress_bogo_inc_lock(stress_args_t *args, void *lock, const b
 	return ret;
 }
 
+/*
+ *  Batched bogo-op counting for stressors with very cheap ops,
+ *  ops are counted locally and published to the shared counter
+ *  in chunks of at most --bogo-batch ops. A chunk never crosses
+ *  the max_ops threshold, so stress_continue() sees the counter
+ *  land exactly on it and --ops stays exact.
+ */
+#define STRESS_BOGO_BATCH_DEFAULT	(64)
+#define STRESS_BOGO_BATCH_MAX		(65536)
+
+typedef struct {
+	uint64_t pending;		/* ops counted but not yet published */
+	uint64_t limit;			/* publish when pending reaches this */
+	uint64_t size;			/* maximum ops in a chunk */
+} stress_bogo_batch_t;
+
+/*
+ *  stress_bogo_batch_flush()
+ *	publish pending ops to the stressor bogo ops counter and
+ *	work out how many ops can be counted before the next publish
+ */
+static inline void stress_bogo_batch_flush(stress_args_t *args, stress_bogo_batch_t *batch)
+{
+	const uint64_t counter = args->bogo.ci.counter + batch->pending;
+	uint64_t limit = batch->size;
+
+	if (batch->pending) {
+		stress_bogo_add(args, batch->pending);
+		batch->pending = 0;
+	}
+	/* at the threshold, publish each op until stress_continue() catches up */
+	limit = STRESS_MINIMUM(limit, (args->bogo.max_ops > counter) ?
+				args->bogo.max_ops - counter : 1);
+	batch->limit = limit;
+}
+
+/*
+ *  stress_bogo_batch_init()
+ *	initialize a bogo-op batch, the chunk size is set
+ *	with --bogo-batch, 1 disables batching
+ */
+static inline void stress_bogo_batch_init(stress_args_t *args, stress_bogo_batch_t *batch)
+{
+	uint64_t size = STRESS_BOGO_BATCH_DEFAULT;
+
+	(void)stress_get_setting("bogo-batch", &size);
+	batch->pending = 0;
+	batch->size = size;
+	stress_bogo_batch_flush(args, batch);
+}
+
+/*
+ *  stress_bogo_batch_inc()
+ *	count one bogo-op, publish when the chunk is full
+ */
+static inline void ALWAYS_INLINE stress_bogo_batch_inc(stress_args_t *args, stress_bogo_batch_t *batch)
+{
+	if (UNLIKELY(++batch->pending >= batch->limit))
+		stress_bogo_batch_flush(args, batch);
+}
+
 /*
  *  stress_instance_zero()
  *	return true if stressor is the 0th instance of N stressor instances
@@ -37,6 +37,7 @@ static const stress_help_t help[] = {
     defined(HAVE_SIGLONGJMP)
 
 static sigjmp_buf jmpbuf;
+static stress_bogo_batch_t nop_batch;
 
 typedef void (*nop_func_t)(stress_args_t *args,
 			   const bool flag,
@@ -77,7 +78,7 @@ static void stress_nop_spin_ ## name(				\
 			(*duration) += stress_time_now() - t;	\
 			(*count) += (double)(64 * NOP_LOOPS);	\
 								\
-			stress_bogo_inc(args);			\
+			stress_bogo_batch_inc(args, &nop_batch);	\
 		}						\
 	} while (flag && stress_continue(args));		\
 }
@@ -346,7 +347,8 @@ static int stress_nop(stress_args_t *args)
 	do_random = (instr->nop_func == stress_nop_random);
 
 	if (sigsetjmp(jmpbuf, 1) != 0) {
-		/* We reach here on an SIGILL trap */
+		/* We reach here on an SIGILL trap, publish ops counted so far */
+		stress_bogo_batch_flush(args, &nop_batch);
 		if (current_instr == &nop_instrs[0]) {
 			/* Really should be able to do nop, skip */
 			pr_inf_skip("%s: 'nop' instruction was illegal, skipping stressor\n",
@@ -366,7 +368,9 @@ static int stress_nop(stress_args_t *args)
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	current_instr = instr;
+	stress_bogo_batch_init(args, &nop_batch);
 	stress_nop_callfunc(instr, args, true, &duration, &count);
+	stress_bogo_batch_flush(args, &nop_batch);
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	rate = (count > 0.0) ? (duration / count) : 0.0;
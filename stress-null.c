@@ -47,6 +47,7 @@ static int stress_null(stress_args_t *args)
 	int metrics_count = 0;
 	bool null_write = false;
 	ssize_t ret;
+	stress_bogo_batch_t batch;
 #if defined(__linux__)
 	int mmap_count = 0;
 #endif
@@ -74,6 +75,7 @@ static int stress_null(stress_args_t *args)
 	stress_sync_start_wait(args);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	stress_bogo_batch_init(args, &batch);
 	if (null_write) {
 		if (stress_instance_zero(args))
 			pr_inf("%s: exercising /dev/null with just writes\n", args->name);
@@ -94,7 +96,7 @@ static int stress_null(stress_args_t *args)
 			} else {
 				bytes += ret;
 			}
-			stress_bogo_inc(args);
+			stress_bogo_batch_inc(args, &batch);
 		} while (stress_continue(args));
 		duration += stress_time_now() - t;
 	} else {
@@ -181,9 +183,10 @@ static int stress_null(stress_args_t *args)
 				}
 			}
 #endif
-			stress_bogo_inc(args);
+			stress_bogo_batch_inc(args, &batch);
 		} while (stress_continue(args));
 	}
+	stress_bogo_batch_flush(args, &batch);
 	(void)close(fd);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
@@ -0,0 +1,481 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-madvise.h"
+#include "core-numa.h"
+#include "core-put.h"
+
+#if defined(HAVE_LINUX_MEMPOLICY_H)
+#include <linux/mempolicy.h>
+#endif
+
+#define MIN_NUMA_MIGRATE_BYTES		(1 * MB)
+#define MAX_NUMA_MIGRATE_BYTES		(MAX_MEM_LIMIT)
+#define DEFAULT_NUMA_MIGRATE_BYTES	(64 * MB)
+
+#define NUMA_MIGRATE_LOADS		(1U << 16)
+
+static const stress_help_t help[] = {
+	{ NULL,	"numa-migrate N",	"start N workers measuring NUMA page migration throughput" },
+	{ NULL,	"numa-migrate-bytes N",	"size of working set to migrate between NUMA nodes" },
+	{ NULL,	"numa-migrate-ops N",	"stop after N NUMA working set migrations" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const stress_opt_t opts[] = {
+	{ OPT_numa_migrate_bytes, "numa-migrate-bytes", TYPE_ID_SIZE_T_BYTES_VM, MIN_NUMA_MIGRATE_BYTES, MAX_NUMA_MIGRATE_BYTES, NULL },
+	END_OPT,
+};
+
+#if defined(__NR_mbind) &&		\
+    defined(__NR_migrate_pages) &&	\
+    defined(__NR_move_pages)
+
+/* Page migration interfaces */
+typedef enum {
+	NUMA_MIGRATE_MOVE_PAGES,	/* move_pages(), batch of pages per call */
+	NUMA_MIGRATE_MBIND,		/* mbind() MPOL_MF_MOVE, batch of pages per call */
+	NUMA_MIGRATE_MIGRATE_PAGES,	/* migrate_pages(), whole process per call */
+} stress_numa_migrate_method_t;
+
+/* Migration results of a method and batch size */
+typedef struct {
+	const char *name;		/* method name */
+	stress_numa_migrate_method_t method; /* migration method */
+	size_t batch;			/* pages per call, 0 = all */
+	uint64_t calls;			/* number of calls */
+	uint64_t pages;			/* pages moved */
+	double duration;		/* time in calls */
+	bool available;			/* false if method failed */
+} stress_numa_migrate_result_t;
+
+/* Working set and state shared by all the migrations */
+typedef struct {
+	stress_args_t *args;
+	uint8_t *buf;			/* working set */
+	size_t buf_size;		/* size of working set */
+	size_t n_pages;			/* pages in working set */
+	void **pages;			/* page addresses for move_pages */
+	int *nodes;			/* destination nodes for move_pages */
+	int *status;			/* status for move_pages */
+	uint32_t *order;		/* pointer chain page order */
+	stress_numa_mask_t *src_mask;	/* source node mask */
+	stress_numa_mask_t *dst_mask;	/* destination node mask */
+	double load_ns_before;		/* total ns per load before migration */
+	double load_ns_after;		/* total ns per load after migration */
+	uint64_t load_count;		/* number of load latency measurements */
+} stress_numa_migrate_t;
+
+static const size_t numa_migrate_batches[] = {
+	1, 16, 256, 4096, 0
+};
+
+/*
+ *  stress_numa_migrate_chain()
+ *	link one pointer per page into a random cyclic chain
+ *	(Sattolo's algorithm), this also faults in all the pages
+ */
+static void **stress_numa_migrate_chain(stress_numa_migrate_t *nm)
+{
+	const size_t page_size = nm->args->page_size;
+	const uint32_t n = (uint32_t)nm->n_pages;
+	const uint32_t lines = (uint32_t)(page_size / 64);
+	uint32_t i;
+	void **first, **ptr;
+
+	for (i = 0; i < n; i++)
+		nm->order[i] = i;
+	for (i = n - 1; i > 0; i--) {
+		const uint32_t j = stress_mwc32modn(i);
+		const uint32_t tmp = nm->order[i];
+
+		nm->order[i] = nm->order[j];
+		nm->order[j] = tmp;
+	}
+	first = (void **)(nm->buf + ((size_t)nm->order[0] * page_size) +
+			(64 * (size_t)stress_mwc32modn(lines)));
+	ptr = first;
+	for (i = 1; i < n; i++) {
+		void **next = (void **)(nm->buf + ((size_t)nm->order[i] * page_size) +
+				(64 * (size_t)stress_mwc32modn(lines)));
+
+		*ptr = (void *)next;
+		ptr = next;
+	}
+	*ptr = (void *)first;
+	return first;
+}
+
+/*
+ *  stress_numa_migrate_load_ns()
+ *	follow the pointer chain, returns nanosecs per dependent load
+ */
+static double OPTIMIZE3 stress_numa_migrate_load_ns(void **ptr)
+{
+	register void **p = ptr;
+	register uint32_t i;
+	double t;
+
+	t = stress_time_now();
+	for (i = 0; i < NUMA_MIGRATE_LOADS; i += 8) {
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+	}
+	t = stress_time_now() - t;
+	stress_void_ptr_put((void *)p);
+
+	return (t * STRESS_DBL_NANOSECOND) / (double)NUMA_MIGRATE_LOADS;
+}
+
+/*
+ *  stress_numa_migrate_on_node()
+ *	count working set pages on a node
+ */
+static size_t stress_numa_migrate_on_node(stress_numa_migrate_t *nm, const int node)
+{
+	size_t i, count = 0;
+
+	if (shim_move_pages(0, (unsigned long int)nm->n_pages, nm->pages, NULL, nm->status, 0) < 0)
+		return 0;
+	for (i = 0; i < nm->n_pages; i++)
+		count += (nm->status[i] == node);
+	return count;
+}
+
+/*
+ *  stress_numa_migrate_run()
+ *	fault a new working set in on the src node, migrate it to the
+ *	dst node with the method and batch size of result and measure
+ *	the load latency before and after, returns false if the method
+ *	failed
+ */
+static bool stress_numa_migrate_run(
+	stress_numa_migrate_t *nm,
+	stress_numa_migrate_result_t *result,
+	const unsigned long int src,
+	const unsigned long int dst)
+{
+	stress_args_t *args = nm->args;
+	const size_t page_size = args->page_size;
+	const size_t batch = result->batch ? result->batch : nm->n_pages;
+	size_t i, on_dst;
+	void **chain;
+	bool ok = true;
+
+	nm->buf = (uint8_t *)mmap(NULL, nm->buf_size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (nm->buf == MAP_FAILED) {
+		pr_inf("%s: failed to mmap %zu bytes%s, errno=%d (%s)\n",
+			args->name, nm->buf_size, stress_get_memfree_str(),
+			errno, strerror(errno));
+		return false;
+	}
+	stress_set_vma_anon_name(nm->buf, nm->buf_size, "numa-migrate-data");
+	/* base pages only, a THP would be migrated as one page */
+	(void)stress_madvise_nohugepage(nm->buf, nm->buf_size);
+
+	(void)shim_memset(nm->src_mask->mask, 0, nm->src_mask->mask_size);
+	(void)shim_memset(nm->dst_mask->mask, 0, nm->dst_mask->mask_size);
+	STRESS_SETBIT(nm->src_mask->mask, src);
+	STRESS_SETBIT(nm->dst_mask->mask, dst);
+
+	/* fault the working set in on the source node */
+	if (shim_mbind((void *)nm->buf, nm->buf_size, MPOL_BIND, nm->src_mask->mask,
+		       nm->src_mask->max_nodes, 0) < 0) {
+		pr_inf("%s: mbind to node %lu failed, errno=%d (%s)\n",
+			args->name, src, errno, strerror(errno));
+		(void)munmap((void *)nm->buf, nm->buf_size);
+		return false;
+	}
+	chain = stress_numa_migrate_chain(nm);
+	for (i = 0; i < nm->n_pages; i++) {
+		nm->pages[i] = (void *)(nm->buf + (i * page_size));
+		nm->nodes[i] = (int)dst;
+	}
+	on_dst = stress_numa_migrate_on_node(nm, (int)dst);
+	nm->load_ns_before += stress_numa_migrate_load_ns(chain);
+
+	switch (result->method) {
+	case NUMA_MIGRATE_MOVE_PAGES:
+		for (i = 0; ok && (i < nm->n_pages); i += batch) {
+			const size_t count = STRESS_MINIMUM(batch, nm->n_pages - i);
+			double t;
+
+			t = stress_time_now();
+			if (shim_move_pages(0, (unsigned long int)count, &nm->pages[i],
+					    &nm->nodes[i], &nm->status[i], MPOL_MF_MOVE) < 0)
+				ok = false;
+			result->duration += stress_time_now() - t;
+			result->calls++;
+		}
+		break;
+	case NUMA_MIGRATE_MBIND:
+		for (i = 0; ok && (i < nm->n_pages); i += batch) {
+			const size_t count = STRESS_MINIMUM(batch, nm->n_pages - i);
+			double t;
+
+			t = stress_time_now();
+			if (shim_mbind((void *)(nm->buf + (i * page_size)), count * page_size,
+				       MPOL_BIND, nm->dst_mask->mask, nm->dst_mask->max_nodes,
+				       MPOL_MF_MOVE) < 0)
+				ok = false;
+			result->duration += stress_time_now() - t;
+			result->calls++;
+		}
+		break;
+	case NUMA_MIGRATE_MIGRATE_PAGES:
+		{
+			double t;
+
+			t = stress_time_now();
+			if (shim_migrate_pages(0, nm->src_mask->max_nodes,
+					       nm->src_mask->mask, nm->dst_mask->mask) < 0)
+				ok = false;
+			result->duration += stress_time_now() - t;
+			result->calls++;
+		}
+		break;
+	}
+	if (!ok) {
+		pr_inf("%s: %s from node %lu to node %lu failed, errno=%d (%s), "
+			"skipping this method\n", args->name, result->name,
+			src, dst, errno, strerror(errno));
+		(void)munmap((void *)nm->buf, nm->buf_size);
+		return false;
+	}
+
+	i = stress_numa_migrate_on_node(nm, (int)dst);
+	result->pages += (i > on_dst) ? i - on_dst : 0;
+	nm->load_ns_after += stress_numa_migrate_load_ns(chain);
+	nm->load_count++;
+
+	(void)munmap((void *)nm->buf, nm->buf_size);
+	return true;
+}
+
+/*
+ *  stress_numa_migrate()
+ *	measure page migration throughput between NUMA nodes
+ */
+static int stress_numa_migrate(stress_args_t *args)
+{
+	const size_t page_size = args->page_size;
+	size_t numa_migrate_bytes_total = DEFAULT_NUMA_MIGRATE_BYTES;
+	stress_numa_migrate_t nm;
+	stress_numa_migrate_result_t results[(SIZEOF_ARRAY(numa_migrate_batches) * 2) + 1];
+	stress_numa_mask_t *numa_nodes;
+	unsigned long int *mem_nodes, node, n_nodes = 0, pair = 0;
+	unsigned int cpu = 0, cpu_node = 0;
+	size_t i, n_results = 0, idx = 0;
+	int rc = EXIT_SUCCESS;
+	char str[32];
+
+	(void)shim_memset(&nm, 0, sizeof(nm));
+	nm.args = args;
+
+	if (!stress_get_setting("numa-migrate-bytes", &numa_migrate_bytes_total)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			numa_migrate_bytes_total = MAX_32;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			numa_migrate_bytes_total = MIN_NUMA_MIGRATE_BYTES;
+	}
+	nm.buf_size = (numa_migrate_bytes_total / args->instances) & ~(page_size - 1);
+	if (nm.buf_size < MIN_NUMA_MIGRATE_BYTES)
+		nm.buf_size = MIN_NUMA_MIGRATE_BYTES;
+	nm.n_pages = nm.buf_size / page_size;
+	if (stress_instance_zero(args))
+		stress_usage_bytes(args, nm.buf_size, nm.buf_size * args->instances);
+
+	numa_nodes = stress_numa_mask_alloc();
+	if (!numa_nodes) {
+		pr_inf_skip("%s: no NUMA nodes found, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)stress_numa_mask_nodes_get(numa_nodes);
+	mem_nodes = (unsigned long int *)calloc(numa_nodes->max_nodes + 1, sizeof(*mem_nodes));
+	nm.src_mask = stress_numa_mask_alloc();
+	nm.dst_mask = stress_numa_mask_alloc();
+	nm.pages = (void **)calloc(nm.n_pages, sizeof(*nm.pages));
+	nm.nodes = (int *)calloc(nm.n_pages, sizeof(*nm.nodes));
+	nm.status = (int *)calloc(nm.n_pages, sizeof(*nm.status));
+	nm.order = (uint32_t *)calloc(nm.n_pages, sizeof(*nm.order));
+	if (!mem_nodes || !nm.src_mask || !nm.dst_mask || !nm.pages ||
+	    !nm.nodes || !nm.status || !nm.order) {
+		pr_inf_skip("%s: cannot allocate page and node arrays%s, skipping stressor\n",
+			args->name, stress_get_memfree_str());
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	for (node = 0; node <= numa_nodes->max_nodes; node++) {
+		if (node < NUMA_LONG_BITS * numa_nodes->numa_elements &&
+		    STRESS_GETBIT(numa_nodes->mask, node))
+			mem_nodes[n_nodes++] = node;
+	}
+	/* count the nodes found, stress_numa_mask_nodes_get() can return ULONG_MAX */
+	if (n_nodes < 2) {
+		if (stress_instance_zero(args))
+			pr_inf_skip("%s: at least 2 NUMA memory nodes are required, skipping stressor\n",
+				args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
+	for (i = 0; i < SIZEOF_ARRAY(numa_migrate_batches); i++) {
+		results[n_results].name = "move_pages";
+		results[n_results].method = NUMA_MIGRATE_MOVE_PAGES;
+		results[n_results++].batch = numa_migrate_batches[i];
+	}
+	for (i = 0; i < SIZEOF_ARRAY(numa_migrate_batches); i++) {
+		results[n_results].name = "mbind";
+		results[n_results].method = NUMA_MIGRATE_MBIND;
+		results[n_results++].batch = numa_migrate_batches[i];
+	}
+	results[n_results].name = "migrate_pages";
+	results[n_results].method = NUMA_MIGRATE_MIGRATE_PAGES;
+	results[n_results++].batch = 0;
+	for (i = 0; i < n_results; i++) {
+		results[i].calls = 0;
+		results[i].pages = 0;
+		results[i].duration = 0.0;
+		results[i].available = true;
+	}
+
+	(void)shim_getcpu(&cpu, &cpu_node, NULL);
+	if (stress_instance_zero(args)) {
+		pr_inf("%s: migrating %s working sets between %lu memory nodes, "
+			"starting on CPU %u, node %u\n", args->name,
+			stress_uint64_to_str(str, sizeof(str), (uint64_t)nm.buf_size, 0, true),
+			n_nodes, cpu, cpu_node);
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		/* step through all ordered pairs of nodes */
+		const unsigned long int src = mem_nodes[pair % n_nodes];
+		const unsigned long int dst = mem_nodes[(pair + 1 + ((pair / n_nodes) % (n_nodes - 1))) % n_nodes];
+		bool ran = false;
+
+		for (i = 0; (i < n_results) && stress_continue(args); i++) {
+			if (!results[i].available)
+				continue;
+			results[i].available = stress_numa_migrate_run(&nm, &results[i], src, dst);
+			if (results[i].available) {
+				stress_bogo_inc(args);
+				ran = true;
+			}
+		}
+		if (!ran)
+			break;
+		pair++;
+	} while (stress_continue(args));
+
+	if (stress_instance_zero(args)) {
+		pr_inf("%s: %14s %6s %12s %9s %11s\n", args->name,
+			"method", "batch", "pages/sec", "GB/sec", "usec/call");
+	}
+	for (i = 0; i < n_results; i++) {
+		const stress_numa_migrate_result_t *result = &results[i];
+		double pages_rate, gb_rate, call_us;
+		char batch[32], description[64];
+
+		if ((result->calls == 0) || (result->duration <= 0.0))
+			continue;
+		pages_rate = (double)result->pages / result->duration;
+		gb_rate = (pages_rate * (double)page_size) / (double)GB;
+		call_us = (result->duration * STRESS_DBL_MICROSECOND) / (double)result->calls;
+		if (result->batch)
+			(void)snprintf(batch, sizeof(batch), "%zu", result->batch);
+		else
+			(void)shim_strscpy(batch, "all", sizeof(batch));
+
+		if (stress_instance_zero(args)) {
+			pr_inf("%s: %14s %6s %12.0f %9.3f %11.2f\n", args->name,
+				result->name, batch, pages_rate, gb_rate, call_us);
+		}
+		if (idx + 3 > STRESS_MISC_METRICS_MAX)
+			continue;
+		(void)snprintf(description, sizeof(description),
+			"pages per sec %s batch %s", result->name, batch);
+		stress_metrics_set(args, idx++, description,
+			pages_rate, STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(description, sizeof(description),
+			"GB per sec %s batch %s", result->name, batch);
+		stress_metrics_set(args, idx++, description,
+			gb_rate, STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(description, sizeof(description),
+			"microsecs per call %s batch %s", result->name, batch);
+		stress_metrics_set(args, idx++, description,
+			call_us, STRESS_METRIC_HARMONIC_MEAN);
+	}
+	if (nm.load_count > 0) {
+		const double before = nm.load_ns_before / (double)nm.load_count;
+		const double after = nm.load_ns_after / (double)nm.load_count;
+
+		if (stress_instance_zero(args)) {
+			pr_inf("%s: load latency %.2f ns before and %.2f ns after migration (%+.1f%%)\n",
+				args->name, before, after,
+				before > 0.0 ? 100.0 * (after - before) / before : 0.0);
+		}
+		if (idx + 2 <= STRESS_MISC_METRICS_MAX) {
+			stress_metrics_set(args, idx++, "nanosecs per load before migration",
+				before, STRESS_METRIC_HARMONIC_MEAN);
+			stress_metrics_set(args, idx++, "nanosecs per load after migration",
+				after, STRESS_METRIC_HARMONIC_MEAN);
+		}
+	}
+
+tidy:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	free(nm.order);
+	free(nm.status);
+	free(nm.nodes);
+	free(nm.pages);
+	stress_numa_mask_free(nm.dst_mask);
+	stress_numa_mask_free(nm.src_mask);
+	free(mem_nodes);
+	stress_numa_mask_free(numa_nodes);
+
+	return rc;
+}
+
+const stressor_info_t stress_numa_migrate_info = {
+	.stressor = stress_numa_migrate,
+	.classifier = CLASS_MEMORY | CLASS_OS,
+	.opts = opts,
+	.help = help
+};
+#else
+const stressor_info_t stress_numa_migrate_info = {
+	.stressor = stress_unimplemented,
+	.classifier = CLASS_MEMORY | CLASS_OS,
+	.opts = opts,
+	.help = help,
+	.unimplemented_reason = "built without mbind(), migrate_pages() or move_pages()"
+};
+#endif
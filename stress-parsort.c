@@ -0,0 +1,332 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-memory.h"
+#include "core-mmap.h"
+#include "core-sort.h"
+
+#define MIN_PARSORT_SIZE	(16 * KB)
+#define MAX_PARSORT_SIZE	(64 * MB)
+#define DEFAULT_PARSORT_SIZE	(1 * MB)
+
+#define MIN_PARSORT_THREADS	(0)
+#define MAX_PARSORT_THREADS	(256)
+
+#define PARSORT_SIZES		(7)	/* 16K * 4^n up to MAX_PARSORT_SIZE */
+#define PARSORT_THREAD_STEPS	(10)	/* 1, 2, 4 .. 256 and the maximum */
+
+typedef int (*stress_parsort_func_t)(int32_t *data, int32_t *tmp,
+	const size_t n, const size_t n_threads);
+
+typedef struct {
+	const char *name;		/* method name */
+	const stress_parsort_func_t func; /* sort function */
+	const bool threaded;		/* sweep thread counts */
+} stress_parsort_method_t;
+
+typedef struct {
+	double duration;		/* total sort time */
+	double elements;		/* total elements sorted */
+} stress_parsort_stats_t;
+
+static const stress_help_t help[] = {
+	{ NULL,	"parsort N",		"start N workers benchmarking parallel int32 sorting" },
+	{ NULL,	"parsort-method M",	"select sort method [ all | mergesort | radixsort | network ]" },
+	{ NULL,	"parsort-ops N",	"stop after N parallel sort bogo operations" },
+	{ NULL,	"parsort-size N",	"maximum number of elements to sort (16384..67108864)" },
+	{ NULL,	"parsort-threads N",	"maximum number of sorting threads, 0 = CPUs / instances" },
+	{ NULL,	NULL,			NULL }
+};
+
+/*
+ *  stress_parsort_network()
+ *	serial sorting network and merge, ignores thread count
+ */
+static int stress_parsort_network(
+	int32_t *data,
+	int32_t *tmp,
+	const size_t n,
+	const size_t n_threads)
+{
+	(void)n_threads;
+
+	stress_sort_network_int32(data, tmp, n);
+	return 0;
+}
+
+static const stress_parsort_method_t stress_parsort_methods[] = {
+	{ "all",	NULL,					false },
+	{ "mergesort",	stress_sort_mergesort_int32_par,	true },
+	{ "radixsort",	stress_sort_radixsort_int32_par,	true },
+	{ "network",	stress_parsort_network,			false },
+};
+
+#define PARSORT_METHODS	(SIZEOF_ARRAY(stress_parsort_methods))
+
+static stress_parsort_stats_t stress_parsort_stats[PARSORT_METHODS][PARSORT_SIZES][PARSORT_THREAD_STEPS];
+
+/*
+ *  stress_parsort_checksum()
+ *	order independent checksum of the data
+ */
+static uint64_t stress_parsort_checksum(const int32_t *data, const size_t n)
+{
+	register uint64_t sum = 0, xor = 0;
+	register size_t i;
+
+	for (i = 0; i < n; i++) {
+		sum += (uint64_t)(uint32_t)data[i];
+		xor ^= (uint64_t)(uint32_t)data[i];
+	}
+	return sum ^ (xor << 32);
+}
+
+/*
+ *  stress_parsort_verify()
+ *	check data is sorted and contains the original elements
+ */
+static int stress_parsort_verify(
+	stress_args_t *args,
+	const char *method,
+	const int32_t *data,
+	const size_t n,
+	const size_t n_threads,
+	const uint64_t checksum)
+{
+	register size_t i;
+
+	for (i = 1; i < n; i++) {
+		if (UNLIKELY(data[i - 1] > data[i])) {
+			pr_fail("%s: %s sort of %zu elements with %zu thread%s not in order at index %zu\n",
+				args->name, method, n, n_threads,
+				(n_threads == 1) ? "" : "s", i);
+			return EXIT_FAILURE;
+		}
+	}
+	if (stress_parsort_checksum(data, n) != checksum) {
+		pr_fail("%s: %s sort of %zu elements with %zu thread%s checksum mismatch\n",
+			args->name, method, n, n_threads,
+			(n_threads == 1) ? "" : "s");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_parsort_report()
+ *	report Melem/s and parallel efficiency, metrics are for
+ *	the largest size only to keep within the metrics limit
+ */
+static void stress_parsort_report(
+	stress_args_t *args,
+	const size_t *sizes,
+	const size_t n_sizes,
+	const size_t *threads,
+	const size_t n_thread_steps)
+{
+	size_t m, s, t, idx = 0;
+
+	if (stress_instance_zero(args)) {
+		pr_block_begin();
+		pr_inf("%s: %-10s %10s %8s %10s %10s\n", args->name,
+			"method", "elements", "threads", "Melem/s", "efficiency");
+	}
+	for (m = 1; m < PARSORT_METHODS; m++) {
+		const size_t steps = stress_parsort_methods[m].threaded ? n_thread_steps : 1;
+
+		for (s = 0; s < n_sizes; s++) {
+			const stress_parsort_stats_t *base = &stress_parsort_stats[m][s][0];
+			const double rate1 = (base->duration > 0.0) ? base->elements / base->duration : 0.0;
+
+			for (t = 0; t < steps; t++) {
+				const stress_parsort_stats_t *stats = &stress_parsort_stats[m][s][t];
+				const double rate = (stats->duration > 0.0) ? stats->elements / stats->duration : 0.0;
+				const double efficiency = (rate1 > 0.0) ?
+					100.0 * rate / ((double)threads[t] * rate1) : 0.0;
+				char str[64];
+
+				if (stats->duration <= 0.0)
+					continue;
+				if (stress_instance_zero(args))
+					pr_inf("%s: %-10s %10zu %8zu %10.2f %9.1f%%\n",
+						args->name, stress_parsort_methods[m].name,
+						sizes[s], threads[t], rate / 1000000.0, efficiency);
+				if (s != n_sizes - 1)
+					continue;
+				(void)snprintf(str, sizeof(str), "%s %zu threads Melem per sec",
+					stress_parsort_methods[m].name, threads[t]);
+				stress_metrics_set(args, idx++, str, rate / 1000000.0,
+					STRESS_METRIC_HARMONIC_MEAN);
+				if (!stress_parsort_methods[m].threaded)
+					continue;
+				(void)snprintf(str, sizeof(str), "%s %zu threads %% efficiency",
+					stress_parsort_methods[m].name, threads[t]);
+				stress_metrics_set(args, idx++, str, efficiency,
+					STRESS_METRIC_GEOMETRIC_MEAN);
+			}
+		}
+	}
+	if (stress_instance_zero(args))
+		pr_block_end();
+}
+
+/*
+ *  stress_parsort()
+ *	stress parallel sorting
+ */
+static int stress_parsort(stress_args_t *args)
+{
+	size_t parsort_method = 0;
+	size_t parsort_size = DEFAULT_PARSORT_SIZE;
+	size_t parsort_threads = 0;
+	size_t sizes[PARSORT_SIZES], threads[PARSORT_THREAD_STEPS];
+	size_t n_sizes, n_thread_steps, buf_size, i, n;
+	int32_t *buf, *orig, *data, *tmp;
+	uint64_t checksums[PARSORT_SIZES];
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("parsort-method", &parsort_method);
+	if (!stress_get_setting("parsort-size", &parsort_size)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			parsort_size = MAX_PARSORT_SIZE;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			parsort_size = MIN_PARSORT_SIZE;
+	}
+	if (!stress_get_setting("parsort-threads", &parsort_threads) || (parsort_threads == 0)) {
+		const int32_t cpus = stress_get_processors_online();
+		const size_t instances = (args->instances > 0) ? (size_t)args->instances : 1;
+
+		parsort_threads = (cpus > 0) ? (size_t)cpus / instances : 1;
+	}
+	if (parsort_threads < 1)
+		parsort_threads = 1;
+	if (parsort_threads > MAX_PARSORT_THREADS)
+		parsort_threads = MAX_PARSORT_THREADS;
+
+	for (n_sizes = 0, n = MIN_PARSORT_SIZE; (n <= parsort_size) && (n_sizes < PARSORT_SIZES); n <<= 2)
+		sizes[n_sizes++] = n;
+	if ((n_sizes < PARSORT_SIZES) && (sizes[n_sizes - 1] != parsort_size))
+		sizes[n_sizes++] = parsort_size;
+	parsort_size = sizes[n_sizes - 1];
+
+	for (n_thread_steps = 0, n = 1; n < parsort_threads; n <<= 1)
+		threads[n_thread_steps++] = n;
+	threads[n_thread_steps++] = parsort_threads;
+
+	if (stress_instance_zero(args))
+		pr_dbg("%s: using method '%s', up to %zu elements and %zu thread%s\n",
+			args->name, stress_parsort_methods[parsort_method].name,
+			parsort_size, parsort_threads, (parsort_threads == 1) ? "" : "s");
+
+	buf_size = 3 * parsort_size * sizeof(*buf);
+	buf = (int32_t *)stress_mmap_populate(NULL, buf_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu byte buffer%s, errno=%d (%s), "
+			"skipping stressor\n", args->name, buf_size,
+			stress_get_memfree_str(), errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, buf_size, "parsort-data");
+	orig = buf;
+	data = orig + parsort_size;
+	tmp = data + parsort_size;
+
+	for (i = 0; i < parsort_size; i++)
+		orig[i] = (int32_t)stress_mwc32();
+	for (i = 0; i < n_sizes; i++)
+		checksums[i] = stress_parsort_checksum(orig, sizes[i]);
+	(void)shim_memset(stress_parsort_stats, 0, sizeof(stress_parsort_stats));
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		size_t m, s, t;
+
+		for (m = 1; m < PARSORT_METHODS; m++) {
+			const stress_parsort_method_t *method = &stress_parsort_methods[m];
+			const size_t steps = method->threaded ? n_thread_steps : 1;
+
+			if ((parsort_method != 0) && (parsort_method != m))
+				continue;
+
+			for (s = 0; s < n_sizes; s++) {
+				for (t = 0; t < steps; t++) {
+					stress_parsort_stats_t *stats = &stress_parsort_stats[m][s][t];
+					double t1, t2;
+
+					if (UNLIKELY(!stress_continue(args)))
+						goto finish;
+
+					(void)shim_memcpy(data, orig, sizes[s] * sizeof(*data));
+					t1 = stress_time_now();
+					if (UNLIKELY(method->func(data, tmp, sizes[s], threads[t]) < 0)) {
+						pr_inf_skip("%s: %s sort out of memory, skipping stressor\n",
+							args->name, method->name);
+						rc = EXIT_NO_RESOURCE;
+						goto finish;
+					}
+					t2 = stress_time_now();
+					stats->duration += t2 - t1;
+					stats->elements += (double)sizes[s];
+					stress_bogo_inc(args);
+
+					if (verify) {
+						rc = stress_parsort_verify(args, method->name, data,
+							sizes[s], threads[t], checksums[s]);
+						if (rc != EXIT_SUCCESS)
+							goto finish;
+					}
+				}
+			}
+		}
+	} while (stress_continue(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_parsort_report(args, sizes, n_sizes, threads, n_thread_steps);
+	(void)munmap((void *)buf, buf_size);
+
+	return rc;
+}
+
+static const char *stress_parsort_method(const size_t i)
+{
+	return (i < PARSORT_METHODS) ? stress_parsort_methods[i].name : NULL;
+}
+
+static const stress_opt_t opts[] = {
+	{ OPT_parsort_method,  "parsort-method",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_parsort_method },
+	{ OPT_parsort_size,    "parsort-size",    TYPE_ID_SIZE_T, MIN_PARSORT_SIZE, MAX_PARSORT_SIZE, NULL },
+	{ OPT_parsort_threads, "parsort-threads", TYPE_ID_SIZE_T, MIN_PARSORT_THREADS, MAX_PARSORT_THREADS, NULL },
+	END_OPT,
+};
+
+const stressor_info_t stress_parsort_info = {
+	.stressor = stress_parsort,
+	.classifier = CLASS_CPU_CACHE | CLASS_CPU | CLASS_SORT,
+	.opts = opts,
+	.verify = VERIFY_OPTIONAL,
+	.help = help
+};
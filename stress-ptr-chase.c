@@ -18,7 +18,12 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-cpu-cache.h"
+#include "core-memory.h"
 #include "core-mmap.h"
+#include "core-put.h"
+
+#include <math.h>
 
 #define MIN_NEXT_PTRS_4K_PAGES		(64)
 #define MAX_NEXT_PTRS_4K_PAGES		(256 * 1024)
@@ -27,10 +32,26 @@
 
 #define PTRS_PER_4K_PAGE		(PAGE_SIZE_4K / sizeof(void *))	/* Must be power of 2 */
 
+#define MIN_SWEEP_MAX			(64 * KB)
+#define MAX_SWEEP_MAX			(MAX_MEM_LIMIT)
+#define SWEEP_MIN_SIZE			(4 * KB)	/* first working set size */
+#define SWEEP_DEFAULT_MIN		(64 * MB)	/* default sweep limits */
+#define SWEEP_DEFAULT_MAX		(1 * GB)
+#define SWEEP_MAX_STEPS			(64)
+#define SWEEP_MAX_LEVELS		(4)
+#define SWEEP_CHUNK_LOADS		(4096)		/* loads between timer reads */
+#define SWEEP_MIN_LOADS			(65536)		/* minimum loads per step */
+#define SWEEP_STEP_TIME			(0.01)		/* minimum seconds per step */
+#define SWEEP_RISE_RATIO		(1.08)		/* latency rise between steps */
+#define SWEEP_KNEE_RATIO		(1.30)		/* latency rise over a knee */
+#define SWEEP_KNEE_OCTAVES		(1.5)		/* knee to cache size tolerance */
+
 static const stress_help_t help[] = {
 	{ NULL,	"ptr-chase N",	 	"start N workers that chase pointers around many nodes" },
 	{ NULL,	"ptr-chase-ops N",	"stop after N bogo pointer chase operations" },
 	{ NULL,	"ptr-chase-pages N",	"N is the number of pages for nodes of pointers" },
+	{ NULL,	"ptr-chase-sweep",	"measure load latency over a sweep of working set sizes" },
+	{ NULL,	"ptr-chase-sweep-max N","maximum working set size of the latency sweep" },
 	{ NULL,	NULL,		 	NULL }
 };
 
@@ -39,11 +60,434 @@ typedef struct stress_ptrs {
 	struct stress_ptrs *next[PTRS_PER_4K_PAGE];
 } stress_ptrs_t;
 
+/* A point on the latency vs working set size curve */
+typedef struct {
+	size_t size;		/* working set size in bytes */
+	double ns;		/* best nanoseconds per load */
+} stress_ptr_sweep_t;
+
+/* A step up in latency, the working set no longer fits a cache level */
+typedef struct {
+	size_t size;		/* largest working set before the rise */
+	double ns;		/* nanoseconds per load before the rise */
+	uint16_t level;		/* matching cache level, 0 if none */
+} stress_ptr_knee_t;
+
 static const stress_opt_t opts[] = {
-	{ OPT_ptr_chase_pages, "ptr-chase-pages", TYPE_ID_UINT64, MIN_NEXT_PTRS_4K_PAGES, MAX_NEXT_PTRS_4K_PAGES, NULL },
+	{ OPT_ptr_chase_pages,     "ptr-chase-pages",     TYPE_ID_UINT64, MIN_NEXT_PTRS_4K_PAGES, MAX_NEXT_PTRS_4K_PAGES, NULL },
+	{ OPT_ptr_chase_sweep,     "ptr-chase-sweep",     TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_ptr_chase_sweep_max, "ptr-chase-sweep-max", TYPE_ID_SIZE_T_BYTES_VM, MIN_SWEEP_MAX, MAX_SWEEP_MAX, NULL },
 	END_OPT,
 };
 
+/*
+ *  stress_ptr_chase_sweep_chain()
+ *	link the first pointer of each cache line into a random
+ *	single cycle through all the lines using Sattolo's algorithm
+ */
+static void *stress_ptr_chase_sweep_chain(
+	uint8_t *buf,
+	const size_t lines,
+	const size_t line_size)
+{
+	size_t i;
+
+	for (i = 0; i < lines; i++)
+		*(void **)(buf + (i * line_size)) = (void *)(buf + (i * line_size));
+
+	for (i = lines - 1; i > 0; i--) {
+		const size_t j = (size_t)stress_mwc64modn((uint64_t)i);
+		void **pi = (void **)(buf + (i * line_size));
+		void **pj = (void **)(buf + (j * line_size));
+		void *tmp = *pi;
+
+		*pi = *pj;
+		*pj = tmp;
+	}
+	return (void *)buf;
+}
+
+/*
+ *  stress_ptr_chase_sweep_loads()
+ *	follow n dependent loads along the chain, n must be
+ *	a multiple of 16
+ */
+static void * OPTIMIZE3 stress_ptr_chase_sweep_loads(void *ptr, const size_t n)
+{
+	register void **p = (void **)ptr;
+	register size_t i;
+
+	for (i = 0; i < n; i += 16) {
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+	}
+	return (void *)p;
+}
+
+/*
+ *  stress_ptr_chase_sweep_step()
+ *	measure the nanoseconds per load for a working set of
+ *	size bytes, returns -1 if stopped early, 0 on success
+ *	and 1 if the chain has been corrupted
+ */
+static int stress_ptr_chase_sweep_step(
+	stress_args_t *args,
+	uint8_t *buf,
+	const size_t size,
+	const size_t line_size,
+	double *ns)
+{
+	const size_t lines = size / line_size;
+	uint64_t loads = 0;
+	double t_start, duration;
+	void *ptr;
+
+	ptr = stress_ptr_chase_sweep_chain(buf, lines, line_size);
+	ptr = stress_ptr_chase_sweep_loads(ptr, SWEEP_CHUNK_LOADS);
+
+	t_start = stress_time_now();
+	do {
+		ptr = stress_ptr_chase_sweep_loads(ptr, SWEEP_CHUNK_LOADS);
+		loads += SWEEP_CHUNK_LOADS;
+		stress_bogo_add(args, SWEEP_CHUNK_LOADS);
+		duration = stress_time_now() - t_start;
+	} while (stress_continue(args) &&
+		 ((loads < SWEEP_MIN_LOADS) || (duration < SWEEP_STEP_TIME)));
+	stress_void_ptr_put(ptr);
+
+	if (((uint8_t *)ptr < buf) || ((uint8_t *)ptr >= buf + size) ||
+	    (((uintptr_t)((uint8_t *)ptr - buf) % line_size) != 0)) {
+		pr_fail("%s: pointer chain of %zu bytes corrupted, "
+			"got pointer %p outside of %p..%p\n",
+			args->name, size, ptr, (void *)buf, (void *)(buf + size - 1));
+		return 1;
+	}
+	if (loads < SWEEP_MIN_LOADS)
+		return -1;
+	*ns = (duration * STRESS_DBL_NANOSECOND) / (double)loads;
+	return 0;
+}
+
+/*
+ *  stress_ptr_chase_sweep_knees()
+ *	find the steps up in the latency curve, a knee is the
+ *	largest working set size before a run of rising latencies
+ *	that rises by at least SWEEP_KNEE_RATIO overall
+ */
+static size_t stress_ptr_chase_sweep_knees(
+	const stress_ptr_sweep_t *curve,
+	const size_t n,
+	stress_ptr_knee_t *knees,
+	const size_t max_knees)
+{
+	size_t i = 0, n_knees = 0;
+
+	while ((i + 1 < n) && (n_knees < max_knees)) {
+		size_t j;
+
+		if (curve[i + 1].ns < curve[i].ns * SWEEP_RISE_RATIO) {
+			i++;
+			continue;
+		}
+		for (j = i + 1; j + 1 < n; j++) {
+			if (curve[j + 1].ns < curve[j].ns * SWEEP_RISE_RATIO)
+				break;
+		}
+		if (curve[j].ns >= curve[i].ns * SWEEP_KNEE_RATIO) {
+			knees[n_knees].size = curve[i].size;
+			knees[n_knees].ns = curve[i].ns;
+			knees[n_knees].level = 0;
+			n_knees++;
+		}
+		i = j;
+	}
+	return n_knees;
+}
+
+/*
+ *  stress_ptr_chase_sweep_ns()
+ *	latency of the curve point closest to size bytes
+ */
+static double stress_ptr_chase_sweep_ns(
+	const stress_ptr_sweep_t *curve,
+	const size_t n,
+	const size_t size)
+{
+	size_t i, best = 0;
+	double best_delta = HUGE_VAL;
+
+	for (i = 0; i < n; i++) {
+		const double delta = fabs(log2((double)curve[i].size / (double)size));
+
+		if (delta < best_delta) {
+			best_delta = delta;
+			best = i;
+		}
+	}
+	return curve[best].ns;
+}
+
+/*
+ *  stress_ptr_chase_sweep_report()
+ *	match the latency knees to the cache sizes, report any
+ *	mismatches and set the latency metrics and curve
+ */
+static void stress_ptr_chase_sweep_report(
+	stress_args_t *args,
+	const stress_ptr_sweep_t *curve,
+	const size_t n,
+	const size_t *cache_sizes,
+	const uint16_t max_level)
+{
+	stress_ptr_knee_t knees[SWEEP_MAX_LEVELS];
+	const bool report = stress_instance_zero(args);
+	const size_t max_size = curve[n - 1].size;
+	size_t i, n_knees, idx = 0, llc_size = 0;
+	uint16_t level, levels;
+	char str1[32], str2[32];
+	char description[64];
+
+	n_knees = stress_ptr_chase_sweep_knees(curve, n, knees, SIZEOF_ARRAY(knees));
+
+	/* match each reported cache size to the closest knee */
+	for (level = 1; level <= max_level; level++) {
+		const size_t cache_size = cache_sizes[level - 1];
+		double best_delta = SWEEP_KNEE_OCTAVES;
+		size_t best = n_knees;
+
+		if (!cache_size)
+			continue;
+		llc_size = cache_size;
+		for (i = 0; i < n_knees; i++) {
+			const double delta = fabs(log2((double)knees[i].size / (double)cache_size));
+
+			if (!knees[i].level && (delta <= best_delta)) {
+				best_delta = delta;
+				best = i;
+			}
+		}
+		if (best < n_knees)
+			knees[best].level = level;
+	}
+	/* no cache information, assume the knees are the cache levels */
+	if (!llc_size) {
+		for (i = 0; i < n_knees; i++)
+			knees[i].level = (uint16_t)(i + 1);
+	}
+	levels = llc_size ? max_level : (uint16_t)n_knees;
+
+	for (level = 1; level <= levels; level++) {
+		const size_t cache_size = llc_size ? cache_sizes[level - 1] : 0;
+		const stress_ptr_knee_t *knee = NULL;
+		double ns;
+
+		for (i = 0; i < n_knees; i++) {
+			if (knees[i].level == level)
+				knee = &knees[i];
+		}
+		if (knee) {
+			ns = knee->ns;
+			if (report) {
+				if (cache_size) {
+					pr_inf("%s: L%" PRIu16 " cache %s, latency knee at %s, %.2f ns per load\n",
+						args->name, level,
+						stress_uint64_to_str(str1, sizeof(str1), (uint64_t)cache_size, 1, true),
+						stress_uint64_to_str(str2, sizeof(str2), (uint64_t)knee->size, 1, true), ns);
+				} else {
+					pr_inf("%s: L%" PRIu16 " latency knee at %s, %.2f ns per load\n",
+						args->name, level,
+						stress_uint64_to_str(str2, sizeof(str2), (uint64_t)knee->size, 1, true), ns);
+				}
+			}
+		} else if (cache_size) {
+			ns = stress_ptr_chase_sweep_ns(curve, n, cache_size / 2);
+			if (report) {
+				if (cache_size >= max_size) {
+					pr_inf("%s: L%" PRIu16 " cache %s is larger than the sweep, "
+						"increase --ptr-chase-sweep-max to find its latency knee\n",
+						args->name, level,
+						stress_uint64_to_str(str1, sizeof(str1), (uint64_t)cache_size, 1, true));
+				} else {
+					pr_inf("%s: L%" PRIu16 " cache %s, no latency knee found near this size, "
+						"%.2f ns per load at half the cache size\n",
+						args->name, level,
+						stress_uint64_to_str(str1, sizeof(str1), (uint64_t)cache_size, 1, true), ns);
+				}
+			}
+		} else {
+			continue;
+		}
+		(void)snprintf(description, sizeof(description), "L%" PRIu16 " knee working set KB", level);
+		stress_metrics_set(args, idx++, description,
+			knee ? (double)knee->size / (double)KB : 0.0, STRESS_METRIC_GEOMETRIC_MEAN);
+		(void)snprintf(description, sizeof(description), "nanosec per load L%" PRIu16, level);
+		stress_metrics_set(args, idx++, description,
+			ns, STRESS_METRIC_HARMONIC_MEAN);
+	}
+
+	if (report) {
+		for (i = 0; i < n_knees; i++) {
+			if (knees[i].level)
+				continue;
+			pr_inf("%s: latency knee at %s, %.2f ns per load, does not match any reported cache size\n",
+				args->name,
+				stress_uint64_to_str(str2, sizeof(str2), (uint64_t)knees[i].size, 1, true),
+				knees[i].ns);
+		}
+	}
+
+	/* memory latency, only if the sweep got well past the last knee or cache */
+	if (n_knees && (max_size >= 2 * STRESS_MAXIMUM(llc_size, knees[n_knees - 1].size))) {
+		if (report)
+			pr_inf("%s: memory latency %.2f ns per load at %s\n",
+				args->name, curve[n - 1].ns,
+				stress_uint64_to_str(str1, sizeof(str1), (uint64_t)max_size, 1, true));
+		stress_metrics_set(args, idx++, "nanosec per load memory",
+			curve[n - 1].ns, STRESS_METRIC_HARMONIC_MEAN);
+	} else if (report) {
+		pr_inf("%s: sweep of %s does not reach memory, "
+			"increase --ptr-chase-sweep-max to measure memory latency\n",
+			args->name,
+			stress_uint64_to_str(str1, sizeof(str1), (uint64_t)max_size, 1, true));
+	}
+
+	for (i = 0; i < n; i++) {
+		(void)snprintf(description, sizeof(description), "nanosec per load %s",
+			stress_uint64_to_str(str1, sizeof(str1), (uint64_t)curve[i].size, 1, true));
+		stress_metrics_set(args, idx++, description,
+			curve[i].ns, STRESS_METRIC_HARMONIC_MEAN);
+	}
+}
+
+/*
+ *  stress_ptr_chase_sweep()
+ *	measure load-to-use latency as the working set grows from
+ *	4K to the sweep maximum in half octave steps, each step
+ *	follows a random chain through every cache line of the
+ *	working set so each load depends on the previous one
+ */
+static int stress_ptr_chase_sweep(stress_args_t *args)
+{
+	stress_ptr_sweep_t curve[SWEEP_MAX_STEPS];
+	size_t cache_sizes[SWEEP_MAX_LEVELS];
+	size_t sweep_max = 0, line_size = 64, freemem, totalmem, freeswap, totalswap, shmall;
+	size_t i, n, llc_size = 0;
+	stress_cpu_cache_cpus_t *cpu_caches;
+	uint16_t level, max_level = 0;
+	uint8_t *buf;
+	uint32_t sweeps = 0;
+	int rc = EXIT_SUCCESS;
+
+	(void)shim_memset(cache_sizes, 0, sizeof(cache_sizes));
+	cpu_caches = stress_cpu_cache_get_all_details();
+	if (cpu_caches) {
+		max_level = stress_cpu_cache_get_max_level(cpu_caches);
+		max_level = STRESS_MINIMUM(max_level, SWEEP_MAX_LEVELS);
+		for (level = 1; level <= max_level; level++) {
+			const stress_cpu_cache_t *cache = stress_cpu_cache_get(cpu_caches, level);
+
+			if (!cache)
+				continue;
+			cache_sizes[level - 1] = (size_t)cache->size;
+			llc_size = STRESS_MAXIMUM(llc_size, (size_t)cache->size);
+			if ((level == 1) && (cache->line_size >= sizeof(void *)))
+				line_size = (size_t)cache->line_size;
+		}
+		stress_free_cpu_caches(cpu_caches);
+	}
+
+	if (!stress_get_setting("ptr-chase-sweep-max", &sweep_max)) {
+		sweep_max = STRESS_MAXIMUM((size_t)SWEEP_DEFAULT_MIN, llc_size * 4);
+		sweep_max = STRESS_MINIMUM(sweep_max, (size_t)SWEEP_DEFAULT_MAX);
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			sweep_max = MIN_SWEEP_MAX;
+
+		/* keep the default sweep to half the free memory */
+		stress_get_memlimits(&shmall, &freemem, &totalmem, &freeswap, &totalswap);
+		if (freemem) {
+			const size_t limit = freemem / (2 * (size_t)args->instances);
+
+			sweep_max = STRESS_MINIMUM(sweep_max, limit);
+			sweep_max = STRESS_MAXIMUM(sweep_max, (size_t)MIN_SWEEP_MAX);
+		}
+	}
+
+	for (n = 0; n < SWEEP_MAX_STEPS; n++) {
+		const size_t base = (size_t)SWEEP_MIN_SIZE << (n / 2);
+		const size_t size = (n & 1) ? base + (base / 2) : base;
+
+		if (!base || (size > sweep_max) || (size < base))
+			break;
+		curve[n].size = size;
+		curve[n].ns = HUGE_VAL;
+	}
+	sweep_max = curve[n - 1].size;
+
+	buf = (uint8_t *)stress_mmap_populate(NULL, sweep_max,
+				PROT_READ | PROT_WRITE,
+				MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes%s, "
+			"errno=%d (%s), skipping stressor\n",
+			args->name, sweep_max,
+			stress_get_memfree_str(), errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, sweep_max, "pointer-sweep");
+
+	if (stress_instance_zero(args))
+		pr_dbg("%s: sweeping %zu working set sizes from %zu to %zu bytes, %zu byte cache lines\n",
+			args->name, n, curve[0].size, sweep_max, line_size);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	/* keep the fastest time of each step over repeated sweeps */
+	do {
+		for (i = 0; i < n; i++) {
+			double ns;
+			const int ret = stress_ptr_chase_sweep_step(args, buf, curve[i].size, line_size, &ns);
+
+			if (ret > 0) {
+				rc = EXIT_FAILURE;
+				goto tidy;
+			}
+			if (ret < 0)
+				break;
+			curve[i].ns = STRESS_MINIMUM(curve[i].ns, ns);
+		}
+		if (i == n)
+			sweeps++;
+	} while (stress_continue(args));
+
+	if (sweeps) {
+		stress_ptr_chase_sweep_report(args, curve, n, cache_sizes, max_level);
+	} else if (stress_instance_zero(args)) {
+		pr_inf("%s: run time too short to complete a latency sweep, "
+			"no latencies reported\n", args->name);
+	}
+tidy:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)munmap((void *)buf, sweep_max);
+
+	return rc;
+}
+
 /*
  *  stress_ptr_chase()
  *	stress list
@@ -61,6 +505,11 @@ static int stress_ptr_chase(stress_args_t *args)
 	size_t alloc_size;
 	double metric, t_start, duration;
 	uint64_t counter;
+	bool ptr_chase_sweep = false;
+
+	(void)stress_get_setting("ptr-chase-sweep", &ptr_chase_sweep);
+	if (ptr_chase_sweep)
+		return stress_ptr_chase_sweep(args);
 
 	if (!stress_get_setting("ptr-chase-pages", &ptr_chase_pages)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -164,7 +613,7 @@ static int stress_ptr_chase(stress_args_t *args)
 
 	counter = stress_bogo_get(args);
 	metric = (counter > 0) ? (duration * STRESS_DBL_NANOSECOND) / (double)counter: 0.0;
-	stress_metrics_set(args, 0, "nanosec per pointer", metric, STRESS_METRIC_HARMONIC_MEAN);
+	stress_metrics_set(args, 1, "nanosec per pointer", metric, STRESS_METRIC_HARMONIC_MEAN);
 
 	rc = EXIT_SUCCESS;
 
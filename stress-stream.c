@@ -29,19 +29,34 @@
  *
  */
 #include "stress-ng.h"
+#include "core-affinity.h"
+#include "core-builtin.h"
 #include "core-cpu.h"
 #include "core-cpu-cache.h"
 #include "core-mmap.h"
 #include "core-nt-store.h"
 #include "core-numa.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 #include "core-target-clones.h"
+#include "core-vmstat.h"
 
 #include <math.h>
+#include <sched.h>
 
 #define MIN_STREAM_L3_SIZE	(4 * KB)
 #define MAX_STREAM_L3_SIZE	(MAX_MEM_LIMIT)
 #define DEFAULT_STREAM_L3_SIZE	(4 * MB)
+#define MAX_STREAM_THREADS	(4096)
+
+#define STREAM_INIT_ROUNDS	(64)	/* kernel rounds between data re-initializations */
+#define STREAM_MATRIX_TIME	(0.25)	/* seconds per node to node measurement */
+#define STREAM_POLL_NS		(100000000ULL)
+
+#if defined(HAVE_LINUX_MEMPOLICY_H) &&	\
+    defined(__NR_mbind)
+#define HAVE_STREAM_NUMA_MATRIX	(1)
+#endif
 
 #if defined(HAVE_NT_STORE_DOUBLE)
 #define NT_STORE(dst, src)		stress_nt_store_double(&dst, src)
@@ -60,11 +75,47 @@ static const stress_help_t help[] = {
 	{ NULL,	"stream-l3-size N",	"specify the L3 cache size of the CPU" },
 	{ NULL,	"stream-madvise M",	"specify mmap'd stream buffer madvise advice" },
 	{ NULL,	"stream-mlock",		"attempt to mlock pages into memory" },
+	{ NULL,	"stream-numa-matrix",	"measure node to node bandwidth, needs --stream-threads" },
 	{ NULL, "stream-prefetch",	"use prefetching (where available)" },
+	{ NULL,	"stream-threads N",	"split the arrays between N threads, 0 = one per CPU" },
 	{ NULL,	"stream-ops N",		"stop after N bogo stream operations" },
 	{ NULL,	NULL,                   NULL }
 };
 
+#if defined(HAVE_LIB_PTHREAD)
+/* State shared by the cooperative stream threads */
+typedef struct {
+	stress_args_t *args;	/* stressor args */
+	bool has_sse2;		/* use non-temporal stores */
+	bool stream_prefetch;	/* use prefetching */
+	bool verify;		/* verify the data after each round */
+	volatile bool go;	/* set when all the threads are initialized */
+	volatile bool stop;	/* set to stop the threads */
+} stress_stream_coop_t;
+
+/* Per-thread state of a cooperative stream thread */
+typedef struct {
+	stress_stream_coop_t *coop;	/* shared state */
+	pthread_t pthread;	/* pthread handle */
+	int ret;		/* pthread create return value */
+	int rc;			/* verify result */
+	int32_t cpu;		/* CPU the thread is pinned to, -1 if not pinned */
+	int32_t node;		/* NUMA node of the CPU */
+	double *a, *b, *c;	/* thread's slice of the arrays */
+	uint64_t n;		/* number of elements in the slice */
+	double v;		/* initial data value */
+	bool first_touch;	/* thread initializes its slice */
+	double duration;	/* run time after initialization, 0.0 to run until stopped */
+	volatile bool ready;	/* slice initialized, waiting to go */
+	volatile bool done;	/* thread has finished */
+	double rd_bytes;	/* bytes read */
+	double wr_bytes;	/* bytes written */
+	double fp_ops;		/* floating point operations */
+	double dt;		/* time in the stream kernels */
+	uint64_t rounds;	/* kernel rounds completed */
+} stress_stream_thread_t;
+#endif
+
 static const stress_stream_madvise_info_t stream_madvise_info[] = {
 #if !defined(HAVE_MADVISE)
 	/* No MADVISE, default to normal, ignored */
@@ -882,6 +933,42 @@ PRAGMA_UNROLL_N(8)
 	return checksum;
 }
 
+/*
+ *  stress_stream_mmap_advise()
+ *	apply --stream-mlock and --stream-madvise to a stream buffer,
+ *	with on_fault the pages are only locked as they are touched so
+ *	that a buffer that is not populated keeps first touch placement
+ */
+static void stress_stream_mmap_advise(
+	void *ptr,
+	const size_t sz,
+	const bool stream_mlock,
+	const bool on_fault)
+{
+	if (stream_mlock) {
+#if defined(MLOCK_ONFAULT)
+		if (!on_fault || (shim_mlock2(ptr, sz, MLOCK_ONFAULT) < 0))
+			(void)shim_mlock(ptr, sz);
+#else
+		(void)on_fault;
+		(void)shim_mlock(ptr, sz);
+#endif
+	}
+#if defined(HAVE_MADVISE)
+	{
+		size_t stream_madvise;
+		int advice = MADV_NORMAL;
+
+		if (stress_get_setting("stream-madvise", &stream_madvise))
+			advice = stream_madvise_info[stream_madvise].advice;
+
+		VOID_RET(int, madvise(ptr, sz, advice));
+	}
+#else
+	UNEXPECTED
+#endif
+}
+
 static inline void *stress_stream_mmap(
 	stress_args_t *args,
 	const uint64_t sz,
@@ -904,19 +991,7 @@ static inline void *stress_stream_mmap(
 		ptr = MAP_FAILED;
 	} else {
 		stress_set_vma_anon_name(ptr, sz, "stream-buffer");
-		if (stream_mlock)
-			(void)shim_mlock(ptr, (size_t)sz);
-#if defined(HAVE_MADVISE)
-		size_t stream_madvise;
-		int advice = MADV_NORMAL;
-
-		if (stress_get_setting("stream-madvise", &stream_madvise))
-			advice = stream_madvise_info[stream_madvise].advice;
-
-		VOID_RET(int, madvise(ptr, (size_t)sz, advice));
-#else
-		UNEXPECTED
-#endif
+		stress_stream_mmap_advise(ptr, (size_t)sz, stream_mlock, false);
 	}
 	return ptr;
 }
@@ -1143,6 +1218,478 @@ static int OPTIMIZE3 TARGET_CLONES stress_stream_verify(
 	return EXIT_SUCCESS;
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+/*
+ *  stress_stream_init_slice()
+ *	initialize a thread's slice of the arrays, the values
+ *	are the same on each call so the checksum can be verified
+ */
+static void stress_stream_init_slice(const stress_stream_thread_t *thread)
+{
+	register uint64_t i;
+	register const double v = thread->v;
+
+	for (i = 0; i < thread->n; i++) {
+		thread->a[i] = v;
+		thread->b[i] = v + 1.0;
+		thread->c[i] = v + 2.0;
+	}
+}
+
+/*
+ *  stress_stream_thread()
+ *	run the stream kernels on a slice of the arrays, the
+ *	thread first touches its slice so the pages are
+ *	allocated on the NUMA node of the CPU it is pinned to
+ */
+static void *stress_stream_thread(void *arg)
+{
+	stress_stream_thread_t *thread = (stress_stream_thread_t *)arg;
+	const stress_stream_coop_t *coop = thread->coop;
+	const double q = 3.0;
+	double old_checksum = -1.0, end_time = 0.0;
+	uint32_t init_counter = 0;
+	sigset_t set;
+
+	/* Block all signals, let the controlling thread handle these */
+	(void)sigfillset(&set);
+	(void)sigprocmask(SIG_BLOCK, &set, NULL);
+
+#if defined(HAVE_SCHED_SETAFFINITY) &&	\
+    defined(HAVE_CPU_SET_T)
+	if (thread->cpu >= 0) {
+		cpu_set_t mask;
+
+		CPU_ZERO(&mask);
+		CPU_SET(thread->cpu, &mask);
+		(void)sched_setaffinity(0, sizeof(mask), &mask);
+	}
+#endif
+	if (thread->first_touch)
+		stress_stream_init_slice(thread);
+	thread->ready = true;
+	while (!coop->go && !coop->stop)
+		(void)shim_nanosleep_uint64(100000ULL);
+	if (thread->duration > 0.0)
+		end_time = stress_time_now() + thread->duration;
+
+	while (!coop->stop) {
+		if ((end_time > 0.0) && (stress_time_now() >= end_time))
+			break;
+		if (coop->verify || (init_counter >= STREAM_INIT_ROUNDS)) {
+			stress_stream_init_slice(thread);
+			init_counter = 0;
+		}
+		init_counter++;
+
+		stress_stream_exercise(&thread->dt, thread->a, thread->b, thread->c,
+				       NULL, NULL, NULL,
+				       &thread->rd_bytes, &thread->wr_bytes, &thread->fp_ops,
+				       q, thread->n, 0, coop->has_sse2, coop->stream_prefetch);
+		if (coop->verify) {
+			thread->rc = stress_stream_verify(coop->args, &old_checksum,
+						thread->a, thread->b, thread->c, thread->n);
+			if (thread->rc != EXIT_SUCCESS)
+				break;
+		}
+		thread->rounds++;
+	}
+	thread->done = true;
+	return &g_nowt;
+}
+
+/*
+ *  stress_stream_threads_run()
+ *	split n elements of the arrays between the threads, start
+ *	them and wait until they finish or the stressor is stopped,
+ *	returns the wall clock run time from when all the threads
+ *	finished initializing their slices
+ */
+static double stress_stream_threads_run(
+	stress_args_t *args,
+	stress_stream_coop_t *coop,
+	stress_stream_thread_t *threads,
+	const size_t n_threads,
+	double *a,
+	double *b,
+	double *c,
+	const uint64_t n,
+	const bool first_touch,
+	const double duration)
+{
+	const uint64_t n_slice = (n / n_threads) & ~(uint64_t)7;
+	double t_start;
+	size_t i;
+	bool running = true;
+
+	coop->go = false;
+	coop->stop = false;
+	for (i = 0; i < n_threads; i++) {
+		stress_stream_thread_t *thread = &threads[i];
+
+		thread->coop = coop;
+		thread->rc = EXIT_SUCCESS;
+		thread->a = a + (i * n_slice);
+		thread->b = b + (i * n_slice);
+		thread->c = c + (i * n_slice);
+		thread->n = n_slice;
+		thread->v = 1.0 / (double)(i + 2);
+		thread->first_touch = first_touch;
+		thread->duration = duration;
+		thread->ready = false;
+		thread->done = false;
+		thread->rd_bytes = 0.0;
+		thread->wr_bytes = 0.0;
+		thread->fp_ops = 0.0;
+		thread->dt = 0.0;
+		thread->rounds = 0;
+		/* entries are reused, mark them all as not created */
+		thread->ret = -1;
+	}
+	for (i = 0; i < n_threads; i++) {
+		stress_stream_thread_t *thread = &threads[i];
+
+		thread->ret = pthread_create(&thread->pthread, NULL,
+				stress_stream_thread, (void *)thread);
+		if (thread->ret) {
+			pr_inf("%s: pthread create failed, errno=%d (%s)\n",
+				args->name, thread->ret, strerror(thread->ret));
+			coop->stop = true;
+			break;
+		}
+	}
+
+	/* start timing once every thread has touched its slice */
+	while (running && !coop->stop) {
+		for (running = false, i = 0; i < n_threads; i++) {
+			if (!threads[i].ready)
+				running = true;
+		}
+		if (!stress_continue(args))
+			coop->stop = true;
+		else if (running)
+			(void)shim_nanosleep_uint64(1000000ULL);
+	}
+	t_start = stress_time_now();
+	coop->go = true;
+
+	running = true;
+	while (running && !coop->stop) {
+		uint64_t rounds = 0;
+
+		(void)shim_nanosleep_uint64(STREAM_POLL_NS);
+		for (running = false, i = 0; i < n_threads; i++) {
+			const stress_stream_thread_t *thread = &threads[i];
+
+			rounds += thread->rounds;
+			if (thread->rc != EXIT_SUCCESS)
+				coop->stop = true;
+			if (!thread->done)
+				running = true;
+		}
+		if (duration == 0.0)
+			stress_bogo_set(args, rounds);
+		if (!stress_continue(args))
+			coop->stop = true;
+	}
+	coop->stop = true;
+
+	for (i = 0; i < n_threads; i++) {
+		stress_stream_thread_t *thread = &threads[i];
+
+		if (!thread->ret)
+			(void)pthread_join(thread->pthread, NULL);
+		thread->ret = -1;
+	}
+	return stress_time_now() - t_start;
+}
+
+#if defined(HAVE_STREAM_NUMA_MATRIX)
+/*
+ *  stress_stream_numa_matrix()
+ *	for each node with CPUs, run the threads pinned to that
+ *	node on arrays bound to each memory node in turn and
+ *	report the node to node bandwidth matrix
+ */
+static void stress_stream_numa_matrix(
+	stress_args_t *args,
+	stress_stream_coop_t *coop,
+	stress_stream_thread_t *threads,
+	const size_t n_threads,
+	const uint64_t n,
+	const bool stream_mlock,
+	size_t *idx)
+{
+	stress_numa_mask_t *numa_nodes, *numa_mask;
+	stress_stream_thread_t *node_threads;
+	const size_t sz = (size_t)n * sizeof(double);
+	unsigned long int cpu_node, mem_node;
+	char buf[1024];
+
+	numa_nodes = stress_numa_mask_alloc();
+	if (!numa_nodes) {
+		pr_inf("%s: cannot determine NUMA nodes, skipping node to node bandwidth matrix\n",
+			args->name);
+		return;
+	}
+	numa_mask = stress_numa_mask_alloc();
+	if (!numa_mask) {
+		pr_inf("%s: cannot allocate NUMA mask, skipping node to node bandwidth matrix\n",
+			args->name);
+		stress_numa_mask_free(numa_nodes);
+		return;
+	}
+	if (stress_numa_mask_nodes_get(numa_nodes) < 1) {
+		pr_inf("%s: no NUMA nodes found, skipping node to node bandwidth matrix\n",
+			args->name);
+		goto free_masks;
+	}
+	node_threads = (stress_stream_thread_t *)calloc(n_threads, sizeof(*node_threads));
+	if (!node_threads) {
+		pr_inf("%s: cannot allocate %zu threads, skipping node to node bandwidth matrix\n",
+			args->name, n_threads);
+		goto free_masks;
+	}
+
+	pr_inf("%s: node to node bandwidth matrix, MB per sec, rows are CPU nodes, columns memory nodes\n",
+		args->name);
+	(void)snprintf(buf, sizeof(buf), "%s:     ", args->name);
+	for (mem_node = 0; mem_node < numa_nodes->max_nodes; mem_node++) {
+		if (STRESS_GETBIT(numa_nodes->mask, mem_node))
+			(void)snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), " %9lu", mem_node);
+	}
+	pr_inf("%s\n", buf);
+
+	for (cpu_node = 0; cpu_node < numa_nodes->max_nodes; cpu_node++) {
+		size_t i, n_node_threads = 0;
+
+		for (i = 0; i < n_threads; i++) {
+			if (threads[i].node == (int32_t)cpu_node)
+				node_threads[n_node_threads++].cpu = threads[i].cpu;
+		}
+		if (!n_node_threads)
+			continue;
+
+		(void)snprintf(buf, sizeof(buf), "%s: %3lu ", args->name, cpu_node);
+		for (mem_node = 0; mem_node < numa_nodes->max_nodes; mem_node++) {
+			double *a, *b, *c, rate, duration;
+
+			if (!STRESS_GETBIT(numa_nodes->mask, mem_node))
+				continue;
+			if (!stress_continue(args))
+				goto free_threads;
+
+			a = (double *)mmap(NULL, 3 * sz, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (a == MAP_FAILED) {
+				pr_inf("%s: failed to mmap %zu bytes%s, errno=%d (%s), "
+					"skipping node to node bandwidth matrix\n",
+					args->name, 3 * sz, stress_get_memfree_str(),
+					errno, strerror(errno));
+				goto free_threads;
+			}
+			stress_set_vma_anon_name(a, 3 * sz, "stream-matrix");
+			b = a + n;
+			c = b + n;
+
+			(void)shim_memset(numa_mask->mask, 0, numa_mask->mask_size);
+			STRESS_SETBIT(numa_mask->mask, mem_node);
+			if (shim_mbind((void *)a, 3 * sz, MPOL_BIND, numa_mask->mask,
+				       numa_mask->max_nodes, MPOL_MF_STRICT) < 0) {
+				pr_inf("%s: cannot bind memory to NUMA node %lu, errno=%d (%s), "
+					"skipping node to node bandwidth matrix\n",
+					args->name, mem_node, errno, strerror(errno));
+				(void)munmap((void *)a, 3 * sz);
+				goto free_threads;
+			}
+			stress_stream_mmap_advise((void *)a, 3 * sz, stream_mlock, true);
+
+			duration = stress_stream_threads_run(args, coop, node_threads, n_node_threads,
+					a, b, c, n, true, STREAM_MATRIX_TIME);
+			for (rate = 0.0, i = 0; i < n_node_threads; i++)
+				rate += node_threads[i].rd_bytes + node_threads[i].wr_bytes;
+			(void)munmap((void *)a, 3 * sz);
+
+			rate = (duration > 0.0) ? (rate / (double)MB) / duration : 0.0;
+			(void)snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), " %9.1f", rate);
+			if (*idx < STRESS_MISC_METRICS_MAX) {
+				char description[96];
+
+				(void)snprintf(description, sizeof(description),
+					"MB per sec node %lu CPUs to node %lu memory", cpu_node, mem_node);
+				stress_metrics_set(args, (*idx)++, description,
+					rate, STRESS_METRIC_HARMONIC_MEAN);
+			}
+		}
+		pr_inf("%s\n", buf);
+	}
+
+free_threads:
+	free(node_threads);
+free_masks:
+	stress_numa_mask_free(numa_mask);
+	stress_numa_mask_free(numa_nodes);
+}
+#endif
+
+/*
+ *  stress_stream_cooperative()
+ *	split one set of arrays between threads pinned to the
+ *	usable CPUs, each thread first touches its own slice so
+ *	the memory is local to the thread's NUMA node, and report
+ *	the aggregate and per NUMA node memory bandwidth
+ */
+static int stress_stream_cooperative(
+	stress_args_t *args,
+	const uint32_t stream_threads,
+	const uint64_t n,
+	const bool has_sse2,
+	const bool stream_prefetch,
+	const bool stream_mlock,
+	const bool verify)
+{
+	stress_stream_coop_t coop;
+	stress_stream_thread_t *threads;
+	uint32_t *cpus = NULL;
+	const uint32_t n_cpus = stress_get_usable_cpus(&cpus, true);
+	size_t n_threads = stream_threads ? (size_t)stream_threads : (size_t)STRESS_MAXIMUM(n_cpus, 1);
+	const size_t sz = (size_t)n * sizeof(double);
+	bool stream_numa_matrix = false;
+	double *a, *b, *c, duration;
+	double rd_bytes = 0.0, wr_bytes = 0.0, fp_ops = 0.0;
+	size_t i, idx = 3;
+	size_t stream_madvise;
+	int32_t node, max_node = 0;
+	int rc = EXIT_SUCCESS;
+	stress_thp_stats_t thp_before, thp_after;
+
+	(void)stress_get_setting("stream-numa-matrix", &stream_numa_matrix);
+	thp_before.valid = false;
+	thp_after.valid = false;
+
+	/* keep at least 64 elements per thread */
+	n_threads = STRESS_MINIMUM(n_threads, (size_t)(n / 64));
+	threads = (stress_stream_thread_t *)calloc(n_threads, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: failed to allocate %zu threads%s, skipping stressor\n",
+			args->name, n_threads, stress_get_memfree_str());
+		stress_free_usable_cpus(&cpus);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < n_threads; i++) {
+		threads[i].cpu = (cpus && n_cpus) ? (int32_t)cpus[i % n_cpus] : -1;
+		threads[i].node = (threads[i].cpu >= 0) ? stress_numa_cpu_node(threads[i].cpu) : 0;
+		max_node = STRESS_MAXIMUM(max_node, threads[i].node);
+	}
+	stress_free_usable_cpus(&cpus);
+
+	/* with explicit advice, report if huge pages were obtained */
+	if (stress_get_setting("stream-madvise", &stream_madvise))
+		(void)stress_thp_stats_get(&thp_before);
+
+	/* not populated, each thread first touches its own slice */
+	a = (double *)mmap(NULL, 3 * sz, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (a == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes%s, errno=%d (%s), "
+			"skipping stressor\n", args->name, 3 * sz,
+			stress_get_memfree_str(), errno, strerror(errno));
+		free(threads);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(a, 3 * sz, "stream-buffer");
+	stress_stream_mmap_advise((void *)a, 3 * sz, stream_mlock, true);
+	b = a + n;
+	c = b + n;
+
+	coop.args = args;
+	coop.has_sse2 = has_sse2;
+	coop.stream_prefetch = stream_prefetch;
+	coop.verify = verify;
+	coop.stop = false;
+
+	if (stress_instance_zero(args))
+		pr_inf("%s: %zu threads sharing %zu bytes of arrays\n",
+			args->name, n_threads, 3 * sz);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+#if defined(HAVE_STREAM_NUMA_MATRIX)
+	if (stream_numa_matrix && stress_instance_zero(args))
+		stress_stream_numa_matrix(args, &coop, threads, n_threads, n, stream_mlock, &idx);
+#else
+	if (stream_numa_matrix && stress_instance_zero(args))
+		pr_inf("%s: NUMA memory binding not supported, skipping node to node bandwidth matrix\n",
+			args->name);
+#endif
+
+	duration = stress_stream_threads_run(args, &coop, threads, n_threads,
+				a, b, c, n, true, 0.0);
+	if (thp_before.valid)
+		(void)stress_thp_stats_get(&thp_after);
+	for (i = 0; i < n_threads; i++) {
+		rd_bytes += threads[i].rd_bytes;
+		wr_bytes += threads[i].wr_bytes;
+		fp_ops += threads[i].fp_ops;
+		if (threads[i].rc != EXIT_SUCCESS)
+			rc = threads[i].rc;
+	}
+
+	if (duration >= 4.5) {
+		const double mb_rd_rate = (rd_bytes / (double)MB) / duration;
+		const double mb_wr_rate = (wr_bytes / (double)MB) / duration;
+		const double mflop_rate = (fp_ops / 1000000.0) / duration;
+
+		pr_inf("%s: aggregate memory rate: %.2f MB read/sec, %.2f MB write/sec, "
+			"%.2f double precision Mflop/sec (instance %" PRIu32 ")\n",
+			args->name, mb_rd_rate, mb_wr_rate, mflop_rate, args->instance);
+		stress_metrics_set(args, 0, "MB per sec memory read rate",
+			mb_rd_rate, STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "MB per sec memory write rate",
+			mb_wr_rate, STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 2, "Mflop per sec (double precision) compute rate",
+			mflop_rate, STRESS_METRIC_HARMONIC_MEAN);
+
+		for (node = 0; node <= max_node; node++) {
+			double node_rate = 0.0;
+			size_t node_threads = 0;
+
+			for (i = 0; i < n_threads; i++) {
+				if (threads[i].node != node)
+					continue;
+				node_rate += threads[i].rd_bytes + threads[i].wr_bytes;
+				node_threads++;
+			}
+			if (!node_threads)
+				continue;
+			node_rate = (node_rate / (double)MB) / duration;
+			pr_inf("%s: node %" PRId32 " memory rate: %.2f MB/sec, %zu threads (instance %" PRIu32 ")\n",
+				args->name, node, node_rate, node_threads, args->instance);
+			if (idx < STRESS_MISC_METRICS_MAX) {
+				char description[64];
+
+				(void)snprintf(description, sizeof(description),
+					"MB per sec node %" PRId32 " memory rate", node);
+				stress_metrics_set(args, idx++, description,
+					node_rate, STRESS_METRIC_HARMONIC_MEAN);
+			}
+		}
+	} else {
+		if (stress_instance_zero(args))
+			pr_inf("%s: run duration too short to reliably determine memory rate\n", args->name);
+	}
+	(void)stress_thp_stats_report(args, &thp_before, &thp_after, 3 * sz, idx);
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)munmap((void *)a, 3 * sz);
+	free(threads);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_stream()
  *	stress cache/memory/CPU with stream stressors
@@ -1159,7 +1706,9 @@ static int stress_stream(stress_args_t *args)
 	uint64_t L3, sz, n, sz_idx;
 	uint64_t stream_L3_size = DEFAULT_STREAM_L3_SIZE;
 	uint32_t init_counter, init_counter_max;
+	uint32_t stream_threads = 0;
 	bool guess = false;
+	bool coop;
 	bool stream_mlock = false;
 	bool stream_prefetch = false;
 #if defined(HAVE_NT_STORE_DOUBLE)
@@ -1169,6 +1718,8 @@ static int stress_stream(stress_args_t *args)
 #endif
 	double rd_bytes = 0.0, wr_bytes = 0.0;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t stream_madvise;
+	stress_thp_stats_t thp_before, thp_after;
 
 	stress_catch_sigill();
 
@@ -1188,6 +1739,7 @@ static int stress_stream(stress_args_t *args)
 		L3 = get_stream_L3_size(args);
 
 	(void)stress_get_setting("stream-index", &stream_index);
+	coop = stress_get_setting("stream-threads", &stream_threads);
 
 	/* Have to take a hunch and badly guess size */
 	if (!L3) {
@@ -1228,6 +1780,24 @@ static int stress_stream(stress_args_t *args)
 	sz = n * sizeof(*a);
 	sz_idx = n * sizeof(size_t);
 
+	if (coop) {
+#if defined(HAVE_LIB_PTHREAD)
+		if (stream_index && stress_instance_zero(args))
+			pr_inf("%s: --stream-index is ignored with --stream-threads\n", args->name);
+		return stress_stream_cooperative(args, stream_threads, n,
+				has_sse2, stream_prefetch, stream_mlock, verify);
+#else
+		if (stress_instance_zero(args))
+			pr_inf("%s: pthreads not supported, ignoring --stream-threads\n", args->name);
+#endif
+	}
+
+	/* with explicit advice, report if huge pages were obtained */
+	thp_before.valid = false;
+	thp_after.valid = false;
+	if (stress_get_setting("stream-madvise", &stream_madvise))
+		(void)stress_thp_stats_get(&thp_before);
+
 	a = stress_stream_mmap(args, sz, stream_mlock);
 	if (a == MAP_FAILED)
 		goto err_unmap;
@@ -1294,6 +1864,8 @@ case_stream_index_1:
 		}
 		stress_bogo_inc(args);
 	} while (stress_continue(args));
+	if (thp_before.valid)
+		(void)stress_thp_stats_get(&thp_after);
 
 	if (dt >= 4.5) {
 		const double mb_rd_rate = (rd_bytes / (double)MB) / dt;
@@ -1313,6 +1885,7 @@ case_stream_index_1:
 		if (stress_instance_zero(args))
 			pr_inf("%s: run duration too short to reliably determine memory rate\n", args->name);
 	}
+	(void)stress_thp_stats_report(args, &thp_before, &thp_after, 3 * sz, 3);
 
 err_unmap:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
@@ -1341,7 +1914,9 @@ static const stress_opt_t opts[] = {
 	{ OPT_stream_l3_size,  "stream-l3-size",  TYPE_ID_UINT64_BYTES_VM, MIN_STREAM_L3_SIZE, MAX_STREAM_L3_SIZE, NULL },
 	{ OPT_stream_madvise,  "stream-madvise",  TYPE_ID_SIZE_T_METHOD, 0, 0, stress_stream_madvise },
 	{ OPT_stream_mlock,    "stream-mlock",    TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_stream_numa_matrix, "stream-numa-matrix", TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_stream_prefetch, "stream-prefetch", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_stream_threads,  "stream-threads",  TYPE_ID_UINT32, 0, MAX_STREAM_THREADS, NULL },
 	END_OPT,
 };
 
@@ -20,6 +20,8 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-capabilities.h"
+#include "core-cgroup.h"
+#include "core-histogram.h"
 #include "core-madvise.h"
 #include "core-out-of-memory.h"
 
@@ -37,11 +39,19 @@
 #define SHIM_EXT2_IOC_SETFLAGS		_IOW('f', 2, long int)
 #define SHIM_FS_NOCOW_FL		0x00800000 /* No Copy-on-Write file */
 
+#define MIN_SWAP_BENCH_BYTES		(16 * MB)
+#define MAX_SWAP_BENCH_BYTES		(MAX_MEM_LIMIT)
+#define DEFAULT_SWAP_BENCH_BYTES	(256 * MB)
+
+#define SWAP_BENCH_PAGEMAP_PAGES	(256)
+
 static const stress_help_t help[] = {
-	{ NULL,	"swap N",	"start N workers exercising swapon/swapoff" },
-	{ NULL,	"swap-ops N",	"stop after N swapon/swapoff operations" },
-	{ NULL,	"swap-self",	"attempt to swap stressors pages out" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"swap N",		"start N workers exercising swapon/swapoff" },
+	{ NULL,	"swap-bench",		"measure swap-in latency and swap throughput to a swap file" },
+	{ NULL,	"swap-bench-bytes N",	"size of working set streamed through swap by --swap-bench" },
+	{ NULL,	"swap-ops N",		"stop after N swapon/swapoff operations" },
+	{ NULL,	"swap-self",		"attempt to swap stressors pages out" },
+	{ NULL,	NULL,			NULL }
 };
 
 #if defined(HAVE_SYS_SWAP_H) &&	\
@@ -107,7 +117,9 @@ static int stress_swap_supported(const char *name)
 #endif
 
 static const stress_opt_t opts[] = {
-	{ OPT_swap_self, "swap-self", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_swap_bench,	"swap-bench",	    TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_swap_bench_bytes,	"swap-bench-bytes", TYPE_ID_SIZE_T_BYTES_VM, MIN_SWAP_BENCH_BYTES, MAX_SWAP_BENCH_BYTES, NULL },
+	{ OPT_swap_self,	"swap-self",	    TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
@@ -321,6 +333,335 @@ static void stress_swap_clean_dir(stress_args_t *args)
 	(void)rmdir(path);
 }
 
+#if defined(MADV_PAGEOUT) &&	\
+    defined(__linux__)
+/* Swap page counters from /proc/vmstat */
+typedef struct {
+	uint64_t pswpin;		/* pages swapped in from swap devices */
+	uint64_t pswpout;		/* pages swapped out to swap devices */
+	uint64_t zswpin;		/* pages loaded from zswap */
+	uint64_t zswpout;		/* pages stored in zswap */
+} stress_swap_vmstat_t;
+
+/*
+ *  stress_swap_vmstat()
+ *	get the swap and zswap page in/out counts from /proc/vmstat
+ */
+static void stress_swap_vmstat(stress_swap_vmstat_t *vmstat)
+{
+	FILE *fp;
+	char buf[4096];
+
+	(void)shim_memset(vmstat, 0, sizeof(*vmstat));
+	fp = fopen("/proc/vmstat", "r");
+	if (!fp)
+		return;
+	while (fgets(buf, sizeof(buf), fp) != NULL) {
+		if (strncmp(buf, "pswpin ", 7) == 0)
+			vmstat->pswpin = (uint64_t)atoll(buf + 7);
+		else if (strncmp(buf, "pswpout ", 8) == 0)
+			vmstat->pswpout = (uint64_t)atoll(buf + 8);
+		else if (strncmp(buf, "zswpin ", 7) == 0)
+			vmstat->zswpin = (uint64_t)atoll(buf + 7);
+		else if (strncmp(buf, "zswpout ", 8) == 0)
+			vmstat->zswpout = (uint64_t)atoll(buf + 8);
+	}
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_swap_zswap()
+ *	get the zswap compressed pool size and the uncompressed size
+ *	of the pages it stores in bytes, from debugfs or from
+ *	/proc/meminfo Zswap and Zswapped, returns false if zswap
+ *	statistics are not available
+ */
+static bool stress_swap_zswap(const size_t page_size, uint64_t *pool, uint64_t *stored)
+{
+	FILE *fp;
+	char buf[256];
+	uint64_t pages;
+	bool zswap = false, zswapped = false;
+
+	*pool = 0;
+	*stored = 0;
+	if ((stress_system_read("/sys/kernel/debug/zswap/pool_total_size", buf, sizeof(buf)) > 0) &&
+	    (sscanf(buf, "%" SCNu64, pool) == 1) &&
+	    (stress_system_read("/sys/kernel/debug/zswap/stored_pages", buf, sizeof(buf)) > 0) &&
+	    (sscanf(buf, "%" SCNu64, &pages) == 1)) {
+		*stored = pages * page_size;
+		return true;
+	}
+
+	fp = fopen("/proc/meminfo", "r");
+	if (!fp)
+		return false;
+	while (fgets(buf, sizeof(buf), fp) != NULL) {
+		uint64_t kb;
+
+		if (sscanf(buf, "Zswap: %" SCNu64, &kb) == 1) {
+			*pool = kb * KB;
+			zswap = true;
+		} else if (sscanf(buf, "Zswapped: %" SCNu64, &kb) == 1) {
+			*stored = kb * KB;
+			zswapped = true;
+		}
+	}
+	(void)fclose(fp);
+	return zswap && zswapped;
+}
+
+/*
+ *  stress_swap_cgroup_leave()
+ *	move this process from the bench cgroup back to the cgroup
+ *	it was in before and remove the bench cgroup
+ */
+static void stress_swap_cgroup_leave(const char *cgpath, const char *orig)
+{
+	char mnt[PATH_MAX], path[(PATH_MAX * 2) + 8];
+
+	if (stress_cgroup2_mount_point(mnt, sizeof(mnt))) {
+		(void)snprintf(path, sizeof(path), "%s%s", mnt, orig);
+		VOID_RET(int, stress_cgroup_move_pid(path, getpid()));
+	}
+	stress_cgroup_remove(cgpath);
+}
+
+/*
+ *  stress_swap_bench()
+ *	swap to a local swap file and stream a working set larger
+ *	than the memory limit of a cgroup (or force it out with
+ *	MADV_PAGEOUT if the cgroup v2 memory controller is not
+ *	available), report swap-in fault latencies, swap throughput
+ *	and the zswap compression ratio and pool size
+ */
+static int stress_swap_bench(
+	stress_args_t *args,
+	const int fd,
+	const char *filename,
+	const uint8_t *page)
+{
+	const size_t page_size = args->page_size;
+	size_t swap_bench_bytes = DEFAULT_SWAP_BENCH_BYTES;
+	size_t ws_bytes, ws_pages, i;
+	uint32_t swap_pages;
+	int32_t written;
+	int swapflags = 0, rc = EXIT_SUCCESS, pagemap_fd;
+	uint8_t *ws;
+	uint64_t entries[SWAP_BENCH_PAGEMAP_PAGES];
+	char cgpath[PATH_MAX + 64], orig[PATH_MAX];
+	bool in_cgroup = false;
+	stress_swap_vmstat_t vm_start, vm_end;
+	uint64_t swapped_in, swapped_out;
+	uint64_t zswap_pool = 0, zswap_stored = 0;
+	double t_start, duration, pageout_duration = 0.0, swapin_duration = 0.0;
+	stress_hist_t hist;
+
+	if (!stress_get_setting("swap-bench-bytes", &swap_bench_bytes)) {
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			swap_bench_bytes = MIN_SWAP_BENCH_BYTES;
+	}
+	ws_bytes = (swap_bench_bytes / args->instances) & ~(page_size - 1);
+	if (ws_bytes < MIN_SWAP_BENCH_BYTES)
+		ws_bytes = MIN_SWAP_BENCH_BYTES;
+	ws_pages = ws_bytes / page_size;
+	if (stress_instance_zero(args))
+		stress_usage_bytes(args, ws_bytes, ws_bytes * args->instances);
+
+	/* swap file big enough for all of the working set */
+	swap_pages = (uint32_t)STRESS_MINIMUM(ws_pages + (ws_pages / 4) + MIN_SWAP_PAGES, UINT32_MAX);
+	written = stress_swap_zero(args, fd, swap_pages, page);
+	if (written < 0)
+		return EXIT_FAILURE;
+	if ((uint32_t)written < swap_pages)
+		return EXIT_NO_RESOURCE;
+	if (stress_swap_set_size(args, fd, swap_pages, SWAP_HDR_SANE) < 0)
+		return EXIT_FAILURE;
+	(void)shim_fsync(fd);
+#if defined(SWAP_FLAG_PREFER)
+	/* highest priority so the bench swaps to its own swap file */
+	swapflags = (SWAP_FLAG_PRIO_MASK << SWAP_FLAG_PRIO_SHIFT) | SWAP_FLAG_PREFER;
+#endif
+	if (swapon(filename, swapflags) < 0) {
+		pr_inf_skip("%s: cannot enable swap%s, errno=%d (%s), skipping stressor\n",
+			args->name, stress_get_fs_type(filename), errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+
+	ws = (uint8_t *)mmap(NULL, ws_bytes, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ws == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes%s, skipping stressor\n",
+			args->name, ws_bytes, stress_get_memfree_str());
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_swapoff;
+	}
+	stress_set_vma_anon_name(ws, ws_bytes, "swap-bench-data");
+	(void)stress_madvise_nohugepage(ws, ws_bytes);
+
+	/* half the working set fits into the cgroup memory limit */
+	if (stress_system_read("/proc/self/cgroup", orig, sizeof(orig)) > 0) {
+		char *ptr = strstr(orig, "0::");
+
+		if (ptr) {
+			(void)memmove(orig, ptr + 3, strlen(ptr + 3) + 1);
+			ptr = strchr(orig, '\n');
+			if (ptr)
+				*ptr = '\0';
+			if ((stress_cgroup_mem_create(args, cgpath, sizeof(cgpath),
+						      ws_bytes / 2, ws_bytes / 2) == 0)) {
+				in_cgroup = (stress_cgroup_move_pid(cgpath, getpid()) == 0);
+				if (!in_cgroup)
+					stress_cgroup_remove(cgpath);
+			}
+		}
+	}
+	if (stress_instance_zero(args)) {
+		if (in_cgroup)
+			pr_inf("%s: streaming working set with a cgroup memory.max of half its size\n",
+				args->name);
+		else
+			pr_inf("%s: cgroup v2 memory controller not available, paging the "
+				"working set out with MADV_PAGEOUT\n", args->name);
+	}
+
+	/* compressible contents, a check value and a random tail */
+	for (i = 0; i < ws_pages; i++) {
+		uint8_t *p = ws + (i * page_size);
+
+		(void)shim_memset(p, (int)i, page_size);
+		*(uintptr_t *)p = (uintptr_t)p;
+		stress_rndbuf(p + page_size - 256, 256);
+	}
+
+	/* paged out pages can still be in the swap cache, so use pagemap and not mincore */
+	pagemap_fd = open("/proc/self/pagemap", O_RDONLY);
+	if (pagemap_fd < 0) {
+		pr_inf_skip("%s: cannot open /proc/self/pagemap, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_munmap;
+	}
+
+	stress_hist_init(&hist, "swap-in fault latency");
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	stress_swap_vmstat(&vm_start);
+	t_start = stress_time_now();
+	do {
+		size_t j;
+
+		if (!in_cgroup) {
+			double t;
+
+			t = stress_time_now();
+			(void)shim_madvise(ws, ws_bytes, MADV_PAGEOUT);
+			pageout_duration += stress_time_now() - t;
+		}
+		/* time the first read of each page that is swapped out */
+		for (i = 0; (i < ws_pages) && stress_continue_flag(); i += SWAP_BENCH_PAGEMAP_PAGES) {
+			const size_t n = STRESS_MINIMUM(SWAP_BENCH_PAGEMAP_PAGES, ws_pages - i);
+			const off_t offset = (off_t)((((uintptr_t)ws / page_size) + i) * sizeof(entries[0]));
+
+			if (pread(pagemap_fd, entries, n * sizeof(entries[0]), offset) < 0)
+				(void)shim_memset(entries, 0, sizeof(entries));
+			for (j = 0; j < n; j++) {
+				uint8_t *p = ws + ((i + j) * page_size);
+				volatile uintptr_t *up = (volatile uintptr_t *)p;
+				uintptr_t val;
+
+				/* bit 62, page is swapped */
+				if (!(entries[j] & (1ULL << 62))) {
+					val = *up;
+				} else {
+					double t;
+
+					t = stress_time_now();
+					val = *up;
+					t = stress_time_now() - t;
+					swapin_duration += t;
+					stress_hist_record(&hist, (uint64_t)(t * STRESS_DBL_NANOSECOND));
+				}
+				if (UNLIKELY(val != (uintptr_t)p)) {
+					pr_fail("%s: failed, address %p contains %" PRIuPTR
+						" and not %" PRIuPTR "\n", args->name,
+						(void *)p, val, (uintptr_t)p);
+					rc = EXIT_FAILURE;
+				}
+				/* dirty it so it has to be written out again */
+				p[sizeof(uintptr_t)]++;
+			}
+		}
+		stress_bogo_inc(args);
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
+	duration = stress_time_now() - t_start;
+	stress_swap_vmstat(&vm_end);
+	vm_end.pswpin -= vm_start.pswpin;
+	vm_end.pswpout -= vm_start.pswpout;
+	vm_end.zswpin -= vm_start.zswpin;
+	vm_end.zswpout -= vm_start.zswpout;
+	swapped_in = vm_end.pswpin + vm_end.zswpin;
+	swapped_out = vm_end.pswpout + vm_end.zswpout;
+	(void)stress_swap_zswap(page_size, &zswap_pool, &zswap_stored);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)close(pagemap_fd);
+
+	if ((duration > 0.0) && (hist.count > 0)) {
+		/* MADV_PAGEOUT writes the pages out synchronously */
+		const double out_duration = in_cgroup ? duration : pageout_duration;
+		const double out_rate = (out_duration > 0.0) ?
+			((double)swapped_out * (double)page_size) / (out_duration * (double)MB) : 0.0;
+		const double in_rate = (swapin_duration > 0.0) ?
+			((double)hist.count * (double)page_size) / (swapin_duration * (double)MB) : 0.0;
+
+		if (stress_instance_zero(args)) {
+			pr_inf("%s: swap-in fault latency nanosecs: p50 %" PRIu64 ", p99 %" PRIu64
+				", p99.9 %" PRIu64 ", max %" PRIu64 " (%" PRIu64 " faults)\n",
+				args->name, stress_hist_percentile(&hist, 50.0),
+				stress_hist_percentile(&hist, 99.0),
+				stress_hist_percentile(&hist, 99.9), hist.max, hist.count);
+			pr_inf("%s: swap-out %.2f MB/sec, swap-in %.2f MB/sec, "
+				"%" PRIu64 " pages swapped out (%" PRIu64 " to zswap), "
+				"%" PRIu64 " pages swapped in (%" PRIu64 " from zswap), "
+				"the other faults hit the swap cache\n",
+				args->name, out_rate, in_rate, swapped_out, vm_end.zswpout,
+				swapped_in, vm_end.zswpin);
+		}
+		stress_metrics_set(args, 0, "nanosecs p50 swap-in fault",
+			(double)stress_hist_percentile(&hist, 50.0), STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 1, "nanosecs p99 swap-in fault",
+			(double)stress_hist_percentile(&hist, 99.0), STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 2, "MB per sec swap-out",
+			out_rate, STRESS_METRIC_HARMONIC_MEAN);
+		stress_metrics_set(args, 3, "MB per sec swap-in",
+			in_rate, STRESS_METRIC_HARMONIC_MEAN);
+		stress_hist_merge(args, 0, &hist);
+	}
+	if (zswap_pool > 0) {
+		const double ratio = (double)zswap_stored / (double)zswap_pool;
+
+		if (stress_instance_zero(args))
+			pr_inf("%s: zswap pool %.2f MB, compression ratio %.2f\n",
+				args->name, (double)zswap_pool / (double)MB, ratio);
+		stress_metrics_set(args, 4, "zswap compression ratio",
+			ratio, STRESS_METRIC_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 5, "MB zswap pool size",
+			(double)zswap_pool / (double)MB, STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+
+tidy_munmap:
+	(void)munmap((void *)ws, ws_bytes);
+	if (in_cgroup)
+		stress_swap_cgroup_leave(cgpath, orig);
+tidy_swapoff:
+	(void)stress_swapoff(filename);
+	return rc;
+}
+
+#endif
+
 /*
  *  stress_swap_child()
  *	stress swap operations
@@ -333,11 +674,13 @@ static int stress_swap_child(stress_args_t *args, void *context)
 	uint64_t swapped_out = 0;
 	int32_t max_swap_pages;
 	const size_t page_size = args->page_size;
-	bool swap_self = false;
+	bool swap_self = false, swap_bench = false;
 	double t, duration, rate;
 
 	(void)context;
 
+	(void)stress_get_setting("swap-bench", &swap_bench);
+
 	if (!stress_get_setting("swap-self", &swap_self)) {
 		if (g_opt_flags & OPT_FLAGS_AGGRESSIVE)
 			swap_self = true;
@@ -387,6 +730,18 @@ static int stress_swap_child(stress_args_t *args, void *context)
 	}
 #endif
 
+#if defined(MADV_PAGEOUT) &&	\
+    defined(__linux__)
+	if (swap_bench) {
+		ret = stress_swap_bench(args, fd, filename, page);
+		goto tidy_close;
+	}
+#else
+	if (swap_bench && stress_instance_zero(args))
+		pr_inf("%s: --swap-bench requires MADV_PAGEOUT, running the swapon/swapoff stressor\n",
+			args->name);
+#endif
+
 	max_swap_pages = stress_swap_zero(args, fd, MAX_SWAP_PAGES, page);
 	if (max_swap_pages < 0) {
 		ret = EXIT_FAILURE;
@@ -554,14 +909,43 @@ tidy_ret:
 static int stress_swap(stress_args_t *args)
 {
 	int ret;
+	bool swap_bench = false;
+	char cgpath[PATH_MAX + 64];
+
+	(void)stress_get_setting("swap-bench", &swap_bench);
 
 	ret = stress_oomable_child(args, NULL, stress_swap_child, STRESS_OOMABLE_NORMAL);
 	stress_swap_clean_dir(args);
+	/* the bench cgroup is left behind if the child was killed */
+	if (swap_bench && stress_cgroup_mem_path(args, cgpath, sizeof(cgpath)))
+		stress_cgroup_remove(cgpath);
 	return ret;
 }
 
+/*
+ *  stress_swap_init()
+ *	save the cgroup v2 root memory controller state
+ */
+static void stress_swap_init(const uint32_t instances)
+{
+	(void)instances;
+
+	stress_cgroup_subtree_save();
+}
+
+/*
+ *  stress_swap_deinit()
+ *	restore the cgroup v2 root memory controller state
+ */
+static void stress_swap_deinit(void)
+{
+	stress_cgroup_subtree_restore();
+}
+
 const stressor_info_t stress_swap_info = {
 	.stressor = stress_swap,
+	.init = stress_swap_init,
+	.deinit = stress_swap_deinit,
 	.supported = stress_swap_supported,
 	.classifier = CLASS_VM | CLASS_OS,
 	.opts = opts,
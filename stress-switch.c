@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-affinity.h"
 #include "core-builtin.h"
+#include "core-histogram.h"
 #include "core-killpid.h"
 #include "core-mmap.h"
 
@@ -54,6 +55,21 @@ typedef struct {
 
 #define THRESH_FREQ	(100)		/* Delay adjustment rate in HZ */
 
+static stress_hist_t switch_hist;	/* context switch latencies */
+
+/*
+ *  stress_switch_record()
+ *	record the time since *t_prev spread over n context switches
+ */
+static inline void stress_switch_record(double *t_prev, const double n)
+{
+	const double t_now = stress_time_now();
+
+	stress_hist_record(&switch_hist,
+		(uint64_t)(((t_now - *t_prev) * STRESS_DBL_NANOSECOND) / n));
+	*t_prev = t_now;
+}
+
 /*
  *  stress_switch_rate()
  *	report context switch duration
@@ -233,7 +249,7 @@ again:
 		(void)close(pipefds[0]);
 		_exit(EXIT_SUCCESS);
 	} else {
-		double t_start;
+		double t_start, t_prev;
 		uint64_t delay = switch_delay;
 		register const int fd = pipefds[1];
 
@@ -242,6 +258,7 @@ again:
 		(void)shim_memset(buf, '_', buf_size);
 
 		t_start = stress_time_now();
+		t_prev = t_start;
 		do {
 			ssize_t ret;
 
@@ -260,9 +277,12 @@ again:
 				}
 				continue;
 			}
+			stress_switch_record(&t_prev, 1.0);
 
-			if (UNLIKELY(switch_freq))
+			if (UNLIKELY(switch_freq)) {
 				stress_switch_delay(args, switch_delay, threshold, t_start, &delay);
+				t_prev = stress_time_now();
+			}
 		} while (stress_continue(args));
 
 		stress_switch_rate(args, "pipe", t_start, stress_time_now(), stress_bogo_get(args));
@@ -343,12 +363,13 @@ again:
 		}
 		_exit(EXIT_SUCCESS);
 	} else {
-		double t_start;
+		double t_start, t_prev;
 		uint64_t delay = switch_delay;
 		struct sembuf sem ALIGN64;
 
 		/* Parent */
 		t_start = stress_time_now();
+		t_prev = t_start;
 		do {
 			stress_bogo_inc(args);
 
@@ -359,8 +380,10 @@ again:
 			if (UNLIKELY(semop(sem_id, &sem, 1) < 0))
 				break;
 
-			if (UNLIKELY(switch_freq))
+			if (UNLIKELY(switch_freq)) {
 				stress_switch_delay(args, switch_delay, threshold, t_start, &delay);
+				t_prev = stress_time_now();
+			}
 
 			if (UNLIKELY(!stress_continue(args)))
 				break;
@@ -370,6 +393,7 @@ again:
 
 			if (UNLIKELY(semop(sem_id, &sem, 1) < 0))
 				break;
+			stress_switch_record(&t_prev, 2.0);
 		} while (stress_continue(args));
 
 		stress_switch_rate(args, "sem-sysv", t_start, stress_time_now(), 2 * stress_bogo_get(args));
@@ -447,20 +471,24 @@ again:
 		}
 		_exit(EXIT_SUCCESS);
 	} else {
-		double t_start;
+		double t_start, t_prev;
 		uint64_t delay = switch_delay;
 
 		/* Parent */
 		t_start = stress_time_now();
+		t_prev = t_start;
 		do {
 			unsigned int prio;
 
 			stress_bogo_inc(args);
 			if (UNLIKELY(mq_receive(mq, (char *)&msg, sizeof(msg), &prio) < 0))
 				break;
+			stress_switch_record(&t_prev, 1.0);
 
-			if (UNLIKELY(switch_freq))
+			if (UNLIKELY(switch_freq)) {
 				stress_switch_delay(args, switch_delay, threshold, t_start, &delay);
+				t_prev = stress_time_now();
+			}
 		} while (stress_continue(args));
 
 		stress_switch_rate(args, "mq", t_start, stress_time_now(), stress_bogo_get(args));
@@ -498,6 +526,7 @@ static int stress_switch(stress_args_t *args)
 {
 	uint64_t switch_freq = 0, switch_delay, threshold;
 	size_t switch_method = 0, i;
+	int rc;
 
 	for (i = 0; i < SIZEOF_ARRAY(stress_switch_methods); i++) {
 		if (strcmp(stress_switch_methods[i].name, "pipe") == 0) {
@@ -512,7 +541,11 @@ static int stress_switch(stress_args_t *args)
 	switch_delay = (switch_freq == 0) ? 0 : STRESS_NANOSECOND / switch_freq;
 	threshold = switch_freq / THRESH_FREQ;
 
-	return stress_switch_methods[switch_method].switch_func(args, switch_freq, switch_delay, threshold);
+	stress_hist_init(&switch_hist, "context switch latency (nanosecs)");
+	rc = stress_switch_methods[switch_method].switch_func(args, switch_freq, switch_delay, threshold);
+	stress_hist_merge(args, 0, &switch_hist);
+
+	return rc;
 }
 
 static const char *stress_switch_method(const size_t i)
@@ -0,0 +1,919 @@
+/*
+ * Copyright (C) 2025 Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-affinity.h"
+#include "core-arch.h"
+#include "core-asm-x86.h"
+#include "core-builtin.h"
+#include "core-cpu.h"
+#include "core-cpu-freq.h"
+#include "core-mmap.h"
+#include "core-pthread.h"
+#include "core-signal.h"
+
+#include <math.h>
+
+#if defined(HAVE_COMPILER_MUSL)
+#undef HAVE_IMMINTRIN_H
+#endif
+
+#if defined(HAVE_IMMINTRIN_H)
+#include <immintrin.h>
+#endif
+
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#endif
+
+#define MIN_VECFREQ_CORES	(0)
+#define MAX_VECFREQ_CORES	(256)
+
+#define MIN_VECFREQ_DURATION	(10)		/* milliseconds */
+#define MAX_VECFREQ_DURATION	(60000)
+#define DEFAULT_VECFREQ_DURATION (500)
+
+#define VECFREQ_CORE_STEPS	(10)		/* 1, 2, 4 .. 256 and the maximum */
+#define VECFREQ_FMA_CHAINS	(8)		/* independent FMA dependency chains */
+#define VECFREQ_FMA_LOOPS	(4096)		/* FMA iterations per kernel call */
+#define VECFREQ_FMA_MUL		(0.9999F)
+#define VECFREQ_FMA_ADD		(0.0001F)
+#define VECFREQ_DOT_FLOATS	(4096)		/* L1 resident dot product length */
+#define VECFREQ_DOT_PASSES	(64)		/* dot products per kernel call */
+#define VECFREQ_MAX_LANES	(16)		/* float lanes in 512 bits */
+#define VECFREQ_AMX_LOOPS	(256)		/* tile dot products per accumulator */
+
+static const stress_help_t help[] = {
+	{ NULL,	"vecfreq N",		"start N workers measuring vector width throughput versus core frequency" },
+	{ NULL,	"vecfreq-cores N",	"maximum number of active cores, 0 = usable CPUs / instances" },
+	{ NULL,	"vecfreq-duration N",	"run each width and active core count for N milliseconds" },
+	{ NULL,	"vecfreq-method M",	"select vecfreq kernel [ all | fma128 | fma256 | fma512 | dot128 | dot256 | dot512 | amx-bf16 ]" },
+	{ NULL,	"vecfreq-ops N",	"stop after N vecfreq kernel width and core count steps" },
+	{ NULL,	NULL,			NULL }
+};
+
+#if defined(STRESS_ARCH_X86_64) &&	\
+    defined(HAVE_VECMATH) &&		\
+    defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_SCHED_SETAFFINITY) &&	\
+    (defined(HAVE_COMPILER_GCC) ||	\
+     defined(HAVE_COMPILER_CLANG) ||	\
+     defined(HAVE_COMPILER_ICX)) &&	\
+    !defined(HAVE_COMPILER_ICC)
+
+#define TARGET_FMA128		__attribute__ ((target("fma")))
+#define TARGET_FMA256		__attribute__ ((target("avx2,fma")))
+#define TARGET_FMA512		__attribute__ ((target("avx512f")))
+
+#if defined(HAVE_IMMINTRIN_H) &&	\
+    defined(HAVE_TILE_DPBF16PS) &&	\
+    defined(__linux__)
+#define HAVE_VECFREQ_AMX
+#define TARGET_AMX_BF16		__attribute__ ((target("amx-tile,amx-bf16")))
+
+#if !defined(ARCH_REQ_XCOMP_PERM)
+#define ARCH_REQ_XCOMP_PERM	(0x1023)
+#endif
+#define XFEATURE_XTILEDATA	(18)
+#endif
+
+#if defined(HAVE_LINUX_PERF_EVENT_H) &&	\
+    defined(__NR_perf_event_open)
+#define HAVE_VECFREQ_PERF
+#endif
+
+typedef float stress_vecfreq_f128_t __attribute__ ((vector_size(128 / 8)));
+typedef float stress_vecfreq_f256_t __attribute__ ((vector_size(256 / 8)));
+typedef float stress_vecfreq_f512_t __attribute__ ((vector_size(512 / 8)));
+
+/* per thread kernel state */
+typedef struct {
+	float x[VECFREQ_DOT_FLOATS] ALIGN64;	/* dot product inputs */
+	float y[VECFREQ_DOT_FLOATS] ALIGN64;
+	float result[VECFREQ_MAX_LANES] ALIGN64; /* last kernel result */
+#if defined(HAVE_VECFREQ_AMX)
+	uint16_t a[16 * 32] ALIGN64;		/* bf16 A tile, 16 rows x 32 */
+	uint16_t b[16 * 32] ALIGN64;		/* bf16 B tile, 16 rows x 32 pairs */
+	float c[4][16 * 16] ALIGN64;		/* fp32 accumulator tiles */
+#endif
+} stress_vecfreq_state_t;
+
+typedef double (*stress_vecfreq_func_t)(stress_vecfreq_state_t *state);
+
+typedef enum {
+	VECFREQ_KERNEL_FMA,
+	VECFREQ_KERNEL_DOT,
+	VECFREQ_KERNEL_AMX,
+} stress_vecfreq_kernel_t;
+
+typedef struct {
+	const char *name;			/* method name */
+	const stress_vecfreq_func_t func;	/* kernel, returns FLOPs */
+	bool (*capable)(void);			/* CPU supports the kernel */
+	const stress_vecfreq_kernel_t kernel;	/* kernel type */
+	const size_t lanes;			/* fp32 lanes */
+	const size_t base;			/* 128 bit method with the same kernel */
+} stress_vecfreq_method_t;
+
+typedef enum {
+	VECFREQ_FREQ_NONE,			/* no frequency measurement */
+	VECFREQ_FREQ_APERF_MPERF,		/* msr PMU APERF/MPERF ratio */
+	VECFREQ_FREQ_CYCLES,			/* unhalted core cycles per second */
+	VECFREQ_FREQ_SYSFS,			/* cpufreq scaling_cur_freq */
+} stress_vecfreq_freq_t;
+
+static const char * const stress_vecfreq_freq_names[] = {
+	"none",
+	"APERF/MPERF perf events",
+	"perf cpu-cycles",
+	"cpufreq sysfs",
+};
+
+typedef struct {
+	double flops;				/* total FLOPs */
+	double duration;			/* total thread seconds */
+	double mhz;				/* sum of per thread MHz */
+	double mhz_count;			/* number of MHz samples */
+} stress_vecfreq_stats_t;
+
+typedef struct stress_vecfreq_ctxt stress_vecfreq_ctxt_t;
+
+typedef struct {
+	pthread_t pthread;			/* worker pthread */
+	int ret;				/* pthread_create return */
+	size_t id;				/* worker index */
+	uint32_t cpu;				/* CPU to pin to */
+	stress_vecfreq_ctxt_t *ctxt;		/* shared context */
+	stress_vecfreq_state_t *state;		/* kernel state */
+	double flops;				/* FLOPs in this step */
+	double duration;			/* seconds in this step */
+	double mhz;				/* effective MHz, 0 if unknown */
+	bool verify_failed;			/* kernel result check failed */
+} stress_vecfreq_worker_t;
+
+struct stress_vecfreq_ctxt {
+	stress_args_t *args;			/* stressor args */
+	const stress_vecfreq_method_t *method;	/* kernel being run */
+	double duration;			/* seconds per step */
+	stress_vecfreq_freq_t freq;		/* frequency measurement method */
+	double tsc_mhz;				/* TSC (MPERF) frequency */
+	uint32_t msr_type;			/* msr PMU type */
+	uint64_t aperf_config;			/* msr PMU aperf event */
+	uint64_t mperf_config;			/* msr PMU mperf event */
+	bool verify;				/* check kernel results */
+	volatile bool go;			/* start measuring */
+	volatile bool stop;			/* stop measuring */
+};
+
+#define STRESS_VECFREQ_FMA(bits)					\
+static double TARGET_FMA ## bits OPTIMIZE3				\
+stress_vecfreq_fma ## bits(stress_vecfreq_state_t *state)		\
+{									\
+	stress_vecfreq_f ## bits ## _t a[VECFREQ_FMA_CHAINS], sum;	\
+	const stress_vecfreq_f ## bits ## _t m = (stress_vecfreq_f ## bits ## _t){} + VECFREQ_FMA_MUL;	\
+	const stress_vecfreq_f ## bits ## _t c = (stress_vecfreq_f ## bits ## _t){} + VECFREQ_FMA_ADD;	\
+	const size_t lanes = sizeof(sum) / sizeof(float);		\
+	register size_t i, j;						\
+									\
+	for (i = 0; i < VECFREQ_FMA_CHAINS; i++)			\
+		for (j = 0; j < lanes; j++)				\
+			a[i][j] = stress_vecfreq_fma_init(i, j);	\
+									\
+	for (i = 0; i < VECFREQ_FMA_LOOPS; i++) {			\
+		a[0] = a[0] * m + c;					\
+		a[1] = a[1] * m + c;					\
+		a[2] = a[2] * m + c;					\
+		a[3] = a[3] * m + c;					\
+		a[4] = a[4] * m + c;					\
+		a[5] = a[5] * m + c;					\
+		a[6] = a[6] * m + c;					\
+		a[7] = a[7] * m + c;					\
+	}								\
+	sum = ((a[0] + a[1]) + (a[2] + a[3])) +				\
+	      ((a[4] + a[5]) + (a[6] + a[7]));				\
+	(void)shim_memcpy(state->result, &sum, sizeof(sum));		\
+									\
+	return 2.0 * VECFREQ_FMA_CHAINS * VECFREQ_FMA_LOOPS * (double)lanes; \
+}
+
+#define STRESS_VECFREQ_DOT(bits)					\
+static double TARGET_FMA ## bits OPTIMIZE3				\
+stress_vecfreq_dot ## bits(stress_vecfreq_state_t *state)		\
+{									\
+	typedef stress_vecfreq_f ## bits ## _t vec_t;			\
+	const vec_t *x = (const vec_t *)state->x;			\
+	const vec_t *y = (const vec_t *)state->y;			\
+	const size_t lanes = sizeof(vec_t) / sizeof(float);		\
+	const size_t n = VECFREQ_DOT_FLOATS / lanes;			\
+	vec_t sum = {};							\
+	register size_t i, pass;					\
+									\
+	for (pass = 0; pass < VECFREQ_DOT_PASSES; pass++) {		\
+		vec_t s0 = {}, s1 = {}, s2 = {}, s3 = {};		\
+									\
+		for (i = 0; i < n; i += 4) {				\
+			s0 += x[i + 0] * y[i + 0];			\
+			s1 += x[i + 1] * y[i + 1];			\
+			s2 += x[i + 2] * y[i + 2];			\
+			s3 += x[i + 3] * y[i + 3];			\
+		}							\
+		sum = (s0 + s1) + (s2 + s3);				\
+		__asm__ __volatile__("" : : "r"(x) : "memory");		\
+	}								\
+	(void)shim_memcpy(state->result, &sum, sizeof(sum));		\
+									\
+	return 2.0 * VECFREQ_DOT_FLOATS * VECFREQ_DOT_PASSES;		\
+}
+
+/*
+ *  stress_vecfreq_fma_init()
+ *	initial value of FMA chain i, lane j
+ */
+static inline float ALWAYS_INLINE stress_vecfreq_fma_init(const size_t i, const size_t j)
+{
+	return 0.5F + (float)((i * VECFREQ_MAX_LANES) + j) * (1.0F / 256.0F);
+}
+
+STRESS_VECFREQ_FMA(128)
+STRESS_VECFREQ_FMA(256)
+STRESS_VECFREQ_FMA(512)
+STRESS_VECFREQ_DOT(128)
+STRESS_VECFREQ_DOT(256)
+STRESS_VECFREQ_DOT(512)
+
+#if defined(HAVE_VECFREQ_AMX)
+/* tile config, palette 1, tiles 0-3 fp32 C, 4-5 bf16 A, 6-7 bf16 B, 16 rows x 64 bytes */
+typedef struct {
+	uint8_t palette_id;
+	uint8_t start_row;
+	uint8_t reserved[14];
+	uint16_t colsb[16];
+	uint8_t rows[16];
+} stress_vecfreq_tilecfg_t;
+
+/*
+ *  stress_vecfreq_amx_bf16()
+ *	four independent tile accumulators of 16 x 16 fp32 each
+ *	fed by 16 x 32 bf16 tiles, each tdpbf16ps is 16 x 16 x 32
+ *	multiply-adds
+ */
+static double TARGET_AMX_BF16 OPTIMIZE3 stress_vecfreq_amx_bf16(stress_vecfreq_state_t *state)
+{
+	stress_vecfreq_tilecfg_t cfg ALIGN64;
+	register size_t i;
+
+	(void)shim_memset(&cfg, 0, sizeof(cfg));
+	cfg.palette_id = 1;
+	for (i = 0; i < 8; i++) {
+		cfg.colsb[i] = 64;
+		cfg.rows[i] = 16;
+	}
+	_tile_loadconfig(&cfg);
+	_tile_zero(0);
+	_tile_zero(1);
+	_tile_zero(2);
+	_tile_zero(3);
+	_tile_loadd(4, state->a, 64);
+	_tile_loadd(5, state->a, 64);
+	_tile_loadd(6, state->b, 64);
+	_tile_loadd(7, state->b, 64);
+	for (i = 0; i < VECFREQ_AMX_LOOPS; i++) {
+		_tile_dpbf16ps(0, 4, 6);
+		_tile_dpbf16ps(1, 4, 7);
+		_tile_dpbf16ps(2, 5, 6);
+		_tile_dpbf16ps(3, 5, 7);
+	}
+	_tile_stored(0, state->c[0], 64);
+	_tile_stored(1, state->c[1], 64);
+	_tile_stored(2, state->c[2], 64);
+	_tile_stored(3, state->c[3], 64);
+	_tile_release();
+
+	return 4.0 * 2.0 * 16.0 * 16.0 * 32.0 * VECFREQ_AMX_LOOPS;
+}
+
+/*
+ *  stress_vecfreq_amx_capable()
+ *	AMX needs CPU support and kernel permission to use tile data
+ */
+static bool stress_vecfreq_amx_capable(void)
+{
+	static int capable = -1;
+
+	if (capable < 0) {
+		capable = stress_cpu_x86_has_amx_tile() &&
+			  stress_cpu_x86_has_amx_bf16() &&
+			  (shim_arch_prctl(ARCH_REQ_XCOMP_PERM, XFEATURE_XTILEDATA) == 0);
+	}
+	return (bool)capable;
+}
+#endif
+
+static bool stress_vecfreq_fma128_capable(void)
+{
+	return stress_cpu_x86_has_fma();
+}
+
+static bool stress_vecfreq_fma256_capable(void)
+{
+	return stress_cpu_x86_has_avx2() && stress_cpu_x86_has_fma();
+}
+
+static bool stress_vecfreq_fma512_capable(void)
+{
+	return stress_cpu_x86_has_avx512_f();
+}
+
+static const stress_vecfreq_method_t stress_vecfreq_methods[] = {
+	{ "all",	NULL,				NULL,				VECFREQ_KERNEL_FMA, 0,  0 },
+	{ "fma128",	stress_vecfreq_fma128,		stress_vecfreq_fma128_capable,	VECFREQ_KERNEL_FMA, 4,  1 },
+	{ "fma256",	stress_vecfreq_fma256,		stress_vecfreq_fma256_capable,	VECFREQ_KERNEL_FMA, 8,  1 },
+	{ "fma512",	stress_vecfreq_fma512,		stress_vecfreq_fma512_capable,	VECFREQ_KERNEL_FMA, 16, 1 },
+	{ "dot128",	stress_vecfreq_dot128,		stress_vecfreq_fma128_capable,	VECFREQ_KERNEL_DOT, 4,  4 },
+	{ "dot256",	stress_vecfreq_dot256,		stress_vecfreq_fma256_capable,	VECFREQ_KERNEL_DOT, 8,  4 },
+	{ "dot512",	stress_vecfreq_dot512,		stress_vecfreq_fma512_capable,	VECFREQ_KERNEL_DOT, 16, 4 },
+#if defined(HAVE_VECFREQ_AMX)
+	{ "amx-bf16",	stress_vecfreq_amx_bf16,	stress_vecfreq_amx_capable,	VECFREQ_KERNEL_AMX, 16, 1 },
+#endif
+};
+
+#define VECFREQ_METHODS	(SIZEOF_ARRAY(stress_vecfreq_methods))
+
+static stress_vecfreq_stats_t stress_vecfreq_stats[VECFREQ_METHODS][VECFREQ_CORE_STEPS];
+
+/*
+ *  stress_vecfreq_verify()
+ *	check the last kernel result against a scalar reference
+ */
+static bool stress_vecfreq_verify(
+	const stress_vecfreq_method_t *method,
+	const stress_vecfreq_state_t *state)
+{
+	size_t i, j, k;
+
+	switch (method->kernel) {
+	case VECFREQ_KERNEL_FMA:
+		for (j = 0; j < method->lanes; j++) {
+			double expected = 0.0;
+
+			for (i = 0; i < VECFREQ_FMA_CHAINS; i++) {
+				float a = stress_vecfreq_fma_init(i, j);
+
+				for (k = 0; k < VECFREQ_FMA_LOOPS; k++)
+					a = fmaf(a, VECFREQ_FMA_MUL, VECFREQ_FMA_ADD);
+				expected += (double)a;
+			}
+			if (fabs((double)state->result[j] - expected) > 1.0E-4 * expected)
+				return false;
+		}
+		return true;
+	case VECFREQ_KERNEL_DOT: {
+		double expected = 0.0, sum = 0.0;
+
+		for (i = 0; i < VECFREQ_DOT_FLOATS; i++)
+			expected += (double)state->x[i] * (double)state->y[i];
+		for (j = 0; j < method->lanes; j++)
+			sum += (double)state->result[j];
+		return fabs(sum - expected) <= 1.0E-3 * expected;
+	}
+#if defined(HAVE_VECFREQ_AMX)
+	case VECFREQ_KERNEL_AMX:
+		/* a and b are bf16 1/16, each tdpbf16ps adds 32 * 1/256 */
+		for (k = 0; k < 4; k++) {
+			for (i = 0; i < 16 * 16; i++) {
+				if (state->c[k][i] != (float)VECFREQ_AMX_LOOPS * 32.0F / 256.0F)
+					return false;
+			}
+		}
+		return true;
+#endif
+	default:
+		return true;
+	}
+}
+
+#if defined(HAVE_VECFREQ_PERF)
+/*
+ *  stress_vecfreq_perf_open()
+ *	open a per thread counting event
+ */
+static int stress_vecfreq_perf_open(const uint32_t type, const uint64_t config, const bool exclude)
+{
+	struct perf_event_attr attr;
+
+	(void)shim_memset(&attr, 0, sizeof(attr));
+	attr.type = type;
+	attr.size = sizeof(attr);
+	attr.config = config;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_RUNNING;
+	/* the msr PMU does not support exclusion */
+	attr.exclude_kernel = exclude;
+	attr.exclude_hv = exclude;
+
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+ *  stress_vecfreq_perf_read()
+ *	read counter value and time running in nanoseconds
+ */
+static bool stress_vecfreq_perf_read(const int fd, uint64_t *value, uint64_t *running)
+{
+	uint64_t buf[2];
+
+	if ((fd < 0) || (read(fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf)))
+		return false;
+	*value = buf[0];
+	*running = buf[1];
+	return true;
+}
+
+/*
+ *  stress_vecfreq_msr_event()
+ *	get msr PMU event config from sysfs, e.g. event=0x02
+ */
+static bool stress_vecfreq_msr_event(const char *event, uint64_t *config)
+{
+	char path[PATH_MAX], buf[64];
+	unsigned int val;
+
+	(void)snprintf(path, sizeof(path), "/sys/bus/event_source/devices/msr/events/%s", event);
+	if (stress_system_read(path, buf, sizeof(buf)) < 0)
+		return false;
+	if (sscanf(buf, "event=%x", &val) != 1)
+		return false;
+	*config = (uint64_t)val;
+	return true;
+}
+#endif
+
+/*
+ *  stress_vecfreq_tsc_mhz()
+ *	calibrate the TSC frequency, MPERF counts at this rate
+ */
+static double stress_vecfreq_tsc_mhz(void)
+{
+#if defined(HAVE_ASM_X86_RDTSC)
+	double t1, t2;
+	uint64_t tsc1, tsc2;
+
+	t1 = stress_time_now();
+	tsc1 = stress_asm_x86_rdtsc();
+	do {
+		t2 = stress_time_now();
+	} while (t2 - t1 < 0.02);
+	tsc2 = stress_asm_x86_rdtsc();
+
+	return ((double)(tsc2 - tsc1) / (t2 - t1)) / 1000000.0;
+#else
+	return 0.0;
+#endif
+}
+
+/*
+ *  stress_vecfreq_freq_init()
+ *	select the best available frequency measurement method
+ */
+static void stress_vecfreq_freq_init(stress_vecfreq_ctxt_t *ctxt)
+{
+#if defined(HAVE_VECFREQ_PERF)
+	char buf[32];
+	int fd;
+
+	ctxt->tsc_mhz = stress_vecfreq_tsc_mhz();
+	if ((ctxt->tsc_mhz > 0.0) &&
+	    (stress_system_read("/sys/bus/event_source/devices/msr/type", buf, sizeof(buf)) > 0) &&
+	    (sscanf(buf, "%" SCNu32, &ctxt->msr_type) == 1) &&
+	    stress_vecfreq_msr_event("aperf", &ctxt->aperf_config) &&
+	    stress_vecfreq_msr_event("mperf", &ctxt->mperf_config)) {
+		fd = stress_vecfreq_perf_open(ctxt->msr_type, ctxt->aperf_config, false);
+		if (fd >= 0) {
+			(void)close(fd);
+			ctxt->freq = VECFREQ_FREQ_APERF_MPERF;
+			return;
+		}
+	}
+	fd = stress_vecfreq_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, true);
+	if (fd >= 0) {
+		(void)close(fd);
+		ctxt->freq = VECFREQ_FREQ_CYCLES;
+		return;
+	}
+#endif
+	{
+		double avg_ghz, min_ghz, max_ghz;
+
+		stress_get_cpu_freq(&avg_ghz, &min_ghz, &max_ghz);
+		ctxt->freq = (avg_ghz > 0.0) ? VECFREQ_FREQ_SYSFS : VECFREQ_FREQ_NONE;
+	}
+}
+
+/*
+ *  stress_vecfreq_worker()
+ *	run the kernel pinned to a CPU until told to stop, measuring
+ *	FLOPs and the effective core frequency
+ */
+static void *stress_vecfreq_worker(void *arg)
+{
+	stress_vecfreq_worker_t *worker = (stress_vecfreq_worker_t *)arg;
+	stress_vecfreq_ctxt_t *ctxt = worker->ctxt;
+	const stress_vecfreq_func_t func = ctxt->method->func;
+	cpu_set_t mask;
+	double t1, t2, flops = 0.0;
+#if defined(HAVE_VECFREQ_PERF)
+	int fd_a = -1, fd_b = -1;
+	uint64_t a1 = 0, a2 = 0, b1 = 0, b2 = 0, r1 = 0, r2 = 0, unused;
+	bool counting = false;
+#endif
+
+	if (worker->id) {
+		sigset_t set;
+
+		(void)sigfillset(&set);
+		(void)pthread_sigmask(SIG_BLOCK, &set, NULL);
+	}
+	CPU_ZERO(&mask);
+	CPU_SET((int)worker->cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+
+#if defined(HAVE_VECFREQ_PERF)
+	if (ctxt->freq == VECFREQ_FREQ_APERF_MPERF) {
+		fd_a = stress_vecfreq_perf_open(ctxt->msr_type, ctxt->aperf_config, false);
+		fd_b = stress_vecfreq_perf_open(ctxt->msr_type, ctxt->mperf_config, false);
+	} else if (ctxt->freq == VECFREQ_FREQ_CYCLES) {
+		fd_a = stress_vecfreq_perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, true);
+	}
+#endif
+	while (!ctxt->go)
+		(void)shim_sched_yield();
+
+	/* warm up, gives the core time to settle on a frequency licence */
+	(void)func(worker->state);
+
+#if defined(HAVE_VECFREQ_PERF)
+	counting = stress_vecfreq_perf_read(fd_a, &a1, &r1);
+	if (ctxt->freq == VECFREQ_FREQ_APERF_MPERF)
+		counting &= stress_vecfreq_perf_read(fd_b, &b1, &unused);
+#endif
+	t1 = stress_time_now();
+	do {
+		flops += func(worker->state);
+		if (worker->id == 0) {
+			t2 = stress_time_now();
+			if ((t2 - t1 >= ctxt->duration) || !stress_continue_flag())
+				ctxt->stop = true;
+		}
+	} while (!ctxt->stop);
+	t2 = stress_time_now();
+
+	worker->mhz = 0.0;
+#if defined(HAVE_VECFREQ_PERF)
+	if (counting && stress_vecfreq_perf_read(fd_a, &a2, &r2)) {
+		if (ctxt->freq == VECFREQ_FREQ_APERF_MPERF) {
+			if (stress_vecfreq_perf_read(fd_b, &b2, &unused) && (b2 > b1))
+				worker->mhz = ctxt->tsc_mhz * (double)(a2 - a1) / (double)(b2 - b1);
+		} else if (r2 > r1) {
+			worker->mhz = (double)(a2 - a1) * 1000.0 / (double)(r2 - r1);
+		}
+	}
+	if (fd_b >= 0)
+		(void)close(fd_b);
+	if (fd_a >= 0)
+		(void)close(fd_a);
+#endif
+	if (ctxt->freq == VECFREQ_FREQ_SYSFS) {
+		double avg_ghz, min_ghz, max_ghz;
+
+		stress_get_cpu_freq(&avg_ghz, &min_ghz, &max_ghz);
+		worker->mhz = avg_ghz * 1000.0;
+	}
+	worker->flops = flops;
+	worker->duration = t2 - t1;
+	worker->verify_failed = ctxt->verify && !stress_vecfreq_verify(ctxt->method, worker->state);
+
+	return &g_nowt;
+}
+
+/*
+ *  stress_vecfreq_step()
+ *	run a kernel on n_cores pinned threads, the calling thread
+ *	is worker 0, returns number of workers that ran
+ */
+static size_t stress_vecfreq_step(
+	stress_vecfreq_ctxt_t *ctxt,
+	stress_vecfreq_worker_t *workers,
+	const size_t n_cores)
+{
+	size_t i, ran = 1;
+
+	ctxt->go = false;
+	ctxt->stop = false;
+	for (i = 1; i < n_cores; i++) {
+		workers[i].ret = pthread_create(&workers[i].pthread, NULL,
+			stress_vecfreq_worker, &workers[i]);
+		if (workers[i].ret == 0)
+			ran++;
+	}
+	ctxt->go = true;
+	(void)stress_vecfreq_worker(&workers[0]);
+	for (i = 1; i < n_cores; i++) {
+		if (workers[i].ret == 0)
+			(void)pthread_join(workers[i].pthread, NULL);
+	}
+	return ran;
+}
+
+/*
+ *  stress_vecfreq_report()
+ *	report GFLOP/s and effective MHz per width and active core
+ *	count, metrics are for 1 and the maximum active cores
+ */
+static void stress_vecfreq_report(
+	stress_args_t *args,
+	const size_t *cores,
+	const size_t n_core_steps)
+{
+	size_t m, c, idx = 0;
+	const bool report = stress_instance_zero(args);
+
+	if (report) {
+		pr_block_begin();
+		pr_inf("%s: %-9s %5s %10s %10s %9s %8s %10s\n", args->name,
+			"kernel", "cores", "GFLOP/s", "per core", "MHz", "MHz %", "FLOP/cycle");
+	}
+	for (m = 1; m < VECFREQ_METHODS; m++) {
+		const stress_vecfreq_method_t *method = &stress_vecfreq_methods[m];
+
+		for (c = 0; c < n_core_steps; c++) {
+			const stress_vecfreq_stats_t *stats = &stress_vecfreq_stats[m][c];
+			const stress_vecfreq_stats_t *base = &stress_vecfreq_stats[method->base][c];
+			const double mhz = (stats->mhz_count > 0.0) ? stats->mhz / stats->mhz_count : 0.0;
+			const double base_mhz = (base->mhz_count > 0.0) ? base->mhz / base->mhz_count : 0.0;
+			double gflops, per_core;
+			char mhz_str[16], pct_str[16], fpc_str[16], str[64];
+
+			if (stats->duration <= 0.0)
+				continue;
+			/* thread duration sum is active cores x seconds */
+			per_core = (stats->flops / stats->duration) / 1.0E9;
+			gflops = per_core * (double)cores[c];
+
+			if (mhz > 0.0) {
+				(void)snprintf(mhz_str, sizeof(mhz_str), "%.0f", mhz);
+				(void)snprintf(fpc_str, sizeof(fpc_str), "%.2f", per_core * 1000.0 / mhz);
+			} else {
+				(void)shim_strscpy(mhz_str, "n/a", sizeof(mhz_str));
+				(void)shim_strscpy(fpc_str, "n/a", sizeof(fpc_str));
+			}
+			if ((mhz > 0.0) && (base_mhz > 0.0))
+				(void)snprintf(pct_str, sizeof(pct_str), "%.1f%%", 100.0 * mhz / base_mhz);
+			else
+				(void)shim_strscpy(pct_str, "n/a", sizeof(pct_str));
+
+			if (report)
+				pr_inf("%s: %-9s %5zu %10.2f %10.2f %9s %8s %10s\n",
+					args->name, method->name, cores[c], gflops,
+					per_core, mhz_str, pct_str, fpc_str);
+
+			if ((c != 0) && (c != n_core_steps - 1))
+				continue;
+			(void)snprintf(str, sizeof(str), "%s %zu cores GFLOP per sec", method->name, cores[c]);
+			stress_metrics_set(args, idx++, str, gflops, STRESS_METRIC_HARMONIC_MEAN);
+			if (mhz > 0.0) {
+				(void)snprintf(str, sizeof(str), "%s %zu cores effective MHz", method->name, cores[c]);
+				stress_metrics_set(args, idx++, str, mhz, STRESS_METRIC_HARMONIC_MEAN);
+			}
+		}
+	}
+	if (report)
+		pr_block_end();
+}
+
+/*
+ *  stress_vecfreq()
+ *	stress wide vector units and measure throughput versus frequency
+ */
+static int stress_vecfreq(stress_args_t *args)
+{
+	stress_vecfreq_ctxt_t ctxt;
+	stress_vecfreq_worker_t *workers;
+	stress_vecfreq_state_t *states;
+	size_t vecfreq_method = 0, vecfreq_cores = 0, n_core_steps, i, n;
+	size_t cores[VECFREQ_CORE_STEPS], states_size;
+	uint32_t vecfreq_duration = DEFAULT_VECFREQ_DURATION;
+	uint32_t *cpus = NULL, n_cpus;
+	bool capable[VECFREQ_METHODS];
+	cpu_set_t orig_mask;
+	int rc = EXIT_SUCCESS;
+
+	stress_catch_sigill();
+
+	(void)stress_get_setting("vecfreq-method", &vecfreq_method);
+	(void)stress_get_setting("vecfreq-duration", &vecfreq_duration);
+
+	n_cpus = stress_get_usable_cpus(&cpus, true);
+	if ((n_cpus == 0) || !cpus) {
+		pr_inf_skip("%s: cannot determine usable CPUs, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	if (!stress_get_setting("vecfreq-cores", &vecfreq_cores) || (vecfreq_cores == 0)) {
+		const size_t instances = (args->instances > 0) ? (size_t)args->instances : 1;
+
+		vecfreq_cores = (size_t)n_cpus / instances;
+	}
+	if (vecfreq_cores < 1)
+		vecfreq_cores = 1;
+	if (vecfreq_cores > MAX_VECFREQ_CORES)
+		vecfreq_cores = MAX_VECFREQ_CORES;
+
+	for (n_core_steps = 0, n = 1; n < vecfreq_cores; n <<= 1)
+		cores[n_core_steps++] = n;
+	cores[n_core_steps++] = vecfreq_cores;
+
+	(void)shim_memset(capable, 0, sizeof(capable));
+	for (n = 0, i = 1; i < VECFREQ_METHODS; i++) {
+		if ((vecfreq_method != 0) && (vecfreq_method != i))
+			continue;
+		capable[i] = stress_vecfreq_methods[i].capable();
+		if (capable[i])
+			n++;
+		else if (stress_instance_zero(args))
+			pr_inf("%s: %s kernel not supported by this CPU, skipping it\n",
+				args->name, stress_vecfreq_methods[i].name);
+	}
+	if (n == 0) {
+		pr_inf_skip("%s: no supported vector kernels, skipping stressor\n", args->name);
+		stress_free_usable_cpus(&cpus);
+		return EXIT_NO_RESOURCE;
+	}
+
+	states_size = vecfreq_cores * sizeof(*states);
+	states = (stress_vecfreq_state_t *)stress_mmap_populate(NULL, states_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (states == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes%s, errno=%d (%s), "
+			"skipping stressor\n", args->name, states_size,
+			stress_get_memfree_str(), errno, strerror(errno));
+		stress_free_usable_cpus(&cpus);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(states, states_size, "vecfreq-state");
+	workers = (stress_vecfreq_worker_t *)calloc(vecfreq_cores, sizeof(*workers));
+	if (!workers) {
+		pr_inf_skip("%s: failed to allocate %zu workers, skipping stressor\n",
+			args->name, vecfreq_cores);
+		(void)munmap((void *)states, states_size);
+		stress_free_usable_cpus(&cpus);
+		return EXIT_NO_RESOURCE;
+	}
+
+	(void)shim_memset(&ctxt, 0, sizeof(ctxt));
+	ctxt.args = args;
+	ctxt.duration = (double)vecfreq_duration / 1000.0;
+	ctxt.verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	stress_vecfreq_freq_init(&ctxt);
+
+	for (i = 0; i < vecfreq_cores; i++) {
+		stress_vecfreq_state_t *state = &states[i];
+		size_t j;
+
+		for (j = 0; j < VECFREQ_DOT_FLOATS; j++) {
+			state->x[j] = (float)stress_mwc16() / 65536.0F;
+			state->y[j] = (float)stress_mwc16() / 65536.0F;
+		}
+#if defined(HAVE_VECFREQ_AMX)
+		for (j = 0; j < SIZEOF_ARRAY(state->a); j++) {
+			state->a[j] = 0x3d80;	/* bf16 1/16 */
+			state->b[j] = 0x3d80;
+		}
+#endif
+		workers[i].id = i;
+		/* spread instances over different CPUs */
+		workers[i].cpu = cpus[(((size_t)args->instance * vecfreq_cores) + i) % n_cpus];
+		workers[i].ctxt = &ctxt;
+		workers[i].state = state;
+	}
+
+	if (stress_instance_zero(args))
+		pr_dbg("%s: up to %zu active cores, %" PRIu32 " ms per step, frequency from %s\n",
+			args->name, vecfreq_cores, vecfreq_duration,
+			stress_vecfreq_freq_names[ctxt.freq]);
+	if ((ctxt.freq == VECFREQ_FREQ_NONE) && stress_instance_zero(args))
+		pr_inf("%s: no APERF/MPERF, cycle counter or cpufreq frequency "
+			"available, reporting throughput only\n", args->name);
+
+	(void)shim_memset(stress_vecfreq_stats, 0, sizeof(stress_vecfreq_stats));
+	CPU_ZERO(&orig_mask);
+	(void)sched_getaffinity(0, sizeof(orig_mask), &orig_mask);
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		size_t m, c;
+
+		for (c = 0; c < n_core_steps; c++) {
+			for (m = 1; m < VECFREQ_METHODS; m++) {
+				stress_vecfreq_stats_t *stats = &stress_vecfreq_stats[m][c];
+				size_t ran;
+
+				if (!capable[m])
+					continue;
+				if (UNLIKELY(!stress_continue(args)))
+					goto finish;
+
+				ctxt.method = &stress_vecfreq_methods[m];
+				ran = stress_vecfreq_step(&ctxt, workers, cores[c]);
+				for (i = 0; i < cores[c]; i++) {
+					const stress_vecfreq_worker_t *worker = &workers[i];
+
+					if ((i > 0) && (worker->ret != 0))
+						continue;
+					if (worker->verify_failed) {
+						pr_fail("%s: %s kernel result mismatch on CPU %" PRIu32 "\n",
+							args->name, ctxt.method->name, worker->cpu);
+						rc = EXIT_FAILURE;
+					}
+					/* discard partial steps cut short by the end of the run */
+					if (ran < cores[c] || !stress_continue_flag())
+						continue;
+					stats->flops += worker->flops;
+					stats->duration += worker->duration;
+					if (worker->mhz > 0.0) {
+						stats->mhz += worker->mhz;
+						stats->mhz_count += 1.0;
+					}
+				}
+				stress_bogo_inc(args);
+				if (rc != EXIT_SUCCESS)
+					goto finish;
+			}
+		}
+	} while (stress_continue(args));
+
+finish:
+	(void)sched_setaffinity(0, sizeof(orig_mask), &orig_mask);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	stress_vecfreq_report(args, cores, n_core_steps);
+
+	free(workers);
+	(void)munmap((void *)states, states_size);
+	stress_free_usable_cpus(&cpus);
+
+	return rc;
+}
+
+static const char *stress_vecfreq_method(const size_t i)
+{
+	return (i < VECFREQ_METHODS) ? stress_vecfreq_methods[i].name : NULL;
+}
+
+static const stress_opt_t opts[] = {
+	{ OPT_vecfreq_cores,	"vecfreq-cores",    TYPE_ID_SIZE_T, MIN_VECFREQ_CORES, MAX_VECFREQ_CORES, NULL },
+	{ OPT_vecfreq_duration,	"vecfreq-duration", TYPE_ID_UINT32, MIN_VECFREQ_DURATION, MAX_VECFREQ_DURATION, NULL },
+	{ OPT_vecfreq_method,	"vecfreq-method",   TYPE_ID_SIZE_T_METHOD, 0, 0, stress_vecfreq_method },
+	END_OPT,
+};
+
+const stressor_info_t stress_vecfreq_info = {
+	.stressor = stress_vecfreq,
+	.classifier = CLASS_CPU | CLASS_COMPUTE | CLASS_FP | CLASS_VECTOR,
+	.opts = opts,
+	.verify = VERIFY_OPTIONAL,
+	.help = help
+};
+#else
+
+static const stress_opt_t opts[] = {
+	{ OPT_vecfreq_cores,	"vecfreq-cores",    TYPE_ID_SIZE_T, MIN_VECFREQ_CORES, MAX_VECFREQ_CORES, NULL },
+	{ OPT_vecfreq_duration,	"vecfreq-duration", TYPE_ID_UINT32, MIN_VECFREQ_DURATION, MAX_VECFREQ_DURATION, NULL },
+	{ OPT_vecfreq_method,	"vecfreq-method",   TYPE_ID_SIZE_T_METHOD, 0, 0, stress_unimplemented_method },
+	END_OPT,
+};
+
+const stressor_info_t stress_vecfreq_info = {
+	.stressor = stress_unimplemented,
+	.classifier = CLASS_CPU | CLASS_COMPUTE | CLASS_FP | CLASS_VECTOR,
+	.opts = opts,
+	.verify = VERIFY_OPTIONAL,
+	.help = help,
+	.unimplemented_reason = "only supported on x86-64 with pthreads, sched_setaffinity() and compiler vector and target attribute support"
+};
+#endif
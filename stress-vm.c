@@ -33,7 +33,15 @@
 #include "core-out-of-memory.h"
 #include "core-pragma.h"
 #include "core-prime.h"
+#include "core-put.h"
 #include "core-vecmath.h"
+#include "core-vmstat.h"
+
+#include <sys/ioctl.h>
+
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#endif
 
 #define MIN_VM_BYTES		(4 * KB)
 #define MAX_VM_BYTES		(MAX_MEM_LIMIT)
@@ -51,6 +59,34 @@
 
 #define NO_MEM_RETRIES_MAX	(32)
 
+#define VM_THP_SYSFS		"/sys/kernel/mm/transparent_hugepage"
+#define VM_THP_TYPES_MAX	(16)
+#define VM_THP_MIN_BYTES	(4 * MB)
+#define VM_THP_MAX_BYTES	(256 * MB)
+#define VM_THP_LOADS		(1U << 20)
+
+#if !defined(MAP_HUGE_2MB) && defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_2MB    (21 << MAP_HUGE_SHIFT)
+#endif
+
+#if !defined(MAP_HUGE_1GB) && defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_1GB    (30 << MAP_HUGE_SHIFT)
+#endif
+
+#if defined(__linux__) &&		\
+    defined(HAVE_MADVISE) &&		\
+    defined(HAVE_MPROTECT) &&		\
+    defined(MADV_HUGEPAGE) &&		\
+    defined(MADV_NOHUGEPAGE)
+#define HAVE_VM_THP_BENCH
+#endif
+
+#if defined(HAVE_LINUX_PERF_EVENT_H) &&	\
+    defined(__NR_perf_event_open) &&	\
+    defined(PERF_EVENT_IOC_ENABLE)
+#define HAVE_VM_DTLB_PERF
+#endif
+
 static size_t stress_vm_cache_line_size;
 static bool vm_flush;
 
@@ -81,6 +117,37 @@ typedef struct {
 	bool vm_numa;
 } stress_vm_context_t;
 
+/* Kinds of pages compared by --vm-thp-bench */
+typedef enum {
+	VM_PAGE_BASE,		/* base pages, THP disabled */
+	VM_PAGE_MTHP,		/* multi-size THP smaller than PMD size */
+	VM_PAGE_THP,		/* PMD sized THP */
+	VM_PAGE_HUGETLB,	/* hugetlbfs pages */
+} stress_vm_page_kind_t;
+
+/* Per page type --vm-thp-bench results */
+typedef struct {
+	char name[24];			/* e.g. "64K mTHP" */
+	stress_vm_page_kind_t kind;	/* kind of page */
+	size_t size;			/* page size in bytes */
+	double fault_ns;		/* best nanosecs per fault */
+	double fault_rate;		/* best GB/sec faulted in */
+	double load_ns;			/* best nanosecs per dependent load */
+	double dtlb_misses;		/* dTLB misses per 1000 loads, -ve if unknown */
+	double backed;			/* % of working set backed by this page type */
+	bool available;			/* false if pages could not be mapped */
+} stress_vm_thp_t;
+
+/* A working set region backed by one page type */
+typedef struct {
+	uint8_t *map;			/* mapping */
+	size_t map_size;		/* size of mapping */
+	uint8_t *base;			/* start of working set */
+	size_t size;			/* size of working set */
+	size_t chunk;			/* contiguous bytes per chunk */
+	size_t stride;			/* bytes between chunks */
+} stress_vm_thp_region_t;
+
 static const stress_help_t help[] = {
 	{ "m N", "vm N",	 "start N workers spinning on anonymous mmap" },
 	{ NULL,	 "vm-bytes N",	 "allocate N bytes per vm worker (default 256MB)" },
@@ -97,6 +164,7 @@ static const stress_help_t help[] = {
 #if defined(MAP_POPULATE)
 	{ NULL,	 "vm-populate",	 "populate (prefault) page tables for a mapping" },
 #endif
+	{ NULL,	 "vm-thp-bench", "compare fault and TLB costs of base, mTHP, THP and hugetlb pages" },
 	{ NULL,	 NULL,		 NULL }
 };
 
@@ -3543,6 +3611,7 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 	int advice = -1;
 	int rc = EXIT_SUCCESS;
 	bool vm_keep = false;
+	stress_thp_stats_t thp_before, thp_after;
 
 	stress_catch_sigill();
 
@@ -3561,6 +3630,12 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 	if (stress_get_setting("vm-madvise", &vm_madvise))
 		advice = vm_madvise_info[vm_madvise].advice;
 
+	/* with explicit advice, report if huge pages were obtained */
+	(void)shim_memset(&thp_before, 0, sizeof(thp_before));
+	(void)shim_memset(&thp_after, 0, sizeof(thp_after));
+	if (advice >= 0)
+		(void)stress_thp_stats_get(&thp_before);
+
 	do {
 		if (!vm_keep || (buf == NULL)) {
 			if (UNLIKELY(!stress_continue_flag()))
@@ -3628,6 +3703,15 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 		no_mem_retries = 0;
 		(void)stress_mincore_touch_pages(buf, buf_sz);
 		*(context->bit_error_count) += func(buf, buf_end, buf_sz, args, max_ops);
+		if (thp_before.valid) {
+			stress_thp_stats_t thp_now;
+
+			/* the last pass may be cut short, keep the best coverage */
+			if (stress_thp_stats_get(&thp_now)) {
+				thp_now.anon_huge_kb = STRESS_MAXIMUM(thp_now.anon_huge_kb, thp_after.anon_huge_kb);
+				thp_after = thp_now;
+			}
+		}
 
 		if (vm_hang == 0) {
 			while (stress_continue_vm(args)) {
@@ -3656,10 +3740,544 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 		(void)stress_munmap_force(buf, buf_sz);
 #endif
 	}
+	(void)stress_thp_stats_report(args, &thp_before, &thp_after, buf_sz, 0);
 
 	return rc;
 }
 
+#if defined(HAVE_VM_THP_BENCH)
+/*
+ *  stress_vm_thp_enabled()
+ *	read the selected THP enabled setting for a size, a size
+ *	of 0 reads the top level setting
+ */
+static void stress_vm_thp_enabled(const size_t size, char *setting, const size_t len)
+{
+	char path[PATH_MAX], buf[128];
+	char *start, *end;
+
+	if (size)
+		(void)snprintf(path, sizeof(path), VM_THP_SYSFS "/hugepages-%zukB/enabled", (size_t)(size / KB));
+	else
+		(void)shim_strscpy(path, VM_THP_SYSFS "/enabled", sizeof(path));
+
+	*setting = '\0';
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return;
+	start = strchr(buf, '[');
+	if (!start)
+		return;
+	start++;
+	end = strchr(start, ']');
+	if (!end)
+		return;
+	*end = '\0';
+	(void)shim_strscpy(setting, start, len);
+}
+
+/*
+ *  stress_vm_thp_enable()
+ *	THP sizes that are disabled are enabled for madvise'd regions,
+ *	the original settings are restored by stress_vm_deinit()
+ */
+static void stress_vm_thp_enable(const size_t size)
+{
+	char path[PATH_MAX], setting[32];
+
+	stress_vm_thp_enabled(size, setting, sizeof(setting));
+	if (!strcmp(setting, "inherit")) {
+		stress_vm_thp_enabled(0, setting, sizeof(setting));
+		if (strcmp(setting, "never"))
+			return;
+	} else if (strcmp(setting, "never")) {
+		return;
+	}
+	(void)snprintf(path, sizeof(path), VM_THP_SYSFS "/hugepages-%zukB/enabled", (size_t)(size / KB));
+	(void)stress_system_write(path, "madvise", 7);
+}
+
+/*
+ *  stress_vm_thp_fault_allocs()
+ *	system wide count of faults that allocated a THP of a given size
+ */
+static uint64_t stress_vm_thp_fault_allocs(const size_t size)
+{
+	char path[PATH_MAX], buf[64];
+
+	(void)snprintf(path, sizeof(path), VM_THP_SYSFS "/hugepages-%zukB/stats/anon_fault_alloc", (size_t)(size / KB));
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return 0;
+	return (uint64_t)atoll(buf);
+}
+
+/*
+ *  stress_vm_thp_add()
+ *	add a page type to the page types to be benchmarked
+ */
+static void stress_vm_thp_add(
+	stress_vm_thp_t *types,
+	size_t *n,
+	const stress_vm_page_kind_t kind,
+	const size_t size)
+{
+	static const char * const kind_names[] = {
+		"base", "mTHP", "THP", "hugetlb",
+	};
+	stress_vm_thp_t *type;
+	char str[32];
+
+	if (*n >= VM_THP_TYPES_MAX)
+		return;
+	type = &types[(*n)++];
+	(void)shim_memset(type, 0, sizeof(*type));
+	type->kind = kind;
+	type->size = size;
+	(void)snprintf(type->name, sizeof(type->name), "%s %s",
+		stress_uint64_to_str(str, sizeof(str), (uint64_t)size, 0, true),
+		kind_names[kind]);
+}
+
+/*
+ *  stress_vm_thp_types()
+ *	find the page sizes to be benchmarked, base pages, multi-size
+ *	THP sizes, PMD sized THP and hugetlb pages
+ */
+static size_t stress_vm_thp_types(stress_vm_thp_t *types, const size_t page_size)
+{
+	size_t n = 0, i, n_sizes = 0, pmd_size = 0;
+	size_t sizes[VM_THP_TYPES_MAX];
+	char buf[64];
+	DIR *dir;
+
+	stress_vm_thp_add(types, &n, VM_PAGE_BASE, page_size);
+
+	if (stress_system_read(VM_THP_SYSFS "/hpage_pmd_size", buf, sizeof(buf)) > 0)
+		pmd_size = (size_t)atoll(buf);
+
+	dir = opendir(VM_THP_SYSFS);
+	if (dir) {
+		const struct dirent *d;
+
+		while ((d = readdir(dir)) != NULL) {
+			char path[PATH_MAX];
+			size_t kb, size;
+
+			if (sscanf(d->d_name, "hugepages-%zukB", &kb) != 1)
+				continue;
+			size = kb * KB;
+			if ((size <= page_size) || (size >= pmd_size))
+				continue;
+			/* some sizes have no enabled control */
+			(void)snprintf(path, sizeof(path), VM_THP_SYSFS "/%s/enabled", d->d_name);
+			if (access(path, R_OK) < 0)
+				continue;
+			if (n_sizes < VM_THP_TYPES_MAX)
+				sizes[n_sizes++] = size;
+		}
+		(void)closedir(dir);
+	}
+	/* insertion sort, there are just a few sizes */
+	for (i = 1; i < n_sizes; i++) {
+		const size_t size = sizes[i];
+		size_t j;
+
+		for (j = i; (j > 0) && (sizes[j - 1] > size); j--)
+			sizes[j] = sizes[j - 1];
+		sizes[j] = size;
+	}
+	for (i = 0; i < n_sizes; i++)
+		stress_vm_thp_add(types, &n, VM_PAGE_MTHP, sizes[i]);
+	if (pmd_size)
+		stress_vm_thp_add(types, &n, VM_PAGE_THP, pmd_size);
+#if defined(MAP_HUGETLB) &&	\
+    defined(MAP_HUGE_2MB) &&	\
+    defined(MAP_HUGE_1GB)
+	stress_vm_thp_add(types, &n, VM_PAGE_HUGETLB, 2 * MB);
+	stress_vm_thp_add(types, &n, VM_PAGE_HUGETLB, 1 * GB);
+#endif
+	return n;
+}
+
+/*
+ *  stress_vm_thp_addr()
+ *	address of byte offset in the working set of a region
+ */
+static inline uint8_t *stress_vm_thp_addr(const stress_vm_thp_region_t *region, const size_t offset)
+{
+	return region->base + ((offset / region->chunk) * region->stride) + (offset % region->chunk);
+}
+
+/*
+ *  stress_vm_thp_map()
+ *	map a working set region that can only be backed by the given
+ *	page type. Multi-size THP regions are split into VMAs of one
+ *	THP each so larger THP sizes cannot be used, returns false if
+ *	the region could not be mapped
+ */
+static bool stress_vm_thp_map(
+	const stress_vm_thp_t *type,
+	stress_vm_thp_region_t *region,
+	const size_t size)
+{
+	size_t i;
+
+	(void)shim_memset(region, 0, sizeof(*region));
+	region->size = size;
+	region->chunk = size;
+	region->stride = size;
+
+	switch (type->kind) {
+	case VM_PAGE_BASE:
+		region->map_size = size;
+		region->map = (uint8_t *)mmap(NULL, region->map_size, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (region->map == MAP_FAILED)
+			return false;
+		region->base = region->map;
+		(void)shim_madvise(region->base, size, MADV_NOHUGEPAGE);
+		break;
+	case VM_PAGE_THP:
+		region->map_size = size + type->size;
+		region->map = (uint8_t *)mmap(NULL, region->map_size, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (region->map == MAP_FAILED)
+			return false;
+		region->base = (uint8_t *)stress_align_address(region->map, type->size);
+		(void)shim_madvise(region->base, size, MADV_HUGEPAGE);
+		break;
+	case VM_PAGE_MTHP:
+		region->chunk = type->size;
+		region->stride = 2 * type->size;
+		region->map_size = (2 * size) + type->size;
+		region->map = (uint8_t *)mmap(NULL, region->map_size, PROT_NONE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (region->map == MAP_FAILED)
+			return false;
+		region->base = (uint8_t *)stress_align_address(region->map, type->size);
+		(void)shim_madvise(region->map, region->map_size, MADV_HUGEPAGE);
+		for (i = 0; i < size; i += type->size) {
+			if (mprotect(stress_vm_thp_addr(region, i), type->size, PROT_READ | PROT_WRITE) < 0) {
+				(void)munmap((void *)region->map, region->map_size);
+				region->map = MAP_FAILED;
+				return false;
+			}
+		}
+		break;
+	case VM_PAGE_HUGETLB:
+#if defined(MAP_HUGETLB) &&	\
+    defined(MAP_HUGE_2MB) &&	\
+    defined(MAP_HUGE_1GB)
+		region->map_size = (size + type->size - 1) & ~(type->size - 1);
+		region->map = (uint8_t *)mmap(NULL, region->map_size, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB |
+					((type->size == GB) ? MAP_HUGE_1GB : MAP_HUGE_2MB), -1, 0);
+		if (region->map == MAP_FAILED)
+			return false;
+		region->base = region->map;
+		break;
+#else
+		region->map = MAP_FAILED;
+		return false;
+#endif
+	default:
+		region->map = MAP_FAILED;
+		return false;
+	}
+	return true;
+}
+
+/*
+ *  stress_vm_thp_chain()
+ *	link one pointer per base page into a random cyclic chain
+ *	(Sattolo's algorithm), each pointer is at a random cache line
+ *	in its page, returns the start of the chain
+ */
+static void **stress_vm_thp_chain(
+	const stress_vm_thp_region_t *region,
+	uint32_t *order,
+	const size_t page_size)
+{
+	const uint32_t pages = (uint32_t)(region->size / page_size);
+	const uint32_t lines = (uint32_t)(page_size / 64);
+	uint32_t i;
+	void **first;
+
+	for (i = 0; i < pages; i++)
+		order[i] = i;
+	for (i = pages - 1; i > 0; i--) {
+		const uint32_t j = stress_mwc32modn(i);
+		const uint32_t tmp = order[i];
+
+		order[i] = order[j];
+		order[j] = tmp;
+	}
+	first = (void **)stress_vm_thp_addr(region, ((size_t)order[0] * page_size) +
+			(64 * (size_t)stress_mwc32modn(lines)));
+	{
+		void **ptr = first;
+
+		for (i = 1; i < pages; i++) {
+			void **next = (void **)stress_vm_thp_addr(region, ((size_t)order[i] * page_size) +
+					(64 * (size_t)stress_mwc32modn(lines)));
+
+			*ptr = (void *)next;
+			ptr = next;
+		}
+		*ptr = (void *)first;
+	}
+	return first;
+}
+
+/*
+ *  stress_vm_thp_chase()
+ *	follow the pointer chain for a given number of dependent loads
+ */
+static void * OPTIMIZE3 stress_vm_thp_chase(void **ptr, const uint32_t loads)
+{
+	register void **p = ptr;
+	register uint32_t i;
+
+	for (i = 0; i < loads; i += 8) {
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+		p = (void **)*p;
+	}
+	return (void *)p;
+}
+
+#if defined(HAVE_VM_DTLB_PERF)
+/*
+ *  stress_vm_dtlb_open()
+ *	open a user space dTLB read miss counter for this process,
+ *	returns -1 if the counter is not available
+ */
+static int stress_vm_dtlb_open(void)
+{
+	struct perf_event_attr attr;
+
+	(void)shim_memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_DTLB |
+		      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+/*
+ *  stress_vm_thp_measure()
+ *	fault in a working set backed by the given page type and
+ *	measure the fault latency, the dependent load latency and
+ *	dTLB miss rate, returns false if the page type is unavailable
+ */
+static bool stress_vm_thp_measure(
+	stress_vm_thp_t *type,
+	const size_t size,
+	uint32_t *order,
+	const size_t page_size,
+	const int dtlb_fd)
+{
+	stress_vm_thp_region_t region;
+	stress_thp_stats_t before, after;
+	uint64_t allocs = 0;
+	size_t offset, faults = 0;
+	double t, duration, ns;
+	void **ptr;
+
+	if (type->kind == VM_PAGE_MTHP)
+		allocs = stress_vm_thp_fault_allocs(type->size);
+	(void)stress_thp_stats_get(&before);
+
+	if (!stress_vm_thp_map(type, &region, size))
+		return false;
+
+	/* fault in each page with a write */
+	t = stress_time_now();
+	for (offset = 0; offset < size; offset += type->size) {
+		*(volatile uint8_t *)stress_vm_thp_addr(&region, offset) = 0xaa;
+		faults++;
+	}
+	duration = stress_time_now() - t;
+
+	(void)stress_thp_stats_get(&after);
+	switch (type->kind) {
+	case VM_PAGE_MTHP:
+		allocs = stress_vm_thp_fault_allocs(type->size) - allocs;
+		type->backed = STRESS_MINIMUM(100.0 * (double)(allocs * type->size) / (double)size, 100.0);
+		break;
+	case VM_PAGE_THP:
+		type->backed = ((after.anon_huge_kb >= before.anon_huge_kb) && before.valid) ?
+			STRESS_MINIMUM(100.0 * (double)((after.anon_huge_kb - before.anon_huge_kb) * KB) / (double)size, 100.0) : 0.0;
+		break;
+	default:
+		type->backed = 100.0;
+		break;
+	}
+
+	ns = (duration * STRESS_DBL_NANOSECOND) / (double)faults;
+	if ((type->fault_ns <= 0.0) || (ns < type->fault_ns))
+		type->fault_ns = ns;
+	if (duration > 0.0) {
+		const double rate = ((double)size / (double)GB) / duration;
+
+		type->fault_rate = STRESS_MAXIMUM(type->fault_rate, rate);
+	}
+
+	/* random dependent loads, one per base page */
+	ptr = stress_vm_thp_chain(&region, order, page_size);
+	ptr = stress_vm_thp_chase(ptr, VM_THP_LOADS / 8);
+#if defined(HAVE_VM_DTLB_PERF)
+	if (dtlb_fd >= 0) {
+		(void)ioctl(dtlb_fd, PERF_EVENT_IOC_RESET, 0);
+		(void)ioctl(dtlb_fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+#else
+	(void)dtlb_fd;
+#endif
+	t = stress_time_now();
+	ptr = stress_vm_thp_chase(ptr, VM_THP_LOADS);
+	duration = stress_time_now() - t;
+#if defined(HAVE_VM_DTLB_PERF)
+	if (dtlb_fd >= 0) {
+		uint64_t misses;
+
+		(void)ioctl(dtlb_fd, PERF_EVENT_IOC_DISABLE, 0);
+		if (read(dtlb_fd, &misses, sizeof(misses)) == (ssize_t)sizeof(misses)) {
+			const double rate = 1000.0 * (double)misses / (double)VM_THP_LOADS;
+
+			if ((type->dtlb_misses < 0.0) || (rate < type->dtlb_misses))
+				type->dtlb_misses = rate;
+		}
+	}
+#endif
+	stress_void_ptr_put((void *)ptr);
+	ns = (duration * STRESS_DBL_NANOSECOND) / (double)VM_THP_LOADS;
+	if ((type->load_ns <= 0.0) || (ns < type->load_ns))
+		type->load_ns = ns;
+
+	(void)munmap((void *)region.map, region.map_size);
+	return true;
+}
+
+/*
+ *  stress_vm_thp_bench_child()
+ *	compare page fault latency, load latency and dTLB miss rates
+ *	of the same working set backed by each available page size
+ */
+static int stress_vm_thp_bench_child(stress_args_t *args, void *ctxt)
+{
+	const stress_vm_context_t *context = (stress_vm_context_t *)ctxt;
+	const size_t page_size = args->page_size;
+	stress_vm_thp_t types[VM_THP_TYPES_MAX];
+	size_t i, n, size, idx = 0;
+	uint32_t *order;
+	int dtlb_fd = -1;
+	char str[32];
+
+	/* same working set for all page sizes, a whole number of PMD pages */
+	size = STRESS_MINIMUM(context->vm_bytes, VM_THP_MAX_BYTES);
+	size = STRESS_MAXIMUM(size, VM_THP_MIN_BYTES) & ~((2 * MB) - 1);
+
+	n = stress_vm_thp_types(types, page_size);
+	for (i = 0; i < n; i++) {
+		types[i].dtlb_misses = -1.0;
+		types[i].available = true;
+		if ((types[i].kind == VM_PAGE_MTHP) || (types[i].kind == VM_PAGE_THP))
+			stress_vm_thp_enable(types[i].size);
+	}
+
+	order = (uint32_t *)calloc(size / page_size, sizeof(*order));
+	if (!order) {
+		pr_inf_skip("%s: cannot allocate %zu page chain order table%s, skipping stressor\n",
+			args->name, size / page_size, stress_get_memfree_str());
+		return EXIT_NO_RESOURCE;
+	}
+#if defined(HAVE_VM_DTLB_PERF)
+	dtlb_fd = stress_vm_dtlb_open();
+#endif
+	if (stress_instance_zero(args)) {
+		pr_inf("%s: comparing %zu page types on a %s working set%s\n",
+			args->name, n,
+			stress_uint64_to_str(str, sizeof(str), (uint64_t)size, 0, true),
+			(dtlb_fd < 0) ? ", dTLB miss counter not available" : "");
+	}
+
+	do {
+		for (i = 0; (i < n) && stress_continue(args); i++) {
+			if (!types[i].available)
+				continue;
+			if (!stress_vm_thp_measure(&types[i], size, order, page_size, dtlb_fd)) {
+				types[i].available = false;
+				if (stress_instance_zero(args))
+					pr_inf("%s: cannot map %s pages, errno=%d (%s), skipping this page type\n",
+						args->name, types[i].name, errno, strerror(errno));
+			}
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+
+	if (dtlb_fd >= 0)
+		(void)close(dtlb_fd);
+	free(order);
+
+	if (stress_instance_zero(args)) {
+		pr_inf("%s: %14s %12s %12s %12s %12s %9s\n", args->name,
+			"page type", "fault usec", "fault GB/s", "load ns",
+			"dTLB/1000", "% backed");
+	}
+	for (i = 0; i < n; i++) {
+		const stress_vm_thp_t *type = &types[i];
+		char description[64];
+
+		if (!type->available || (type->load_ns <= 0.0))
+			continue;
+		if (stress_instance_zero(args)) {
+			char dtlb[16];
+
+			if (type->dtlb_misses < 0.0)
+				(void)shim_strscpy(dtlb, "n/a", sizeof(dtlb));
+			else
+				(void)snprintf(dtlb, sizeof(dtlb), "%.2f", type->dtlb_misses);
+			pr_inf("%s: %14s %12.2f %12.2f %12.2f %12s %9.1f\n", args->name,
+				type->name, type->fault_ns / 1000.0, type->fault_rate,
+				type->load_ns, dtlb, type->backed);
+		}
+		if (idx + 5 > STRESS_MISC_METRICS_MAX)
+			break;
+		(void)snprintf(description, sizeof(description), "microsecs per fault %.23s", type->name);
+		stress_metrics_set(args, idx++, description,
+			type->fault_ns / 1000.0, STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(description, sizeof(description), "GB per sec faulted %.23s", type->name);
+		stress_metrics_set(args, idx++, description,
+			type->fault_rate, STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(description, sizeof(description), "nanosec per load %.23s", type->name);
+		stress_metrics_set(args, idx++, description,
+			type->load_ns, STRESS_METRIC_HARMONIC_MEAN);
+		if (type->dtlb_misses >= 0.0) {
+			(void)snprintf(description, sizeof(description), "dTLB misses per 1000 loads %.23s", type->name);
+			stress_metrics_set(args, idx++, description,
+				type->dtlb_misses, STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+		if ((type->kind == VM_PAGE_MTHP) || (type->kind == VM_PAGE_THP)) {
+			(void)snprintf(description, sizeof(description), "%% backed by %.23s", type->name);
+			stress_metrics_set(args, idx++, description,
+				type->backed, STRESS_METRIC_GEOMETRIC_MEAN);
+		}
+	}
+	return EXIT_SUCCESS;
+}
+#endif
+
 /*
  *  stress_vm_get_cache_line_size()
  *	determine size of a cache line, default to 64 if information
@@ -3699,6 +4317,7 @@ static int stress_vm(stress_args_t *args)
 	size_t vm_method = 0;
 	size_t vm_total = DEFAULT_VM_BYTES;
 	stress_vm_context_t context;
+	bool vm_thp_bench = false;
 
 	(void)shim_memset(&context, 0, sizeof(context));
 	stress_vm_get_cache_line_size();
@@ -3719,6 +4338,7 @@ static int stress_vm(stress_args_t *args)
 	context.bit_error_count = MAP_FAILED;
 
 	(void)stress_get_setting("vm-method", &vm_method);
+	(void)stress_get_setting("vm-thp-bench", &vm_thp_bench);
 	context.vm_method = &vm_methods[vm_method];
 
 	if (!stress_get_setting("vm-bytes", &vm_total)) {
@@ -3737,6 +4357,32 @@ static int stress_vm(stress_args_t *args)
 		vm_total = context.vm_bytes * args->instances;
 	}
 
+	if (vm_thp_bench) {
+#if defined(HAVE_VM_THP_BENCH)
+		if (stress_instance_zero(args))
+			stress_usage_bytes(args, context.vm_bytes, vm_total);
+		stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+		stress_sync_start_wait(args);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+		ret = stress_oomable_child(args, &context, stress_vm_thp_bench_child, STRESS_OOMABLE_NORMAL);
+
+		stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+#else
+		if (stress_instance_zero(args))
+			pr_inf_skip("%s: --vm-thp-bench is not supported on this system, "
+				"skipping stressor\n", args->name);
+		ret = EXIT_NOT_IMPLEMENTED;
+#endif
+#if defined(HAVE_LINUX_MEMPOLICY_H)
+		if (context.numa_mask)
+			stress_numa_mask_free(context.numa_mask);
+		if (context.numa_nodes)
+			stress_numa_mask_free(context.numa_nodes);
+#endif
+		return ret;
+	}
+
 	if (stress_instance_zero(args)) {
 		pr_dbg("%s: using method '%s'\n", args->name, context.vm_method->name);
 		stress_usage_bytes(args, context.vm_bytes, vm_total);
@@ -3803,6 +4449,69 @@ static int stress_vm(stress_args_t *args)
 	return ret;
 }
 
+#if defined(HAVE_VM_THP_BENCH)
+/* THP size enabled settings saved by stress_vm_init() */
+static size_t vm_thp_saved_size[VM_THP_TYPES_MAX];
+static char vm_thp_saved[VM_THP_TYPES_MAX][32];
+static size_t vm_thp_saved_n;
+#endif
+
+/*
+ *  stress_vm_init()
+ *	save the THP size enabled settings that --vm-thp-bench may
+ *	change, this runs once before any instance starts so the
+ *	settings are restored even if an instance is killed
+ */
+static void stress_vm_init(const uint32_t instances)
+{
+#if defined(HAVE_VM_THP_BENCH)
+	DIR *dir;
+	const struct dirent *d;
+
+	(void)instances;
+
+	vm_thp_saved_n = 0;
+	dir = opendir(VM_THP_SYSFS);
+	if (!dir)
+		return;
+	while (((d = readdir(dir)) != NULL) && (vm_thp_saved_n < VM_THP_TYPES_MAX)) {
+		size_t kb;
+
+		if (sscanf(d->d_name, "hugepages-%zukB", &kb) != 1)
+			continue;
+		stress_vm_thp_enabled(kb * KB, vm_thp_saved[vm_thp_saved_n], sizeof(vm_thp_saved[0]));
+		if (*vm_thp_saved[vm_thp_saved_n])
+			vm_thp_saved_size[vm_thp_saved_n++] = kb * KB;
+	}
+	(void)closedir(dir);
+#else
+	(void)instances;
+#endif
+}
+
+/*
+ *  stress_vm_deinit()
+ *	restore any THP size enabled settings changed by --vm-thp-bench
+ */
+static void stress_vm_deinit(void)
+{
+#if defined(HAVE_VM_THP_BENCH)
+	size_t i;
+
+	for (i = 0; i < vm_thp_saved_n; i++) {
+		char path[PATH_MAX], setting[32];
+
+		stress_vm_thp_enabled(vm_thp_saved_size[i], setting, sizeof(setting));
+		if (!strcmp(setting, vm_thp_saved[i]))
+			continue;
+		(void)snprintf(path, sizeof(path), VM_THP_SYSFS "/hugepages-%zukB/enabled",
+			(size_t)(vm_thp_saved_size[i] / KB));
+		(void)stress_system_write(path, vm_thp_saved[i], strlen(vm_thp_saved[i]));
+	}
+	vm_thp_saved_n = 0;
+#endif
+}
+
 static const char *stress_vm_madvise(const size_t i)
 {
 	return (i < SIZEOF_ARRAY(vm_madvise_info)) ? vm_madvise_info[i].name : NULL;
@@ -3823,11 +4532,14 @@ static const stress_opt_t opts[] = {
 	{ OPT_vm_method,   "vm-method",   TYPE_ID_SIZE_T_METHOD, 0, 0, stress_vm_method },
 	{ OPT_vm_numa,	   "vm-numa",	  TYPE_ID_BOOL, 0, 1, NULL },
 	{ OPT_vm_populate, "vm-populate", TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_vm_thp_bench, "vm-thp-bench", TYPE_ID_BOOL, 0, 1, NULL },
 	END_OPT,
 };
 
 const stressor_info_t stress_vm_info = {
 	.stressor = stress_vm,
+	.init = stress_vm_init,
+	.deinit = stress_vm_deinit,
 	.classifier = CLASS_VM | CLASS_MEMORY | CLASS_OS,
 	.opts = opts,
 	.verify = VERIFY_OPTIONAL,
@@ -25,6 +25,7 @@
 #include "core-asm-generic.h"
 #include "core-cpu-cache.h"
 #include "core-builtin.h"
+#include "core-histogram.h"
 #include "core-madvise.h"
 #include "core-mmap.h"
 #include "core-pthread.h"
@@ -64,7 +65,9 @@ typedef struct {
 } stress_workload_ctxt_t;
 #endif
 
-#define NUM_BUCKETS	(20)
+#define WORKLOAD_HIST_START		(0)	/* start time in the slice */
+#define WORKLOAD_HIST_LATENESS		(1)	/* wakeup lateness */
+#define WORKLOAD_HISTS			(2)
 
 #define STRESS_WORKLOAD_DIST_CLUSTER	(0)
 #define STRESS_WORKLOAD_DIST_EVEN	(1)
@@ -108,12 +111,6 @@ typedef struct {
 	const int method;
 } stress_workload_method_t;
 
-typedef struct {
-	double width;
-	uint64_t bucket[NUM_BUCKETS];
-	uint64_t overflow;
-} stress_workload_bucket_t;
-
 static const stress_help_t help[] = {
 	{ NULL,	"workload N",		"start N workers that exercise a mix of scheduling loads" },
 	{ NULL,	"workload-dist type",	"workload distribution type [random1, random2, random3, cluster]" },
@@ -619,70 +616,6 @@ static inline void stress_workload_waste_time(
 	}
 }
 
-static void stress_workload_bucket_init(stress_workload_bucket_t *bucket, const double width)
-{
-	size_t i;
-
-	for (i = 0; i < SIZEOF_ARRAY(bucket->bucket); i++)
-		bucket->bucket[i] = 0;
-	bucket->width = width / SIZEOF_ARRAY(bucket->bucket);
-	bucket->overflow = 0;
-}
-
-static void stress_workload_bucket_account(stress_workload_bucket_t *bucket, const double value)
-{
-	ssize_t i;
-
-	i = (ssize_t)(value / bucket->width);
-	if (UNLIKELY(i < 0))
-		i = 0;
-	if (i < (ssize_t)SIZEOF_ARRAY(bucket->bucket))
-		bucket->bucket[i]++;
-	else
-		bucket->overflow++;
-}
-
-static void stress_workload_bucket_report(stress_workload_bucket_t *bucket)
-{
-	size_t i;
-	int width1, width2;
-	char buf[64];
-	uint64_t total;
-
-	(void)snprintf(buf, sizeof(buf), "%" PRIu64,
-		(uint64_t)((SIZEOF_ARRAY(bucket->bucket) + 1) * bucket->width));
-	width1 = (int)strlen(buf);
-	if (width1 < 7)
-		width1 = 7;
-
-	total = bucket->overflow;
-	for (i = 0; i < SIZEOF_ARRAY(bucket->bucket); i++)
-		total += bucket->bucket[i];
-	(void)snprintf(buf, sizeof(buf), "%" PRIu64, total);
-	width2 = (int)strlen(buf);
-	if (width2 < 7)
-		width2 = 7;
-
-	pr_block_begin();
-	pr_dbg("distribution of workload start time in workload slice:\n");
-	pr_dbg("%-*s %*s %4s\n",
-		(width1 * 2) + 4, "start time (us)",
-		width2, "count", "%");
-	for (i = 0; i < SIZEOF_ARRAY(bucket->bucket); i++) {
-		pr_dbg("%*" PRIu64 " .. %*" PRIu64 " %*" PRIu64 " %4.1f\n",
-			width1, (uint64_t)(i * bucket->width),
-			width1, (uint64_t)((i + 1) * bucket->width) - 1,
-			width2, bucket->bucket[i],
-			(double)100.0 * (double)bucket->bucket[i] / (double)total);
-	}
-	pr_dbg("%*" PRIu64 " .. %*s %*" PRIu64 " %4.1f\n",
-		width1, (uint64_t)(i * bucket->width),
-		width1, "",
-		width2, bucket->overflow,
-		(double)100.0 * (double)bucket->overflow / (double)total);
-	pr_block_end();
-}
-
 static int stress_workload_cmp(const void *p1, const void *p2)
 {
 	const stress_workload_t *w1 = (const stress_workload_t *)p1;
@@ -712,13 +645,13 @@ static int stress_workload_exercise(
 	const uint32_t max_quanta,
 	const int workload_dist,
 	stress_workload_t *workload,
-	stress_workload_bucket_t *slice_offset_bucket,
+	stress_hist_t *hists,
 	uint8_t *buffer,
 	const size_t buffer_len)
 {
 	size_t i;
 	const double scale_us_to_sec = 1.0 / STRESS_DBL_MICROSECOND;
-	double t_begin, t_end, sleep_duration_ns, run_duration_sec;
+	double t_begin, t_end, sleep_duration_ns, run_duration_sec, t_now, late_ns;
 	const double scale32bit = 1.0 / (double)4294967296.0;
 	double sum, scale;
 	uint32_t offset;
@@ -796,7 +729,11 @@ static int stress_workload_exercise(
 		} else {
 			(void)shim_sched_yield();
 		}
-		stress_workload_bucket_account(slice_offset_bucket, STRESS_DBL_MICROSECOND * (stress_time_now() - t_begin));
+		t_now = stress_time_now();
+		stress_hist_record(&hists[WORKLOAD_HIST_START],
+			(uint64_t)(STRESS_DBL_MICROSECOND * (t_now - t_begin)));
+		late_ns = (t_now - run_when) * STRESS_DBL_NANOSECOND;
+		stress_hist_record(&hists[WORKLOAD_HIST_LATENESS], (late_ns > 0.0) ? (uint64_t)late_ns : 0);
 		if (run_duration_sec > 0.0) {
 			if (workload_threads) {
 #if defined(WORKLOAD_THREADED)
@@ -864,7 +801,7 @@ static int stress_workload(stress_args_t *args)
 	stress_workload_t *workload;
 	uint8_t *buffer;
 	const size_t buffer_len = MB;
-	stress_workload_bucket_t slice_offset_bucket;
+	stress_hist_t *hists;
 	int rc = EXIT_SUCCESS;
 #if defined(WORKLOAD_THREADED)
 	workload_thread_t *threads = NULL;
@@ -1002,7 +939,21 @@ static int stress_workload(stress_args_t *args)
 #endif
 	}
 
-	stress_workload_bucket_init(&slice_offset_bucket, (double)workload_slice_us);
+	hists = (stress_hist_t *)calloc(WORKLOAD_HISTS, sizeof(*hists));
+	if (!hists) {
+		pr_inf_skip("%s: cannot allocate workload histograms%s, "
+			"skipping stressor\n", args->name,
+			stress_get_memfree_str());
+		free(workload);
+		rc = EXIT_NO_RESOURCE;
+#if defined(WORKLOAD_THREADED)
+		goto exit_free_threads;
+#else
+		goto exit_free_buffer;
+#endif
+	}
+	stress_hist_init(&hists[WORKLOAD_HIST_START], "workload start time in workload slice (microsecs)");
+	stress_hist_init(&hists[WORKLOAD_HIST_LATENESS], "workload wakeup lateness (nanosecs)");
 
 	(void)stress_workload_set_sched(args, workload_sched);
 
@@ -1022,15 +973,16 @@ static int stress_workload(stress_args_t *args)
 					workload_threads,
 					max_quanta, workload_dist,
 					workload,
-					&slice_offset_bucket,
+					hists,
 					buffer, buffer_len);
 	} while (stress_continue(args));
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
-	if (stress_instance_zero(args))
-		stress_workload_bucket_report(&slice_offset_bucket);
+	stress_hist_merge(args, WORKLOAD_HIST_START, &hists[WORKLOAD_HIST_START]);
+	stress_hist_merge(args, WORKLOAD_HIST_LATENESS, &hists[WORKLOAD_HIST_LATENESS]);
 
+	free(hists);
 	free(workload);
 
 #if defined(WORKLOAD_THREADED)
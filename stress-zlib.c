@@ -32,6 +32,9 @@
 
 static const stress_help_t help[] = {
 	{ NULL,	"zlib N",		"start N workers compressing data with zlib" },
+	{ NULL,	"zlib-bench",		"benchmark zlib, lz4, zstd and bzip2 compression throughput" },
+	{ NULL,	"zlib-bench-bytes N",	"size of the data buffer compressed in benchmark mode" },
+	{ NULL,	"zlib-bench-threads N",	"number of zstd-mt compression threads in benchmark mode" },
 	{ NULL,	"zlib-level L",		"specify zlib compression level 0=fast, 9=best" },
 	{ NULL,	"zlib-mem-level L",	"specify zlib compression state memory usage 1=minimum, 9=maximum" },
 	{ NULL,	"zlib-method M",	"specify zlib random data generation method M" },
@@ -47,6 +50,19 @@ static const stress_help_t help[] = {
 
 #include "zlib.h"
 
+#if defined(HAVE_LIB_LZ4)
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+#if defined(HAVE_LIB_ZSTD)
+#include <zstd.h>
+#endif
+
+#if defined(HAVE_LIB_BZ2)
+#include <bzlib.h>
+#endif
+
 #define DATA_SIZE_64K 	(KB * 64)	/* Must be a multiple of 64 bytes */
 #define DATA_SIZE DATA_SIZE_64K
 
@@ -56,6 +72,13 @@ static const stress_help_t help[] = {
 #define ZLIB_MIN_MEM_LEVEL	(1)
 #define ZLIB_MAX_MEM_LEVEL	(9)
 
+#define ZLIB_BENCH_MIN_BYTES	(DATA_SIZE)
+#define ZLIB_BENCH_MAX_BYTES	(256 * MB)
+#define ZLIB_BENCH_DEFAULT_BYTES (2 * MB)
+
+#define ZLIB_BENCH_MIN_THREADS	(0)
+#define ZLIB_BENCH_MAX_THREADS	(256)
+
 typedef void (*stress_zlib_rand_data_func)(stress_args_t *args,
 	uint64_t *RESTRICT data, uint64_t *RESTRICT data_end);
 
@@ -1360,6 +1383,9 @@ static const char *stress_zlib_method(const size_t i)
 
 
 static const stress_opt_t opts[] = {
+	{ OPT_zlib_bench,        "zlib-bench",        TYPE_ID_BOOL, 0, 1, NULL },
+	{ OPT_zlib_bench_bytes,  "zlib-bench-bytes",  TYPE_ID_SIZE_T_BYTES_VM, ZLIB_BENCH_MIN_BYTES, ZLIB_BENCH_MAX_BYTES, NULL },
+	{ OPT_zlib_bench_threads, "zlib-bench-threads", TYPE_ID_UINT32, ZLIB_BENCH_MIN_THREADS, ZLIB_BENCH_MAX_THREADS, NULL },
 	{ OPT_zlib_level,        "zlib-level",        TYPE_ID_UINT32, ZLIB_MIN_COMPRESSION, ZLIB_MAX_COMPRESSION, NULL },
 	{ OPT_zlib_mem_level,    "zlib-mem-level",    TYPE_ID_UINT32, ZLIB_MIN_MEM_LEVEL, ZLIB_MAX_MEM_LEVEL, NULL },
 	{ OPT_zlib_method,       "zlib-method",       TYPE_ID_SIZE_T_METHOD, 0, 0, stress_zlib_method },
@@ -1744,6 +1770,583 @@ zlib_checksum_error:
 	return ret;
 }
 
+/*
+ *  Compression benchmark, compresses and decompresses buffers filled
+ *  by the zlib data generators with each of the available codecs
+ *  and levels, measuring throughput, ratio and ns per byte
+ */
+#define ZLIB_BENCH_DATA_TYPES	(SIZEOF_ARRAY(zlib_rand_data_methods))
+
+typedef struct stress_zlib_bench stress_zlib_bench_t;
+typedef struct stress_zlib_bench_codec stress_zlib_bench_codec_t;
+
+typedef int (*stress_zlib_bench_func_t)(stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec, const uint8_t *src,
+	const size_t src_len, uint8_t *dst, const size_t dst_size,
+	size_t *dst_len);
+
+struct stress_zlib_bench_codec {
+	const char *name;			/* codec name */
+	const int level;			/* compression level */
+	const stress_zlib_bench_func_t compress;   /* compress src to dst */
+	const stress_zlib_bench_func_t decompress; /* decompress src to dst */
+};
+
+typedef struct {
+	double comp_duration;			/* total compression time */
+	double decomp_duration;			/* total decompression time */
+	double bytes_in;			/* total uncompressed bytes */
+	double bytes_out;			/* total compressed bytes */
+} stress_zlib_bench_stats_t;
+
+struct stress_zlib_bench {
+	stress_zlib_args_t zlib_args;		/* zlib level, window bits etc */
+	bool zlib_level_set;			/* --zlib-level overrides zlib levels */
+	uint32_t threads;			/* zstd-mt worker threads */
+#if defined(HAVE_LIB_ZSTD)
+	ZSTD_CCtx *zstd_cctx;			/* reusable zstd compression context */
+	ZSTD_DCtx *zstd_dctx;			/* reusable zstd decompression context */
+#endif
+};
+
+static int stress_zlib_bench_deflate(stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec, const uint8_t *src,
+	const size_t src_len, uint8_t *dst, const size_t dst_size,
+	size_t *dst_len);
+
+/*
+ *  stress_zlib_bench_level()
+ *	compression level of a codec, zlib uses --zlib-level if set
+ */
+static int stress_zlib_bench_level(
+	const stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec)
+{
+	if (bench->zlib_level_set && (codec->compress == stress_zlib_bench_deflate))
+		return (int)bench->zlib_args.level;
+	return codec->level;
+}
+
+/*
+ *  stress_zlib_bench_deflate()
+ *	one shot deflate using the --zlib-* settings
+ */
+static int stress_zlib_bench_deflate(
+	stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_size,
+	size_t *dst_len)
+{
+	z_stream stream;
+	int32_t window_bits = bench->zlib_args.window_bits;
+	int ret;
+
+	/* default to zlib format if inflate auto detect has been used */
+	if (window_bits > 31)
+		window_bits -= 32;
+
+	(void)shim_memset(&stream, 0, sizeof(stream));
+	ret = deflateInit2(&stream, stress_zlib_bench_level(bench, codec), Z_DEFLATED, window_bits,
+		(int)bench->zlib_args.mem_level, (int)bench->zlib_args.strategy);
+	if (ret != Z_OK)
+		return -1;
+	stream.next_in = (unsigned char *)src;
+	stream.avail_in = (unsigned int)src_len;
+	stream.next_out = dst;
+	stream.avail_out = (unsigned int)dst_size;
+	ret = deflate(&stream, Z_FINISH);
+	*dst_len = (size_t)stream.total_out;
+	(void)deflateEnd(&stream);
+
+	return (ret == Z_STREAM_END) ? 0 : -1;
+}
+
+/*
+ *  stress_zlib_bench_inflate()
+ *	one shot inflate
+ */
+static int stress_zlib_bench_inflate(
+	stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_size,
+	size_t *dst_len)
+{
+	z_stream stream;
+	int ret;
+
+	(void)codec;
+
+	(void)shim_memset(&stream, 0, sizeof(stream));
+	ret = inflateInit2(&stream, bench->zlib_args.window_bits);
+	if (ret != Z_OK)
+		return -1;
+	stream.next_in = (unsigned char *)src;
+	stream.avail_in = (unsigned int)src_len;
+	stream.next_out = dst;
+	stream.avail_out = (unsigned int)dst_size;
+	ret = inflate(&stream, Z_FINISH);
+	*dst_len = (size_t)stream.total_out;
+	(void)inflateEnd(&stream);
+
+	return (ret == Z_STREAM_END) ? 0 : -1;
+}
+
+#if defined(HAVE_LIB_LZ4)
+/*
+ *  stress_zlib_bench_lz4_compress()
+ *	lz4 fast compression, HC compression for levels > 0
+ */
+static int stress_zlib_bench_lz4_compress(
+	stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_size,
+	size_t *dst_len)
+{
+	int ret;
+
+	(void)bench;
+
+	if (codec->level > 0)
+		ret = LZ4_compress_HC((const char *)src, (char *)dst,
+			(int)src_len, (int)dst_size, codec->level);
+	else
+		ret = LZ4_compress_default((const char *)src, (char *)dst,
+			(int)src_len, (int)dst_size);
+	if (ret <= 0)
+		return -1;
+	*dst_len = (size_t)ret;
+	return 0;
+}
+
+/*
+ *  stress_zlib_bench_lz4_decompress()
+ *	lz4 decompression
+ */
+static int stress_zlib_bench_lz4_decompress(
+	stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_size,
+	size_t *dst_len)
+{
+	int ret;
+
+	(void)bench;
+	(void)codec;
+
+	ret = LZ4_decompress_safe((const char *)src, (char *)dst,
+		(int)src_len, (int)dst_size);
+	if (ret < 0)
+		return -1;
+	*dst_len = (size_t)ret;
+	return 0;
+}
+#endif
+
+#if defined(HAVE_LIB_ZSTD)
+#define ZLIB_BENCH_ZSTD_LONG_WINDOW_LOG	(27)
+#define ZLIB_BENCH_ZSTD_MT_JOB_SIZE	(512 * KB)
+
+/*
+ *  stress_zlib_bench_zstd_compress_ctx()
+ *	zstd compression with optional long distance matching and
+ *	worker threads
+ */
+static int stress_zlib_bench_zstd_compress_ctx(
+	stress_zlib_bench_t *bench,
+	const int level,
+	const bool long_mode,
+	const int workers,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_size,
+	size_t *dst_len)
+{
+	ZSTD_CCtx *cctx = bench->zstd_cctx;
+	size_t ret;
+
+	(void)ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters);
+	if (ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level)))
+		return -1;
+	if (long_mode) {
+		if (ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_enableLongDistanceMatching, 1)))
+			return -1;
+		if (ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_windowLog, ZLIB_BENCH_ZSTD_LONG_WINDOW_LOG)))
+			return -1;
+	}
+	if (workers > 0) {
+		/* fails if libzstd is built without multithreading */
+		if (ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, workers)))
+			return -1;
+		(void)ZSTD_CCtx_setParameter(cctx, ZSTD_c_jobSize, ZLIB_BENCH_ZSTD_MT_JOB_SIZE);
+	}
+	ret = ZSTD_compress2(cctx, dst, dst_size, src, src_len);
+	if (ZSTD_isError(ret))
+		return -1;
+	*dst_len = ret;
+	return 0;
+}
+
+static int stress_zlib_bench_zstd_compress(
+	stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_size,
+	size_t *dst_len)
+{
+	return stress_zlib_bench_zstd_compress_ctx(bench, codec->level, false, 0,
+		src, src_len, dst, dst_size, dst_len);
+}
+
+static int stress_zlib_bench_zstd_long_compress(
+	stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_size,
+	size_t *dst_len)
+{
+	return stress_zlib_bench_zstd_compress_ctx(bench, codec->level, true, 0,
+		src, src_len, dst, dst_size, dst_len);
+}
+
+static int stress_zlib_bench_zstd_mt_compress(
+	stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_size,
+	size_t *dst_len)
+{
+	return stress_zlib_bench_zstd_compress_ctx(bench, codec->level, false,
+		(int)bench->threads, src, src_len, dst, dst_size, dst_len);
+}
+
+/*
+ *  stress_zlib_bench_zstd_decompress()
+ *	zstd decompression, allowing long mode window sizes
+ */
+static int stress_zlib_bench_zstd_decompress(
+	stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_size,
+	size_t *dst_len)
+{
+	size_t ret;
+
+	(void)codec;
+
+	ret = ZSTD_decompressDCtx(bench->zstd_dctx, dst, dst_size, src, src_len);
+	if (ZSTD_isError(ret))
+		return -1;
+	*dst_len = ret;
+	return 0;
+}
+#endif
+
+#if defined(HAVE_LIB_BZ2)
+/*
+ *  stress_zlib_bench_bzip2_compress()
+ *	bzip2 compression, level is the block size in 100K units
+ */
+static int stress_zlib_bench_bzip2_compress(
+	stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_size,
+	size_t *dst_len)
+{
+	unsigned int len = (unsigned int)dst_size;
+
+	(void)bench;
+
+	if (BZ2_bzBuffToBuffCompress((char *)dst, &len, (char *)src,
+			(unsigned int)src_len, codec->level, 0, 0) != BZ_OK)
+		return -1;
+	*dst_len = (size_t)len;
+	return 0;
+}
+
+/*
+ *  stress_zlib_bench_bzip2_decompress()
+ *	bzip2 decompression
+ */
+static int stress_zlib_bench_bzip2_decompress(
+	stress_zlib_bench_t *bench,
+	const stress_zlib_bench_codec_t *codec,
+	const uint8_t *src,
+	const size_t src_len,
+	uint8_t *dst,
+	const size_t dst_size,
+	size_t *dst_len)
+{
+	unsigned int len = (unsigned int)dst_size;
+
+	(void)bench;
+	(void)codec;
+
+	if (BZ2_bzBuffToBuffDecompress((char *)dst, &len, (char *)src,
+			(unsigned int)src_len, 0, 0) != BZ_OK)
+		return -1;
+	*dst_len = (size_t)len;
+	return 0;
+}
+#endif
+
+static const stress_zlib_bench_codec_t zlib_bench_codecs[] = {
+	{ "zlib",	1,	stress_zlib_bench_deflate,		stress_zlib_bench_inflate },
+	{ "zlib",	6,	stress_zlib_bench_deflate,		stress_zlib_bench_inflate },
+	{ "zlib",	9,	stress_zlib_bench_deflate,		stress_zlib_bench_inflate },
+#if defined(HAVE_LIB_LZ4)
+	{ "lz4",	0,	stress_zlib_bench_lz4_compress,		stress_zlib_bench_lz4_decompress },
+	{ "lz4hc",	LZ4HC_CLEVEL_DEFAULT, stress_zlib_bench_lz4_compress, stress_zlib_bench_lz4_decompress },
+	{ "lz4hc",	LZ4HC_CLEVEL_MAX, stress_zlib_bench_lz4_compress, stress_zlib_bench_lz4_decompress },
+#endif
+#if defined(HAVE_LIB_ZSTD)
+	{ "zstd",	1,	stress_zlib_bench_zstd_compress,	stress_zlib_bench_zstd_decompress },
+	{ "zstd",	3,	stress_zlib_bench_zstd_compress,	stress_zlib_bench_zstd_decompress },
+	{ "zstd",	9,	stress_zlib_bench_zstd_compress,	stress_zlib_bench_zstd_decompress },
+	{ "zstd",	19,	stress_zlib_bench_zstd_compress,	stress_zlib_bench_zstd_decompress },
+	{ "zstd-long",	3,	stress_zlib_bench_zstd_long_compress,	stress_zlib_bench_zstd_decompress },
+	{ "zstd-long",	19,	stress_zlib_bench_zstd_long_compress,	stress_zlib_bench_zstd_decompress },
+	{ "zstd-mt",	3,	stress_zlib_bench_zstd_mt_compress,	stress_zlib_bench_zstd_decompress },
+	{ "zstd-mt",	19,	stress_zlib_bench_zstd_mt_compress,	stress_zlib_bench_zstd_decompress },
+#endif
+#if defined(HAVE_LIB_BZ2)
+	{ "bzip2",	1,	stress_zlib_bench_bzip2_compress,	stress_zlib_bench_bzip2_decompress },
+	{ "bzip2",	9,	stress_zlib_bench_bzip2_compress,	stress_zlib_bench_bzip2_decompress },
+#endif
+};
+
+#define ZLIB_BENCH_CODECS	(SIZEOF_ARRAY(zlib_bench_codecs))
+
+/*
+ *  stress_zlib_bench_report()
+ *	report per codec, level and data type results, metrics are
+ *	per codec and level over all the data types
+ */
+static void stress_zlib_bench_report(
+	stress_args_t *args,
+	const stress_zlib_bench_t *bench,
+	stress_zlib_bench_stats_t stats[ZLIB_BENCH_CODECS][ZLIB_BENCH_DATA_TYPES])
+{
+	size_t c, d, idx = 0;
+	const bool report = stress_instance_zero(args);
+
+	if (report) {
+		pr_block_begin();
+		pr_inf("%s: %-10s %5s %-12s %11s %11s %9s %11s %11s\n",
+			args->name, "codec", "level", "data", "comp MB/s",
+			"decomp MB/s", "ratio", "comp ns/B", "decomp ns/B");
+	}
+	for (c = 0; c < ZLIB_BENCH_CODECS; c++) {
+		const stress_zlib_bench_codec_t *codec = &zlib_bench_codecs[c];
+		const int level = stress_zlib_bench_level(bench, codec);
+		stress_zlib_bench_stats_t total;
+		char str[64];
+
+		(void)shim_memset(&total, 0, sizeof(total));
+		for (d = 0; d < ZLIB_BENCH_DATA_TYPES; d++) {
+			const stress_zlib_bench_stats_t *s = &stats[c][d];
+
+			if ((s->comp_duration <= 0.0) || (s->decomp_duration <= 0.0) || (s->bytes_out <= 0.0))
+				continue;
+			total.comp_duration += s->comp_duration;
+			total.decomp_duration += s->decomp_duration;
+			total.bytes_in += s->bytes_in;
+			total.bytes_out += s->bytes_out;
+			if (report)
+				pr_inf("%s: %-10s %5d %-12s %11.2f %11.2f %9.3f %11.3f %11.3f\n",
+					args->name, codec->name, level,
+					zlib_rand_data_methods[d].name,
+					(s->bytes_in / s->comp_duration) / MB,
+					(s->bytes_in / s->decomp_duration) / MB,
+					s->bytes_in / s->bytes_out,
+					STRESS_DBL_NANOSECOND * s->comp_duration / s->bytes_in,
+					STRESS_DBL_NANOSECOND * s->decomp_duration / s->bytes_in);
+		}
+		if ((total.comp_duration <= 0.0) || (total.decomp_duration <= 0.0) || (total.bytes_out <= 0.0))
+			continue;
+		(void)snprintf(str, sizeof(str), "%s-%d compress MB per sec", codec->name, level);
+		stress_metrics_set(args, idx++, str,
+			(total.bytes_in / total.comp_duration) / MB, STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s-%d decompress MB per sec", codec->name, level);
+		stress_metrics_set(args, idx++, str,
+			(total.bytes_in / total.decomp_duration) / MB, STRESS_METRIC_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s-%d compression ratio", codec->name, level);
+		stress_metrics_set(args, idx++, str,
+			total.bytes_in / total.bytes_out, STRESS_METRIC_GEOMETRIC_MEAN);
+	}
+	if (report)
+		pr_block_end();
+}
+
+/*
+ *  stress_zlib_bench()
+ *	compression codec throughput benchmark
+ */
+static int stress_zlib_bench(stress_args_t *args)
+{
+	static stress_zlib_bench_stats_t stats[ZLIB_BENCH_CODECS][ZLIB_BENCH_DATA_TYPES];
+	stress_zlib_bench_t bench;
+	size_t bench_bytes = ZLIB_BENCH_DEFAULT_BYTES, buf_size, out_size, d, c;
+	uint8_t *buf, *src, *comp, *decomp;
+	bool codec_failed[ZLIB_BENCH_CODECS];
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	int rc = EXIT_SUCCESS;
+
+	(void)shim_memset(&bench, 0, sizeof(bench));
+	stress_zlib_get_args(&bench.zlib_args);
+	bench.zlib_level_set = stress_get_setting("zlib-level", &bench.zlib_args.level);
+	(void)stress_get_setting("zlib-bench-bytes", &bench_bytes);
+	bench_bytes &= ~(size_t)(DATA_SIZE - 1);
+	if (bench_bytes < DATA_SIZE)
+		bench_bytes = DATA_SIZE;
+	if (!stress_get_setting("zlib-bench-threads", &bench.threads) || (bench.threads == 0)) {
+		const int32_t cpus = stress_get_processors_online();
+		const uint32_t instances = (args->instances > 0) ? args->instances : 1;
+
+		bench.threads = (cpus > 0) ? (uint32_t)cpus / instances : 1;
+	}
+	if (bench.threads < 1)
+		bench.threads = 1;
+
+	/* source, compressed and decompressed buffers, worst case bzip2 bound is 101% + 600 */
+	out_size = bench_bytes + (bench_bytes / 16) + DATA_SIZE;
+	buf_size = bench_bytes + out_size + bench_bytes;
+	buf = (uint8_t *)stress_mmap_populate(NULL, buf_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu byte buffer%s, errno=%d (%s), "
+			"skipping stressor\n", args->name, buf_size,
+			stress_get_memfree_str(), errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(buf, buf_size, "zlib-bench-data");
+	src = buf;
+	comp = src + bench_bytes;
+	decomp = comp + out_size;
+
+#if defined(HAVE_LIB_ZSTD)
+	bench.zstd_cctx = ZSTD_createCCtx();
+	bench.zstd_dctx = ZSTD_createDCtx();
+	if (!bench.zstd_cctx || !bench.zstd_dctx) {
+		pr_inf_skip("%s: failed to create zstd contexts, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_zstd;
+	}
+	(void)ZSTD_DCtx_setParameter(bench.zstd_dctx, ZSTD_d_windowLogMax, ZLIB_BENCH_ZSTD_LONG_WINDOW_LOG);
+#endif
+	if (stress_instance_zero(args))
+		pr_dbg("%s: benchmarking %zu codec levels on %zu byte buffers, %" PRIu32 " zstd-mt thread%s\n",
+			args->name, ZLIB_BENCH_CODECS, bench_bytes, bench.threads,
+			(bench.threads == 1) ? "" : "s");
+
+	(void)shim_memset(stats, 0, sizeof(stats));
+	(void)shim_memset(codec_failed, 0, sizeof(codec_failed));
+
+	stress_set_proc_state(args->name, STRESS_STATE_SYNC_WAIT);
+	stress_sync_start_wait(args);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+
+	do {
+		/* index 0 is the random method, all other data types are swept */
+		for (d = 1; d < ZLIB_BENCH_DATA_TYPES; d++) {
+			size_t i;
+
+			if ((bench.zlib_args.method != 0) && (bench.zlib_args.method != d))
+				continue;
+			for (i = 0; i < bench_bytes; i += DATA_SIZE)
+				zlib_rand_data_methods[d].func(args, (uint64_t *)(src + i),
+					(uint64_t *)(src + i + DATA_SIZE));
+
+			for (c = 0; c < ZLIB_BENCH_CODECS; c++) {
+				const stress_zlib_bench_codec_t *codec = &zlib_bench_codecs[c];
+				size_t comp_len = 0, decomp_len = 0;
+				double t1, t2, t3;
+
+				if (UNLIKELY(!stress_continue(args)))
+					goto finish;
+				if (codec_failed[c])
+					continue;
+				/* with --zlib-level just the first zlib codec runs, at that level */
+				if (bench.zlib_level_set && (c > 0) &&
+				    (codec->compress == stress_zlib_bench_deflate) &&
+				    (zlib_bench_codecs[c - 1].compress == stress_zlib_bench_deflate))
+					continue;
+
+				t1 = stress_time_now();
+				if (codec->compress(&bench, codec, src, bench_bytes, comp, out_size, &comp_len) < 0) {
+					if (stress_instance_zero(args))
+						pr_inf("%s: %s level %d compression failed, skipping codec\n",
+							args->name, codec->name, stress_zlib_bench_level(&bench, codec));
+					codec_failed[c] = true;
+					continue;
+				}
+				t2 = stress_time_now();
+				if (codec->decompress(&bench, codec, comp, comp_len, decomp, bench_bytes, &decomp_len) < 0) {
+					pr_fail("%s: %s level %d decompression of %s data failed\n",
+						args->name, codec->name, stress_zlib_bench_level(&bench, codec),
+						zlib_rand_data_methods[d].name);
+					rc = EXIT_FAILURE;
+					goto finish;
+				}
+				t3 = stress_time_now();
+
+				if (verify && ((decomp_len != bench_bytes) ||
+					       (shim_memcmp(src, decomp, bench_bytes) != 0))) {
+					pr_fail("%s: %s level %d decompressed %s data does not match original data\n",
+						args->name, codec->name, stress_zlib_bench_level(&bench, codec),
+						zlib_rand_data_methods[d].name);
+					rc = EXIT_FAILURE;
+					goto finish;
+				}
+				stats[c][d].comp_duration += t2 - t1;
+				stats[c][d].decomp_duration += t3 - t2;
+				stats[c][d].bytes_in += (double)bench_bytes;
+				stats[c][d].bytes_out += (double)comp_len;
+				stress_bogo_inc(args);
+			}
+		}
+	} while (stress_continue(args));
+
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	stress_zlib_bench_report(args, &bench, stats);
+
+#if defined(HAVE_LIB_ZSTD)
+free_zstd:
+	if (bench.zstd_dctx)
+		(void)ZSTD_freeDCtx(bench.zstd_dctx);
+	if (bench.zstd_cctx)
+		(void)ZSTD_freeCCtx(bench.zstd_cctx);
+#endif
+	(void)munmap((void *)buf, buf_size);
+
+	return rc;
+}
+
 /*
  *  stress_zlib()
  *	stress cpu with compression and decompression
@@ -1755,9 +2358,14 @@ static int stress_zlib(stress_args_t *args)
 	bool error = false;
 	bool interrupted = false;
 	stress_zlib_shared_checksums_t *shared_checksums;
+	bool zlib_bench = false;
 
 	stress_catch_sigill();
 
+	(void)stress_get_setting("zlib-bench", &zlib_bench);
+	if (zlib_bench)
+		return stress_zlib_bench(args);
+
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
 
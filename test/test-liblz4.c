@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2025      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include <lz4.h>
+#include <lz4hc.h>
+
+int main(void)
+{
+	static char src[1024], dst[LZ4_COMPRESSBOUND(1024)];
+	int ret;
+
+	ret = LZ4_compress_default(src, dst, sizeof(src), sizeof(dst));
+	ret += LZ4_compress_HC(src, dst, sizeof(src), sizeof(dst), LZ4HC_CLEVEL_DEFAULT);
+	ret += LZ4_decompress_safe(dst, src, ret, sizeof(src));
+
+	return ret;
+}
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2025      Colin Ian King
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include <immintrin.h>
+#include <stdint.h>
+
+static uint8_t cfg[64];
+static uint16_t a[16 * 32], b[16 * 32];
+static float c[16 * 16];
+
+int __attribute__ ((target("amx-tile,amx-bf16"))) main(int argc, char **argv)
+{
+	(void)argc;
+	(void)argv;
+
+	cfg[0] = 1;
+	_tile_loadconfig(cfg);
+	_tile_zero(0);
+	_tile_loadd(1, a, 64);
+	_tile_loadd(2, b, 64);
+	_tile_dpbf16ps(0, 1, 2);
+	_tile_stored(0, c, 64);
+	_tile_release();
+
+	return (int)c[0];
+}